@@ -0,0 +1,182 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+#include "capture.h"
+
+#define CAPTURE_MASK (CAPTURE_FRAMES - 1)
+
+void initCaptureBuffer(CaptureBuffer *cap, const uint32_t pre, const uint32_t post, const uint32_t trigger_mask, const int maxpixel_limit)
+{
+  memset(cap, 0, sizeof(CaptureBuffer));
+  cap->post = post < CAPTURE_FRAMES ? post : CAPTURE_FRAMES - 1;
+  cap->pre = pre + 1 + cap->post <= CAPTURE_FRAMES ? pre : CAPTURE_FRAMES - 1 - cap->post;
+  cap->trigger_mask = trigger_mask;
+  cap->maxpixel_limit = maxpixel_limit;
+  cap->state = CAPTURE_ARMED;
+}
+
+void captureFrame(CaptureBuffer *cap, const uint8_t frame_bytes[FRAME_READER_FRAME_BYTES], const uint32_t timestamp_us, const uint32_t frame)
+{
+  if (cap->state == CAPTURE_FROZEN) {
+    return;
+  }
+  CaptureRecord *record = &cap->records[cap->head & CAPTURE_MASK];
+  record->timestamp_us = timestamp_us;
+  record->frame = frame;
+  memcpy(record->data, frame_bytes, FRAME_READER_FRAME_BYTES);
+  cap->head++;
+
+  if (cap->state == CAPTURE_TRIGGERED && --cap->remaining == 0) {
+    cap->state = CAPTURE_FROZEN;
+  }
+}
+
+void checkCaptureTriggers(CaptureBuffer *cap, const uint32_t state, const int maxpixel)
+{
+  if ((cap->trigger_mask & CAPTURE_ON_STATE) && state != cap->last_gesture_state) {
+    triggerCapture(cap, CAPTURE_CAUSE_STATE);
+  }
+  else if ((cap->trigger_mask & CAPTURE_ON_MAXPIXEL) && maxpixel >= cap->maxpixel_limit) {
+    triggerCapture(cap, CAPTURE_CAUSE_MAXPIXEL);
+  }
+  cap->last_gesture_state = state;
+}
+
+int triggerCapture(CaptureBuffer *cap, const CaptureCause cause)
+{
+  // The trigger frame must be one recorded since the capture was armed, which the dump starts with
+  if (cap->state != CAPTURE_ARMED || cap->head <= cap->arm_head) {
+    return 0;
+  }
+  cap->cause = cause;
+  cap->trigger_head = cap->head;
+  cap->remaining = cap->post;
+  cap->state = cap->post ? CAPTURE_TRIGGERED : CAPTURE_FROZEN;
+  cap->triggers++;
+  return 1;
+}
+
+void armCapture(CaptureBuffer *cap)
+{
+  cap->arm_head = cap->head;
+  cap->state = CAPTURE_ARMED;
+  cap->cause = CAPTURE_CAUSE_NONE;
+}
+
+unsigned int getCaptureDump(const CaptureBuffer *cap, uint8_t header[CAPTURE_DUMP_HEADER_BYTES], const CaptureRecord *runs[2], unsigned int counts[2], uint8_t *checksum)
+{
+  // Without a trigger the whole ring is dumped, up to the frame recorded last
+  uint32_t start = cap->head > CAPTURE_FRAMES ? cap->head - CAPTURE_FRAMES : 0;
+  uint32_t trigger = cap->head ? cap->head - 1 : 0;
+  if (cap->state != CAPTURE_ARMED) {
+    trigger = cap->trigger_head - 1;
+    start = trigger > cap->pre ? trigger - cap->pre : 0;
+  }
+  if (start < cap->arm_head) {
+    start = cap->arm_head; // The frames before the freeze do not continue into the new ones
+  }
+  const unsigned int count = cap->head - start;
+  const unsigned int trigger_record = count ? trigger - start : 0;
+
+  header[0] = 0xFF;
+  header[1] = CAPTURE_DUMP_SYNC;
+  header[2] = (uint8_t)cap->cause;
+  header[3] = CAPTURE_DUMP_VERSION;
+  header[4] = count & 0xFF;
+  header[5] = count >> 8;
+  header[6] = trigger_record & 0xFF;
+  header[7] = trigger_record >> 8;
+
+  const unsigned int first = start & CAPTURE_MASK;
+  runs[0] = &cap->records[first];
+  counts[0] = count < CAPTURE_FRAMES - first ? count : CAPTURE_FRAMES - first;
+  runs[1] = &cap->records[0];
+  counts[1] = count - counts[0];
+
+  uint8_t sum = 0;
+  for (unsigned int i = 2; i < CAPTURE_DUMP_HEADER_BYTES; i++) {
+    sum += header[i];
+  }
+  for (unsigned int r = 0; r < 2; r++) {
+    const uint8_t *bytes = (const uint8_t *)runs[r];
+    for (unsigned long i = 0; i < (unsigned long)counts[r] * CAPTURE_RECORD_BYTES; i++) {
+      sum += bytes[i];
+    }
+  }
+  *checksum = sum;
+  return count;
+}
+
+static uint32_t getLe32(const uint8_t *src)
+{
+  return (uint32_t)src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+int decodeCaptureDump(const uint8_t *data, const unsigned long length, CaptureDump *dump)
+{
+  for (unsigned long pos = 0; pos + CAPTURE_DUMP_HEADER_BYTES + 1 <= length; pos++) {
+    const uint8_t *header = data + pos;
+    if (header[0] != 0xFF || header[1] != CAPTURE_DUMP_SYNC || header[3] != CAPTURE_DUMP_VERSION) {
+      continue;
+    }
+    const unsigned int count = header[4] | (header[5] << 8);
+    const unsigned int trigger = header[6] | (header[7] << 8);
+    const unsigned long total = CAPTURE_DUMP_HEADER_BYTES + (unsigned long)count * CAPTURE_RECORD_BYTES + 1;
+    if (pos + total > length || (count && trigger >= count)) {
+      continue;
+    }
+    uint8_t sum = 0;
+    for (unsigned long i = 2; i < total - 1; i++) {
+      sum += header[i];
+    }
+    if (sum != header[total - 1]) {
+      continue;
+    }
+    dump->cause = header[2];
+    dump->num_records = count;
+    dump->trigger_record = trigger;
+    dump->records = header + CAPTURE_DUMP_HEADER_BYTES;
+    return 0;
+  }
+  return -1;
+}
+
+const uint8_t * getCaptureDumpRecord(const CaptureDump *dump, const unsigned int index, uint32_t *timestamp_us, uint32_t *frame)
+{
+  const uint8_t *record = dump->records + (unsigned long)index * CAPTURE_RECORD_BYTES;
+  *timestamp_us = getLe32(record);
+  *frame = getLe32(record + 4);
+  return record + 8;
+}
@@ -0,0 +1,239 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+#ifndef CAPTURE_H_INCLUDED
+#define CAPTURE_H_INCLUDED
+
+#include "frame_reader.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+* Pre/post-trigger capture of raw sensor frames, for reproducing problems seen in the field.
+*
+* Every frame read from the sensor is copied as it came from the bus (the bytes of the frame slot, before any
+* conversion) into a ring of CAPTURE_FRAMES records; this copy is the only cost per frame. A trigger (a change
+* of the gesture state, a max pixel at or above a limit, or a command) keeps the pre frames before the trigger
+* frame, records post more frames and then freezes the ring until it is armed again, so the frozen frames can
+* be dumped and replayed on a host (gesture_replay -d).
+*
+* Dump format, one binary message:
+*   byte   field
+*   0      0xFF       sync
+*   1      0x43       CAPTURE_DUMP_SYNC
+*   2      cause      CaptureCause
+*   3      version    CAPTURE_DUMP_VERSION
+*   4      records    number of records, 16-bit little-endian
+*   6      trigger    index of the trigger record, 16-bit little-endian
+*   8      records    CAPTURE_RECORD_BYTES each, oldest first: timestamp_us and frame number as 32-bit
+*                     little-endian (FrameSlot fields), then FRAME_READER_FRAME_BYTES of pixel data
+*   last   checksum   8-bit sum of all bytes after the sync bytes
+*/
+#ifndef CAPTURE_FRAMES
+#define CAPTURE_FRAMES 64                                 // Ring size, a power of two
+#endif
+#define CAPTURE_DUMP_SYNC 0x43
+#define CAPTURE_DUMP_VERSION 1
+#define CAPTURE_DUMP_HEADER_BYTES 8
+#define CAPTURE_RECORD_BYTES (8 + FRAME_READER_FRAME_BYTES)
+
+// Trigger mask bits
+#define CAPTURE_ON_STATE 0x01                             // The gesture state changed
+#define CAPTURE_ON_MAXPIXEL 0x02                          // The max pixel reached the limit
+
+typedef enum {
+  CAPTURE_CAUSE_NONE,
+  CAPTURE_CAUSE_COMMAND,
+  CAPTURE_CAUSE_STATE,
+  CAPTURE_CAUSE_MAXPIXEL
+} CaptureCause;
+
+typedef enum {
+  CAPTURE_ARMED,                                          // Recording, waiting for a trigger
+  CAPTURE_TRIGGERED,                                      // Recording the frames after the trigger
+  CAPTURE_FROZEN                                          // Complete, not recording
+} CaptureState;
+
+// One frame. The layout is the dump record on little-endian targets, so the dump is sent straight from the ring
+typedef struct {
+  uint32_t timestamp_us;
+  uint32_t frame;
+  uint8_t data[FRAME_READER_FRAME_BYTES];
+} CaptureRecord;
+
+typedef struct {
+  CaptureRecord records[CAPTURE_FRAMES];
+  uint32_t head;                        // Records written
+  uint32_t arm_head;                    // head when the capture was last armed
+
+  // Settings
+  uint32_t pre;                         // Frames kept before the trigger frame
+  uint32_t post;                        // Frames recorded after the trigger frame
+  uint32_t trigger_mask;                // CAPTURE_ON_ bits
+  int maxpixel_limit;
+
+  uint32_t state;                       // CaptureState
+  uint32_t cause;                       // CaptureCause of the trigger
+  uint32_t trigger_head;                // head just after the trigger record
+  uint32_t remaining;                   // Frames still to record after the trigger
+  uint32_t last_gesture_state;
+  uint32_t triggers;                    // Triggers since initialization
+} CaptureBuffer;
+
+// A dump decoded by decodeCaptureDump. The records point into the dump data
+typedef struct {
+  uint32_t cause;
+  unsigned int num_records;
+  unsigned int trigger_record;
+  const uint8_t *records;
+} CaptureDump;
+
+/**
+* This function initializes a capture buffer, armed and empty.
+*
+* Parameters
+* cap:            A pointer to a CaptureBuffer structure
+* pre:            Frames kept before the trigger frame
+* post:           Frames recorded after the trigger frame. pre + 1 + post is limited to CAPTURE_FRAMES by
+*                 reducing pre
+* trigger_mask:   CAPTURE_ON_ bits of the automatic triggers
+* maxpixel_limit: Max pixel that triggers with CAPTURE_ON_MAXPIXEL
+*
+* Return Value
+* None
+*/
+void initCaptureBuffer(CaptureBuffer *cap, const uint32_t pre, const uint32_t post, const uint32_t trigger_mask, const int maxpixel_limit);
+
+/**
+* This function records a frame, unless the buffer is frozen. Called for every frame read, in order.
+*
+* Parameters
+* cap:          A pointer to the CaptureBuffer
+* frame_bytes:  FRAME_READER_FRAME_BYTES of pixel data as read from the sensor
+* timestamp_us: Data ready time of the frame
+* frame:        Frame number
+*
+* Return Value
+* None
+*/
+void captureFrame(CaptureBuffer *cap, const uint8_t frame_bytes[FRAME_READER_FRAME_BYTES], const uint32_t timestamp_us, const uint32_t frame);
+
+/**
+* This function checks the automatic triggers with the result of the frame recorded last.
+*
+* Parameters
+* cap:      A pointer to the CaptureBuffer
+* state:    Gesture state of the frame
+* maxpixel: Max pixel of the frame
+*
+* Return Value
+* None
+*/
+void checkCaptureTriggers(CaptureBuffer *cap, const uint32_t state, const int maxpixel);
+
+/**
+* This function triggers the capture at the frame recorded last, if it is armed and a frame was recorded since.
+*
+* Parameters
+* cap:   A pointer to the CaptureBuffer
+* cause: CaptureCause reported in the dump
+*
+* Return Value
+* 1 if triggered, 0 if the capture was already triggered or frozen, or no frame was recorded since it was armed
+*/
+int triggerCapture(CaptureBuffer *cap, const CaptureCause cause);
+
+/**
+* This function arms the capture again after a trigger. The next capture starts with the next frame.
+*
+* Parameters
+* cap: A pointer to the CaptureBuffer
+*
+* Return Value
+* None
+*/
+void armCapture(CaptureBuffer *cap);
+
+/**
+* This function prepares the dump of a capture: the header, the records as at most two runs of the ring, and
+* the checksum. The records are sent as they are, CAPTURE_RECORD_BYTES each.
+*
+* Parameters
+* cap:      A pointer to the CaptureBuffer
+* header:   Receives the CAPTURE_DUMP_HEADER_BYTES header
+* runs:     Receives the first record of each run
+* counts:   Receives the number of records in each run (the second may be 0)
+* checksum: Receives the checksum byte
+*
+* Return Value
+* Number of records
+*/
+unsigned int getCaptureDump(const CaptureBuffer *cap, uint8_t header[CAPTURE_DUMP_HEADER_BYTES], const CaptureRecord *runs[2], unsigned int counts[2], uint8_t *checksum);
+
+/**
+* This function finds and checks a dump in received data.
+*
+* Parameters
+* data:   Received data, which may contain other bytes before the dump
+* length: Length of data
+* dump:   Receives the dump
+*
+* Return Value
+* 0 if a complete dump with a valid checksum was found, -1 otherwise
+*/
+int decodeCaptureDump(const uint8_t *data, const unsigned long length, CaptureDump *dump);
+
+/**
+* This function obtains a record of a decoded dump.
+*
+* Parameters
+* dump:         A pointer to the CaptureDump
+* index:        Record index, less than dump->num_records
+* timestamp_us: Receives the data ready time of the frame
+* frame:        Receives the frame number
+*
+* Return Value
+* Pointer to the FRAME_READER_FRAME_BYTES of pixel data, for frameBytesToPixels
+*/
+const uint8_t * getCaptureDumpRecord(const CaptureDump *dump, const unsigned int index, uint32_t *timestamp_us, uint32_t *frame);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
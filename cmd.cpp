@@ -41,6 +41,11 @@
 #include "interface.h"
 #include "gesture_lib.h"
 #include "config.h"
+#include "frame_reader.h"
+#include "cmd_packet.h"
+#include "profiler.h"
+#include "frame_rate.h"
+#include "capture.h"
 
 extern const char *version_string;
 
@@ -62,10 +67,15 @@ commandTable cmdTable[] =
   {"help","Display help.", cmd_help},
   {"ver","Display firmware version", cmd_ver},
   {"reg", "reg <read/write> <addr> <num/value>. Read or write to a device register.", cmd_reg},
-  {"stream", "stream <on/off> [nopixels]. Enable data streaming mode. Use nopixels parameter to suppress pixel data.", cmd_stream},
+  {"stream", "stream <on/off> [nopixels] [v2/v2delta]. Enable data streaming mode. Use nopixels parameter to suppress pixel data, v2 or v2delta for the compact frame format.", cmd_stream},
   {"forcecal", "Force bias calibration (tracking mode).", cmd_force_tracking_cal},
   {"reset", "reset device register settings.", cmd_reset},
   {"poll", "Request gesture results", cmd_poll},
+  {"txq", "txq [policy <oldest/newest/block>] [hold <us>]. Report the data stream transmit queue counters, or set the policy when full and the partial block hold time.", cmd_txq},
+  {"stats", "stats [reset]. Report the time taken by each stage of the frame pipeline (count, min, mean, max and 99th percentile), or clear it. Requires a build with GESTURE_PROFILE=1.", cmd_stats},
+  {"frames", "Report frame acquisition counters: interrupts, frames read and processed, overruns, drops, ring use and latency.", cmd_frames},
+  {"capture", "capture [trigger/arm/dump] [pre <n>] [post <n>] [state <on/off>] [maxpixel <limit/off>]. Report the raw frame capture, trigger it, arm it again, send the frozen frames as one binary dump, or set the frames kept and the automatic triggers.", cmd_capture},
+  {"rate", "rate [auto/fast/slow]. Report the sensor frame rate mode, sample delay, measured sample period and number of rate changes, or set the mode.", cmd_rate},
   {CMD_TABLE_END, "", NULL} // last command must be NULL
 };
 
@@ -106,6 +116,56 @@ int lookupCmd(const char *str)
   }
 }
 
+// Binary commands, indexed by opcode. Each writes its response payload and returns a cmd_status
+typedef uint8_t (*binCmdHandler)(const uint8_t *payload, const uint8_t length, uint8_t *response, uint8_t *response_length);
+
+static uint8_t bin_ping(const uint8_t *payload, const uint8_t length, uint8_t *response, uint8_t *response_length);
+static uint8_t bin_ver(const uint8_t *payload, const uint8_t length, uint8_t *response, uint8_t *response_length);
+static uint8_t bin_poll(const uint8_t *payload, const uint8_t length, uint8_t *response, uint8_t *response_length);
+static uint8_t bin_reg_read(const uint8_t *payload, const uint8_t length, uint8_t *response, uint8_t *response_length);
+static uint8_t bin_reg_write(const uint8_t *payload, const uint8_t length, uint8_t *response, uint8_t *response_length);
+static uint8_t bin_stream(const uint8_t *payload, const uint8_t length, uint8_t *response, uint8_t *response_length);
+static uint8_t bin_frames(const uint8_t *payload, const uint8_t length, uint8_t *response, uint8_t *response_length);
+static uint8_t bin_txq(const uint8_t *payload, const uint8_t length, uint8_t *response, uint8_t *response_length);
+
+static const binCmdHandler binCmdTable[CMD_OP_COUNT] =
+{
+  NULL,           // opcode 0 is not used
+  bin_ping,       // CMD_OP_PING
+  bin_ver,        // CMD_OP_VERSION
+  bin_poll,       // CMD_OP_POLL
+  bin_reg_read,   // CMD_OP_REG_READ
+  bin_reg_write,  // CMD_OP_REG_WRITE
+  bin_stream,     // CMD_OP_STREAM
+  bin_frames,     // CMD_OP_FRAMES
+  bin_txq         // CMD_OP_TXQ
+};
+
+static CmdPacketParser cmdPacketParser;
+
+// Runs a complete binary request and queues its response on the data stream, in order with the stream frames.
+// The response is never dropped, whatever the policy of the queue: it waits for room
+static void processCmdPacket(const CmdPacketParser *parser, const int valid)
+{
+  static uint8_t response[CMD_RESPONSE_MAX_BYTES];
+  uint8_t length = 0;
+  uint8_t status;
+
+  if (!valid) {
+    status = CMD_STATUS_BAD_CHECKSUM;
+  }
+  else if (parser->opcode >= CMD_OP_COUNT || binCmdTable[parser->opcode] == NULL) {
+    status = CMD_STATUS_BAD_OPCODE;
+  }
+  else {
+    status = binCmdTable[parser->opcode](parser->payload, parser->length, response + CMD_RESPONSE_HEADER_BYTES, &length);
+  }
+  if (status != CMD_STATUS_OK) {
+    length = 0;
+  }
+  sendCmdResponse(response, finishCmdResponse(response, parser->opcode, status, length));
+}
+
 // Custom implementation of polling of serial port
 // to build a command string and pass it to processCmdString()
 int checkUserCmd()
@@ -115,19 +175,32 @@ int checkUserCmd()
   int status = 0;
   while ((*serial).readable()) {
     char ch = (char)(*serial).getc();
-    if (ch == 0x08 && index > 0) { // got a backspace, delete the previous character
+    const uint32_t now_us = us_ticker_read();
+    // A sync byte at the start of a line begins a binary request; it is collected until complete, or until its
+    // bytes stop arriving
+    if (cmdPacketInProgress(&cmdPacketParser, now_us) || (index == 0 && (uint8_t)ch == CMD_PACKET_SYNC)) {
+      int result = parseCmdPacketByte(&cmdPacketParser, (uint8_t)ch, now_us);
+      if (result != 0) {
+        processCmdPacket(&cmdPacketParser, result > 0);
+        status = 1;
+      }
+    }
+    else if (ch == 0x08 && index > 0) { // got a backspace, delete the previous character
       index--;
     }
     else if (ch == '\r') {/*ignore*/}
     else if (ch == '\n') {    // Command string is ready to be processed
       cmdString[index] = 0;   // NULL terminate the string
       index = 0;              // reset the index
+      flushDataStream();      // command output goes directly to the port; keep it between whole frames
       if (processCmdString(cmdString) == CMD_NACK) {
         (*serial).printf("Invalid command received: %s\n", cmdString);
       }
       else {
         status = 1;
       }
+      serialOutputWritten();
+      flushDataStream();      // replies queued by the command are never dropped
     }
     else {
         cmdString[index++] = ch;
@@ -216,18 +289,23 @@ int cmd_stream(char *toks[], const unsigned int tokCount)
   }
   char * enable_stream = toks[1];
   if (strcmp(enable_stream, "on") == 0) {
-    if (tokCount > 2) {
-      char * no_data_parameter = toks[2];
-      if (strcmp(no_data_parameter, "nopixels") == 0) {
-        set_stream_on(0);
+    uint32_t send_pixel_data = 1;
+    uint32_t format = STREAM_FORMAT_V1;
+    for (unsigned int i = 2; i < tokCount; i++) {
+      if (strcmp(toks[i], "nopixels") == 0) {
+        send_pixel_data = 0;
+      }
+      else if (strcmp(toks[i], "v2") == 0) {
+        format = STREAM_FORMAT_V2;
+      }
+      else if (strcmp(toks[i], "v2delta") == 0) {
+        format = STREAM_FORMAT_V2_DELTA;
       }
       else {
         return CMD_NACK;
       }
     }
-    else {
-      set_stream_on(1);
-    }
+    set_stream_on(send_pixel_data, format);
   }
   else if (strcmp(enable_stream, "off") == 0) {
     set_stream_off();
@@ -264,12 +342,237 @@ int cmd_reset(char *toks[], const unsigned int tokCount)
   return CMD_ACK;
 }
 
+extern FrameReader frameReader;
+int cmd_frames(char *toks[], const unsigned int tokCount)
+{
+  FrameReaderStats stats;
+  getFrameReaderStats(&frameReader, &stats);
+  (*serial).printf("data_ready=%lu read=%lu processed=%lu overruns=%lu dropped=%lu queued=%lu max_queued=%lu max_latency_us=%lu\n",
+    (unsigned long)stats.data_ready,
+    (unsigned long)stats.frames_read,
+    (unsigned long)stats.frames_processed,
+    (unsigned long)stats.overruns,
+    (unsigned long)stats.dropped,
+    (unsigned long)stats.queued,
+    (unsigned long)stats.max_queued,
+    (unsigned long)stats.max_latency_us
+  );
+  return CMD_ACK;
+}
+
+extern CaptureBuffer frameCapture;
+
+// Sends the capture in order with the data stream. It is queued with the blocking policy and flushed before
+// stream frames can push it out. A host that stops reading for the flush timeout gets a truncated dump: the rest
+// of it is dropped, and counted in the transmit queue counters, rather than left to be mixed with stream frames
+static void sendCaptureDump()
+{
+  uint8_t header[CAPTURE_DUMP_HEADER_BYTES];
+  const CaptureRecord *runs[2];
+  unsigned int counts[2];
+  uint8_t checksum;
+  getCaptureDump(&frameCapture, header, runs, counts, &checksum);
+
+  int status = txQueuePushWithPolicy(&txQueue, header, CAPTURE_DUMP_HEADER_BYTES, TX_BLOCK);
+  for (unsigned int r = 0; r < 2 && status == 0; r++) {
+    if (counts[r]) {
+      status = txQueuePushWithPolicy(&txQueue, (const uint8_t *)runs[r], counts[r] * CAPTURE_RECORD_BYTES, TX_BLOCK);
+    }
+  }
+  if (status == 0) {
+    txQueuePushWithPolicy(&txQueue, &checksum, 1, TX_BLOCK);
+  }
+  if (flushDataStream() > 0) {
+    txQueueDiscard(&txQueue);
+  }
+}
+
+int cmd_capture(char *toks[], const unsigned int tokCount)
+{
+  unsigned int i = 1;
+  if (tokCount > 1) {
+    if (strcmp(toks[1], "trigger") == 0) {
+      triggerCapture(&frameCapture, CAPTURE_CAUSE_COMMAND);
+      i++;
+    }
+    else if (strcmp(toks[1], "arm") == 0) {
+      armCapture(&frameCapture);
+      i++;
+    }
+    else if (strcmp(toks[1], "dump") == 0) {
+      sendCaptureDump();
+      return CMD_ACK;
+    }
+  }
+  uint32_t pre = frameCapture.pre, post = frameCapture.post, mask = frameCapture.trigger_mask;
+  int limit = frameCapture.maxpixel_limit;
+  for (; i < tokCount; i += 2) {
+    if (i + 1 >= tokCount) {
+      return CMD_NACK;
+    }
+    if (strcmp(toks[i], "pre") == 0) {
+      pre = strtoul(toks[i+1], NULL, 0);
+    }
+    else if (strcmp(toks[i], "post") == 0) {
+      post = strtoul(toks[i+1], NULL, 0);
+    }
+    else if (strcmp(toks[i], "state") == 0) {
+      mask = strcmp(toks[i+1], "on") == 0 ? mask | CAPTURE_ON_STATE : mask & ~CAPTURE_ON_STATE;
+    }
+    else if (strcmp(toks[i], "maxpixel") == 0) {
+      if (strcmp(toks[i+1], "off") == 0) {
+        mask &= ~CAPTURE_ON_MAXPIXEL;
+      }
+      else {
+        mask |= CAPTURE_ON_MAXPIXEL;
+        limit = strtol(toks[i+1], NULL, 0);
+      }
+    }
+    else {
+      return CMD_NACK;
+    }
+  }
+  if (pre != frameCapture.pre || post != frameCapture.post) {
+    initCaptureBuffer(&frameCapture, pre, post, mask, limit); // restarts the capture
+  }
+  frameCapture.trigger_mask = mask;
+  frameCapture.maxpixel_limit = limit;
+
+  static const char *stateNames[] = {"armed", "triggered", "frozen"};
+  static const char *causeNames[] = {"none", "command", "state", "maxpixel"};
+  (*serial).printf("state=%s cause=%s recorded=%lu pre=%lu post=%lu triggers=%lu state_trigger=%s maxpixel_trigger=%d\n",
+    stateNames[frameCapture.state],
+    causeNames[frameCapture.cause],
+    (unsigned long)frameCapture.head,
+    (unsigned long)frameCapture.pre,
+    (unsigned long)frameCapture.post,
+    (unsigned long)frameCapture.triggers,
+    (frameCapture.trigger_mask & CAPTURE_ON_STATE) ? "on" : "off",
+    (frameCapture.trigger_mask & CAPTURE_ON_MAXPIXEL) ? frameCapture.maxpixel_limit : -1
+  );
+  return CMD_ACK;
+}
+
+extern FrameRateScheduler frameRate;
+int cmd_rate(char *toks[], const unsigned int tokCount)
+{
+  #if ENABLE_ADAPTIVE_FRAME_RATE
+  if (tokCount > 1) {
+    FrameRateMode mode;
+    if (strcmp(toks[1], "auto") == 0) {
+      mode = FRAME_RATE_AUTO;
+    }
+    else if (strcmp(toks[1], "fast") == 0) {
+      mode = FRAME_RATE_FAST;
+    }
+    else if (strcmp(toks[1], "slow") == 0) {
+      mode = FRAME_RATE_SLOW;
+    }
+    else {
+      return CMD_NACK;
+    }
+    const int sdly = setFrameRateMode(&frameRate, mode, us_ticker_read());
+    if (sdly >= 0) {
+      set_sample_delay(sdly);
+    }
+  }
+  static const char *modeNames[] = {"auto", "fast", "slow"};
+  (*serial).printf("mode=%s sdly=%d period_ms=%.2f switches=%lu\n",
+    modeNames[frameRate.mode],
+    getFrameRateSdly(&frameRate),
+    frameRate.period_ms,
+    (unsigned long)frameRate.switches
+  );
+  #else
+  (*serial).printf("Adaptive frame rate not built in, set ENABLE_ADAPTIVE_FRAME_RATE in config.h\n");
+  #endif
+  return CMD_ACK;
+}
+
+int cmd_txq(char *toks[], const unsigned int tokCount)
+{
+  for (unsigned int i = 1; i < tokCount; i += 2) {
+    if (i + 1 >= tokCount) {
+      return CMD_NACK;
+    }
+    if (strcmp(toks[i], "policy") == 0) {
+      if (strcmp(toks[i+1], "oldest") == 0) {
+        txQueue.policy = TX_DROP_OLDEST;
+      }
+      else if (strcmp(toks[i+1], "newest") == 0) {
+        txQueue.policy = TX_DROP_NEWEST;
+      }
+      else if (strcmp(toks[i+1], "block") == 0) {
+        txQueue.policy = TX_BLOCK;
+      }
+      else {
+        return CMD_NACK;
+      }
+    }
+    else if (strcmp(toks[i], "hold") == 0) {
+      txQueue.short_block_hold_us = strtoul(toks[i+1], NULL, 0);
+    }
+    else {
+      return CMD_NACK;
+    }
+  }
+  if (tokCount > 1) {
+    return CMD_ACK;
+  }
+
+  TxQueueStats stats;
+  getTxQueueStats(&txQueue, &stats);
+  (*serial).printf("queued=%lu dropped=%lu blocked=%lu block_timeouts=%lu blocks=%lu short_blocks=%lu bytes=%lu queued_bytes=%lu max_queued_bytes=%lu queued_frames=%lu max_queued_frames=%lu\n",
+    (unsigned long)stats.frames_queued,
+    (unsigned long)stats.frames_dropped,
+    (unsigned long)stats.blocked,
+    (unsigned long)stats.block_timeouts,
+    (unsigned long)stats.blocks_sent,
+    (unsigned long)stats.short_blocks_sent,
+    (unsigned long)stats.bytes_sent,
+    (unsigned long)stats.queued_bytes,
+    (unsigned long)stats.max_queued_bytes,
+    (unsigned long)stats.queued_frames,
+    (unsigned long)stats.max_queued_frames
+  );
+  return CMD_ACK;
+}
+
+int cmd_stats(char *toks[], const unsigned int tokCount)
+{
+  if (tokCount > 1) {
+    if (strcmp(toks[1], "reset") != 0) {
+      return CMD_NACK;
+    }
+    resetProfiler();
+    return CMD_ACK;
+  }
+  #if GESTURE_PROFILE
+  (*serial).printf("unit=%s core_hz=%lu\n", getProfileTickUnit(), (unsigned long)SystemCoreClock);
+  for (int i = 0; i < PROFILE_NUM_STAGES; i++) {
+    ProfileSummary summary;
+    getProfileSummary((ProfileStage)i, &summary);
+    (*serial).printf("%s count=%lu min=%lu mean=%lu max=%lu p99=%lu\n",
+      getProfileStageName((ProfileStage)i),
+      (unsigned long)summary.count,
+      (unsigned long)summary.min,
+      (unsigned long)summary.mean,
+      (unsigned long)summary.max,
+      (unsigned long)summary.p99
+    );
+  }
+  #else
+  (*serial).printf("Profiling not built in, compile with GESTURE_PROFILE=1\n");
+  #endif
+  return CMD_ACK;
+}
+
 extern GestureResult gesResult;
 extern GestureEvent latched_gesture;
 int cmd_poll(char *toks[], const unsigned int tokCount)
 {
   (*serial).printf("%d,%d,%d,%d,%.2f,%.2f,%.2f,%d,%d,%d\n",
-    gesResult.int_placeholder,
+    latched_gesture,
     gesResult.state,
     gesResult.n_sample,
     gesResult.maxpixel,
@@ -280,4 +583,111 @@ int cmd_poll(char *toks[], const unsigned int tokCount)
     gesResult.int_placeholder,
     gesResult.int_placeholder
   );
+  latched_gesture = GEST_NONE;
+  return CMD_ACK;
+}
+
+static uint8_t bin_ping(const uint8_t *payload, const uint8_t length, uint8_t *response, uint8_t *response_length)
+{
+  return CMD_STATUS_OK;
+}
+
+static uint8_t bin_ver(const uint8_t *payload, const uint8_t length, uint8_t *response, uint8_t *response_length)
+{
+  size_t n = strlen(version_string);
+  if (n > CMD_PACKET_MAX_PAYLOAD) {
+    n = CMD_PACKET_MAX_PAYLOAD;
+  }
+  memcpy(response, version_string, n);
+  *response_length = n;
+  return CMD_STATUS_OK;
+}
+
+// Reports the latched swipe like the poll command
+static uint8_t bin_poll(const uint8_t *payload, const uint8_t length, uint8_t *response, uint8_t *response_length)
+{
+  GestureResult result = gesResult;
+  result.gesture = latched_gesture;
+  latched_gesture = GEST_NONE;
+  *response_length = packGestureResult(response, &result);
+  return CMD_STATUS_OK;
+}
+
+// Register values go straight from the bus into the response
+static uint8_t bin_reg_read(const uint8_t *payload, const uint8_t length, uint8_t *response, uint8_t *response_length)
+{
+  if (length != 2) {
+    return CMD_STATUS_BAD_LENGTH;
+  }
+  if (payload[1] == 0 || payload[0] + payload[1] - 1 > 0xFF) { // a burst must not wrap past the last register
+    return CMD_STATUS_BAD_ARGUMENT;
+  }
+  reg_read(payload[0], payload[1], response);
+  *response_length = payload[1];
+  return CMD_STATUS_OK;
+}
+
+static uint8_t bin_reg_write(const uint8_t *payload, const uint8_t length, uint8_t *response, uint8_t *response_length)
+{
+  if (length < 2) {
+    return CMD_STATUS_BAD_LENGTH;
+  }
+  if (payload[0] + (length - 1) - 1 > 0xFF) {
+    return CMD_STATUS_BAD_ARGUMENT;
+  }
+  for (int i = 1; i < length; i++) {
+    reg_write(payload[0] + i - 1, payload[i]);
+  }
+  return CMD_STATUS_OK;
+}
+
+static uint8_t bin_stream(const uint8_t *payload, const uint8_t length, uint8_t *response, uint8_t *response_length)
+{
+  if (length != 3) {
+    return CMD_STATUS_BAD_LENGTH;
+  }
+  if (payload[2] > STREAM_FORMAT_V2_DELTA) {
+    return CMD_STATUS_BAD_ARGUMENT;
+  }
+  if (payload[0]) {
+    set_stream_on(payload[1] != 0, payload[2]);
+  }
+  else {
+    set_stream_off();
+  }
+  return CMD_STATUS_OK;
+}
+
+static uint8_t bin_frames(const uint8_t *payload, const uint8_t length, uint8_t *response, uint8_t *response_length)
+{
+  FrameReaderStats stats;
+  getFrameReaderStats(&frameReader, &stats);
+  putCmdUint32(response, stats.data_ready);
+  putCmdUint32(response + 4, stats.frames_read);
+  putCmdUint32(response + 8, stats.frames_processed);
+  putCmdUint32(response + 12, stats.overruns);
+  putCmdUint32(response + 16, stats.dropped);
+  putCmdUint32(response + 20, stats.queued);
+  putCmdUint32(response + 24, stats.max_queued);
+  putCmdUint32(response + 28, stats.max_latency_us);
+  *response_length = 32;
+  return CMD_STATUS_OK;
+}
+
+static uint8_t bin_txq(const uint8_t *payload, const uint8_t length, uint8_t *response, uint8_t *response_length)
+{
+  TxQueueStats stats;
+  getTxQueueStats(&txQueue, &stats);
+  putCmdUint32(response, stats.frames_queued);
+  putCmdUint32(response + 4, stats.frames_dropped);
+  putCmdUint32(response + 8, stats.blocked);
+  putCmdUint32(response + 12, stats.blocks_sent);
+  putCmdUint32(response + 16, stats.short_blocks_sent);
+  putCmdUint32(response + 20, stats.bytes_sent);
+  putCmdUint32(response + 24, stats.queued_bytes);
+  putCmdUint32(response + 28, stats.max_queued_bytes);
+  putCmdUint32(response + 32, stats.queued_frames);
+  putCmdUint32(response + 36, stats.max_queued_frames);
+  *response_length = 40;
+  return CMD_STATUS_OK;
 }
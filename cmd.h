@@ -47,11 +47,15 @@
 #define MAX_REG_OUTPUT_LENGTH 512
 #define MAX_REG_READ_SIZE 256
 
+// Data stream frame formats. See stream_codec.h for version 2
+enum stream_formats {STREAM_FORMAT_V1, STREAM_FORMAT_V2, STREAM_FORMAT_V2_DELTA};
+
 extern void enable_read_sensor_frames();
 extern void disable_read_sensor_frames();
-extern void set_stream_on(uint32_t send_pixel_data);
+extern void set_stream_on(uint32_t send_pixel_data, uint32_t format);
 extern void set_stream_off();
 extern void set_default_register_settings();
+extern void set_sample_delay(const int sdly);
 
 typedef struct {
     char cmd[128];
@@ -71,4 +75,9 @@ int cmd_stream(char *toks[], const unsigned int tokCount);
 int cmd_force_tracking_cal(char *toks[], const unsigned int tokCount);
 int cmd_poll(char *toks[], const unsigned int tokCount);
 int cmd_reset(char *toks[], const unsigned int tokCount);
+int cmd_frames(char *toks[], const unsigned int tokCount);
+int cmd_txq(char *toks[], const unsigned int tokCount);
+int cmd_stats(char *toks[], const unsigned int tokCount);
+int cmd_rate(char *toks[], const unsigned int tokCount);
+int cmd_capture(char *toks[], const unsigned int tokCount);
 #endif
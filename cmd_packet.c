@@ -0,0 +1,194 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+#include <string.h>
+#include "cmd_packet.h"
+
+enum parser_states {WAIT_SYNC, WAIT_OPCODE, WAIT_LENGTH, WAIT_PAYLOAD, WAIT_CHECKSUM};
+
+void initCmdPacketParser(CmdPacketParser *parser)
+{
+  parser->state = WAIT_SYNC;
+  parser->opcode = 0;
+  parser->length = 0;
+  parser->received = 0;
+  parser->sum = 0;
+  parser->last_byte_us = 0;
+}
+
+int parseCmdPacketByte(CmdPacketParser *parser, const uint8_t byte, const uint32_t now_us)
+{
+  parser->last_byte_us = now_us;
+  switch (parser->state) {
+    case WAIT_SYNC:
+      if (byte == CMD_PACKET_SYNC) {
+        parser->state = WAIT_OPCODE;
+      }
+      return 0;
+    case WAIT_OPCODE:
+      parser->opcode = byte;
+      parser->sum = byte;
+      parser->state = WAIT_LENGTH;
+      return 0;
+    case WAIT_LENGTH:
+      parser->length = byte;
+      parser->received = 0;
+      parser->sum += byte;
+      parser->state = byte ? WAIT_PAYLOAD : WAIT_CHECKSUM;
+      return 0;
+    case WAIT_PAYLOAD:
+      parser->payload[parser->received++] = byte;
+      parser->sum += byte;
+      if (parser->received == parser->length) {
+        parser->state = WAIT_CHECKSUM;
+      }
+      return 0;
+    default:
+      parser->state = WAIT_SYNC;
+      return byte == parser->sum ? 1 : -1;
+  }
+}
+
+int cmdPacketInProgress(CmdPacketParser *parser, const uint32_t now_us)
+{
+  if (parser->state != WAIT_SYNC && now_us - parser->last_byte_us > CMD_PACKET_BYTE_TIMEOUT_US) {
+    parser->state = WAIT_SYNC; // truncated request
+  }
+  return parser->state != WAIT_SYNC;
+}
+
+int finishCmdResponse(uint8_t *response, const uint8_t opcode, const uint8_t status, const uint8_t length)
+{
+  uint8_t sum = 0;
+  response[0] = CMD_RESPONSE_SYNC;
+  response[1] = opcode;
+  response[2] = status;
+  response[3] = length;
+  for (int i = 1; i < CMD_RESPONSE_HEADER_BYTES + length; i++) {
+    sum += response[i];
+  }
+  response[CMD_RESPONSE_HEADER_BYTES + length] = sum;
+  return CMD_RESPONSE_HEADER_BYTES + length + 1;
+}
+
+int decodeCmdResponse(const uint8_t *data, const unsigned int length, uint8_t *opcode, uint8_t *status,
+  const uint8_t **payload, unsigned int *payload_length)
+{
+  if (length < 1) {
+    return 0;
+  }
+  if (data[0] != CMD_RESPONSE_SYNC) {
+    return -1;
+  }
+  if (length < CMD_RESPONSE_HEADER_BYTES) {
+    return 0;
+  }
+  unsigned int total = CMD_RESPONSE_HEADER_BYTES + data[3] + 1;
+  if (length < total) {
+    return 0;
+  }
+  uint8_t sum = 0;
+  for (unsigned int i = 1; i < total - 1; i++) {
+    sum += data[i];
+  }
+  if (sum != data[total - 1]) {
+    return -1;
+  }
+  *opcode = data[1];
+  *status = data[2];
+  *payload = data + CMD_RESPONSE_HEADER_BYTES;
+  *payload_length = data[3];
+  return total;
+}
+
+void putCmdUint32(uint8_t *dst, const uint32_t value)
+{
+  dst[0] = value & 0xFF;
+  dst[1] = (value >> 8) & 0xFF;
+  dst[2] = (value >> 16) & 0xFF;
+  dst[3] = (value >> 24) & 0xFF;
+}
+
+uint32_t getCmdUint32(const uint8_t *src)
+{
+  return (uint32_t)src[0] | (uint32_t)src[1] << 8 | (uint32_t)src[2] << 16 | (uint32_t)src[3] << 24;
+}
+
+static uint32_t floatBits(const float value)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static float bitsFloat(const uint32_t bits)
+{
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+int packGestureResult(uint8_t *dst, const GestureResult *gesResult)
+{
+  dst[0] = (uint8_t)gesResult->gesture;
+  dst[1] = (uint8_t)gesResult->state;
+  putCmdUint32(dst + 2, gesResult->n_sample);
+  putCmdUint32(dst + 6, (uint32_t)gesResult->maxpixel);
+  putCmdUint32(dst + 10, floatBits(gesResult->x));
+  putCmdUint32(dst + 14, floatBits(gesResult->y));
+  putCmdUint32(dst + 18, floatBits(gesResult->float_placeholder));
+  putCmdUint32(dst + 22, gesResult->int_placeholder);
+  dst[26] = (uint8_t)gesResult->tracking_state;
+  putCmdUint32(dst + 27, (uint32_t)gesResult->tracking_maxpixel);
+  putCmdUint32(dst + 31, floatBits(gesResult->tracking_x));
+  putCmdUint32(dst + 35, floatBits(gesResult->tracking_y));
+  return CMD_POLL_PAYLOAD_BYTES;
+}
+
+void unpackGestureResult(GestureResult *gesResult, const uint8_t *src)
+{
+  gesResult->gesture = (GestureEvent)src[0];
+  gesResult->state = src[1];
+  gesResult->n_sample = getCmdUint32(src + 2);
+  gesResult->maxpixel = (int32_t)getCmdUint32(src + 6);
+  gesResult->x = bitsFloat(getCmdUint32(src + 10));
+  gesResult->y = bitsFloat(getCmdUint32(src + 14));
+  gesResult->float_placeholder = bitsFloat(getCmdUint32(src + 18));
+  gesResult->int_placeholder = getCmdUint32(src + 22);
+  gesResult->tracking_state = src[26];
+  gesResult->tracking_maxpixel = (int32_t)getCmdUint32(src + 27);
+  gesResult->tracking_x = bitsFloat(getCmdUint32(src + 31));
+  gesResult->tracking_y = bitsFloat(getCmdUint32(src + 35));
+}
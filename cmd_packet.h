@@ -0,0 +1,225 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+#ifndef CMD_PACKET_H_INCLUDED
+#define CMD_PACKET_H_INCLUDED
+
+#include <stdint.h>
+#include "gesture_lib.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+* Binary command channel, alongside the text command line.
+*
+* A request starts with CMD_PACKET_SYNC, a byte no text command starts with, so both can share the serial port:
+*   sync 0xAA, opcode, payload length, payload, checksum
+* and is answered with
+*   sync 0xAB, opcode, status, payload length, payload, checksum
+* The checksum is the 8-bit sum of every byte after the sync byte. Multi-byte values are little-endian and
+* floats are sent as their IEEE 754 bits, so nothing is formatted or rounded on the device.
+*/
+#define CMD_PACKET_SYNC 0xAA
+#define CMD_RESPONSE_SYNC 0xAB
+#define CMD_PACKET_MAX_PAYLOAD 255
+#define CMD_RESPONSE_HEADER_BYTES 4                 // sync, opcode, status, length
+#define CMD_RESPONSE_MAX_BYTES (CMD_RESPONSE_HEADER_BYTES + CMD_PACKET_MAX_PAYLOAD + 1)
+// A request whose next byte does not arrive within this time is abandoned, so a truncated request does not
+// swallow the text commands that follow it
+#define CMD_PACKET_BYTE_TIMEOUT_US 50000
+
+/*
+* Request opcodes, and the request and response payloads
+*/
+enum cmd_opcodes {
+  CMD_OP_PING = 1,      // -> empty
+  CMD_OP_VERSION,       // -> version string, not terminated
+  CMD_OP_POLL,          // -> packed GestureResult, CMD_POLL_PAYLOAD_BYTES
+  CMD_OP_REG_READ,      // address, count -> count register bytes. The burst must end at register 0xFF at most
+  CMD_OP_REG_WRITE,     // address, values... -> empty. Writes consecutive registers, up to register 0xFF
+  CMD_OP_STREAM,        // enable, pixels, stream_formats -> empty
+  CMD_OP_FRAMES,        // -> FrameReaderStats, 8 x uint32
+  CMD_OP_TXQ,           // -> TxQueueStats, 10 x uint32
+  CMD_OP_COUNT
+};
+
+enum cmd_status {
+  CMD_STATUS_OK,
+  CMD_STATUS_BAD_CHECKSUM,
+  CMD_STATUS_BAD_OPCODE,
+  CMD_STATUS_BAD_LENGTH,
+  CMD_STATUS_BAD_ARGUMENT
+};
+
+// Packed GestureResult: gesture, state, then n_sample, maxpixel, x, y, float_placeholder, int_placeholder as 32 bits each,
+// then tracking_state and tracking_maxpixel, tracking_x, tracking_y as 32 bits each
+#define CMD_POLL_PAYLOAD_BYTES 39
+
+// Request parser, fed one byte at a time
+typedef struct {
+  uint8_t state;
+  uint8_t opcode;
+  uint8_t length;
+  uint8_t received;
+  uint8_t sum;
+  uint32_t last_byte_us;          // Arrival time of the last byte
+  uint8_t payload[CMD_PACKET_MAX_PAYLOAD];
+} CmdPacketParser;
+
+/**
+* This function resets a request parser to wait for a sync byte.
+*
+* Parameters
+* parser: A pointer to a CmdPacketParser structure
+*
+* Return Value
+* None
+*/
+void initCmdPacketParser(CmdPacketParser *parser);
+
+/**
+* This function feeds the next received byte to a request parser. Bytes before a sync byte are ignored.
+* After a complete request, parser->opcode, parser->length and parser->payload hold it until the next byte.
+*
+* Parameters
+* parser: A pointer to the CmdPacketParser
+* byte:   The received byte
+* now_us: Arrival time of the byte in microseconds
+*
+* Return Value
+* 1 if a request is complete, 0 if more bytes are needed, -1 if a complete request had a bad checksum
+*/
+int parseCmdPacketByte(CmdPacketParser *parser, const uint8_t byte, const uint32_t now_us);
+
+/**
+* This function checks whether the parser is inside a request, past its sync byte. A request whose last byte
+* arrived more than CMD_PACKET_BYTE_TIMEOUT_US ago is abandoned, and the parser waits for a sync byte again.
+*
+* Parameters
+* parser: A pointer to the CmdPacketParser
+* now_us: Current time in microseconds
+*
+* Return Value
+* 1 if a request is being received, 0 otherwise
+*/
+int cmdPacketInProgress(CmdPacketParser *parser, const uint32_t now_us);
+
+/**
+* This function completes a response in place. The handler writes the payload at
+* response + CMD_RESPONSE_HEADER_BYTES; the header and checksum are added around it.
+*
+* Parameters
+* response: A buffer of at least CMD_RESPONSE_MAX_BYTES
+* opcode:   The request opcode
+* status:   A cmd_status value
+* length:   Payload length
+*
+* Return Value
+* Total response length in bytes
+*/
+int finishCmdResponse(uint8_t *response, const uint8_t opcode, const uint8_t status, const uint8_t length);
+
+/**
+* This function decodes a response, as received by the host.
+*
+* Parameters
+* data:    The received bytes, starting at a sync byte
+* length:  Number of bytes available
+* opcode:  Set to the response opcode
+* status:  Set to the response status
+* payload: Set to the payload, inside data
+* payload_length: Set to the payload length
+*
+* Return Value
+* The response length on success, 0 if more bytes are needed, -1 if the bytes are not a valid response
+*/
+int decodeCmdResponse(const uint8_t *data, const unsigned int length, uint8_t *opcode, uint8_t *status,
+  const uint8_t **payload, unsigned int *payload_length);
+
+/**
+* This function packs a GestureResult for a CMD_OP_POLL response.
+*
+* Parameters
+* dst:       CMD_POLL_PAYLOAD_BYTES bytes
+* gesResult: A pointer to the GestureResult
+*
+* Return Value
+* CMD_POLL_PAYLOAD_BYTES
+*/
+int packGestureResult(uint8_t *dst, const GestureResult *gesResult);
+
+/**
+* This function unpacks a CMD_OP_POLL response payload.
+*
+* Parameters
+* gesResult: A pointer to the GestureResult to fill
+* src:       CMD_POLL_PAYLOAD_BYTES bytes
+*
+* Return Value
+* None
+*/
+void unpackGestureResult(GestureResult *gesResult, const uint8_t *src);
+
+/**
+* This function stores a 32-bit value little-endian, for building response payloads.
+*
+* Parameters
+* dst:   4 bytes
+* value: The value
+*
+* Return Value
+* None
+*/
+void putCmdUint32(uint8_t *dst, const uint32_t value);
+
+/**
+* This function loads a little-endian 32-bit value.
+*
+* Parameters
+* src: 4 bytes
+*
+* Return Value
+* The value
+*/
+uint32_t getCmdUint32(const uint8_t *src);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
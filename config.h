@@ -41,5 +41,29 @@
 //#define COMPILE_FOR_MAX32630
 #define COMPILE_FOR_MAX32620
 
+// Lower the sensor frame rate while nothing is in front of it, see frame_rate.h. The fast rate uses the sample
+// delay of the default register settings of the device (set_default_register_settings); the slow rate the longest
+#define ENABLE_ADAPTIVE_FRAME_RATE 1
+#if defined(MAX25405_DEVICE)
+  #define FRAME_RATE_FAST_SDLY 2
+#elif defined(MAX25205_DEVICE)
+  #define FRAME_RATE_FAST_SDLY 0
+#endif
+#define FRAME_RATE_SLOW_SDLY 7
+
+// Raw frame capture, see capture.h: frames kept before and after the trigger frame, and the automatic triggers
+#define CAPTURE_PRE_FRAMES 32
+#define CAPTURE_POST_FRAMES 31
+#define CAPTURE_TRIGGERS 0 /*CAPTURE_ON_STATE and/or CAPTURE_ON_MAXPIXEL; the capture command always triggers*/
+#define CAPTURE_MAXPIXEL_LIMIT 8000
+
 // With EVKIT hardware, cannot instantiate SPI and also use I2C (these share clk and data lines on HW)
 #define USE_SPI 1
+
+// Read frames with an asynchronous SPI (DMA) transfer started from the INTB interrupt, if the target supports it.
+// Otherwise frames are read with a blocking block transfer from the main loop
+#if USE_SPI && DEVICE_SPI_ASYNCH
+  #define ASYNC_FRAME_READ 1
+#else
+  #define ASYNC_FRAME_READ 0
+#endif
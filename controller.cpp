@@ -36,9 +36,13 @@
 #include "mbed.h"
 #include "controller.h"
 #include "config.h"
+#include "profiler.h"
 
 static uint32_t i2c_device_addr = 0x9E; // LSB justified
 
+// Set while a register access holds the SPI bus. An asynchronous frame readout is not started meanwhile
+static volatile uint8_t spi_reg_access = 0;
+
 #define I2C_ADDR_SELECT 0
 
 void i2c_init()
@@ -97,9 +101,34 @@ int i2c_write(const uint8_t reg_addr, const uint8_t reg_val)
   return 0;
 }
 
+#if ASYNC_FRAME_READ
+static FrameReader *asyncFrameReader = NULL;
+static volatile uint8_t spi_frame_read_busy = 0;
+
+// SPI transfer complete interrupt of the frame readout
+static void spiFrameReadDone(int event)
+{
+  csb = 1;
+  spi_frame_read_busy = 0;
+  frameReaderTransferDone(asyncFrameReader);
+}
+#endif
+
+#if USE_SPI
+// Claims the SPI bus for a register access, waiting for a frame readout in progress to complete
+static void waitSpiFrameRead()
+{
+  spi_reg_access = 1;
+  #if ASYNC_FRAME_READ
+  while (spi_frame_read_busy) {}
+  #endif
+}
+#endif
+
 int spi_read(const uint8_t reg_addr, const uint8_t num_bytes, uint8_t reg_vals[])
 {
   #if USE_SPI
+  waitSpiFrameRead();
   csb = 0;
   spi.write(reg_addr);                // byte 1: register address
   spi.write(0x80);                    // byte 2: read command 0x80
@@ -107,6 +136,7 @@ int spi_read(const uint8_t reg_addr, const uint8_t num_bytes, uint8_t reg_vals[]
     reg_vals[i] = spi.write(0x00);  // byte3: read byte
   }
   csb = 1;
+  spi_reg_access = 0;
   #endif
   return 0;
 }
@@ -114,11 +144,13 @@ int spi_read(const uint8_t reg_addr, const uint8_t num_bytes, uint8_t reg_vals[]
 int spi_write(const uint8_t reg_addr, const uint8_t reg_val)
 {
   #if USE_SPI
+  waitSpiFrameRead();
   csb = 0;
   spi.write(reg_addr);    // byte1: register address
   spi.write(0x00);        // byte2: write command 0x00
   spi.write(reg_val);     // byte3: write byte
   csb = 1;
+  spi_reg_access = 0;
   #endif
   return 0;
 }
@@ -126,19 +158,62 @@ int spi_write(const uint8_t reg_addr, const uint8_t reg_val)
 void getSensorPixels(int pixels[], const uint8_t flip_sensor_pixels)
 {
   unsigned char reg_vals[NUM_SENSOR_PIXELS*2];
-  reg_read(0x10, NUM_SENSOR_PIXELS*2, reg_vals);
+  PROFILE_BEGIN(read_start);
+  reg_read(FRAME_READER_PIXEL_REG, NUM_SENSOR_PIXELS*2, reg_vals);
+  frameBytesToPixels(reg_vals, pixels, flip_sensor_pixels);
+  PROFILE_END(PROFILE_READ_PIXELS, read_start);
+}
+
+#if !ASYNC_FRAME_READ
+// Readout requested by the INTB interrupt, performed by serviceSensorFrameRead in the main loop
+static FrameReader * volatile pendingFrameReader = NULL;
+static uint8_t *pendingFrameBuffer = NULL;
+#endif
 
-  for (int i = 0; i < NUM_SENSOR_PIXELS; i++) {
-    pixels[i] = convertTwoUnsignedBytesToInt(reg_vals[2 * i], reg_vals[2 * i + 1]);
+int startSensorFrameRead(void *ctx, FrameReader *reader, uint8_t buffer[FRAME_READER_BUFFER_BYTES])
+{
+  #if ASYNC_FRAME_READ
+  // Called from the INTB interrupt. The data lands in buffer while the main loop keeps processing
+  if (spi_reg_access) {
+    return -1;
   }
+  asyncFrameReader = reader;
+  spi_frame_read_busy = 1;
+  csb = 0;
+  if (spi.transfer(frameReadSpiCommand, FRAME_READER_BUFFER_BYTES, buffer, FRAME_READER_BUFFER_BYTES,
+                   event_callback_t(spiFrameReadDone), SPI_EVENT_COMPLETE) != 0) {
+    csb = 1;
+    spi_frame_read_busy = 0;
+    return -1;
+  }
+  #else
+  // A blocking transfer cannot run in the interrupt; leave it to the main loop
+  pendingFrameBuffer = buffer;
+  pendingFrameReader = reader;
+  #endif
+  return 0;
+}
 
-  if (flip_sensor_pixels) {
-    for (int i = 0; i < NUM_SENSOR_PIXELS/2; i++) {
-      int temp = pixels[i];
-      pixels[i] = pixels[NUM_SENSOR_PIXELS-1-i];
-      pixels[NUM_SENSOR_PIXELS-1-i] = temp;
-    }
+void serviceSensorFrameRead()
+{
+  #if !ASYNC_FRAME_READ
+  FrameReader *reader = pendingFrameReader;
+  if (!reader) {
+    return;
   }
+  PROFILE_BEGIN(read_start);
+  #if USE_SPI
+  // One block transfer instead of a spi.write() call per byte
+  csb = 0;
+  spi.write((const char *)frameReadSpiCommand, FRAME_READER_BUFFER_BYTES, (char *)pendingFrameBuffer, FRAME_READER_BUFFER_BYTES);
+  csb = 1;
+  #else
+  i2c_read(FRAME_READER_PIXEL_REG, FRAME_READER_FRAME_BYTES, pendingFrameBuffer + FRAME_READER_HEADROOM);
+  #endif
+  PROFILE_END(PROFILE_READ_PIXELS, read_start);
+  pendingFrameReader = NULL;
+  frameReaderTransferDone(reader);
+  #endif
 }
 
 int convertTwoUnsignedBytesToInt(uint8_t hi_byte, uint8_t lo_byte)
@@ -37,6 +37,7 @@
 #define CONTROLLER_H_INCLUDED
 
 #include "gesture_common.h"
+#include "frame_reader.h"
 
 extern DigitalOut rLED;
 extern DigitalOut gLED;
@@ -61,4 +62,9 @@ int spi_write(const uint8_t reg_addr, const uint8_t reg_val);
 void getSensorPixels(int pixels[], const uint8_t flip_sensor_pixels);
 int convertTwoUnsignedBytesToInt(const unsigned char hi_byte, const unsigned char lo_byte);
 
+// FrameReader transport: reads the pixel registers with one block transfer. With ASYNC_FRAME_READ the transfer
+// runs asynchronously from the INTB interrupt; otherwise the main loop performs it in serviceSensorFrameRead
+int startSensorFrameRead(void *ctx, FrameReader *reader, uint8_t buffer[FRAME_READER_BUFFER_BYTES]);
+void serviceSensorFrameRead();
+
 #endif
@@ -0,0 +1,146 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+#include <string.h>
+#include <math.h>
+#include "frame_rate.h"
+
+#define FRAME_RATE_SETTLE_INTERVALS 4           // Intervals measured before a new period is reported
+#define FRAME_RATE_PERIOD_ALPHA 0.25f           // Smoothing of the measured period
+#define FRAME_RATE_PERIOD_TOLERANCE 0.05f       // Relative drift before the period is reported again
+
+void initFrameRateScheduler(FrameRateScheduler *sched, const uint8_t fast_sdly, const uint8_t slow_sdly, const int wake_threshold, const uint32_t idle_ms)
+{
+  memset(sched, 0, sizeof(FrameRateScheduler));
+  sched->mode = FRAME_RATE_AUTO;
+  sched->fast_sdly = fast_sdly;
+  sched->slow_sdly = slow_sdly;
+  sched->wake_threshold = wake_threshold;
+  sched->idle_us = idle_ms * 1000;
+  sched->fast = 1;
+}
+
+int getFrameRateSdly(const FrameRateScheduler *sched)
+{
+  return sched->fast ? sched->fast_sdly : sched->slow_sdly;
+}
+
+// Changes the rate and restarts the period measurement
+static int selectFrameRate(FrameRateScheduler *sched, const uint8_t fast, const uint32_t now_us)
+{
+  if (sched->fast == fast) {
+    return -1;
+  }
+  sched->fast = fast;
+  sched->idle = 0;
+  sched->switch_us = now_us;
+  sched->switched = 1;
+  sched->switches++;
+  sched->have_last = 0;
+  sched->intervals = 0;
+  sched->reported_period_ms = 0;
+  return fast ? sched->fast_sdly : sched->slow_sdly;
+}
+
+int setFrameRateMode(FrameRateScheduler *sched, const FrameRateMode mode, const uint32_t now_us)
+{
+  sched->mode = mode;
+  return selectFrameRate(sched, mode != FRAME_RATE_SLOW, now_us);
+}
+
+int updateFrameRate(FrameRateScheduler *sched, const uint32_t active, const int maxpixel, const uint32_t now_us)
+{
+  if (sched->mode != FRAME_RATE_AUTO) {
+    return -1;
+  }
+  if (active || maxpixel >= sched->wake_threshold) {
+    sched->idle = 0;
+    return selectFrameRate(sched, 1, now_us);
+  }
+  if (!sched->fast) {
+    return -1;
+  }
+  if (!sched->idle) {
+    sched->idle = 1;
+    sched->idle_since_us = now_us;
+    return -1;
+  }
+  if (now_us - sched->idle_since_us >= sched->idle_us) {
+    return selectFrameRate(sched, 0, now_us);
+  }
+  return -1;
+}
+
+int measureFramePeriod(FrameRateScheduler *sched, const uint32_t timestamp_us, const uint32_t frame, float *period_ms)
+{
+  // Frames that were ready before the change are at the old rate
+  if (sched->switched) {
+    if ((int32_t)(timestamp_us - sched->switch_us) <= 0) {
+      return 0;
+    }
+    sched->switched = 0;
+  }
+  if (!sched->have_last || frame == sched->last_frame) {
+    sched->have_last = 1;
+    sched->last_timestamp_us = timestamp_us;
+    sched->last_frame = frame;
+    return 0;
+  }
+  const float interval_ms = (float)(timestamp_us - sched->last_timestamp_us) / 1000.0f / (float)(frame - sched->last_frame);
+  sched->last_timestamp_us = timestamp_us;
+  sched->last_frame = frame;
+
+  // The first frame after the change may have started converting at the old rate
+  sched->intervals++;
+  if (sched->intervals == 1) {
+    return 0;
+  }
+  if (sched->intervals == 2 || sched->period_ms == 0) {
+    sched->period_ms = interval_ms;
+  }
+  else {
+    sched->period_ms += FRAME_RATE_PERIOD_ALPHA * (interval_ms - sched->period_ms);
+  }
+  if (sched->intervals < FRAME_RATE_SETTLE_INTERVALS) {
+    return 0;
+  }
+  if (sched->reported_period_ms == 0
+    || fabsf(sched->period_ms - sched->reported_period_ms) > FRAME_RATE_PERIOD_TOLERANCE * sched->reported_period_ms) {
+    sched->reported_period_ms = sched->period_ms;
+    *period_ms = sched->period_ms;
+    return 1;
+  }
+  return 0;
+}
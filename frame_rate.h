@@ -0,0 +1,167 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+#ifndef FRAME_RATE_H_INCLUDED
+#define FRAME_RATE_H_INCLUDED
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+* Activity-adaptive sensor frame rate.
+*
+* While nothing is in front of the sensor the frames are only used to follow the background, so the sensor runs
+* with a long sample delay (SDLY), which lowers the LED duty cycle and the processing load. As soon as the max
+* pixel of a frame reaches the wake threshold the scheduler selects the shortest sample delay, so the gesture
+* itself is sampled at the fastest rate; it returns to the slow rate once the frames have stayed inactive for
+* idle_ms. Only SDLY changes: the conversion settings (TIM, NRPT, NCDS) and therefore the pixel values and the
+* tracking calibration stay the same.
+*
+* The sample period at each setting is measured from the frame timestamps rather than assumed, and reported
+* once it has settled after a change (and whenever it drifts), so the gesture library can be kept up to date
+* with setGestureSamplePeriod.
+*/
+#define FRAME_RATE_REG 0x03                     // Sensor register holding SDLY
+#define FRAME_RATE_SDLY_SHIFT 4
+#define FRAME_RATE_SDLY_MASK 0x70
+#define FRAME_RATE_IDLE_MS 1000                 // Default inactive time before dropping to the slow rate
+
+typedef enum {
+  FRAME_RATE_AUTO,                              // Follow the activity
+  FRAME_RATE_FAST,                              // Always the fast rate
+  FRAME_RATE_SLOW                               // Always the slow rate
+} FrameRateMode;
+
+typedef struct {
+  // Settings
+  FrameRateMode mode;
+  uint8_t fast_sdly;
+  uint8_t slow_sdly;
+  int wake_threshold;                           // Max pixel that selects the fast rate
+  uint32_t idle_us;                             // Inactive time before the slow rate is selected
+
+  uint8_t fast;                                 // The fast rate is selected
+  uint8_t idle;                                 // Frames have been inactive since idle_since_us
+  uint32_t idle_since_us;
+  uint32_t switch_us;                           // Time of the last change
+  uint8_t switched;                             // No frame ready after switch_us has been measured yet
+  uint32_t switches;                            // Changes of the rate
+
+  // Period measurement
+  uint8_t have_last;
+  uint32_t last_timestamp_us;
+  uint32_t last_frame;
+  uint32_t intervals;                           // Frame intervals measured since the last change
+  float period_ms;                              // Measured sample period, 0 until measured
+  float reported_period_ms;                     // Last period returned by measureFramePeriod
+} FrameRateScheduler;
+
+/**
+* This function initializes a frame rate scheduler in automatic mode with the fast rate selected.
+*
+* Parameters
+* sched:          A pointer to a FrameRateScheduler structure
+* fast_sdly:      SDLY of the fast rate
+* slow_sdly:      SDLY of the slow rate
+* wake_threshold: Max pixel (background corrected) that selects the fast rate
+* idle_ms:        Time without activity before the slow rate is selected
+*
+* Return Value
+* None
+*/
+void initFrameRateScheduler(FrameRateScheduler *sched, const uint8_t fast_sdly, const uint8_t slow_sdly, const int wake_threshold, const uint32_t idle_ms);
+
+/**
+* This function returns the SDLY of the selected rate.
+*
+* Parameters
+* sched: A pointer to the FrameRateScheduler
+*
+* Return Value
+* SDLY to program
+*/
+int getFrameRateSdly(const FrameRateScheduler *sched);
+
+/**
+* This function selects the scheduler mode.
+*
+* Parameters
+* sched:  A pointer to the FrameRateScheduler
+* mode:   FRAME_RATE_AUTO, FRAME_RATE_FAST or FRAME_RATE_SLOW
+* now_us: Current time in microseconds
+*
+* Return Value
+* SDLY to program, or -1 if the rate does not change
+*/
+int setFrameRateMode(FrameRateScheduler *sched, const FrameRateMode mode, const uint32_t now_us);
+
+/**
+* This function is called with the result of every processed frame and selects the rate.
+*
+* Parameters
+* sched:    A pointer to the FrameRateScheduler
+* active:   The gesture state of the frame is not inactive
+* maxpixel: Max pixel of the frame (background corrected)
+* now_us:   Current time in microseconds
+*
+* Return Value
+* SDLY to program, or -1 if the rate does not change
+*/
+int updateFrameRate(FrameRateScheduler *sched, const uint32_t active, const int maxpixel, const uint32_t now_us);
+
+/**
+* This function measures the sample period from the frames taken from the frame reader, in order. Frames
+* converted before the last change of the rate are not used, nor is the first interval after it.
+*
+* Parameters
+* sched:        A pointer to the FrameRateScheduler
+* timestamp_us: Data ready time of the frame (FrameSlot.timestamp_us)
+* frame:        Frame number (FrameSlot.frame), so lost frames do not count as longer periods
+* period_ms:    Set to the measured period when the function returns 1
+*
+* Return Value
+* 1 if the period has settled after a change or drifted from the last one returned, 0 otherwise
+*/
+int measureFramePeriod(FrameRateScheduler *sched, const uint32_t timestamp_us, const uint32_t frame, float *period_ms);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
@@ -0,0 +1,132 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+#include "frame_reader.h"
+
+const uint8_t frameReadSpiCommand[FRAME_READER_BUFFER_BYTES] = {FRAME_READER_PIXEL_REG, 0x80};
+
+#define SLOT_MASK (FRAME_READER_SLOTS - 1)
+
+void initFrameReader(FrameReader *reader, FrameReaderStartRead start_read, void *ctx)
+{
+  memset(reader, 0, sizeof(FrameReader));
+  reader->start_read = start_read;
+  reader->ctx = ctx;
+}
+
+int frameReaderDataReady(FrameReader *reader, const uint32_t timestamp_us)
+{
+  const uint32_t frame = reader->data_ready++;
+  if (reader->busy) {
+    reader->overruns++;
+    return 0;
+  }
+  const uint32_t head = reader->head; // only written here and in frameReaderTransferDone, both producer side
+  if (head - __atomic_load_n(&reader->tail, __ATOMIC_ACQUIRE) == FRAME_READER_SLOTS) {
+    reader->dropped++;
+    return 0;
+  }
+  FrameSlot *slot = &reader->slots[head & SLOT_MASK];
+  slot->timestamp_us = timestamp_us;
+  slot->frame = frame;
+  reader->busy = 1;
+  if (reader->start_read(reader->ctx, reader, slot->buffer)) {
+    reader->busy = 0;
+    reader->overruns++;
+    return 0;
+  }
+  return 1;
+}
+
+void frameReaderTransferDone(FrameReader *reader)
+{
+  const uint32_t head = reader->head + 1;
+  const uint32_t queued = head - __atomic_load_n(&reader->tail, __ATOMIC_ACQUIRE);
+  if (queued > reader->max_queued) {
+    reader->max_queued = queued;
+  }
+  __atomic_store_n(&reader->head, head, __ATOMIC_RELEASE); // publishes the slot contents
+  reader->busy = 0;
+}
+
+const FrameSlot * acquireFrameReaderSlot(FrameReader *reader, const uint32_t now_us)
+{
+  const uint32_t tail = reader->tail; // only written by the consumer
+  if (tail == __atomic_load_n(&reader->head, __ATOMIC_ACQUIRE)) {
+    return NULL;
+  }
+  const FrameSlot *slot = &reader->slots[tail & SLOT_MASK];
+  if (!reader->acquired) {
+    reader->acquired = 1;
+    const uint32_t latency = now_us - slot->timestamp_us;
+    if (latency > reader->max_latency_us) {
+      reader->max_latency_us = latency;
+    }
+  }
+  return slot;
+}
+
+void releaseFrameReaderSlot(FrameReader *reader)
+{
+  if (reader->acquired) {
+    reader->acquired = 0;
+    __atomic_store_n(&reader->tail, reader->tail + 1, __ATOMIC_RELEASE); // hands the slot back to the producer
+  }
+}
+
+void getFrameReaderStats(const FrameReader *reader, FrameReaderStats *stats)
+{
+  const uint32_t tail = reader->tail;
+  const uint32_t head = __atomic_load_n(&reader->head, __ATOMIC_ACQUIRE);
+  stats->data_ready = reader->data_ready;
+  stats->frames_read = head;
+  stats->frames_processed = tail;
+  stats->overruns = reader->overruns;
+  stats->dropped = reader->dropped;
+  stats->queued = head - tail;
+  stats->max_queued = reader->max_queued;
+  stats->max_latency_us = reader->max_latency_us;
+}
+
+void frameBytesToPixels(const uint8_t frame_bytes[], int pixels[], const uint8_t flip_sensor_pixels)
+{
+  for (int i = 0; i < NUM_SENSOR_PIXELS; i++) {
+    // Same conversion as convertTwoUnsignedBytesToInt() in controller.cpp
+    int pixel = (int)(frame_bytes[2*i] << 8 | frame_bytes[2*i + 1]);
+    if ((1 << 15) < pixel)
+      pixel -= (1 << 16);
+    pixels[flip_sensor_pixels ? NUM_SENSOR_PIXELS-1-i : i] = pixel;
+  }
+}
@@ -0,0 +1,210 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+#ifndef FRAME_READER_H_INCLUDED
+#define FRAME_READER_H_INCLUDED
+
+#include "gesture_common.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+* Sensor frame acquisition into a single-producer/single-consumer ring of timestamped frame slots.
+*
+* The sensor's data ready interrupt (INTB) calls frameReaderDataReady, which starts the readout of the pixel
+* registers into the next free slot through a transport: an asynchronous SPI DMA transfer, or a blocking block
+* transfer that the main loop performs (see controller.cpp). The transport signals completion with
+* frameReaderTransferDone, which publishes the slot. The main loop drains the ring in order with
+* acquireFrameReaderSlot / releaseFrameReaderSlot, so the processing of frame N overlaps the readout of later
+* frames, and a main loop delayed by commands or USB writes catches up instead of losing frames.
+*
+* The producer (interrupts) only writes head and the consumer (main loop) only writes tail; both are accessed
+* with acquire/release atomics, so no lock or interrupt masking is needed.
+*
+* Frames that cannot be read are counted, never silently lost:
+*   overruns: data ready while the readout of the previous frame was still in progress (or not yet serviced)
+*   dropped:  data ready while all slots held frames not yet processed
+* Each slot carries the frame number (the count of data ready interrupts), so gaps are visible downstream.
+*/
+#define FRAME_READER_PIXEL_REG 0x10                           // First pixel data register
+#define FRAME_READER_FRAME_BYTES (NUM_SENSOR_PIXELS*2)        // Pixel data bytes per frame, 16-bit big-endian
+#define FRAME_READER_HEADROOM 2                               // Bytes ahead of the pixel data a transport may use (SPI address and command)
+#define FRAME_READER_BUFFER_BYTES (FRAME_READER_HEADROOM + FRAME_READER_FRAME_BYTES)
+#define FRAME_READER_SLOTS 8                                  // Ring size, a power of two
+
+// SPI frame readout command: pixel register address and read command, then dummy bytes clocking out the data.
+// Sent as a single full duplex transfer of FRAME_READER_BUFFER_BYTES into a frame slot
+extern const uint8_t frameReadSpiCommand[FRAME_READER_BUFFER_BYTES];
+
+typedef struct FrameReader FrameReader;
+
+// Starts the readout of FRAME_READER_FRAME_BYTES from FRAME_READER_PIXEL_REG into buffer + FRAME_READER_HEADROOM.
+// Returns 0 if the transfer was started; the transport then calls frameReaderTransferDone when it completes
+typedef int (*FrameReaderStartRead)(void *ctx, FrameReader *reader, uint8_t buffer[FRAME_READER_BUFFER_BYTES]);
+
+typedef struct {
+  uint32_t timestamp_us;                        // Time of the data ready interrupt
+  uint32_t frame;                               // Frame number: data ready interrupts before this one
+  uint8_t buffer[FRAME_READER_BUFFER_BYTES];    // Pixel data starts at FRAME_READER_HEADROOM
+} FrameSlot;
+
+// Frame acquisition counters, see getFrameReaderStats
+typedef struct {
+  uint32_t data_ready;          // Data ready interrupts
+  uint32_t frames_read;         // Frames read into the ring
+  uint32_t frames_processed;    // Frames released by the main loop
+  uint32_t overruns;            // Frames lost because the previous readout was still in progress
+  uint32_t dropped;             // Frames lost because the ring was full
+  uint32_t queued;              // Frames in the ring now
+  uint32_t max_queued;          // Highest number of frames in the ring
+  uint32_t max_latency_us;      // Longest time from data ready to the main loop taking the frame
+} FrameReaderStats;
+
+struct FrameReader {
+  FrameReaderStartRead start_read;
+  void *ctx;
+  FrameSlot slots[FRAME_READER_SLOTS];
+
+  uint32_t head;                        // Slots published by the producer. Written by interrupts only
+  uint32_t tail;                        // Slots released by the consumer. Written by the main loop only
+  volatile uint8_t busy;                // A readout into slot head is in progress
+
+  // Counters, written by the interrupts
+  volatile uint32_t data_ready;
+  volatile uint32_t overruns;
+  volatile uint32_t dropped;
+  volatile uint32_t max_queued;
+
+  // Written by the main loop
+  uint32_t max_latency_us;
+  uint8_t acquired;                     // The main loop holds slot tail
+};
+
+/**
+* This function initializes a frame reader.
+*
+* Parameters
+* reader:     A pointer to a FrameReader structure
+* start_read: The transport function that starts the readout of a frame
+* ctx:        Passed to start_read
+*
+* Return Value
+* None
+*/
+void initFrameReader(FrameReader *reader, FrameReaderStartRead start_read, void *ctx);
+
+/**
+* This function is called when the sensor has a new frame (INTB interrupt). It starts the readout of the frame
+* into the next free slot.
+*
+* Parameters
+* reader:       A pointer to the FrameReader
+* timestamp_us: Time of the interrupt in microseconds, stored with the frame
+*
+* Return Value
+* 1 if the readout was started, 0 if the frame was lost (overrun or dropped)
+*/
+int frameReaderDataReady(FrameReader *reader, const uint32_t timestamp_us);
+
+/**
+* This function is called by the transport when the readout started by frameReaderDataReady has completed.
+* It publishes the frame to the main loop.
+*
+* Parameters
+* reader: A pointer to the FrameReader
+*
+* Return Value
+* None
+*/
+void frameReaderTransferDone(FrameReader *reader);
+
+/**
+* This function returns the oldest frame in the ring, if any. The slot belongs to the main loop until it is
+* given back with releaseFrameReaderSlot; acquiring again before that returns the same slot.
+*
+* Parameters
+* reader: A pointer to the FrameReader
+* now_us: Current time in microseconds, for the latency statistics
+*
+* Return Value
+* Pointer to the slot, or NULL if the ring is empty. The pixel data is at slot->buffer + FRAME_READER_HEADROOM
+*/
+const FrameSlot * acquireFrameReaderSlot(FrameReader *reader, const uint32_t now_us);
+
+/**
+* This function gives the slot returned by acquireFrameReaderSlot back to the reader.
+*
+* Parameters
+* reader: A pointer to the FrameReader
+*
+* Return Value
+* None
+*/
+void releaseFrameReaderSlot(FrameReader *reader);
+
+/**
+* This function obtains the frame acquisition counters. Called from the main loop.
+*
+* Parameters
+* reader: A pointer to the FrameReader
+* stats:  A pointer to a FrameReaderStats structure
+*
+* Return Value
+* None
+*/
+void getFrameReaderStats(const FrameReader *reader, FrameReaderStats *stats);
+
+/**
+* This function converts the pixel data bytes of a frame (16-bit big-endian two's complement, sensor order)
+* to pixel values, like getSensorPixels.
+*
+* Parameters
+* frame_bytes:        FRAME_READER_FRAME_BYTES bytes of pixel data
+* pixels:             Output array of NUM_SENSOR_PIXELS pixels
+* flip_sensor_pixels: Reverse the pixel order, for a sensor mounted upside-down
+*
+* Return Value
+* None
+*/
+void frameBytesToPixels(const uint8_t frame_bytes[], int pixels[], const uint8_t flip_sensor_pixels);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
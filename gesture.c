@@ -35,169 +35,411 @@
 
 #include "gesture_common.h"
 
-// Gesture states
-typedef enum {STATE_INACTIVE, GESTURE_IN_PROGRESS} GestureState;
+static void runDynamicGesture(GestureEngine *eng, int _pixels[], const int maxpixel, DynamicGestureResult *gesResult);
+static int filterFrame(GestureEngine *eng, int pixels[], int *tracking_maxpixel);
+static void filterFrames(GestureEngine *eng, int frames[], const unsigned int num_frames);
+static void runFilteredFrame(GestureEngine *eng, int pixels[], const int maxpixel, const int tracking_maxpixel, GestureResult *gesResult);
 
-static uint32_t reset_flag = TRUE;
+// -----------------------------------------
+// Gesture engine instances
+// -----------------------------------------
 
-// Create a static instance of the configuration to maintain current config parameters
-static GestureConfig gestCfg;
+// The table driven interpolation supports powers of two up to MAX_INTERP_FACTOR.
+// Other factors are rounded down to the nearest supported one
+static uint32_t supportedInterpFactor(const uint32_t factor)
+{
+  uint32_t supported = 1;
+  while (supported * 2 <= factor && supported * 2 <= MAX_INTERP_FACTOR) {
+    supported *= 2;
+  }
+  return supported;
+}
 
-static void runDynamicGesture(const GestureConfig *cfg, int _pixels[], DynamicGestureResult *gesResult);
-void noiseWindow3Filter(int pixels[], const float alpha, const uint32_t reset_flag);
+void initGestureEngine(GestureEngine *eng)
+{
+  memset(eng, 0, sizeof(GestureEngine));
+  eng->reset_flag = TRUE;
+  initTrackingContext(&eng->tracking);
+  configGestureEngine(eng, NULL);
+}
 
-void resetGesture()
+GestureEngine * createGestureEngine()
+{
+  GestureEngine *eng = (GestureEngine *)malloc(sizeof(GestureEngine));
+  if (eng) {
+    initGestureEngine(eng);
+  }
+  return eng;
+}
+
+void destroyGestureEngine(GestureEngine *eng)
+{
+  free(eng);
+}
+
+// The default engine serves the single-sensor API below
+GestureEngine * getDefaultGestureEngine()
+{
+  static GestureEngine defaultEngine;
+  static uint32_t initialized = FALSE;
+  if (!initialized) {
+    initGestureEngine(&defaultEngine);
+    initialized = TRUE;
+  }
+  return &defaultEngine;
+}
+
+void resetGestureEngine(GestureEngine *eng)
 {
-  reset_flag = TRUE;
+  eng->reset_flag = TRUE;
   // Reset submodules
-  resetTracking();
+  resetTracking(&eng->tracking);
+}
+
+void getGestureEngineConfig(const GestureEngine *eng, GestureConfig *_cfg)
+{
+  *_cfg = eng->cfg;
+}
+
+// Copy the user's config struct to the engine, and initialize calculated values
+void configGestureEngine(GestureEngine *eng, const GestureConfig *_cfg)
+{
+  if (!_cfg) {
+    initConfigStructToDefaults(&eng->cfg); // Use default configuration if pointer is NULL
+  }
+  else {
+    eng->cfg = *_cfg; // make a copy of the struct
+  }
+
+  eng->window_filter_alpha_q16 = floatToQ16(eng->cfg.window_filter_alpha);
+  eng->background_filter_alpha_q16 = floatToQ16(eng->cfg.background_filter_alpha);
+  eng->low_pass_filter_alpha_q16 = floatToQ16(eng->cfg.low_pass_filter_alpha);
+
+  eng->cfg.interp_factor = supportedInterpFactor(eng->cfg.interp_factor);
+  buildInterpTable(&eng->interp_table, SENSOR_XRES, SENSOR_YRES, eng->cfg.interp_factor);
+
+  configTracking(&eng->tracking, eng->cfg.sample_period_ms, eng->cfg.adc_full_scale, &eng->cfg.trackingConfig);
+  configSwipe(&eng->dynamic.swipe, &eng->cfg);
+
+  resetGestureEngine(eng);
+}
+
+void forceGestureEngineTrackingCalibration(GestureEngine *eng)
+{
+  requestTrackingCalibration(&eng->tracking);
+}
+
+void setGestureEngineSamplePeriod(GestureEngine *eng, const float sample_period_ms)
+{
+  eng->cfg.sample_period_ms = sample_period_ms;
+  setTrackingSamplePeriod(&eng->tracking, eng->cfg.sample_period_ms, &eng->cfg.trackingConfig);
+  setSwipeSamplePeriod(&eng->dynamic.swipe, &eng->cfg);
+}
+
+void getGestureEngineStats(const GestureEngine *eng, GestureStats *stats)
+{
+  stats->frames = eng->dynamic.n_frame;
+  stats->idle_frames_skipped = eng->dynamic.n_idle_frame;
+}
+
+// -----------------------------------------
+// Single sensor API, operates on the default engine
+// -----------------------------------------
+
+void resetGesture()
+{
+  resetGestureEngine(getDefaultGestureEngine());
 }
 
 // Get a copy of the config struct
 void getGestureConfig(GestureConfig *_cfg)
 {
-  *_cfg = gestCfg;
+  getGestureEngineConfig(getDefaultGestureEngine(), _cfg);
 }
 
 // Get a pointer to the config struct
 GestureConfig * getGestureConfigPtr()
 {
-  return &gestCfg;
+  return &getDefaultGestureEngine()->cfg;
 }
 
-// Copy the user's config struct to the local struct, and initialize calculated values
 void configGesture(const GestureConfig *_cfg)
 {
-  if (!_cfg) {
-    initConfigStructToDefaults(&gestCfg); // Use default configuration if pointer is NULL
-  }
-  else {
-    gestCfg = *_cfg; // make a copy of the struct
+  configGestureEngine(getDefaultGestureEngine(), _cfg);
+}
+
+void runGesture(int pixels[], GestureResult *gesResult)
+{
+  runGestureEngine(getDefaultGestureEngine(), pixels, gesResult);
+}
+
+void runGestureBatch(int frames[], const unsigned int num_frames, GestureResult gesResults[])
+{
+  runGestureEngineBatch(getDefaultGestureEngine(), frames, num_frames, gesResults);
+}
+
+void forceTrackingCalibration()
+{
+  forceGestureEngineTrackingCalibration(getDefaultGestureEngine());
+}
+
+void setGestureSamplePeriod(const float sample_period_ms)
+{
+  setGestureEngineSamplePeriod(getDefaultGestureEngine(), sample_period_ms);
+}
+
+void getGestureStats(GestureStats *stats)
+{
+  getGestureEngineStats(getDefaultGestureEngine(), stats);
+}
+
+// -----------------------------------------
+// Algorithm
+// -----------------------------------------
+
+void runGestureEngine(GestureEngine *eng, int pixels[], GestureResult *gesResult)
+{
+  PROFILE_BEGIN(frame_start);
+
+  // Noise filter, static background subtraction and post-filter max pixel
+  PROFILE_BEGIN(filter_start);
+  int tracking_maxpixel;
+  int maxpixel = filterFrame(eng, pixels, &tracking_maxpixel);
+  PROFILE_END(PROFILE_FILTER, filter_start);
+
+  runFilteredFrame(eng, pixels, maxpixel, tracking_maxpixel, gesResult);
+
+  PROFILE_END(PROFILE_FRAME, frame_start);
+}
+
+void runGestureEngineBatch(GestureEngine *eng, int frames[], const unsigned int num_frames, GestureResult gesResults[])
+{
+  // Dual mode keeps a window filtered copy of the frame for tracking, which there is only room for one frame of
+  if (eng->cfg.gesture_mode == GESTURE_MODE_DUAL) {
+    for (unsigned int f = 0; f < num_frames; f++) {
+      runGestureEngine(eng, &frames[f * NUM_SENSOR_PIXELS], &gesResults[f]);
+    }
+    return;
   }
 
-  configTracking(gestCfg.sample_period_ms, gestCfg.adc_full_scale, &gestCfg.trackingConfig);
+  // Filter all frames first, then run the rest of the algorithm frame by frame
+  filterFrames(eng, frames, num_frames);
 
-  resetGesture();
+  for (unsigned int f = 0; f < num_frames; f++) {
+    int *pixels = &frames[f * NUM_SENSOR_PIXELS];
+    const int maxpixel = getMaxPixelValue(pixels, NUM_SENSOR_PIXELS);
+    runFilteredFrame(eng, pixels, maxpixel, maxpixel, &gesResults[f]);
+  }
 }
 
-void runGesture(int pixels[], GestureResult *gesResult)
+// Runs the dynamic gesture and tracking algorithms on a frame that went through filterFrame(s). tracking_maxpixel is
+// the max of the frame tracking works on, see filterFrame
+static void runFilteredFrame(GestureEngine *eng, int pixels[], const int maxpixel, const int tracking_maxpixel, GestureResult *gesResult)
 {
+  const GestureConfig *cfg = &eng->cfg;
+
   // Initialize result structure
   memset(gesResult, 0, sizeof(GestureResult));
   gesResult->state = STATE_INACTIVE;
   gesResult->gesture = GEST_NONE;
 
-  // Noise filter
-  if (gestCfg.enable_window_filter) {
-    noiseWindow3Filter(pixels, gestCfg.window_filter_alpha, reset_flag);
-  }
+  eng->dynamic.n_frame++;
+
+  // In dual mode tracking works on the copy that filterFrame made before background subtraction
+  int *tracking_pixels = cfg->gesture_mode == GESTURE_MODE_DUAL ? eng->tracking_pixels : pixels;
 
   // Process pixels for dynamic gesture
-  if (1) {
+  if (cfg->gesture_mode != GESTURE_MODE_TRACKING) {
     DynamicGestureResult dynamicResult;
-    runDynamicGesture(&gestCfg, pixels, &dynamicResult);
+    runDynamicGesture(eng, pixels, maxpixel, &dynamicResult);
+    gesResult->gesture = dynamicResult.gesture;
     gesResult->state = dynamicResult.state;
     gesResult->n_sample = dynamicResult.n_sample;
     gesResult->maxpixel = dynamicResult.maxpixel;
     gesResult->x = dynamicResult.x;
     gesResult->y = dynamicResult.y;
   }
-  // Process pixels for tracking
-  if (0) {
+  // Process pixels for tracking. Its interpolation reuses the buffer of the dynamic gesture algorithm
+  if (cfg->gesture_mode != GESTURE_MODE_DYNAMIC) {
     TrackingResult trackResult;
-    runTracking(&gestCfg.trackingConfig, pixels, &trackResult);
-    gesResult->state = trackResult.state;
-    gesResult->maxpixel = trackResult.maxpixel; // Will override dynamic result if any
-    gesResult->x = trackResult.x; // Will override dynamic result if any
-    gesResult->y = trackResult.y; // Will override dynamic result if any
+    runTracking(&eng->tracking, &cfg->trackingConfig, &eng->interp_table, eng->interp_pixels, tracking_pixels, tracking_maxpixel, &trackResult);
+    gesResult->tracking_state = trackResult.state;
+    gesResult->tracking_maxpixel = trackResult.maxpixel;
+    gesResult->tracking_x = trackResult.x;
+    gesResult->tracking_y = trackResult.y;
+    if (cfg->gesture_mode == GESTURE_MODE_TRACKING) {
+      gesResult->state = trackResult.state;
+      gesResult->maxpixel = trackResult.maxpixel;
+      gesResult->x = trackResult.x;
+      gesResult->y = trackResult.y;
+    }
   }
 }
 
-static void runDynamicGesture(const GestureConfig *cfg, int pixels[], DynamicGestureResult *gesResult)
+// pixels went through the noise filter and static background subtraction, maxpixel is their max
+static void runDynamicGesture(GestureEngine *eng, int pixels[], const int maxpixel, DynamicGestureResult *gesResult)
 {
-  memset(gesResult, 0, sizeof(DynamicGestureResult));
+  const GestureConfig *cfg = &eng->cfg;
+  DynamicGestureContext *ctx = &eng->dynamic;
 
-  static GestureState state = STATE_INACTIVE;
-  GestureEvent gest_event = GEST_NONE;
-  static uint32_t n_sample = 0, n_frame =0;
+  memset(gesResult, 0, sizeof(DynamicGestureResult));
 
-  if (reset_flag) {
-    state = STATE_INACTIVE;
+  float cmx = -1.0f, cmy = -1.0f;
+  if (maxpixel < cfg->end_detection_threshold) {
+    // Idle fast path: nothing is present and the position would be discarded. The filters are already
+    // updated above, so interpolation, thresholding and center of mass are skipped
+    ctx->n_idle_frame++;
   }
+  else {
+    const InterpTable *interp = &eng->interp_table;
+    const int peak_threshold = (int)(maxpixel/cfg->zero_clamp_threshold_factor);
+    const int clamp_threshold = peak_threshold > cfg->zero_clamp_threshold ? peak_threshold : cfg->zero_clamp_threshold;
+    int totalmass=0;
 
-  int rawmaxpixel = getMaxPixelValue(pixels, NUM_SENSOR_PIXELS);
+    if (interp->factor > 1 && clamp_threshold >= 1) {
+      // Region of interest: only interpolate, clamp and sum around the source pixels that can survive the clamp
+      PixelRect src_rect, roi;
+      int *interp_pixels = eng->interp_pixels;
+      PROFILE_BEGIN(interp_start);
+      if (findPixelBoundingBox(pixels, SENSOR_XRES, SENSOR_YRES, clamp_threshold, &src_rect)) {
+        interpRectFromSourceRect(interp, &src_rect, &roi);
+        interpnTableRect(pixels, interp_pixels, interp, &roi);
+        PROFILE_END(PROFILE_INTERP, interp_start);
 
-  // Static background subtraction
-  {
-    static float foreground_pixels[NUM_SENSOR_PIXELS], background_pixels[NUM_SENSOR_PIXELS];
-    if (reset_flag) {
-      for(uint32_t i=0; i<NUM_SENSOR_PIXELS; i++) {
-        foreground_pixels[i] = pixels[i]; // clear the filter
-        background_pixels[i] = pixels[i]; // clear the filter
+        // Thresholding (zero out pixels below some percent of peak and below the fixed threshold) and center of mass
+        PROFILE_BEGIN(clamp_start);
+        clampCenterOfMassRect(interp_pixels, interp->w2, &roi, clamp_threshold, &cmx, &cmy, &totalmass);
+        PROFILE_END(PROFILE_CLAMP_COM, clamp_start);
+      }
+      else {
+        cmx = cmy = 0.0f; // Nothing survives the clamp, same result as an all-zero frame
       }
     }
-
-    float background_alpha = cfg->background_filter_alpha;
-
-    subtractBackground(pixels, foreground_pixels, background_pixels, NUM_SENSOR_PIXELS, cfg->low_pass_filter_alpha, background_alpha);
-  }
-
-  // Clear the reset flag. All reset activity should be done by now
-  if (reset_flag) {
-    reset_flag = FALSE;
-  }
-
-  // Find post-filter max pixel
-  int maxpixel=getMaxPixelValue(pixels, NUM_SENSOR_PIXELS);
-
-  float cmx,cmy;
-  {
-    #if INTERP_FACTOR == 1
+    else {
       int *interp_pixels;
-      interp_pixels = pixels;
-    #else
-      static int interp_pixels[NUM_INTERP_PIXELS];
-      interpn(pixels, interp_pixels, SENSOR_XRES, SENSOR_YRES, INTERP_FACTOR);
-    #endif
-
-    // Thresholding
-    zeroPixelsBelowThreshold(interp_pixels,NUM_INTERP_PIXELS,(int)(maxpixel/cfg->zero_clamp_threshold_factor)); // zero out pixels below some percent of peak
-    zeroPixelsBelowThreshold(interp_pixels,NUM_INTERP_PIXELS,cfg->zero_clamp_threshold); // and also zero out below fixed threshold
+      if (interp->factor == 1) {
+        interp_pixels = pixels;
+      }
+      else {
+        interp_pixels = eng->interp_pixels;
+        PROFILE_BEGIN(interp_start);
+        interpnTable(pixels, interp_pixels, interp);
+        PROFILE_END(PROFILE_INTERP, interp_start);
+      }
 
-    // Center of mass
-    int totalmass=0;
-    if (maxpixel >= cfg->end_detection_threshold) {
-      calcCenterOfMass(interp_pixels, INTERP_XRES, INTERP_YRES, &cmx, &cmy, &totalmass); // Only calculate COM if there is a pixel above the noise (avoid divide-by-zero)
-      cmx = cmx/INTERP_FACTOR;
-      cmy = cmy/INTERP_FACTOR * DY_PIXEL_SCALE; // scale y so it has same unit dimension as x
+      // Thresholding (zero out pixels below some percent of peak and below the fixed threshold) and center of mass
+      PROFILE_BEGIN(clamp_start);
+      clampCenterOfMass(interp_pixels, interp->w2, interp->h2, clamp_threshold, &cmx, &cmy, &totalmass);
+      PROFILE_END(PROFILE_CLAMP_COM, clamp_start);
     }
-  }
 
-  n_frame++;
+    cmx = cmx/interp->factor;
+    cmy = cmy/interp->factor * DY_PIXEL_SCALE; // scale y so it has same unit dimension as x
+  }
 
-  gesResult->n_sample = n_sample;
-  gesResult->maxpixel = maxpixel; //rawmaxpixel;
+  gesResult->gesture = runSwipe(&ctx->swipe, maxpixel, cmx, cmy);
+  gesResult->n_sample = ctx->swipe.n_sample;
+  gesResult->maxpixel = maxpixel;
   gesResult->state = maxpixel >= cfg->end_detection_threshold ? GESTURE_IN_PROGRESS : STATE_INACTIVE;
-  gesResult->x = maxpixel >= cfg->end_detection_threshold ? cmx : -1.00;
-  gesResult->y = maxpixel >= cfg->end_detection_threshold ? cmy : -1.00;
+  gesResult->x = cmx;
+  gesResult->y = cmy;
+}
+
+// Ends a reset once the filters have been cleared
+static void completeReset(GestureEngine *eng)
+{
+  if (eng->reset_flag) {
+    resetSwipe(&eng->dynamic.swipe);
+    eng->reset_flag = FALSE;
+  }
 }
 
-void noiseWindow3Filter(int pixels[], const float alpha, const uint32_t reset_flag)
+// Noise window filter, static background subtraction and max pixel of the result in a single pass over the
+// frame, with the same results as running them one after another. Tracking works on the window filtered frame:
+// tracking mode skips background subtraction, and dual mode copies the frame to eng->tracking_pixels before it.
+// tracking_maxpixel is set to the max of the frame tracking works on
+static int filterFrame(GestureEngine *eng, int pixels[], int *tracking_maxpixel)
 {
-  static int nwin[3][NUM_SENSOR_PIXELS];
-  if (reset_flag) {
-    for(uint32_t i=0; i<NUM_SENSOR_PIXELS; i++) {
-      nwin[0][i] = pixels[i]; // clear the filter
-      nwin[1][i] = pixels[i]; // clear the filter
-      nwin[2][i] = pixels[i]; // clear the filter
+  const GestureConfig *cfg = &eng->cfg;
+  DynamicGestureContext *ctx = &eng->dynamic;
+  const uint32_t reset_flag = eng->reset_flag;
+  const int dual = cfg->gesture_mode == GESTURE_MODE_DUAL;
+  const int background = cfg->gesture_mode != GESTURE_MODE_TRACKING;
+  int maxpixel=-99999;
+  *tracking_maxpixel=-99999;
+
+  if (!cfg->enable_window_filter && !reset_flag) {
+    // Background subtraction alone, which has vectorized kernels
+    if (dual) {
+      memcpy(eng->tracking_pixels, pixels, sizeof(eng->tracking_pixels));
+      *tracking_maxpixel = getMaxPixelValue(pixels, NUM_SENSOR_PIXELS);
+    }
+    if (!background) {
+      maxpixel = getMaxPixelValue(pixels, NUM_SENSOR_PIXELS);
+    }
+    else {
+      #if GESTURE_FIXED_POINT
+        maxpixel = subtractBackgroundMaxQ16(pixels, ctx->foreground_pixels, ctx->background_pixels, NUM_SENSOR_PIXELS, eng->low_pass_filter_alpha_q16, eng->background_filter_alpha_q16);
+      #else
+        maxpixel = subtractBackgroundMax(pixels, ctx->foreground_pixels, ctx->background_pixels, NUM_SENSOR_PIXELS, cfg->low_pass_filter_alpha, cfg->background_filter_alpha);
+      #endif
     }
   }
   else {
     for (uint32_t i=0; i<NUM_SENSOR_PIXELS; i++) {
-      nwin[0][i] = nwin[1][i];
-      nwin[1][i] = nwin[2][i];
-      nwin[2][i] = pixels[i];
-      pixels[i] = alpha * nwin[1][i] + (1-alpha)*(nwin[0][i] + nwin[2][i])/2;
+      int win[3] = {eng->nwin[0][i], eng->nwin[1][i], eng->nwin[2][i]};
+      int pixel = windowFilterPixel(eng, win, pixels[i], reset_flag);
+      eng->nwin[0][i] = win[0];
+      eng->nwin[1][i] = win[1];
+      eng->nwin[2][i] = win[2];
+      if (dual) {
+        eng->tracking_pixels[i] = pixel;
+        if (*tracking_maxpixel < pixel) {
+          *tracking_maxpixel = pixel;
+        }
+      }
+      if (background) {
+        pixel = backgroundPixel(eng, &ctx->foreground_pixels[i], &ctx->background_pixels[i], pixel, reset_flag);
+      }
+      pixels[i] = pixel;
+      if (maxpixel < pixel) {
+        maxpixel = pixel;
+      }
+    }
+  }
+  if (!dual) {
+    *tracking_maxpixel = maxpixel;
+  }
+  completeReset(eng);
+  return maxpixel;
+}
+
+// filterFrame over consecutive frames, except in dual mode. Each pixel is filtered independently of the others, so
+// the frames are processed pixel by pixel: the filter state of a pixel is loaded once and stays in registers for
+// all frames
+static void filterFrames(GestureEngine *eng, int frames[], const unsigned int num_frames)
+{
+  if (num_frames == 0) {
+    return; // Nothing seeds the filters, so a pending reset must stay pending
+  }
+  DynamicGestureContext *ctx = &eng->dynamic;
+  const int background = eng->cfg.gesture_mode != GESTURE_MODE_TRACKING;
+  for (uint32_t i=0; i<NUM_SENSOR_PIXELS; i++) {
+    int win[3] = {eng->nwin[0][i], eng->nwin[1][i], eng->nwin[2][i]};
+    filt_t foreground_pixel = ctx->foreground_pixels[i], background_pixel = ctx->background_pixels[i];
+    int *pixel = &frames[i];
+    for (unsigned int f = 0; f < num_frames; f++, pixel += NUM_SENSOR_PIXELS) {
+      const uint32_t reset_flag = f == 0 ? eng->reset_flag : FALSE;
+      *pixel = windowFilterPixel(eng, win, *pixel, reset_flag);
+      if (background) {
+        *pixel = backgroundPixel(eng, &foreground_pixel, &background_pixel, *pixel, reset_flag);
+      }
     }
+    eng->nwin[0][i] = win[0];
+    eng->nwin[1][i] = win[1];
+    eng->nwin[2][i] = win[2];
+    ctx->foreground_pixels[i] = foreground_pixel;
+    ctx->background_pixels[i] = background_pixel;
   }
+  completeReset(eng);
 }
@@ -38,6 +38,7 @@
 
 #include "img_utils.h"
 #include "gesture_lib.h"
+#include "profiler.h"
 
 //#define USE_MBED
 
@@ -51,16 +52,38 @@
 	#define FALSE 0
 #endif
 
-// Sensor constants. Declared as constants so arrays can be statically sized
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Set to 1 to run the filter stages in integer Q16 fixed point instead of float. See img_utils.h for the error bound
+#ifndef GESTURE_FIXED_POINT
+#define GESTURE_FIXED_POINT 0
+#endif
+
+#if GESTURE_FIXED_POINT
+  typedef q16_t filt_t;
+#else
+  typedef float filt_t;
+#endif
+
+// Sensor constants. Declared as constants so arrays can be statically sized. They size the engine buffers: the
+// compiled pipeline (gesture_pipeline.h) can run any SensorGeometry that fits them, runGestureEngine runs this one
+#ifndef SENSOR_XRES
 #define SENSOR_XRES 10
+#endif
+#ifndef SENSOR_YRES
 #define SENSOR_YRES 6
+#endif
 #define NUM_SENSOR_PIXELS (SENSOR_XRES * SENSOR_YRES)
 
-// Interpolation used in gesture algorithm
-#define INTERP_FACTOR 4
-#define INTERP_XRES ((SENSOR_XRES-1)*INTERP_FACTOR+1)
-#define INTERP_YRES ((SENSOR_YRES-1)*INTERP_FACTOR+1)
-#define NUM_INTERP_PIXELS (INTERP_XRES*INTERP_YRES)
+// Interpolation used in gesture algorithm. The factor is selected at run time by GestureConfig.interp_factor,
+// the interpolation buffers are sized for the largest supported factor
+#define MAX_INTERP_FACTOR 8
+#define MAX_INTERP_XRES ((SENSOR_XRES-1)*MAX_INTERP_FACTOR+1)
+#define MAX_INTERP_YRES ((SENSOR_YRES-1)*MAX_INTERP_FACTOR+1)
+#define MAX_NUM_INTERP_PIXELS (MAX_INTERP_XRES*MAX_INTERP_YRES)
 
 #define DY_PIXEL_SCALE  1.42857f /*10.0f/7.0f*/
 
@@ -77,14 +100,86 @@ typedef struct {
 	float y;                    // Object y-position
 } TrackingResult;
 
+// Tracking state and filters. One instance is kept per gesture engine
+typedef struct {
+  uint32_t reset_flag;
+  uint32_t reset_bias_flag;
+  uint32_t force_calibration_flag;
+
+  // Calculated from parameters
+  float sampleT;                // Sample period in milliseconds
+  uint32_t adc_full_scale;
+  uint32_t static_state_bias_n;
+  float last_sampleT;
+  uint32_t last_adc_full_scale;
+
+  uint32_t state;
+  uint32_t calibration_done;
+  uint32_t static_state_bias_count;
+  uint32_t reset_filter_flag;
+
+  // Fixed point coefficients, calculated from parameters
+  q16_t low_pass_filter_alpha_q16;
+  q16_t gain_factor_q16[3];
+
+  int biaspixels[NUM_SENSOR_PIXELS];
+  int refpixels[NUM_SENSOR_PIXELS];
+  filt_t filtpixels[NUM_SENSOR_PIXELS];
+} TrackingContext;
+
 // Functions in tracking.cpp
-void configTracking(const uint32_t _sampleT, const uint32_t _adc_full_scale, const TrackingConfig *cfg);
-void runTracking(const TrackingConfig *cfg, int in_pixels[], TrackingResult *gesResult);
-void resetTracking();
-void clearTrackingCalibration();
+void initTrackingContext(TrackingContext *ctx);
+void configTracking(TrackingContext *ctx, const float _sampleT, const uint32_t _adc_full_scale, const TrackingConfig *cfg);
+// maxpixel is the max of in_pixels, interp_pixels a buffer of MAX_NUM_INTERP_PIXELS for the interpolated frame
+void runTracking(TrackingContext *ctx, const TrackingConfig *cfg, const InterpTable *interp, int interp_pixels[], int in_pixels[], const int maxpixel, TrackingResult *gesResult);
+// The stages of runTracking, in order. Each works on the pixels in place. The bias compensation also starts
+// a tracking frame (handles a reset), so it must run first. The frame has num_pixels (xres x yres) pixels,
+// trackingPosition takes the resolution from the interpolation table
+void trackingBiasCompensation(TrackingContext *ctx, const TrackingConfig *cfg, int pixels[], const unsigned int num_pixels, const int maxpixel);
+void trackingLowPassFilter(TrackingContext *ctx, const TrackingConfig *cfg, int pixels[], const unsigned int num_pixels);
+void trackingGain(const TrackingContext *ctx, const TrackingConfig *cfg, int pixels[], const unsigned int xres, const unsigned int yres);
+void trackingPosition(TrackingContext *ctx, const TrackingConfig *cfg, const InterpTable *interp, int interp_buffer[], int pixels[], TrackingResult *gesResult);
+void resetTracking(TrackingContext *ctx);
+void clearTrackingCalibration(TrackingContext *ctx);
+// Changes the sample period without clearing the calibration, which does not depend on it
+void setTrackingSamplePeriod(TrackingContext *ctx, const float _sampleT, const TrackingConfig *cfg);
+void requestTrackingCalibration(TrackingContext *ctx);
+
+// Gain zone of a sensor pixel, counted from the border: 2 for the two outer columns and the outer row, 1 for the
+// next column and row, 0 inside. The zone selects gain_factor_0..2 of the tracking software gain
+static inline unsigned int trackingGainZone(const unsigned int col, const unsigned int row, const unsigned int xres, const unsigned int yres)
+{
+  const unsigned int dx = col < xres-1-col ? col : xres-1-col;
+  const unsigned int dy = row < yres-1-row ? row : yres-1-row;
+  return dx <= 1 || dy == 0 ? 2 : dx == 2 || dy == 1 ? 1 : 0;
+}
+
+// Software gain of an xres x yres frame. Inline so that with a constant resolution the zones are resolved at
+// compile time, see the TrackingGain stage
+static inline void applyTrackingGain(const TrackingContext *ctx, const TrackingConfig *cfg, int pixels[], const unsigned int xres, const unsigned int yres)
+{
+  #if GESTURE_FIXED_POINT
+    const q16_t *gain_factors = ctx->gain_factor_q16;
+    (void)cfg;
+  #else
+    const float gain_factors[3] = {cfg->gain_factor_0, cfg->gain_factor_1, cfg->gain_factor_2};
+    (void)ctx;
+  #endif
+  for (unsigned int row = 0; row < yres; row++) {
+    for (unsigned int col = 0; col < xres; col++) {
+      int *pixel = &pixels[row*xres + col];
+      #if GESTURE_FIXED_POINT
+        *pixel = (int)(((int64_t)*pixel * gain_factors[trackingGainZone(col, row, xres, yres)]) / Q16_ONE);
+      #else
+        *pixel *= gain_factors[trackingGainZone(col, row, xres, yres)];
+      #endif
+    }
+  }
+}
 
 // Structure to store dynamic gesture results
 typedef struct {
+	GestureEvent gesture;       // Swipe completed on this frame
 	uint32_t state;             // 0: inactive; 1: object detected; 2: rotation in progress
 	uint32_t n_sample;          // The current sample number of this gesture
 	int maxpixel;               // Maximum pixel value for this frame
@@ -92,4 +187,129 @@ typedef struct {
 	float y;                    // Object y-position
 } DynamicGestureResult;
 
+// Dynamic gesture states
+typedef enum {STATE_INACTIVE, GESTURE_IN_PROGRESS} GestureState;
+
+// Swipe recognizer. The trajectory of the object is kept as running features, updated in constant time per frame
+typedef struct {
+  // Calculated from parameters
+  int start_detection_threshold;
+  int end_detection_threshold;
+  float min_distance;
+  float min_speed;                // Pixels per frame
+  uint32_t exit_frames;           // Frames the object must stay gone before the swipe is classified
+
+  uint32_t state;                 // GestureState
+  uint32_t n_sample;              // Frames with the object present since the gesture started
+  uint32_t n_exit;                // Frames since the object left
+  uint32_t rejected;              // The path length exceeded MAX_ABS_ACCUM_DX/DY: not a swipe
+  float start_x, start_y;
+  float last_x, last_y;
+  float accum_dx, accum_dy;       // Path length along each axis
+  float vx, vy;                   // Smoothed velocity, pixels per frame
+  float peak_vx, peak_vy;         // Largest absolute smoothed velocity
+} SwipeContext;
+
+// Functions in swipe.c
+void configSwipe(SwipeContext *ctx, const GestureConfig *cfg);
+// Recalculates the speed and exit time in frames for a new cfg->sample_period_ms, keeping the gesture in progress
+void setSwipeSamplePeriod(SwipeContext *ctx, const GestureConfig *cfg);
+void resetSwipe(SwipeContext *ctx);
+// Returns the swipe completed on this frame, if any. x and y are only used when maxpixel is above the end threshold
+GestureEvent runSwipe(SwipeContext *ctx, const int maxpixel, const float x, const float y);
+
+// Dynamic gesture state and filters
+typedef struct {
+  SwipeContext swipe;
+  uint32_t n_frame;
+  uint32_t n_idle_frame;        // Frames that took the idle fast path
+  filt_t foreground_pixels[NUM_SENSOR_PIXELS];
+  filt_t background_pixels[NUM_SENSOR_PIXELS];
+} DynamicGestureContext;
+
+// Gesture engine instance, see gesture_lib.h
+struct GestureEngine {
+  GestureConfig cfg;
+  uint32_t reset_flag;
+
+  // Fixed point coefficients, calculated from cfg
+  q16_t window_filter_alpha_q16;
+  q16_t background_filter_alpha_q16;
+  q16_t low_pass_filter_alpha_q16;
+
+  InterpTable interp_table;         // Built from cfg.interp_factor
+
+  int nwin[3][NUM_SENSOR_PIXELS];   // Window filter history
+  DynamicGestureContext dynamic;
+  TrackingContext tracking;
+
+  // Buffers shared by the dynamic gesture and tracking algorithms, which run one after the other
+  int interp_pixels[MAX_NUM_INTERP_PIXELS];     // Interpolated frame
+  int tracking_pixels[NUM_SENSOR_PIXELS];       // Dual mode: copy of the window filtered frame for tracking
+};
+
+// Per pixel filter stages of the dynamic gesture algorithm, shared by gesture.c and host/stream_group.c
+
+// One step of the 3-frame noise window filter for one pixel. win holds the last three frames of the pixel
+static inline int windowFilterStep(int win[3], const int pixel, const float alpha)
+{
+  win[0] = win[1];
+  win[1] = win[2];
+  win[2] = pixel;
+  return alpha * win[1] + (1-alpha)*(win[0] + win[2])/2;
+}
+
+// Fixed point version of windowFilterStep. The result is truncated toward zero like the float version
+static inline int windowFilterStepQ16(int win[3], const int pixel, const q16_t alpha)
+{
+  win[0] = win[1];
+  win[1] = win[2];
+  win[2] = pixel;
+  int64_t sum = (int64_t)alpha * 2 * win[1] + (int64_t)(Q16_ONE - alpha) * (win[0] + win[2]);
+  return (int)(sum / (2 * Q16_ONE));
+}
+
+// Noise window filter of one pixel. The filter is cleared if reset_flag is set
+static inline int windowFilterPixel(const GestureEngine *eng, int win[3], int pixel, const uint32_t reset_flag)
+{
+  const GestureConfig *cfg = &eng->cfg;
+  if (cfg->enable_window_filter) {
+    if (reset_flag) {
+      win[0] = pixel; // clear the filter
+      win[1] = pixel; // clear the filter
+      win[2] = pixel; // clear the filter
+    }
+    else {
+      #if GESTURE_FIXED_POINT
+        pixel = windowFilterStepQ16(win, pixel, eng->window_filter_alpha_q16);
+      #else
+        pixel = windowFilterStep(win, pixel, cfg->window_filter_alpha);
+      #endif
+    }
+  }
+  return pixel;
+}
+
+// Static background subtraction of one pixel. The filters are cleared if reset_flag is set
+static inline int backgroundPixel(const GestureEngine *eng, filt_t *foreground, filt_t *background, const int pixel, const uint32_t reset_flag)
+{
+  #if GESTURE_FIXED_POINT
+    if (reset_flag) {
+      *foreground = pixel * Q16_ONE; // clear the filter
+      *background = pixel * Q16_ONE; // clear the filter
+    }
+    return subtractBackgroundPixelQ16(pixel, foreground, background, eng->low_pass_filter_alpha_q16, eng->background_filter_alpha_q16);
+  #else
+    if (reset_flag) {
+      *foreground = pixel; // clear the filter
+      *background = pixel; // clear the filter
+    }
+    return subtractBackgroundPixel(pixel, foreground, background, eng->cfg.low_pass_filter_alpha, eng->cfg.background_filter_alpha);
+  #endif
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
 #endif
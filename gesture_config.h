@@ -46,6 +46,11 @@
   #define WINDOW_FILTER_ALPHA 0.5F
   #define START_DETECTION_THRESHOLD 150 /*Changed from 400 for 400um device*/
   #define END_DETECTION_THRESHOLD 50 /*Changed from 250 for 400um device*/
+  #define INTERP_FACTOR 4
+  #define GESTURE_MODE GESTURE_MODE_DYNAMIC /*GESTURE_MODE_TRACKING or GESTURE_MODE_DUAL to run tracking*/
+  #define SWIPE_MIN_DISTANCE 3.0F
+  #define SWIPE_MIN_SPEED 15.0F
+  #define SWIPE_EXIT_MS 20.0F /*One frame at 19.8 ms: swipes are reported within 2 frame periods of the hand leaving*/
 
 
 
@@ -72,6 +72,11 @@ void initConfigStructToDefaults(GestureConfig *cfg)
   cfg->window_filter_alpha = WINDOW_FILTER_ALPHA;
   cfg->start_detection_threshold = START_DETECTION_THRESHOLD;
   cfg->end_detection_threshold = END_DETECTION_THRESHOLD;
+  cfg->interp_factor = INTERP_FACTOR;
+  cfg->gesture_mode = GESTURE_MODE;
+  cfg->swipe_min_distance = SWIPE_MIN_DISTANCE;
+  cfg->swipe_min_speed = SWIPE_MIN_SPEED;
+  cfg->swipe_exit_ms = SWIPE_EXIT_MS;
 
   // Initialize tracking config strucutre
   initTrackingConfigStructToDefaults(&cfg->trackingConfig);
@@ -48,9 +48,22 @@ extern "C"
 */
 typedef enum {
 	GEST_NONE,
-	GEST_PLACEHOLDER
+	GEST_SWIPE_LEFT,             // Swipes, reported once the object has left. Left: toward column 0
+	GEST_SWIPE_RIGHT,            // Toward the last column
+	GEST_SWIPE_UP,               // Toward row 0
+	GEST_SWIPE_DOWN              // Toward the last row
 } GestureEvent;
 
+/*
+* Algorithms run on each frame, see GestureConfig.gesture_mode. Both start from the window filtered frame; only
+* dynamic gestures subtract the static background from it
+*/
+typedef enum {
+	GESTURE_MODE_DYNAMIC,        // Dynamic gestures only
+	GESTURE_MODE_TRACKING,       // Tracking only. The state, maxpixel and position fields report the tracking result
+	GESTURE_MODE_DUAL            // Both, from the same filtered frame. The tracking result is in the tracking_ fields
+} GestureMode;
+
 /*
 * Structure to store gesture results.
 */
@@ -63,10 +76,23 @@ typedef struct {
 	float y;                     // Object y-position. Only accurate if TRACKING_ENABLE mask is set.
 	float float_placeholder;
 	uint32_t int_placeholder;
+	uint32_t tracking_state;     // Tracking and dual mode: 0: inactive; 1: tracking
+	int tracking_maxpixel;       // Tracking and dual mode: maximum pixel after bias compensation, filter and gain
+	float tracking_x;            // Tracking and dual mode: object x-position, scaled to the tracking area
+	float tracking_y;            // Tracking and dual mode: object y-position, scaled to the tracking area
 
 } GestureResult;
 
 
+/*
+* Structure to store processing statistics. Counters start when the engine is initialized.
+*/
+typedef struct {
+	uint32_t frames;                 // Frames processed
+	uint32_t idle_frames_skipped;    // Frames with nothing present, for which interpolation and center of mass were skipped
+} GestureStats;
+
+
 /*
 * Structure for configuration parameters that apply to tracking mode, region selection, and linger-to-click.
 * An instance of this structure is a member of the GestureConfig stucture.
@@ -106,10 +132,24 @@ typedef struct {
 	float window_filter_alpha;
 	int start_detection_threshold;            // Pixel activation level (background corrected) to start gesture tracking
 	int end_detection_threshold;              // Pixel threshold (background corrected) to end gesture tracking
+	uint32_t interp_factor;                   // Interpolation factor before center of mass: 1, 2, 4 or 8. Higher gives finer position resolution at more cost per frame
+	uint32_t gesture_mode;                    // GestureMode: dynamic gestures, tracking, or both
+	float swipe_min_distance;                 // Net motion (in pixels) along its axis for a swipe
+	float swipe_min_speed;                    // Peak speed (in pixels per second) along its axis for a swipe
+	float swipe_exit_ms;                      // Time the object must stay gone before a swipe is reported. Bounds the event latency
 	TrackingConfig trackingConfig;
 } GestureConfig;
 
 
+/*
+* Gesture engine instance. An engine holds the configuration and all filter and state machine state of the
+* algorithm for one sensor, so several sensors (or recorded streams) can be processed independently.
+* The functions without an engine parameter operate on a default engine instance.
+* The structure is defined in gesture_common.h so that engines can also be statically allocated.
+*/
+typedef struct GestureEngine GestureEngine;
+
+
 /**
 * This function obtains a copy of the GestureConfig structure.
 * Obtain a copy in order to modify parameters and then pass the struct back using configGesture.
@@ -176,6 +216,24 @@ void initConfigStructToDefaults(GestureConfig *cfg);
 void runGesture(int pixels[], GestureResult *gesResult);
 
 
+/**
+* This function executes the algorithm for a sequence of consecutive frames, with the same results as calling
+* runGesture for each of them in turn. It is meant for offline processing of recorded data: the filter
+* stages run over the whole sequence one pixel at a time, which is considerably faster than frame by frame.
+* In GESTURE_MODE_DUAL the frames are processed one at a time.
+*
+* Parameters
+* frames:     An integer array of num_frames frames of sensor pixel data, one after another. Like the pixels
+*             passed to runGesture, the frames are processed in place
+* num_frames: The number of frames
+* gesResults: An array of num_frames GestureResult struct instances; they will be populated with the result of each frame
+*
+* Return Value
+* None
+*/
+void runGestureBatch(int frames[], const unsigned int num_frames, GestureResult gesResults[]);
+
+
 /**
 * This function resets the gesture algorithm by resetting the state machine and clearing filters.
 * Note that the initialization parameters are not changed
@@ -202,6 +260,57 @@ void resetGesture();
 */
 void forceTrackingCalibration();
 
+
+/**
+* This function changes the sample period when the sensor frame rate changes while frames are processed.
+* Unlike configGesture it keeps the filters, the gesture in progress and the tracking calibration, and only
+* recalculates the values given in milliseconds: the tracking static state time, the swipe speed and exit time.
+* The filter coefficients (window_filter_alpha, background_filter_alpha, low_pass_filter_alpha and the tracking
+* low_pass_filter_alpha) are per frame and are not rescaled, so their time constants scale with the period: at
+* a slower rate the background and the low pass filters follow changes more slowly in time.
+*
+* Parameters
+* sample_period_ms: The new sample period in milliseconds
+*
+* Return Value
+* None
+*/
+void setGestureSamplePeriod(const float sample_period_ms);
+
+
+/**
+* This function obtains the processing statistics of the gesture algorithm.
+*
+* Parameters
+* stats: A pointer to a GestureStats structure
+*
+* Return Value
+* None
+*/
+void getGestureStats(GestureStats *stats);
+
+
+/**
+* These functions are the gesture engine equivalents of the functions above. They take the engine instance
+* to operate on as the first parameter and behave the same way otherwise.
+*
+* createGestureEngine allocates and initializes an engine on the heap; release it with destroyGestureEngine.
+* initGestureEngine initializes a statically allocated engine. Both configure the engine with default values.
+* getDefaultGestureEngine returns the engine used by configGesture, runGesture and resetGesture.
+*/
+GestureEngine * createGestureEngine();
+void destroyGestureEngine(GestureEngine *eng);
+void initGestureEngine(GestureEngine *eng);
+GestureEngine * getDefaultGestureEngine();
+void getGestureEngineConfig(const GestureEngine *eng, GestureConfig *_cfg);
+void configGestureEngine(GestureEngine *eng, const GestureConfig *cfg);
+void runGestureEngine(GestureEngine *eng, int pixels[], GestureResult *gesResult);
+void runGestureEngineBatch(GestureEngine *eng, int frames[], const unsigned int num_frames, GestureResult gesResults[]);
+void resetGestureEngine(GestureEngine *eng);
+void forceGestureEngineTrackingCalibration(GestureEngine *eng);
+void setGestureEngineSamplePeriod(GestureEngine *eng, const float sample_period_ms);
+void getGestureEngineStats(const GestureEngine *eng, GestureStats *stats);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
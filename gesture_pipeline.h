@@ -0,0 +1,492 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+#ifndef GESTURE_PIPELINE_H_INCLUDED
+#define GESTURE_PIPELINE_H_INCLUDED
+
+#include "gesture_common.h"
+
+/*
+* Compile-time composed gesture pipeline (C++).
+*
+* A pipeline is a chain of stages. Each stage is a class template whose parameter is the next stage, e.g.
+*
+*   GesturePipeline<WindowFilter<BackgroundSubtraction<Interpolation<ClampCenterOfMass<DynamicState<> > > > > >
+*
+* or GesturePipeline<GestureStages<GESTURE_MODE_DUAL, 1>::Stages> for the chain of a GestureMode.
+*
+* Every stage has a static template <class Geometry> run(GestureEngine *, PipelineFrame &) that does its work and
+* then calls Next::template run<Geometry>, so the compiler inlines the whole chain into GesturePipeline::run. A stage
+* left out of the chain costs nothing and no configuration flag is tested per frame: whether the window filter
+* runs is decided by the chain, not by GestureConfig.enable_window_filter. A custom stage is a template of the
+* same shape, inserted anywhere.
+*
+* The sensor resolution is the Geometry parameter of GesturePipeline, a SensorGeometry. The stage loops run over
+* its compile-time sizes, so they are unrolled for each geometry, and pipelines for sensors of different sizes can
+* be built into one program, each with its own engine. The default is SENSOR_XRES x SENSOR_YRES, which also sizes
+* the engine buffers.
+*
+* The stages keep their state in a GestureEngine, which still holds the configuration (configGestureEngine) and
+* is reset by resetGestureEngine. With the GestureStages chains below, a pipeline gives the same results as
+* runGestureEngine on an engine with the same configuration.
+*/
+
+// Resolution of the sensor a pipeline runs on. It must fit the engine buffers, which are sized by SENSOR_XRES and
+// SENSOR_YRES, and the interpolation table at MAX_INTERP_FACTOR; otherwise the FitsEngine array has a negative
+// size and the pipeline does not compile
+template <unsigned int xres, unsigned int yres>
+struct SensorGeometry {
+  enum {
+    XRES = xres,
+    YRES = yres,
+    NUM_PIXELS = xres * yres,
+    MAX_INTERP_WIDTH = (xres-1) * MAX_INTERP_FACTOR + 1,
+    MAX_INTERP_HEIGHT = (yres-1) * MAX_INTERP_FACTOR + 1
+  };
+  typedef char FitsEngine[xres >= 1 && yres >= 1
+    && NUM_PIXELS <= NUM_SENSOR_PIXELS
+    && MAX_INTERP_WIDTH * MAX_INTERP_HEIGHT <= MAX_NUM_INTERP_PIXELS
+    && MAX_INTERP_WIDTH <= MAX_INTERP_TABLE_LENGTH && MAX_INTERP_HEIGHT <= MAX_INTERP_TABLE_LENGTH ? 1 : -1];
+};
+
+typedef SensorGeometry<SENSOR_XRES, SENSOR_YRES> DefaultSensorGeometry;
+
+// Interpolation table of a pipeline for GestureConfig.interp_factor. A pipeline of another geometry than the default
+// builds its own table, again only when the factor of the engine changes; the engine table is not touched
+template <class Geometry>
+class PipelineInterpTable {
+public:
+  PipelineInterpTable() : factor(0), status(-1) {}
+
+  // Builds the table if the interpolation factor of the engine changed. Returns 0, or -1 if the table cannot be
+  // built for the factor, in which case the pipeline does not interpolate
+  int update(const GestureEngine *eng)
+  {
+    if (factor != eng->cfg.interp_factor) {
+      factor = eng->cfg.interp_factor;
+      status = buildInterpTable(&table, Geometry::XRES, Geometry::YRES, factor);
+      if (status) {
+        buildInterpTable(&table, Geometry::XRES, Geometry::YRES, 1);
+      }
+    }
+    return status;
+  }
+
+  const InterpTable * get(const GestureEngine *) const { return &table; }
+
+private:
+  InterpTable table;
+  unsigned int factor;      // GestureConfig.interp_factor the table was built for
+  int status;
+};
+
+// configGestureEngine builds the engine table for the default geometry, which its pipelines use
+template <>
+class PipelineInterpTable<DefaultSensorGeometry> {
+public:
+  int update(const GestureEngine *) { return 0; }
+  const InterpTable * get(const GestureEngine *eng) const { return &eng->interp_table; }
+};
+
+// Frame state handed from stage to stage
+struct PipelineFrame {
+  int *pixels;                    // Sensor frame, processed in place
+  int maxpixel;                   // Max pixel after the filters, see setPipelineMaxPixel
+  int active;                     // maxpixel reached end_detection_threshold. Position stages skip idle frames
+  int clamp_threshold;            // Pixels below this are clamped to zero before the center of mass
+  const InterpTable *interp_table;  // Interpolation table for the geometry of the pipeline
+  int *interp_pixels;             // Input of the clamp stage: pixels, or the interpolated frame
+  unsigned int interp_w, interp_h, interp_factor;
+  int use_roi;                    // Only roi of interp_pixels was interpolated
+  int roi_empty;                  // No pixel reaches the clamp threshold
+  PixelRect roi;
+  float x, y;                     // Center of mass in sensor pixels, y scaled by DY_PIXEL_SCALE. -1 if idle
+  int *tracking_pixels;           // Input of the tracking stages: pixels, or the copy made by CopyForTracking
+  int tracking_maxpixel;          // Max of tracking_pixels
+  int dynamic_result;             // DynamicState filled the result; tracking then only sets the tracking_ fields
+  GestureResult *result;
+};
+
+// Sets the max pixel of the filtered frame. A custom stage that replaces BackgroundSubtraction must call it
+static inline void setPipelineMaxPixel(const GestureEngine *eng, PipelineFrame &frame, const int maxpixel)
+{
+  const GestureConfig *cfg = &eng->cfg;
+  const int peak_threshold = (int)(maxpixel/cfg->zero_clamp_threshold_factor);
+  frame.maxpixel = maxpixel;
+  frame.active = maxpixel >= cfg->end_detection_threshold;
+  frame.clamp_threshold = peak_threshold > cfg->zero_clamp_threshold ? peak_threshold : cfg->zero_clamp_threshold;
+}
+
+// Last stage of every chain
+struct PipelineEnd {
+  template <class Geometry>
+  static void run(GestureEngine *, PipelineFrame &) {}
+};
+
+// 3-frame noise window filter
+template <class Next = PipelineEnd>
+struct WindowFilter {
+  template <class Geometry>
+  static void run(GestureEngine *eng, PipelineFrame &frame)
+  {
+    PROFILE_BEGIN(start);
+    int *pixels = frame.pixels;
+    if (eng->reset_flag) {
+      for (uint32_t i = 0; i < Geometry::NUM_PIXELS; i++) {
+        eng->nwin[0][i] = eng->nwin[1][i] = eng->nwin[2][i] = pixels[i]; // clear the filter
+      }
+    }
+    else {
+      for (uint32_t i = 0; i < Geometry::NUM_PIXELS; i++) {
+        int win[3] = {eng->nwin[0][i], eng->nwin[1][i], eng->nwin[2][i]};
+        #if GESTURE_FIXED_POINT
+          pixels[i] = windowFilterStepQ16(win, pixels[i], eng->window_filter_alpha_q16);
+        #else
+          pixels[i] = windowFilterStep(win, pixels[i], eng->cfg.window_filter_alpha);
+        #endif
+        eng->nwin[0][i] = win[0];
+        eng->nwin[1][i] = win[1];
+        eng->nwin[2][i] = win[2];
+      }
+    }
+    PROFILE_END(PROFILE_WINDOW_FILTER, start);
+    Next::template run<Geometry>(eng, frame);
+  }
+};
+
+// Static background subtraction. Sets the max pixel of the result
+template <class Next = PipelineEnd>
+struct BackgroundSubtraction {
+  template <class Geometry>
+  static void run(GestureEngine *eng, PipelineFrame &frame)
+  {
+    PROFILE_BEGIN(start);
+    DynamicGestureContext *ctx = &eng->dynamic;
+    int *pixels = frame.pixels;
+    if (eng->reset_flag) {
+      for (uint32_t i = 0; i < Geometry::NUM_PIXELS; i++) {
+        #if GESTURE_FIXED_POINT
+          ctx->foreground_pixels[i] = ctx->background_pixels[i] = pixels[i] * Q16_ONE; // clear the filter
+        #else
+          ctx->foreground_pixels[i] = ctx->background_pixels[i] = pixels[i]; // clear the filter
+        #endif
+      }
+    }
+    #if GESTURE_FIXED_POINT
+      int maxpixel = subtractBackgroundMaxQ16(pixels, ctx->foreground_pixels, ctx->background_pixels, Geometry::NUM_PIXELS, eng->low_pass_filter_alpha_q16, eng->background_filter_alpha_q16);
+    #else
+      int maxpixel = subtractBackgroundMax(pixels, ctx->foreground_pixels, ctx->background_pixels, Geometry::NUM_PIXELS, eng->cfg.low_pass_filter_alpha, eng->cfg.background_filter_alpha);
+    #endif
+    setPipelineMaxPixel(eng, frame, maxpixel);
+    PROFILE_END(PROFILE_BACKGROUND, start);
+    Next::template run<Geometry>(eng, frame);
+  }
+};
+
+// Interpolation by GestureConfig.interp_factor. Only the region that can survive the clamp is interpolated
+template <class Next = PipelineEnd>
+struct Interpolation {
+  template <class Geometry>
+  static void run(GestureEngine *eng, PipelineFrame &frame)
+  {
+    const InterpTable *interp = frame.interp_table;
+    if (frame.active && interp->factor > 1) {
+      PROFILE_BEGIN(start);
+      frame.interp_pixels = eng->interp_pixels;
+      frame.interp_w = interp->w2;
+      frame.interp_h = interp->h2;
+      frame.interp_factor = interp->factor;
+      if (frame.clamp_threshold >= 1) {
+        PixelRect src_rect;
+        frame.use_roi = TRUE;
+        if (findPixelBoundingBox(frame.pixels, Geometry::XRES, Geometry::YRES, frame.clamp_threshold, &src_rect)) {
+          interpRectFromSourceRect(interp, &src_rect, &frame.roi);
+          interpnTableRect(frame.pixels, frame.interp_pixels, interp, &frame.roi);
+        }
+        else {
+          frame.roi_empty = TRUE;
+        }
+      }
+      else {
+        interpnTable(frame.pixels, frame.interp_pixels, interp);
+      }
+      PROFILE_END(PROFILE_INTERP, start);
+    }
+    Next::template run<Geometry>(eng, frame);
+  }
+};
+
+// Clamp below the threshold and center of mass, in a single pass
+template <class Next = PipelineEnd>
+struct ClampCenterOfMass {
+  template <class Geometry>
+  static void run(GestureEngine *eng, PipelineFrame &frame)
+  {
+    if (frame.active) {
+      PROFILE_BEGIN(start);
+      float cmx = -1.0f, cmy = -1.0f;
+      int totalmass = 0;
+      if (frame.roi_empty) {
+        cmx = cmy = 0.0f; // Nothing survives the clamp, same result as an all-zero frame
+      }
+      else if (frame.use_roi) {
+        clampCenterOfMassRect(frame.interp_pixels, frame.interp_w, &frame.roi, frame.clamp_threshold, &cmx, &cmy, &totalmass);
+      }
+      else {
+        clampCenterOfMass(frame.interp_pixels, frame.interp_w, frame.interp_h, frame.clamp_threshold, &cmx, &cmy, &totalmass);
+      }
+      frame.x = cmx/frame.interp_factor;
+      frame.y = cmy/frame.interp_factor * DY_PIXEL_SCALE; // scale y so it has same unit dimension as x
+      PROFILE_END(PROFILE_CLAMP_COM, start);
+    }
+    Next::template run<Geometry>(eng, frame);
+  }
+};
+
+// Dynamic gesture state and result
+template <class Next = PipelineEnd>
+struct DynamicState {
+  template <class Geometry>
+  static void run(GestureEngine *eng, PipelineFrame &frame)
+  {
+    DynamicGestureContext *ctx = &eng->dynamic;
+    if (!frame.active) {
+      ctx->n_idle_frame++;
+    }
+    frame.dynamic_result = TRUE;
+
+    GestureResult *gesResult = frame.result;
+    gesResult->gesture = runSwipe(&ctx->swipe, frame.maxpixel, frame.x, frame.y);
+    gesResult->n_sample = ctx->swipe.n_sample;
+    gesResult->maxpixel = frame.maxpixel;
+    gesResult->state = frame.active ? GESTURE_IN_PROGRESS : STATE_INACTIVE;
+    gesResult->x = frame.x;
+    gesResult->y = frame.y;
+    Next::template run<Geometry>(eng, frame);
+  }
+};
+
+// Tracking mode: the tracking stages work on the window filtered pixels in place
+template <class Next = PipelineEnd>
+struct TrackingInput {
+  template <class Geometry>
+  static void run(GestureEngine *eng, PipelineFrame &frame)
+  {
+    frame.tracking_pixels = frame.pixels;
+    frame.tracking_maxpixel = getMaxPixelValue(frame.pixels, Geometry::NUM_PIXELS);
+    Next::template run<Geometry>(eng, frame);
+  }
+};
+
+// Dual mode: tracking works on the window filtered frame, which background subtraction and the dynamic gesture
+// stages change in place, so the tracking stages get a copy made in between
+template <class Next = PipelineEnd>
+struct CopyForTracking {
+  template <class Geometry>
+  static void run(GestureEngine *eng, PipelineFrame &frame)
+  {
+    memcpy(eng->tracking_pixels, frame.pixels, Geometry::NUM_PIXELS * sizeof(int));
+    frame.tracking_pixels = eng->tracking_pixels;
+    frame.tracking_maxpixel = getMaxPixelValue(eng->tracking_pixels, Geometry::NUM_PIXELS);
+    Next::template run<Geometry>(eng, frame);
+  }
+};
+
+// Tracking stages, see runTracking. They work on frame.tracking_pixels, after TrackingInput or CopyForTracking.
+// TrackingBiasCompensation must come first
+template <class Next = PipelineEnd>
+struct TrackingBiasCompensation {
+  template <class Geometry>
+  static void run(GestureEngine *eng, PipelineFrame &frame)
+  {
+    trackingBiasCompensation(&eng->tracking, &eng->cfg.trackingConfig, frame.tracking_pixels, Geometry::NUM_PIXELS, frame.tracking_maxpixel);
+    Next::template run<Geometry>(eng, frame);
+  }
+};
+
+template <class Next = PipelineEnd>
+struct TrackingLowPassFilter {
+  template <class Geometry>
+  static void run(GestureEngine *eng, PipelineFrame &frame)
+  {
+    trackingLowPassFilter(&eng->tracking, &eng->cfg.trackingConfig, frame.tracking_pixels, Geometry::NUM_PIXELS);
+    Next::template run<Geometry>(eng, frame);
+  }
+};
+
+template <class Next = PipelineEnd>
+struct TrackingGain {
+  template <class Geometry>
+  static void run(GestureEngine *eng, PipelineFrame &frame)
+  {
+    // Inlined, so the gain zone of every pixel is known at compile time
+    PROFILE_BEGIN(start);
+    applyTrackingGain(&eng->tracking, &eng->cfg.trackingConfig, frame.tracking_pixels, Geometry::XRES, Geometry::YRES);
+    PROFILE_END(PROFILE_TRACK_GAIN, start);
+    Next::template run<Geometry>(eng, frame);
+  }
+};
+
+// Tracking state and position. Without a dynamic gesture result they also fill the state, max pixel and position
+template <class Next = PipelineEnd>
+struct TrackingPosition {
+  template <class Geometry>
+  static void run(GestureEngine *eng, PipelineFrame &frame)
+  {
+    TrackingResult trackResult;
+    GestureResult *gesResult = frame.result;
+    trackingPosition(&eng->tracking, &eng->cfg.trackingConfig, frame.interp_table, eng->interp_pixels, frame.tracking_pixels, &trackResult);
+    gesResult->tracking_state = trackResult.state;
+    gesResult->tracking_maxpixel = trackResult.maxpixel;
+    gesResult->tracking_x = trackResult.x;
+    gesResult->tracking_y = trackResult.y;
+    if (!frame.dynamic_result) {
+      gesResult->state = trackResult.state;
+      gesResult->maxpixel = trackResult.maxpixel;
+      gesResult->x = trackResult.x;
+      gesResult->y = trackResult.y;
+    }
+    Next::template run<Geometry>(eng, frame);
+  }
+};
+
+// The algorithms of runGestureEngine
+typedef Interpolation<ClampCenterOfMass<DynamicState<> > > DynamicGesturePositionStages;
+typedef TrackingBiasCompensation<TrackingLowPassFilter<TrackingGain<TrackingPosition<> > > > TrackingStages;
+
+// The window filter in front of them, if enabled
+template <int window_filter, class Next>
+struct WindowFilterStages {
+  typedef WindowFilter<Next> Stages;
+};
+
+template <class Next>
+struct WindowFilterStages<0, Next> {
+  typedef Next Stages;
+};
+
+// The filters in front of the dynamic gesture stages
+template <int window_filter, class Next>
+struct FilterStages {
+  typedef typename WindowFilterStages<window_filter, BackgroundSubtraction<Next> >::Stages Stages;
+};
+
+// The chain of runGestureEngine for a GestureMode and GestureConfig.enable_window_filter setting. Tracking branches
+// off after the window filter, before background subtraction
+template <int gesture_mode, int window_filter>
+struct GestureStages {
+  typedef typename FilterStages<window_filter, DynamicGesturePositionStages>::Stages Stages;
+};
+
+template <int window_filter>
+struct GestureStages<GESTURE_MODE_TRACKING, window_filter> {
+  typedef typename WindowFilterStages<window_filter, TrackingInput<TrackingStages> >::Stages Stages;
+};
+
+template <int window_filter>
+struct GestureStages<GESTURE_MODE_DUAL, window_filter> {
+  typedef typename WindowFilterStages<window_filter,
+    CopyForTracking<BackgroundSubtraction<Interpolation<ClampCenterOfMass<DynamicState<TrackingStages> > > > > >::Stages Stages;
+};
+
+// Whether a configuration selects the algorithms that GestureStages<gesture_mode, window_filter> compiled in. The
+// chain ignores GestureConfig.gesture_mode and enable_window_filter, so a pipeline gives the same results as
+// runGestureEngine only if this holds
+template <int gesture_mode, int window_filter>
+inline int gestureStagesMatchConfig(const GestureConfig *cfg)
+{
+  return (int)cfg->gesture_mode == gesture_mode && (cfg->enable_window_filter != 0) == (window_filter != 0);
+}
+
+typedef GestureStages<GESTURE_MODE_DYNAMIC, 1>::Stages DynamicGestureStages;
+typedef GestureStages<GESTURE_MODE_DYNAMIC, 0>::Stages DynamicGestureStagesNoWindowFilter;
+
+template <class Stages, class Geometry = DefaultSensorGeometry>
+class GesturePipeline {
+public:
+  explicit GesturePipeline(GestureEngine *eng) : eng(eng), interp_status(interp.update(eng)) {}
+
+  GestureEngine * engine() const { return eng; }
+
+  // 0, or -1 if the interpolation table for GestureConfig.interp_factor could not be built for Geometry, in which
+  // case the pipeline does not interpolate. Checked at construction and whenever the factor changes
+  int interpStatus() const { return interp_status; }
+
+  // Processes one sensor frame of Geometry::NUM_PIXELS pixels in place, like runGestureEngine
+  void run(int pixels[], GestureResult *gesResult)
+  {
+    PROFILE_BEGIN(start);
+    memset(gesResult, 0, sizeof(GestureResult));
+    gesResult->state = STATE_INACTIVE;
+    gesResult->gesture = GEST_NONE;
+
+    interp_status = interp.update(eng);
+
+    PipelineFrame frame;
+    frame.pixels = pixels;
+    frame.maxpixel = 0;
+    frame.active = FALSE;
+    frame.clamp_threshold = 0;
+    frame.interp_table = interp.get(eng);
+    frame.interp_pixels = pixels;
+    frame.interp_w = Geometry::XRES;
+    frame.interp_h = Geometry::YRES;
+    frame.interp_factor = 1;
+    frame.use_roi = FALSE;
+    frame.roi_empty = FALSE;
+    frame.x = frame.y = -1.0f;
+    frame.tracking_pixels = pixels;
+    frame.tracking_maxpixel = 0;
+    frame.dynamic_result = FALSE;
+    frame.result = gesResult;
+
+    eng->dynamic.n_frame++;
+    if (eng->reset_flag) {
+      resetSwipe(&eng->dynamic.swipe);
+    }
+    Stages::template run<Geometry>(eng, frame);
+
+    // End a reset once the filters have been cleared
+    eng->reset_flag = FALSE;
+    PROFILE_END(PROFILE_FRAME, start);
+  }
+
+private:
+  GestureEngine *eng;
+  PipelineInterpTable<Geometry> interp;
+  int interp_status;
+};
+
+#endif
@@ -0,0 +1,637 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+/*
+* Microbenchmarks of the gesture library: every image kernel (img_utils.h) of the selected kernel set, the
+* stages of the algorithm on their own (the noise window filter, the filters together, the dynamic gesture
+* stages that follow them, as in runDynamicGesture, and runTracking), and whole frames through runGestureEngine,
+* runGestureEngineBatch and the compiled pipeline in every gesture mode. Each runs on a set of idle frames and
+* a set of frames with an object moving over the sensor, at every interpolation factor where the factor matters.
+* The results are written as JSON, one entry per benchmark with the median and minimum time per frame over the
+* repetitions, so they can be compared between builds.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "gesture_pipeline.h"
+#include "img_utils.h"
+
+#define BENCH_FRAMES 64             // Frames per repetition: one revolution of the moving object
+#define BENCH_WARMUP_FRAMES 128     // Idle frames before the frame set, enough for the tracking bias calibration
+#define BENCH_MIN_TIME_MS 20
+#define BENCH_MIN_REPS 10
+#define BENCH_MAX_REPS 100000
+
+static void usage(const char *prog)
+{
+  fprintf(stderr,
+    "usage: %s [-k kernels] [-t ms] [-l label] [-o output.json]\n"
+    "  -k kernels image kernel set: scalar, sse2 or avx2 (default: best supported by this CPU)\n"
+    "  -t ms      minimum time per benchmark (default %d)\n"
+    "  -l label   label written to the output, e.g. the commit measured\n"
+    "  -o file    write the results to file instead of stdout\n", prog, BENCH_MIN_TIME_MS);
+}
+
+static const unsigned int interpFactors[] = {1, 2, 4, 8};
+#define NUM_INTERP_FACTORS (sizeof(interpFactors) / sizeof(interpFactors[0]))
+
+static const char * const modeNames[] = {"dynamic", "tracking", "dual"};
+
+// Sensor frames of one kind, and the same frames after the window filter and background subtraction
+struct FrameSet {
+  const char *name;
+  int raw[BENCH_FRAMES * NUM_SENSOR_PIXELS];
+  int filtered[BENCH_FRAMES * NUM_SENSOR_PIXELS];
+  int maxpixel[BENCH_FRAMES];           // Of the filtered frames
+  int clamp_threshold[BENCH_FRAMES];    // Clamp threshold of the filtered frames, as runGestureEngine computes it
+  unsigned int active_frames;           // Frames with maxpixel at or above end_detection_threshold
+};
+
+// Which frames a benchmark processes
+enum BenchInput {
+  INPUT_RAW,
+  INPUT_FILTERED,
+  INPUT_INTERPOLATED      // Filtered frames interpolated by the interpolation factor
+};
+
+struct BenchState {
+  GestureConfig cfg;
+  GestureEngine *eng;                   // Engine configured with cfg, for the stage and frame benchmarks
+  InterpTable table;
+  const FrameSet *set;
+  int *scratch;                         // Input of a repetition, copied from the frame set before it
+  unsigned int stride;                  // Pixels per frame in scratch
+  unsigned int w, h;                    // Resolution of the frames in scratch
+  PixelRect roi[BENCH_FRAMES];          // Interpolated region of interest of each frame, see interpRectFromSourceRect
+  int roi_valid[BENCH_FRAMES];
+  int out[MAX_NUM_INTERP_PIXELS];
+  float short_avg[NUM_SENSOR_PIXELS], long_avg[NUM_SENSOR_PIXELS];
+  q16_t short_avg_q16[NUM_SENSOR_PIXELS], long_avg_q16[NUM_SENSOR_PIXELS];
+  GestureResult results[BENCH_FRAMES];
+};
+
+// Results of the pure kernels are summed here, so that they are observable
+static volatile int benchSink;
+
+static int * scratchFrame(BenchState &s, const unsigned int f)
+{
+  return s.scratch + (size_t)f * s.stride;
+}
+
+// Kernels
+static void benchGetMaxPixelValue(BenchState &s)
+{
+  for (unsigned int f = 0; f < BENCH_FRAMES; f++) {
+    benchSink += getMaxPixelValue(scratchFrame(s, f), s.stride);
+  }
+}
+
+static void benchGetMinPixelValue(BenchState &s)
+{
+  for (unsigned int f = 0; f < BENCH_FRAMES; f++) {
+    benchSink += getMinPixelValue(scratchFrame(s, f), s.stride);
+  }
+}
+
+static void benchZeroPixelsBelowThreshold(BenchState &s)
+{
+  for (unsigned int f = 0; f < BENCH_FRAMES; f++) {
+    benchSink += zeroPixelsBelowThreshold(scratchFrame(s, f), s.w * s.h, s.set->clamp_threshold[f]);
+  }
+}
+
+static void benchFilterLowPassPixels(BenchState &s)
+{
+  for (unsigned int f = 0; f < BENCH_FRAMES; f++) {
+    filterLowPassPixels(scratchFrame(s, f), s.short_avg, NUM_SENSOR_PIXELS, s.cfg.low_pass_filter_alpha);
+  }
+}
+
+static void benchSubtractBackground(BenchState &s)
+{
+  for (unsigned int f = 0; f < BENCH_FRAMES; f++) {
+    subtractBackground(scratchFrame(s, f), s.short_avg, s.long_avg, NUM_SENSOR_PIXELS, s.cfg.low_pass_filter_alpha, s.cfg.background_filter_alpha);
+  }
+}
+
+static void benchSubtractBackgroundMax(BenchState &s)
+{
+  for (unsigned int f = 0; f < BENCH_FRAMES; f++) {
+    benchSink += subtractBackgroundMax(scratchFrame(s, f), s.short_avg, s.long_avg, NUM_SENSOR_PIXELS, s.cfg.low_pass_filter_alpha, s.cfg.background_filter_alpha);
+  }
+}
+
+static void benchFilterLowPassPixelsQ16(BenchState &s)
+{
+  const q16_t alpha = floatToQ16(s.cfg.low_pass_filter_alpha);
+  for (unsigned int f = 0; f < BENCH_FRAMES; f++) {
+    filterLowPassPixelsQ16(scratchFrame(s, f), s.short_avg_q16, NUM_SENSOR_PIXELS, alpha);
+  }
+}
+
+static void benchSubtractBackgroundQ16(BenchState &s)
+{
+  const q16_t alpha_short = floatToQ16(s.cfg.low_pass_filter_alpha);
+  const q16_t alpha_long = floatToQ16(s.cfg.background_filter_alpha);
+  for (unsigned int f = 0; f < BENCH_FRAMES; f++) {
+    subtractBackgroundQ16(scratchFrame(s, f), s.short_avg_q16, s.long_avg_q16, NUM_SENSOR_PIXELS, alpha_short, alpha_long);
+  }
+}
+
+static void benchSubtractBackgroundMaxQ16(BenchState &s)
+{
+  const q16_t alpha_short = floatToQ16(s.cfg.low_pass_filter_alpha);
+  const q16_t alpha_long = floatToQ16(s.cfg.background_filter_alpha);
+  for (unsigned int f = 0; f < BENCH_FRAMES; f++) {
+    benchSink += subtractBackgroundMaxQ16(scratchFrame(s, f), s.short_avg_q16, s.long_avg_q16, NUM_SENSOR_PIXELS, alpha_short, alpha_long);
+  }
+}
+
+static void benchCalcCenterOfMass(BenchState &s)
+{
+  for (unsigned int f = 0; f < BENCH_FRAMES; f++) {
+    float cmx, cmy;
+    int totalmass;
+    calcCenterOfMass(scratchFrame(s, f), s.w, s.h, &cmx, &cmy, &totalmass);
+    benchSink += totalmass;
+  }
+}
+
+static void benchClampCenterOfMass(BenchState &s)
+{
+  for (unsigned int f = 0; f < BENCH_FRAMES; f++) {
+    float cmx, cmy;
+    int totalmass;
+    benchSink += clampCenterOfMass(scratchFrame(s, f), s.w, s.h, s.set->clamp_threshold[f], &cmx, &cmy, &totalmass);
+  }
+}
+
+static void benchClampCenterOfMassRect(BenchState &s)
+{
+  for (unsigned int f = 0; f < BENCH_FRAMES; f++) {
+    if (s.roi_valid[f]) {
+      float cmx, cmy;
+      int totalmass;
+      benchSink += clampCenterOfMassRect(scratchFrame(s, f), s.w, &s.roi[f], s.set->clamp_threshold[f], &cmx, &cmy, &totalmass);
+    }
+  }
+}
+
+static void benchFindPixelBoundingBox(BenchState &s)
+{
+  for (unsigned int f = 0; f < BENCH_FRAMES; f++) {
+    PixelRect rect;
+    benchSink += findPixelBoundingBox(scratchFrame(s, f), SENSOR_XRES, SENSOR_YRES, s.set->clamp_threshold[f], &rect);
+  }
+}
+
+static void benchInterpn(BenchState &s)
+{
+  for (unsigned int f = 0; f < BENCH_FRAMES; f++) {
+    interpn(scratchFrame(s, f), s.out, SENSOR_XRES, SENSOR_YRES, s.table.factor);
+  }
+}
+
+static void benchInterpnTable(BenchState &s)
+{
+  for (unsigned int f = 0; f < BENCH_FRAMES; f++) {
+    interpnTable(scratchFrame(s, f), s.out, &s.table);
+  }
+}
+
+// The region of interest interpolation as runDynamicGesture does it: bounding box, region, interpolation
+static void benchInterpnTableRect(BenchState &s)
+{
+  for (unsigned int f = 0; f < BENCH_FRAMES; f++) {
+    PixelRect src_rect, roi;
+    if (findPixelBoundingBox(scratchFrame(s, f), SENSOR_XRES, SENSOR_YRES, s.set->clamp_threshold[f], &src_rect)) {
+      interpRectFromSourceRect(&s.table, &src_rect, &roi);
+      interpnTableRect(scratchFrame(s, f), s.out, &s.table, &roi);
+    }
+  }
+}
+
+// Stages
+template <class Stages>
+static void runStages(BenchState &s)
+{
+  GesturePipeline<Stages> pipeline(s.eng);
+  for (unsigned int f = 0; f < BENCH_FRAMES; f++) {
+    pipeline.run(scratchFrame(s, f), &s.results[f]);
+  }
+}
+
+// Stands in for the filter stages in front of the dynamic gesture stages: sets the max pixel of the filtered frame
+static const int *benchMaxPixel;
+
+template <class Next = PipelineEnd>
+struct FilteredMaxPixel {
+  template <class Geometry>
+  static void run(GestureEngine *eng, PipelineFrame &frame)
+  {
+    setPipelineMaxPixel(eng, frame, *benchMaxPixel++);
+    Next::template run<Geometry>(eng, frame);
+  }
+};
+
+static void benchWindowFilter(BenchState &s)
+{
+  runStages<WindowFilter<> >(s);
+}
+
+static void benchFilterStages(BenchState &s)
+{
+  runStages<FilterStages<1, PipelineEnd>::Stages>(s);
+}
+
+// Interpolation, clamp, center of mass and swipe state of a filtered frame, the work of runDynamicGesture
+static void benchDynamicGesture(BenchState &s)
+{
+  benchMaxPixel = s.set->maxpixel;
+  runStages<FilteredMaxPixel<DynamicGesturePositionStages> >(s);
+}
+
+static void benchTracking(BenchState &s)
+{
+  for (unsigned int f = 0; f < BENCH_FRAMES; f++) {
+    TrackingResult result;
+    runTracking(&s.eng->tracking, &s.eng->cfg.trackingConfig, &s.eng->interp_table, s.eng->interp_pixels, scratchFrame(s, f), s.set->maxpixel[f], &result);
+    benchSink += result.state;
+  }
+}
+
+// Whole frames
+static void benchRunGestureEngine(BenchState &s)
+{
+  for (unsigned int f = 0; f < BENCH_FRAMES; f++) {
+    runGestureEngine(s.eng, scratchFrame(s, f), &s.results[f]);
+  }
+}
+
+static void benchRunGestureEngineBatch(BenchState &s)
+{
+  runGestureEngineBatch(s.eng, s.scratch, BENCH_FRAMES, s.results);
+}
+
+static void benchPipeline(BenchState &s)
+{
+  switch (s.cfg.gesture_mode) {
+    case GESTURE_MODE_TRACKING: runStages<GestureStages<GESTURE_MODE_TRACKING, 1>::Stages>(s); break;
+    case GESTURE_MODE_DUAL: runStages<GestureStages<GESTURE_MODE_DUAL, 1>::Stages>(s); break;
+    default: runStages<GestureStages<GESTURE_MODE_DYNAMIC, 1>::Stages>(s); break;
+  }
+}
+
+#define MODE_MASK(mode) (1 << (mode))
+#define ALL_MODES (MODE_MASK(GESTURE_MODE_DYNAMIC) | MODE_MASK(GESTURE_MODE_TRACKING) | MODE_MASK(GESTURE_MODE_DUAL))
+
+struct Benchmark {
+  const char *group;
+  const char *name;
+  BenchInput input;
+  int per_factor;         // Run at every interpolation factor
+  int modes;              // Gesture modes to run in on a warmed up engine, 0 for the kernels, which need none
+  void (*run)(BenchState &s);
+};
+
+static const Benchmark benchmarks[] = {
+  {"kernel", "getMaxPixelValue", INPUT_FILTERED, 0, 0, benchGetMaxPixelValue},
+  {"kernel", "getMinPixelValue", INPUT_FILTERED, 0, 0, benchGetMinPixelValue},
+  {"kernel", "filterLowPassPixels", INPUT_RAW, 0, 0, benchFilterLowPassPixels},
+  {"kernel", "subtractBackground", INPUT_RAW, 0, 0, benchSubtractBackground},
+  {"kernel", "subtractBackgroundMax", INPUT_RAW, 0, 0, benchSubtractBackgroundMax},
+  {"kernel", "filterLowPassPixelsQ16", INPUT_RAW, 0, 0, benchFilterLowPassPixelsQ16},
+  {"kernel", "subtractBackgroundQ16", INPUT_RAW, 0, 0, benchSubtractBackgroundQ16},
+  {"kernel", "subtractBackgroundMaxQ16", INPUT_RAW, 0, 0, benchSubtractBackgroundMaxQ16},
+  {"kernel", "findPixelBoundingBox", INPUT_FILTERED, 0, 0, benchFindPixelBoundingBox},
+  {"kernel", "interpn", INPUT_FILTERED, 1, 0, benchInterpn},
+  {"kernel", "interpnTable", INPUT_FILTERED, 1, 0, benchInterpnTable},
+  {"kernel", "interpnTableRect", INPUT_FILTERED, 1, 0, benchInterpnTableRect},
+  {"kernel", "zeroPixelsBelowThreshold", INPUT_INTERPOLATED, 1, 0, benchZeroPixelsBelowThreshold},
+  {"kernel", "calcCenterOfMass", INPUT_INTERPOLATED, 1, 0, benchCalcCenterOfMass},
+  {"kernel", "clampCenterOfMass", INPUT_INTERPOLATED, 1, 0, benchClampCenterOfMass},
+  {"kernel", "clampCenterOfMassRect", INPUT_INTERPOLATED, 1, 0, benchClampCenterOfMassRect},
+  {"stage", "windowFilter", INPUT_RAW, 0, MODE_MASK(GESTURE_MODE_DYNAMIC), benchWindowFilter},
+  {"stage", "filterStages", INPUT_RAW, 0, MODE_MASK(GESTURE_MODE_DYNAMIC), benchFilterStages},
+  {"stage", "dynamicGesture", INPUT_FILTERED, 1, MODE_MASK(GESTURE_MODE_DYNAMIC), benchDynamicGesture},
+  {"stage", "runTracking", INPUT_FILTERED, 1, MODE_MASK(GESTURE_MODE_TRACKING), benchTracking},
+  {"frame", "runGestureEngine", INPUT_RAW, 1, ALL_MODES, benchRunGestureEngine},
+  {"frame", "runGestureEngineBatch", INPUT_RAW, 1, ALL_MODES, benchRunGestureEngineBatch},
+  {"frame", "GesturePipeline", INPUT_RAW, 1, ALL_MODES, benchPipeline},
+};
+#define NUM_BENCHMARKS (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+/*
+* Synthetic frames: a fixed background with noise, and for the active set a Gaussian spot, like a hand, circling
+* the center of the sensor once per BENCH_FRAMES frames. The noise is a fixed pseudo-random sequence
+*/
+static uint32_t benchRng = 1;
+
+static int benchNoise(const int amplitude)
+{
+  // xorshift32
+  benchRng ^= benchRng << 13;
+  benchRng ^= benchRng >> 17;
+  benchRng ^= benchRng << 5;
+  return (int)(benchRng % (uint32_t)(2*amplitude + 1)) - amplitude;
+}
+
+static int benchBackground[NUM_SENSOR_PIXELS];
+
+static void generateFrames(int frames[], const unsigned int num_frames, const int active)
+{
+  for (unsigned int f = 0; f < num_frames; f++) {
+    const float angle = 6.2831853F * f / BENCH_FRAMES;
+    const float x = (SENSOR_XRES - 1) / 2.0F + 3 * cosf(angle);
+    const float y = (SENSOR_YRES - 1) / 2.0F + 1.5F * sinf(angle);
+    for (int i = 0; i < NUM_SENSOR_PIXELS; i++) {
+      int pixel = benchBackground[i] + benchNoise(8);
+      if (active) {
+        const float dx = i % SENSOR_XRES - x;
+        const float dy = (i / SENSOR_XRES - y) * DY_PIXEL_SCALE;
+        pixel += (int)(2500 * expf(-(dx*dx + dy*dy) / 3.0F));
+      }
+      frames[(size_t)f * NUM_SENSOR_PIXELS + i] = pixel;
+    }
+  }
+}
+
+static int warmupFrames[BENCH_WARMUP_FRAMES * NUM_SENSOR_PIXELS];
+static int scratchBuffer[BENCH_FRAMES * MAX_NUM_INTERP_PIXELS];
+
+// Brings an engine to the state it has while processing the frame set: the warm-up frames, then one pass of the set
+template <class Stages>
+static void warmUp(GestureEngine *eng, const FrameSet *set, GestureResult results[])
+{
+  GesturePipeline<Stages> pipeline(eng);
+  memcpy(scratchBuffer, warmupFrames, sizeof(warmupFrames));
+  for (unsigned int f = 0; f < BENCH_WARMUP_FRAMES; f++) {
+    pipeline.run(scratchBuffer + (size_t)f * NUM_SENSOR_PIXELS, &results[f % BENCH_FRAMES]);
+  }
+  memcpy(scratchBuffer, set->raw, sizeof(set->raw));
+  for (unsigned int f = 0; f < BENCH_FRAMES; f++) {
+    pipeline.run(scratchBuffer + (size_t)f * NUM_SENSOR_PIXELS, &results[f]);
+  }
+}
+
+// Fills in the filtered frames of a frame set, as the filter stages leave them after warming up
+static void filterFrameSet(FrameSet *set)
+{
+  GestureConfig cfg;
+  initConfigStructToDefaults(&cfg);
+  GestureEngine *eng = createGestureEngine();
+  configGestureEngine(eng, &cfg);
+  GestureResult results[BENCH_FRAMES];
+  warmUp<FilterStages<1, PipelineEnd>::Stages>(eng, set, results);
+
+  GesturePipeline<FilterStages<1, PipelineEnd>::Stages> pipeline(eng);
+  memcpy(set->filtered, set->raw, sizeof(set->raw));
+  set->active_frames = 0;
+  for (unsigned int f = 0; f < BENCH_FRAMES; f++) {
+    int *pixels = set->filtered + (size_t)f * NUM_SENSOR_PIXELS;
+    pipeline.run(pixels, &results[f]);
+    const int maxpixel = getMaxPixelValue(pixels, NUM_SENSOR_PIXELS);
+    const int peak_threshold = (int)(maxpixel/cfg.zero_clamp_threshold_factor);
+    set->maxpixel[f] = maxpixel;
+    set->clamp_threshold[f] = peak_threshold > cfg.zero_clamp_threshold ? peak_threshold : cfg.zero_clamp_threshold;
+    set->active_frames += maxpixel >= cfg.end_detection_threshold;
+  }
+  destroyGestureEngine(eng);
+}
+
+static void prepareEngine(BenchState &s)
+{
+  s.eng = createGestureEngine();
+  if (!s.eng) {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+  }
+  configGestureEngine(s.eng, &s.cfg);
+  switch (s.cfg.gesture_mode) {
+    case GESTURE_MODE_TRACKING: warmUp<GestureStages<GESTURE_MODE_TRACKING, 1>::Stages>(s.eng, s.set, s.results); break;
+    case GESTURE_MODE_DUAL: warmUp<GestureStages<GESTURE_MODE_DUAL, 1>::Stages>(s.eng, s.set, s.results); break;
+    default: warmUp<GestureStages<GESTURE_MODE_DYNAMIC, 1>::Stages>(s.eng, s.set, s.results); break;
+  }
+}
+
+// Copies the input of a repetition into scratch
+static void prepareInput(BenchState &s, const BenchInput input, int *interpolated)
+{
+  if (input == INPUT_INTERPOLATED) {
+    memcpy(s.scratch, interpolated, (size_t)BENCH_FRAMES * s.stride * sizeof(int));
+  }
+  else {
+    memcpy(s.scratch, input == INPUT_RAW ? s.set->raw : s.set->filtered, sizeof(s.set->raw));
+  }
+}
+
+static double monotonicSeconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compareDouble(const void *a, const void *b)
+{
+  const double x = *(const double *)a, y = *(const double *)b;
+  return x < y ? -1 : x > y;
+}
+
+static int interpolatedBuffer[BENCH_FRAMES * MAX_NUM_INTERP_PIXELS];
+static double repTimes[BENCH_MAX_REPS];
+
+// Runs one benchmark and writes its JSON entry
+static void runBenchmark(FILE *out, const Benchmark *bench, const FrameSet *set, const int gesture_mode, const unsigned int factor,
+                         const double min_time, int *first)
+{
+  static BenchState s;
+  memset(&s, 0, sizeof(s));
+  initConfigStructToDefaults(&s.cfg);
+  s.cfg.gesture_mode = gesture_mode >= 0 ? gesture_mode : s.cfg.gesture_mode;
+  s.cfg.interp_factor = factor ? factor : s.cfg.interp_factor;
+  s.set = set;
+  s.scratch = scratchBuffer;
+  buildInterpTable(&s.table, SENSOR_XRES, SENSOR_YRES, s.cfg.interp_factor);
+  s.stride = NUM_SENSOR_PIXELS;
+  s.w = SENSOR_XRES;
+  s.h = SENSOR_YRES;
+
+  if (bench->input == INPUT_INTERPOLATED) {
+    s.stride = s.w = s.table.w2;
+    s.h = s.table.h2;
+    s.stride *= s.h;
+    for (unsigned int f = 0; f < BENCH_FRAMES; f++) {
+      const int *pixels = set->filtered + (size_t)f * NUM_SENSOR_PIXELS;
+      PixelRect src_rect;
+      interpnTable(pixels, interpolatedBuffer + (size_t)f * s.stride, &s.table);
+      s.roi_valid[f] = findPixelBoundingBox(pixels, SENSOR_XRES, SENSOR_YRES, set->clamp_threshold[f], &src_rect) != 0;
+      if (s.roi_valid[f]) {
+        interpRectFromSourceRect(&s.table, &src_rect, &s.roi[f]);
+      }
+    }
+  }
+  if (bench->modes) {
+    prepareEngine(s);
+  }
+
+  // Repeat until both the minimum time and the minimum number of repetitions are reached
+  unsigned int reps = 0;
+  double total = 0;
+  while ((total < min_time || reps < BENCH_MIN_REPS) && reps < BENCH_MAX_REPS) {
+    prepareInput(s, bench->input, interpolatedBuffer);
+    const double start = monotonicSeconds();
+    bench->run(s);
+    repTimes[reps] = monotonicSeconds() - start;
+    total += repTimes[reps++];
+  }
+  qsort(repTimes, reps, sizeof(double), compareDouble);
+  if (s.eng) {
+    destroyGestureEngine(s.eng);
+  }
+
+  fprintf(out, "%s\n    {\"group\": \"%s\", \"name\": \"%s\", \"frames\": \"%s\", \"mode\": ", *first ? "" : ",", bench->group, bench->name, set->name);
+  if (gesture_mode >= 0) {
+    fprintf(out, "\"%s\"", modeNames[gesture_mode]);
+  }
+  else {
+    fprintf(out, "null");
+  }
+  fprintf(out, ", \"interp_factor\": ");
+  if (factor) {
+    fprintf(out, "%u", factor);
+  }
+  else {
+    fprintf(out, "null");
+  }
+  fprintf(out, ", \"ns_per_frame\": %.2f, \"ns_per_frame_min\": %.2f, \"reps\": %u}",
+    repTimes[reps / 2] * 1e9 / BENCH_FRAMES, repTimes[0] * 1e9 / BENCH_FRAMES, reps);
+  *first = 0;
+}
+
+static FrameSet frameSets[2];
+
+int main(int argc, char *argv[])
+{
+  const char *kernels = NULL;
+  const char *label = NULL;
+  const char *out_path = NULL;
+  unsigned int min_time_ms = BENCH_MIN_TIME_MS;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "k:t:l:o:h")) != -1) {
+    switch (opt) {
+      case 'k': kernels = optarg; break;
+      case 't': min_time_ms = strtoul(optarg, NULL, 0); break;
+      case 'l': label = optarg; break;
+      case 'o': out_path = optarg; break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if (optind != argc) {
+    usage(argv[0]);
+    return 2;
+  }
+  if (selectImgUtilsKernels(kernels)) {
+    fprintf(stderr, "kernel set %s is not available\n", kernels);
+    return 2;
+  }
+  FILE *out = stdout;
+  if (out_path) {
+    out = fopen(out_path, "w");
+    if (!out) {
+      perror(out_path);
+      return 1;
+    }
+  }
+
+  for (int i = 0; i < NUM_SENSOR_PIXELS; i++) {
+    benchBackground[i] = 800 + benchNoise(50);
+  }
+  generateFrames(warmupFrames, BENCH_WARMUP_FRAMES, FALSE);
+  frameSets[0].name = "idle";
+  generateFrames(frameSets[0].raw, BENCH_FRAMES, FALSE);
+  frameSets[1].name = "active";
+  generateFrames(frameSets[1].raw, BENCH_FRAMES, TRUE);
+  for (int i = 0; i < 2; i++) {
+    filterFrameSet(&frameSets[i]);
+  }
+
+  fprintf(out, "{\n  \"tool\": \"gesture_bench\",\n");
+  if (label) {
+    fprintf(out, "  \"label\": \"");
+    for (const char *c = label; *c; c++) {
+      fprintf(out, *c == '"' || *c == '\\' ? "\\%c" : "%c", *c);
+    }
+    fprintf(out, "\",\n");
+  }
+  fprintf(out, "  \"kernels\": \"%s\",\n  \"fixed_point\": %s,\n  \"profile\": %s,\n", getImgUtilsKernels()->name,
+    GESTURE_FIXED_POINT ? "true" : "false", GESTURE_PROFILE ? "true" : "false");
+  fprintf(out, "  \"frames_per_rep\": %d,\n  \"frame_sets\": {\"idle\": {\"active_frames\": %u}, \"active\": {\"active_frames\": %u}},\n",
+    BENCH_FRAMES, frameSets[0].active_frames, frameSets[1].active_frames);
+  fprintf(out, "  \"results\": [");
+
+  const double start = monotonicSeconds();
+  unsigned int count = 0;
+  int first = 1;
+  for (unsigned int b = 0; b < NUM_BENCHMARKS; b++) {
+    const Benchmark *bench = &benchmarks[b];
+    for (int mode = -1; mode < 3; mode++) {
+      // The kernels run once without an engine, the others in each of their modes
+      if (bench->modes ? mode < 0 || !(bench->modes & MODE_MASK(mode)) : mode >= 0) {
+        continue;
+      }
+      for (unsigned int k = 0; k < NUM_INTERP_FACTORS; k++) {
+        if (!bench->per_factor && k) {
+          break;
+        }
+        for (int i = 0; i < 2; i++) {
+          runBenchmark(out, bench, &frameSets[i], mode, bench->per_factor ? interpFactors[k] : 0, min_time_ms * 1e-3, &first);
+          count++;
+        }
+      }
+    }
+  }
+  fprintf(out, "\n  ]\n}\n");
+  fprintf(stderr, "%u benchmarks in %.1f s, %s kernels\n", count, monotonicSeconds() - start, getImgUtilsKernels()->name);
+  if (out != stdout) {
+    fclose(out);
+  }
+  return 0;
+}
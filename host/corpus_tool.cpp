@@ -0,0 +1,705 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+/*
+* Golden corpus regression check. The corpus (host/corpus) holds the frame sequences listed in its corpus.txt and,
+* in its golden directory, the results of the reference implementation (runGestureEngine frame by frame with
+* the scalar image kernels) for every sequence in every configuration of corpusConfigs, written with -g.
+* The check runs every sequence through every processing variant with every image kernel set this CPU supports
+* and compares the results field by field with the golden results. The results must be bit-exact, except in a
+* GESTURE_FIXED_POINT build, where maxpixel and the positions may differ by the rounding of the Q16 filters.
+* -S writes the synthetic sequences of the corpus.
+*/
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "frame_io.h"
+#include "gesture_config.h"
+#include "gesture_pipeline.h"
+#include "img_utils.h"
+#include "stream_group.h"
+
+static void usage(const char *prog)
+{
+  fprintf(stderr,
+    "usage: %s [-l] [-v variant] [-k kernels] <corpus dir>\n"
+    "       %s -g <corpus dir>\n"
+    "       %s -S <corpus dir>\n"
+    "  -l         list every run, not only the runs that differ from the golden results\n"
+    "  -v variant check only this variant: frame, batch, pipeline or streams\n"
+    "  -k kernels check only this image kernel set: scalar, sse2 or avx2. Exits with 77 (skipped) if this CPU\n"
+    "             does not support it\n"
+    "  -g         write the golden results of every sequence with the reference implementation\n"
+    "  -S         write the synthetic sequences\n", prog, prog, prog);
+}
+
+// Configurations every sequence is checked in
+struct CorpusConfig {
+  int gesture_mode;
+  unsigned int interp_factor;
+  int window_filter;
+};
+
+static const CorpusConfig corpusConfigs[] = {
+  {GESTURE_MODE_DYNAMIC, 1, 1},
+  {GESTURE_MODE_DYNAMIC, 2, 1},
+  {GESTURE_MODE_DYNAMIC, 4, 1},
+  {GESTURE_MODE_DYNAMIC, 8, 1},
+  {GESTURE_MODE_TRACKING, 1, 1},
+  {GESTURE_MODE_TRACKING, 4, 1},
+  {GESTURE_MODE_TRACKING, 8, 1},
+  {GESTURE_MODE_TRACKING, 4, 0},
+  {GESTURE_MODE_DUAL, 1, 1},
+  {GESTURE_MODE_DUAL, 4, 1},
+  {GESTURE_MODE_DUAL, 8, 1},
+  {GESTURE_MODE_DUAL, 4, 0},
+};
+#define NUM_CORPUS_CONFIGS (sizeof(corpusConfigs) / sizeof(corpusConfigs[0]))
+
+static const char * const modeNames[] = {"dynamic", "tracking", "dual"};
+
+// Ways of running the algorithm that must give the reference results
+enum Variant {
+  VARIANT_FRAME,      // runGestureEngine frame by frame, the reference
+  VARIANT_BATCH,      // runGestureEngineBatch
+  VARIANT_PIPELINE,   // The compile-time composed pipeline the firmware runs (gesture_pipeline.h)
+  VARIANT_STREAMS,    // The stream group engine (host/stream_group.h), dynamic mode only
+  NUM_VARIANTS
+};
+
+static const char * const variantNames[NUM_VARIANTS] = {"frame", "batch", "pipeline", "streams"};
+
+static const char * const kernelNames[] = {"scalar", "sse2", "avx2"};
+#define NUM_KERNEL_SETS (sizeof(kernelNames) / sizeof(kernelNames[0]))
+#define EXIT_SKIPPED 77 // -k names a kernel set this CPU does not support, the skip code of ctest and automake
+
+// Fields of GestureResult written to the result files
+enum Field {
+  FIELD_GESTURE,
+  FIELD_STATE,
+  FIELD_N_SAMPLE,
+  FIELD_MAXPIXEL,
+  FIELD_X,
+  FIELD_Y,
+  FIELD_TRACKING_STATE,
+  FIELD_TRACKING_MAXPIXEL,
+  FIELD_TRACKING_X,
+  FIELD_TRACKING_Y,
+  NUM_FIELDS
+};
+
+static const char * const fieldNames[NUM_FIELDS] = {
+  "gesture", "state", "n_sample", "maxpixel", "x", "y", "tracking_state", "tracking_maxpixel", "tracking_x", "tracking_y"
+};
+
+#if GESTURE_FIXED_POINT
+// The Q16 filters round differently from float: maxpixel may be off by a count and the positions by the
+// resulting shift of the center of mass, largest on the weak first frames of an object. The events and
+// states must match
+static const double fieldTolerance[NUM_FIELDS] = {0, 0, 0, 1, 0.05, 0.05, 0, 1, 0.05, 0.05};
+#else
+static const double fieldTolerance[NUM_FIELDS] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+#endif
+
+static double fieldValue(const GestureResult *result, const int field)
+{
+  switch (field) {
+    case FIELD_GESTURE: return result->gesture;
+    case FIELD_STATE: return result->state;
+    case FIELD_N_SAMPLE: return result->n_sample;
+    case FIELD_MAXPIXEL: return result->maxpixel;
+    case FIELD_X: return result->x;
+    case FIELD_Y: return result->y;
+    case FIELD_TRACKING_STATE: return result->tracking_state;
+    case FIELD_TRACKING_MAXPIXEL: return result->tracking_maxpixel;
+    case FIELD_TRACKING_X: return result->tracking_x;
+    default: return result->tracking_y;
+  }
+}
+
+// snprintf that fails instead of truncating. Returns -1 if the result does not fit in size bytes
+static int formatString(char *str, const size_t size, const char *format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  const int len = vsnprintf(str, size, format, args);
+  va_end(args);
+  if (len < 0 || (size_t)len >= size) {
+    fprintf(stderr, "%s...: too long\n", str);
+    return -1;
+  }
+  return 0;
+}
+
+static int goldenPath(char *path, const size_t size, const char *dir, const char *name, const CorpusConfig *config)
+{
+  return formatString(path, size, "%s/golden/%s_%s_x%u%s.csv", dir, name, modeNames[config->gesture_mode],
+    config->interp_factor, config->window_filter ? "" : "_nowf");
+}
+
+static void corpusGestureConfig(const CorpusConfig *config, GestureConfig *cfg)
+{
+  initConfigStructToDefaults(cfg);
+  cfg->gesture_mode = config->gesture_mode;
+  cfg->interp_factor = config->interp_factor;
+  cfg->enable_window_filter = config->window_filter;
+}
+
+template <class Pipeline>
+static void runPipeline(Pipeline &pipeline, int *work, const unsigned int num_frames, GestureResult results[])
+{
+  for (unsigned int f = 0; f < num_frames; f++) {
+    pipeline.run(work + (size_t)f * NUM_SENSOR_PIXELS, &results[f]);
+  }
+}
+
+template <int gesture_mode>
+static void runStages(GestureEngine *eng, const int window_filter, int *work, const unsigned int num_frames, GestureResult results[])
+{
+  if (window_filter) {
+    GesturePipeline<typename GestureStages<gesture_mode, 1>::Stages> pipeline(eng);
+    runPipeline(pipeline, work, num_frames, results);
+  }
+  else {
+    GesturePipeline<typename GestureStages<gesture_mode, 0>::Stages> pipeline(eng);
+    runPipeline(pipeline, work, num_frames, results);
+  }
+}
+
+// Runs a sequence through one variant on a fresh engine. Returns -1 if the variant does not support the mode
+static int runVariant(const int variant, const GestureConfig *cfg, const int *frames, int *work, const unsigned int num_frames, GestureResult results[])
+{
+  if (variant == VARIANT_STREAMS) {
+    if (cfg->gesture_mode != GESTURE_MODE_DYNAMIC) {
+      return -1;
+    }
+    GestureStreamGroup *grp = createGestureStreamGroup(cfg);
+    if (!grp) {
+      fprintf(stderr, "out of memory\n");
+      exit(1);
+    }
+    // The sequence runs on lane 0, the other lanes have no frames
+    const int *lanes[GESTURE_STREAM_LANES] = {NULL};
+    GestureResult laneResults[GESTURE_STREAM_LANES];
+    for (unsigned int f = 0; f < num_frames; f++) {
+      lanes[0] = frames + (size_t)f * NUM_SENSOR_PIXELS;
+      runGestureStreams(grp, lanes, laneResults);
+      results[f] = laneResults[0];
+    }
+    destroyGestureStreamGroup(grp);
+    return 0;
+  }
+
+  // A fresh engine for every run, since the tracking bias calibration survives resetGestureEngine
+  GestureEngine *eng = createGestureEngine();
+  if (!eng) {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+  }
+  configGestureEngine(eng, cfg);
+  memcpy(work, frames, (size_t)num_frames * NUM_SENSOR_PIXELS * sizeof(int));
+  switch (variant) {
+    case VARIANT_BATCH:
+      runGestureEngineBatch(eng, work, num_frames, results);
+      break;
+    case VARIANT_PIPELINE:
+      switch (cfg->gesture_mode) {
+        case GESTURE_MODE_TRACKING:
+          runStages<GESTURE_MODE_TRACKING>(eng, cfg->enable_window_filter, work, num_frames, results);
+          break;
+        case GESTURE_MODE_DUAL:
+          runStages<GESTURE_MODE_DUAL>(eng, cfg->enable_window_filter, work, num_frames, results);
+          break;
+        default:
+          runStages<GESTURE_MODE_DYNAMIC>(eng, cfg->enable_window_filter, work, num_frames, results);
+          break;
+      }
+      break;
+    default:
+      for (unsigned int f = 0; f < num_frames; f++) {
+        runGestureEngine(eng, work + (size_t)f * NUM_SENSOR_PIXELS, &results[f]);
+      }
+      break;
+  }
+  destroyGestureEngine(eng);
+  return 0;
+}
+
+// Differences of one field over a sequence
+struct FieldStats {
+  unsigned int frames;    // Frames that differ
+  double max_error;
+  double sum_error;
+};
+
+// Compares the results of a run with the golden results. Returns 0 if bit-exact, 1 if within the tolerances
+// and -1 if not. The first frame outside the tolerances is reported
+static int compareResults(const char *run, const GestureResult *golden, const unsigned int num_golden,
+                          const GestureResult *results, const unsigned int num_frames, const int list)
+{
+  if (num_golden != num_frames) {
+    printf("%s: FAIL, %u golden results for %u frames\n", run, num_golden, num_frames);
+    return -1;
+  }
+  FieldStats stats[NUM_FIELDS];
+  memset(stats, 0, sizeof(stats));
+  int first = -1;
+  int first_field = 0;
+  for (unsigned int f = 0; f < num_frames; f++) {
+    for (int i = 0; i < NUM_FIELDS; i++) {
+      const double error = fabs(fieldValue(&results[f], i) - fieldValue(&golden[f], i));
+      // Compared as values, so a NaN on one side only is a difference
+      if (error > 0 || fieldValue(&results[f], i) != fieldValue(&golden[f], i)) {
+        stats[i].frames++;
+        stats[i].sum_error += error;
+        stats[i].max_error = error > stats[i].max_error ? error : stats[i].max_error;
+        if (first < 0 && !(error <= fieldTolerance[i])) {
+          first = (int)f;
+          first_field = i;
+        }
+      }
+    }
+  }
+
+  int differ = 0;
+  for (int i = 0; i < NUM_FIELDS; i++) {
+    differ |= stats[i].frames != 0;
+  }
+  if (first >= 0) {
+    printf("%s: FAIL, first divergence at frame %d: %s %.9g, golden %.9g\n", run, first, fieldNames[first_field],
+      fieldValue(&results[first], first_field), fieldValue(&golden[first], first_field));
+  }
+  else if (differ) {
+    printf("%s: ok, within tolerance\n", run);
+  }
+  else if (list) {
+    printf("%s: ok, bit-exact\n", run);
+  }
+  for (int i = 0; i < NUM_FIELDS; i++) {
+    if (stats[i].frames) {
+      printf("  %-18s %5u frames differ, max error %.6g, mean error %.6g\n", fieldNames[i], stats[i].frames,
+        stats[i].max_error, stats[i].sum_error / stats[i].frames);
+    }
+  }
+  return first >= 0 ? -1 : differ;
+}
+
+// Reads the sequence names of corpus.txt, one per line or separated by whitespace. '#' starts a comment
+static int loadCorpusList(const char *dir, char names[][64], const unsigned int max_names, unsigned int *num_names)
+{
+  char path[4096];
+  if (formatString(path, sizeof(path), "%s/corpus.txt", dir)) {
+    return -1;
+  }
+  FILE *fp = fopen(path, "r");
+  if (!fp) {
+    perror(path);
+    return -1;
+  }
+  *num_names = 0;
+  char line[256];
+  while (fgets(line, sizeof(line), fp)) {
+    char *comment = strchr(line, '#');
+    if (comment) {
+      *comment = '\0';
+    }
+    for (char *tok = strtok(line, " \t\r\n"); tok; tok = strtok(NULL, " \t\r\n")) {
+      if (*num_names == max_names || strlen(tok) >= sizeof(names[0])) {
+        fprintf(stderr, "%s: too many sequences or name too long\n", path);
+        fclose(fp);
+        return -1;
+      }
+      strcpy(names[(*num_names)++], tok);
+    }
+  }
+  fclose(fp);
+  return 0;
+}
+
+static int loadSequence(const char *dir, const char *name, int **frames, unsigned int *num_frames)
+{
+  char path[4096];
+  if (formatString(path, sizeof(path), "%s/%s.csv", dir, name)) {
+    return -1;
+  }
+  return loadFrameFile(path, FRAME_FORMAT_TEXT, frames, num_frames);
+}
+
+static int writeGolden(const char *dir, char names[][64], const unsigned int num_names)
+{
+  char path[4096];
+  if (formatString(path, sizeof(path), "%s/golden", dir)) {
+    return 1;
+  }
+  mkdir(path, 0777);
+  selectImgUtilsKernels("scalar");
+  for (unsigned int s = 0; s < num_names; s++) {
+    int *frames;
+    unsigned int num_frames;
+    if (loadSequence(dir, names[s], &frames, &num_frames)) {
+      return 1;
+    }
+    int *work = (int *)malloc((size_t)num_frames * NUM_SENSOR_PIXELS * sizeof(int));
+    GestureResult *results = (GestureResult *)malloc((size_t)num_frames * sizeof(GestureResult));
+    if (!work || !results) {
+      fprintf(stderr, "out of memory\n");
+      return 1;
+    }
+    for (unsigned int c = 0; c < NUM_CORPUS_CONFIGS; c++) {
+      GestureConfig cfg;
+      corpusGestureConfig(&corpusConfigs[c], &cfg);
+      runVariant(VARIANT_FRAME, &cfg, frames, work, num_frames, results);
+      if (goldenPath(path, sizeof(path), dir, names[s], &corpusConfigs[c])) {
+        return 1;
+      }
+      FILE *out = fopen(path, "w");
+      if (!out) {
+        perror(path);
+        return 1;
+      }
+      writeResultHeader(out);
+      for (unsigned int f = 0; f < num_frames; f++) {
+        writeResult(out, f, &results[f]);
+      }
+      fclose(out);
+    }
+    printf("%s: %u frames\n", names[s], num_frames);
+    free(results);
+    free(work);
+    free(frames);
+  }
+  return 0;
+}
+
+static int check(const char *dir, char names[][64], const unsigned int num_names, const int only_variant, const char *only_kernels, const int list)
+{
+  unsigned int runs = 0, exact = 0, tolerated = 0, failed = 0;
+  for (unsigned int s = 0; s < num_names; s++) {
+    int *frames;
+    unsigned int num_frames;
+    if (loadSequence(dir, names[s], &frames, &num_frames)) {
+      return 1;
+    }
+    int *work = (int *)malloc((size_t)num_frames * NUM_SENSOR_PIXELS * sizeof(int));
+    GestureResult *results = (GestureResult *)malloc((size_t)num_frames * sizeof(GestureResult));
+    if (!work || !results) {
+      fprintf(stderr, "out of memory\n");
+      return 1;
+    }
+    for (unsigned int c = 0; c < NUM_CORPUS_CONFIGS; c++) {
+      char path[4096];
+      GestureResult *golden;
+      unsigned int num_golden;
+      if (goldenPath(path, sizeof(path), dir, names[s], &corpusConfigs[c]) || loadResultFile(path, &golden, &num_golden)) {
+        return 1;
+      }
+      GestureConfig cfg;
+      corpusGestureConfig(&corpusConfigs[c], &cfg);
+      for (unsigned int k = 0; k < NUM_KERNEL_SETS; k++) {
+        if ((only_kernels && strcmp(only_kernels, kernelNames[k]) != 0) || selectImgUtilsKernels(kernelNames[k])) {
+          continue;
+        }
+        for (int v = 0; v < NUM_VARIANTS; v++) {
+          if ((only_variant >= 0 && v != only_variant) || runVariant(v, &cfg, frames, work, num_frames, results)) {
+            continue;
+          }
+          char run[256];
+          if (formatString(run, sizeof(run), "%s %s x%u%s %s/%s", names[s], modeNames[cfg.gesture_mode],
+                cfg.interp_factor, cfg.enable_window_filter ? "" : " nowf", variantNames[v], kernelNames[k])) {
+            return 1;
+          }
+          const int status = compareResults(run, golden, num_golden, results, num_frames, list);
+          runs++;
+          exact += status == 0;
+          tolerated += status == 1;
+          failed += status < 0;
+        }
+      }
+      free(golden);
+    }
+    free(results);
+    free(work);
+    free(frames);
+  }
+  printf("%u runs: %u bit-exact, %u within tolerance, %u failed\n", runs, exact, tolerated, failed);
+  return failed || !runs ? 1 : 0;
+}
+
+/*
+* Synthetic sequences. An object is a Gaussian spot on a noisy background, like a hand over the sensor, clipped
+* at the ADC full scale. The noise is a fixed pseudo-random sequence, so a sequence is regenerated exactly.
+*/
+class SyntheticSequence {
+public:
+  SyntheticSequence(FILE *fp, const uint32_t seed, const int noise) : fp(fp), rng(seed), noise(noise), offset(0), drift(0)
+  {
+    for (int i = 0; i < NUM_SENSOR_PIXELS; i++) {
+      background[i] = 800 + random(50);
+    }
+  }
+
+  // Background offset added per frame, like a slow temperature change, and a sudden offset step
+  void setDrift(const float per_frame) { drift = per_frame; }
+  void step(const float delta) { offset += delta; }
+
+  void idle(const unsigned int frames)
+  {
+    for (unsigned int f = 0; f < frames; f++) {
+      write(0, 0, 0);
+    }
+  }
+
+  // Moves the object from (x0, y0) to (x1, y1), in pixels, with its peak going from amplitude0 to amplitude1
+  void move(const float x0, const float y0, const float x1, const float y1, const unsigned int frames,
+            const float amplitude0, const float amplitude1)
+  {
+    for (unsigned int f = 0; f < frames; f++) {
+      const float t = frames > 1 ? (float)f / (frames - 1) : 0;
+      write(x0 + t*(x1 - x0), y0 + t*(y1 - y0), amplitude0 + t*(amplitude1 - amplitude0));
+    }
+  }
+
+  void move(const float x0, const float y0, const float x1, const float y1, const unsigned int frames, const float amplitude)
+  {
+    move(x0, y0, x1, y1, frames, amplitude, amplitude);
+  }
+
+  void circle(const float cx, const float cy, const float rx, const float ry, const unsigned int frames, const float amplitude)
+  {
+    for (unsigned int f = 0; f < frames; f++) {
+      const float angle = 6.2831853F * f / frames;
+      write(cx + rx*cosf(angle), cy + ry*sinf(angle), amplitude);
+    }
+  }
+
+private:
+  int random(const int amplitude)
+  {
+    // xorshift32
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return (int)(rng % (uint32_t)(2*amplitude + 1)) - amplitude;
+  }
+
+  void write(const float x, const float y, const float amplitude)
+  {
+    offset += drift;
+    for (int j = 0; j < SENSOR_YRES; j++) {
+      for (int i = 0; i < SENSOR_XRES; i++) {
+        const float dx = i - x;
+        const float dy = (j - y) * DY_PIXEL_SCALE;
+        int pixel = background[j*SENSOR_XRES + i] + (int)offset + random(noise);
+        if (amplitude > 0) {
+          pixel += (int)(amplitude * expf(-(dx*dx + dy*dy) / 3.0F));
+        }
+        pixel = pixel < ADC_FULL_SCALE ? pixel : ADC_FULL_SCALE - 1;
+        fprintf(fp, "%d%s", pixel, j*SENSOR_XRES + i < NUM_SENSOR_PIXELS - 1 ? "," : "\n");
+      }
+    }
+  }
+
+  FILE *fp;
+  uint32_t rng;
+  int noise;
+  float offset;
+  float drift;
+  int background[NUM_SENSOR_PIXELS];
+};
+
+// Swipes cross the whole sensor from outside it
+static void swipe(SyntheticSequence &seq, const GestureEvent direction, const unsigned int frames, const float amplitude)
+{
+  const float cx = (SENSOR_XRES - 1) / 2.0F;
+  const float cy = (SENSOR_YRES - 1) / 2.0F;
+  switch (direction) {
+    case GEST_SWIPE_LEFT: seq.move(SENSOR_XRES, cy, -1, cy, frames, amplitude); break;
+    case GEST_SWIPE_RIGHT: seq.move(-1, cy, SENSOR_XRES, cy, frames, amplitude); break;
+    case GEST_SWIPE_UP: seq.move(cx, SENSOR_YRES, cx, -1, frames, amplitude); break;
+    default: seq.move(cx, -1, cx, SENSOR_YRES, frames, amplitude); break;
+  }
+}
+
+static int writeSynthetic(const char *dir)
+{
+  static const char * const names[] = {"idle_drift", "swipes", "speeds", "hover", "threshold", "saturation", "noisy"};
+  const float cx = (SENSOR_XRES - 1) / 2.0F;
+  const float cy = (SENSOR_YRES - 1) / 2.0F;
+  for (unsigned int s = 0; s < sizeof(names) / sizeof(names[0]); s++) {
+    char path[4096];
+    if (formatString(path, sizeof(path), "%s/%s.csv", dir, names[s])) {
+      return 1;
+    }
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+      perror(path);
+      return 1;
+    }
+    fprintf(fp, "# Synthetic sequence %s, written by gesture_corpus -S\n", names[s]);
+    // Sequences with tracking start with enough idle frames for its bias calibration (STATIC_STATE_BIAS_MS)
+    SyntheticSequence seq(fp, 1 + s, strcmp(names[s], "noisy") == 0 ? 60 : 8);
+    switch (s) {
+      case 0:   // Nothing present: slow background drift and an offset step below the detection threshold
+        seq.idle(60);
+        seq.setDrift(0.5F);
+        seq.idle(80);
+        seq.setDrift(0);
+        seq.step(40);
+        seq.idle(60);
+        break;
+      case 1:   // One swipe in each direction
+        seq.idle(110);
+        swipe(seq, GEST_SWIPE_RIGHT, 30, 2500);
+        seq.idle(25);
+        swipe(seq, GEST_SWIPE_LEFT, 30, 2500);
+        seq.idle(25);
+        swipe(seq, GEST_SWIPE_DOWN, 30, 2500);
+        seq.idle(25);
+        swipe(seq, GEST_SWIPE_UP, 30, 2500);
+        seq.idle(25);
+        break;
+      case 2:   // A fast swipe, one below the minimum speed, and a diagonal one that is neither horizontal nor vertical
+        seq.idle(60);
+        swipe(seq, GEST_SWIPE_RIGHT, 8, 2500);
+        seq.idle(30);
+        swipe(seq, GEST_SWIPE_LEFT, 60, 2500);
+        seq.idle(30);
+        seq.move(-1, -1, SENSOR_XRES, SENSOR_YRES, 30, 2500);
+        seq.idle(30);
+        break;
+      case 3:   // Tracking: hold, circle, then the corners through all gain zones
+        seq.idle(110);
+        seq.move(-1, cy, cx, cy, 15, 2500);
+        seq.move(cx, cy, cx, cy, 50, 2500);
+        seq.circle(cx, cy, 3, 1.5F, 60, 2500);
+        seq.move(cx, cy, 0, 0, 15, 2500);
+        seq.move(0, 0, 0, 0, 10, 2500);
+        seq.move(0, 0, SENSOR_XRES - 1, 0, 15, 2500);
+        seq.move(SENSOR_XRES - 1, 0, SENSOR_XRES - 1, SENSOR_YRES - 1, 15, 2500);
+        seq.move(SENSOR_XRES - 1, SENSOR_YRES - 1, 0, SENSOR_YRES - 1, 15, 2500);
+        seq.move(0, SENSOR_YRES - 1, -2, SENSOR_YRES - 1, 10, 2500);
+        seq.idle(20);
+        break;
+      case 4:   // Weak objects around the detection thresholds: a slow rise the background filter partly follows,
+                // and a weak swipe
+        seq.idle(60);
+        seq.move(cx - 1, cy, cx + 1, cy, 60, 0, 500);
+        seq.move(cx + 1, cy, cx - 1, cy, 60, 500, 0);
+        seq.idle(30);
+        swipe(seq, GEST_SWIPE_RIGHT, 30, 180);
+        seq.idle(20);
+        break;
+      case 5:   // An object far above the ADC full scale
+        seq.idle(60);
+        seq.move(cx, cy, cx, cy, 20, 30000);
+        swipe(seq, GEST_SWIPE_RIGHT, 20, 30000);
+        seq.idle(20);
+        break;
+      default:  // Swipes in heavy noise
+        seq.idle(60);
+        swipe(seq, GEST_SWIPE_RIGHT, 30, 2500);
+        seq.idle(20);
+        swipe(seq, GEST_SWIPE_UP, 30, 2500);
+        seq.idle(20);
+        break;
+    }
+    fclose(fp);
+    printf("%s\n", path);
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[])
+{
+  int golden = 0;
+  int synthetic = 0;
+  int list = 0;
+  int only_variant = -1;
+  const char *only_kernels = NULL;
+  unsigned int k;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "gSlv:k:h")) != -1) {
+    switch (opt) {
+      case 'g': golden = 1; break;
+      case 'S': synthetic = 1; break;
+      case 'l': list = 1; break;
+      case 'v':
+        for (only_variant = NUM_VARIANTS - 1; only_variant >= 0; only_variant--) {
+          if (strcmp(optarg, variantNames[only_variant]) == 0) {
+            break;
+          }
+        }
+        if (only_variant < 0) {
+          usage(argv[0]);
+          return 2;
+        }
+        break;
+      case 'k':
+        only_kernels = optarg;
+        for (k = 0; k < NUM_KERNEL_SETS && strcmp(optarg, kernelNames[k]) != 0; k++) {}
+        if (k == NUM_KERNEL_SETS) {
+          usage(argv[0]);
+          return 2;
+        }
+        break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if (optind != argc - 1 || golden + synthetic > 1) {
+    usage(argv[0]);
+    return 2;
+  }
+  const char *dir = argv[optind];
+  if (only_kernels && !golden && !synthetic && selectImgUtilsKernels(only_kernels)) {
+    printf("%s kernels are not supported on this CPU\n", only_kernels);
+    return EXIT_SKIPPED;
+  }
+  if (synthetic) {
+    return writeSynthetic(dir);
+  }
+
+  static char names[256][64];
+  unsigned int num_names;
+  if (loadCorpusList(dir, names, sizeof(names) / sizeof(names[0]), &num_names)) {
+    return 1;
+  }
+  return golden ? writeGolden(dir, names, num_names) : check(dir, names, num_names, only_variant, only_kernels, list);
+}
@@ -0,0 +1,402 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+#include <errno.h>
+#include "frame_io.h"
+
+// Frames are appended to a growing buffer. Start with one second of data at the default sample period
+#define INITIAL_FRAME_CAPACITY 64
+
+static int appendFrame(int **frames, unsigned int *num_frames, unsigned int *capacity, const int pixels[])
+{
+  if (*num_frames == *capacity) {
+    unsigned int new_capacity = *capacity ? *capacity * 2 : INITIAL_FRAME_CAPACITY;
+    int *new_frames = (int *)realloc(*frames, (size_t)new_capacity * NUM_SENSOR_PIXELS * sizeof(int));
+    if (!new_frames) {
+      return -1;
+    }
+    *frames = new_frames;
+    *capacity = new_capacity;
+  }
+  memcpy(*frames + (size_t)(*num_frames) * NUM_SENSOR_PIXELS, pixels, NUM_SENSOR_PIXELS * sizeof(int));
+  (*num_frames)++;
+  return 0;
+}
+
+static int loadTextFrames(FILE *fp, const char *path, int **frames, unsigned int *num_frames, unsigned int *capacity)
+{
+  char line[2048];
+  unsigned int line_num = 0;
+  while (fgets(line, sizeof(line), fp)) {
+    line_num++;
+    char *comment = strchr(line, '#');
+    if (comment) {
+      *comment = 0;
+    }
+
+    int pixels[NUM_SENSOR_PIXELS];
+    unsigned int count = 0;
+    char *tok = strtok(line, ", \t\r\n");
+    while (tok && count < NUM_SENSOR_PIXELS) {
+      char *end;
+      pixels[count++] = (int)strtol(tok, &end, 0);
+      if (*end != 0) {
+        fprintf(stderr, "%s:%u: invalid pixel value '%s'\n", path, line_num, tok);
+        return -1;
+      }
+      tok = strtok(NULL, ", \t\r\n");
+    }
+    if (count == 0) {
+      continue; // blank or comment line
+    }
+    if (count != NUM_SENSOR_PIXELS || tok != NULL) {
+      fprintf(stderr, "%s:%u: expected %d pixels per frame\n", path, line_num, NUM_SENSOR_PIXELS);
+      return -1;
+    }
+    if (appendFrame(frames, num_frames, capacity, pixels)) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+// Same conversion as convertTwoUnsignedBytesToInt() in controller.cpp
+static int streamBytesToInt(const uint8_t hi_byte, const uint8_t lo_byte)
+{
+  int intval = (int)(hi_byte << 8 | lo_byte);
+  if ((1 << 15) < intval)
+    intval -= (1 << 16);
+  return intval;
+}
+
+static int appendStreamFrame(StreamFrame **frames, unsigned int *num_frames, unsigned int *capacity, const StreamFrame *frame)
+{
+  if (*num_frames == *capacity) {
+    unsigned int new_capacity = *capacity ? *capacity * 2 : INITIAL_FRAME_CAPACITY;
+    StreamFrame *new_frames = (StreamFrame *)realloc(*frames, (size_t)new_capacity * sizeof(StreamFrame));
+    if (!new_frames) {
+      return -1;
+    }
+    *frames = new_frames;
+    *capacity = new_capacity;
+  }
+  (*frames)[(*num_frames)++] = *frame;
+  return 0;
+}
+
+// Fields of a version 1 frame, at the offsets written by processFrame()
+static void decodeStreamV1Frame(const uint8_t frm_data[], const uint8_t seq, StreamFrame *frame)
+{
+  memset(frame, 0, sizeof(StreamFrame));
+  frame->seq = seq;
+  frame->encoding = STREAM_PIXELS_PACKED;
+  frame->result.gesture = (GestureEvent)frm_data[2];
+  frame->result.state = frm_data[3];
+  frame->result.n_sample = frm_data[4];
+  frame->result.maxpixel = streamBytesToInt(frm_data[6], frm_data[7]);
+  memcpy(&frame->result.x, frm_data + 10, 4);
+  memcpy(&frame->result.y, frm_data + 15, 4);
+  for (uint32_t i=0; i<NUM_SENSOR_PIXELS; i++) {
+    frame->pixels[i] = streamBytesToInt(frm_data[2*i + STREAM_INFO_BYTES], frm_data[2*i+1 + STREAM_INFO_BYTES]);
+  }
+}
+
+static int readWholeFile(FILE *fp, uint8_t **data, size_t *length)
+{
+  size_t capacity = 1 << 16;
+  *data = NULL;
+  *length = 0;
+  while (1) {
+    uint8_t *new_data = (uint8_t *)realloc(*data, capacity);
+    if (!new_data) {
+      free(*data);
+      return -1;
+    }
+    *data = new_data;
+    *length += fread(*data + *length, 1, capacity - *length, fp);
+    if (*length < capacity) {
+      return ferror(fp) ? -1 : 0;
+    }
+    capacity *= 2;
+  }
+}
+
+// Decodes the frames of a capture held in memory. Resynchronizes byte by byte on anything that is not a valid frame
+static int decodeStreamCapture(const uint8_t *data, const size_t length, StreamFrame **frames, unsigned int *num_frames, StreamCaptureStats *stats)
+{
+  StreamDecoder decoder;
+  StreamFrame frame;
+  unsigned int capacity = 0;
+  uint8_t v1_seq = 0;
+  size_t pos = 0;
+  initStreamDecoder(&decoder);
+  memset(stats, 0, sizeof(StreamCaptureStats));
+  while (pos + 1 < length) {
+    int frame_length = -1;
+    if (data[pos] == 0xFF && data[pos+1] == 0xFF) {
+      if (length - pos < STREAM_FRAME_BYTES) {
+        break; // truncated last frame
+      }
+      decodeStreamV1Frame(data + pos, v1_seq++, &frame);
+      frame_length = STREAM_FRAME_BYTES;
+      stats->v1_frames++;
+    }
+    else if (data[pos] == STREAM_V2_SYNC && data[pos+1] == STREAM_V2_SYNC2) {
+      frame_length = decodeStreamFrame(&decoder, data + pos, length - pos, &frame);
+      if (frame_length == 0) {
+        break; // truncated last frame
+      }
+      if (frame_length == -2) {
+        stats->v2_skipped++;
+        frame_length = STREAM_V2_HEADER_BYTES + data[pos + 13] + 1;
+        stats->frame_bytes += frame_length;
+        pos += frame_length;
+        continue;
+      }
+      if (frame_length > 0) {
+        stats->v2_frames++;
+      }
+    }
+    if (frame_length < 0) {
+      stats->garbage_bytes++;
+      pos++;
+      continue;
+    }
+    if (appendStreamFrame(frames, num_frames, &capacity, &frame)) {
+      return -1;
+    }
+    stats->frame_bytes += frame_length;
+    pos += frame_length;
+  }
+  stats->garbage_bytes += length - pos;
+  return 0;
+}
+
+int loadStreamCapture(const char *path, StreamFrame **frames, unsigned int *num_frames, StreamCaptureStats *stats)
+{
+  FILE *fp = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+  if (!fp) {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    return -1;
+  }
+  uint8_t *data;
+  size_t length;
+  int status = readWholeFile(fp, &data, &length);
+  if (fp != stdin) {
+    fclose(fp);
+  }
+  *frames = NULL;
+  *num_frames = 0;
+  if (status == 0) {
+    status = decodeStreamCapture(data, length, frames, num_frames, stats);
+    free(data);
+  }
+  if (status) {
+    fprintf(stderr, "%s: read error or out of memory\n", path);
+    free(*frames);
+    *frames = NULL;
+    *num_frames = 0;
+  }
+  return status;
+}
+
+// Keeps the frames of a capture that carry pixel data
+static int loadStreamFrames(const char *path, int **frames, unsigned int *num_frames, unsigned int *capacity)
+{
+  StreamFrame *stream_frames;
+  unsigned int num_stream_frames;
+  StreamCaptureStats stats;
+  if (loadStreamCapture(path, &stream_frames, &num_stream_frames, &stats)) {
+    return -1;
+  }
+  int status = 0;
+  for (unsigned int f = 0; f < num_stream_frames && status == 0; f++) {
+    if (stream_frames[f].encoding != STREAM_PIXELS_NONE) {
+      status = appendFrame(frames, num_frames, capacity, stream_frames[f].pixels);
+    }
+  }
+  free(stream_frames);
+  return status;
+}
+
+// Frames of the first valid dump in a capture file
+static int loadCaptureFrames(const char *path, int **frames, unsigned int *num_frames, unsigned int *capacity)
+{
+  FILE *fp = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+  if (!fp) {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    return -1;
+  }
+  uint8_t *data;
+  size_t length;
+  int status = readWholeFile(fp, &data, &length);
+  if (fp != stdin) {
+    fclose(fp);
+  }
+  if (status) {
+    fprintf(stderr, "%s: read error or out of memory\n", path);
+    return -1;
+  }
+  CaptureDump dump;
+  if (decodeCaptureDump(data, length, &dump)) {
+    fprintf(stderr, "%s: no complete capture dump\n", path);
+    free(data);
+    return -1;
+  }
+  for (unsigned int r = 0; r < dump.num_records && status == 0; r++) {
+    uint32_t timestamp_us, frame;
+    int pixels[NUM_SENSOR_PIXELS];
+    frameBytesToPixels(getCaptureDumpRecord(&dump, r, &timestamp_us, &frame), pixels, FALSE);
+    status = appendFrame(frames, num_frames, capacity, pixels);
+  }
+  free(data);
+  return status;
+}
+
+int loadFrameFile(const char *path, const FrameFormat format, int **frames, unsigned int *num_frames)
+{
+  unsigned int capacity = 0;
+  *frames = NULL;
+  *num_frames = 0;
+  int status;
+  if (format == FRAME_FORMAT_STREAM) {
+    status = loadStreamFrames(path, frames, num_frames, &capacity);
+  }
+  else if (format == FRAME_FORMAT_CAPTURE) {
+    status = loadCaptureFrames(path, frames, num_frames, &capacity);
+  }
+  else {
+    FILE *fp = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!fp) {
+      fprintf(stderr, "%s: %s\n", path, strerror(errno));
+      return -1;
+    }
+    status = loadTextFrames(fp, path, frames, num_frames, &capacity);
+    if (fp != stdin) {
+      fclose(fp);
+    }
+  }
+  if (status) {
+    free(*frames);
+    *frames = NULL;
+    *num_frames = 0;
+  }
+  return status;
+}
+
+int parseGestureMode(const char *name)
+{
+  if (strcmp(name, "dynamic") == 0) {
+    return GESTURE_MODE_DYNAMIC;
+  }
+  if (strcmp(name, "tracking") == 0) {
+    return GESTURE_MODE_TRACKING;
+  }
+  if (strcmp(name, "dual") == 0) {
+    return GESTURE_MODE_DUAL;
+  }
+  return -1;
+}
+
+void writeResultHeader(FILE *fp)
+{
+  fprintf(fp, "frame,gesture,state,n_sample,maxpixel,x,y,tracking_state,tracking_maxpixel,tracking_x,tracking_y\n");
+}
+
+void writeResult(FILE *fp, const unsigned int frame, const GestureResult *result)
+{
+  fprintf(fp, "%u,%d,%u,%u,%d,%.9g,%.9g,%u,%d,%.9g,%.9g\n",
+    frame,
+    (int)result->gesture,
+    result->state,
+    result->n_sample,
+    result->maxpixel,
+    result->x,
+    result->y,
+    result->tracking_state,
+    result->tracking_maxpixel,
+    result->tracking_x,
+    result->tracking_y
+  );
+}
+
+int loadResultFile(const char *path, GestureResult **results, unsigned int *num_results)
+{
+  *results = NULL;
+  *num_results = 0;
+  FILE *fp = fopen(path, "r");
+  if (!fp) {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    return -1;
+  }
+  unsigned int capacity = 0;
+  unsigned int line_num = 0;
+  char line[512];
+  while (fgets(line, sizeof(line), fp)) {
+    line_num++;
+    if (line_num == 1 && strncmp(line, "frame,", 6) == 0) {
+      continue;
+    }
+    unsigned int frame;
+    int gesture;
+    GestureResult result;
+    memset(&result, 0, sizeof(result));
+    if (sscanf(line, "%u,%d,%u,%u,%d,%f,%f,%u,%d,%f,%f", &frame, &gesture, &result.state, &result.n_sample,
+               &result.maxpixel, &result.x, &result.y, &result.tracking_state, &result.tracking_maxpixel,
+               &result.tracking_x, &result.tracking_y) != 11 || frame != *num_results) {
+      fprintf(stderr, "%s:%u: malformed result\n", path, line_num);
+      fclose(fp);
+      free(*results);
+      *results = NULL;
+      return -1;
+    }
+    result.gesture = (GestureEvent)gesture;
+    if (*num_results == capacity) {
+      capacity = capacity ? capacity * 2 : INITIAL_FRAME_CAPACITY;
+      GestureResult *new_results = (GestureResult *)realloc(*results, (size_t)capacity * sizeof(GestureResult));
+      if (!new_results) {
+        fprintf(stderr, "%s: out of memory\n", path);
+        fclose(fp);
+        free(*results);
+        *results = NULL;
+        return -1;
+      }
+      *results = new_results;
+    }
+    (*results)[(*num_results)++] = result;
+  }
+  fclose(fp);
+  return 0;
+}
@@ -0,0 +1,111 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+#ifndef FRAME_IO_H_INCLUDED
+#define FRAME_IO_H_INCLUDED
+
+#include <stdio.h>
+#include "gesture_common.h"
+#include "stream_codec.h"
+#include "capture.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Recorded frame file formats understood by the host tools
+typedef enum {
+  FRAME_FORMAT_TEXT,      // One frame per line, NUM_SENSOR_PIXELS integers separated by commas or whitespace. '#' starts a comment
+  FRAME_FORMAT_STREAM,    // Raw capture of the serial data stream, version 1 (0xFF 0xFF sync, NUM_INFO_BYTES header, 16-bit
+                          // big-endian pixels) or version 2 (0xFF 0x5A sync, see stream_codec.h). Frames without pixels are skipped
+  FRAME_FORMAT_CAPTURE    // Raw frame capture dump (capture dump command, see capture.h), which may follow other serial data.
+                          // The frames are in sensor order, as read from the sensor
+} FrameFormat;
+
+// Size of one data stream frame as built by processFrame() in main.cpp
+#define STREAM_INFO_BYTES 40
+#define STREAM_FRAME_BYTES (STREAM_INFO_BYTES + NUM_SENSOR_PIXELS*2)
+
+/**
+* Loads all frames of a recording into a single contiguous buffer of NUM_SENSOR_PIXELS ints per frame.
+* The buffer is allocated with malloc and must be released by the caller with free.
+*
+* Return Value
+* 0 on success, -1 if the file could not be read or contains a malformed frame
+*/
+int loadFrameFile(const char *path, const FrameFormat format, int **frames, unsigned int *num_frames);
+
+// Statistics of a data stream capture
+typedef struct {
+  unsigned int v1_frames;       // Version 1 frames
+  unsigned int v2_frames;       // Version 2 frames decoded
+  unsigned int v2_skipped;      // Version 2 delta frames skipped because an earlier frame was lost
+  unsigned long frame_bytes;    // Bytes in all frames decoded
+  unsigned long garbage_bytes;  // Bytes that are not part of a valid frame
+} StreamCaptureStats;
+
+/**
+* Decodes all frames of a data stream capture, in either version. Version 1 frames are returned with
+* encoding STREAM_PIXELS_PACKED, seq counting up from 0, and the result fields processFrame() sends.
+* The frames are allocated with malloc and must be released by the caller with free.
+*
+* Return Value
+* 0 on success, -1 if the file could not be read
+*/
+int loadStreamCapture(const char *path, StreamFrame **frames, unsigned int *num_frames, StreamCaptureStats *stats);
+
+// Parses a GestureMode name: dynamic, tracking or dual. Returns -1 for an unknown name
+int parseGestureMode(const char *name);
+
+// Writes one GestureResult as a CSV line. Floats are printed with enough digits to round-trip exactly
+void writeResultHeader(FILE *fp);
+void writeResult(FILE *fp, const unsigned int frame, const GestureResult *result);
+
+/**
+* Loads a result file written with writeResultHeader and writeResult. The frame column gives the index of each
+* result; the placeholder fields, which are not written, are zero.
+* The results are allocated with malloc and must be released by the caller with free.
+*
+* Return Value
+* 0 on success, -1 if the file could not be read or contains a malformed line
+*/
+int loadResultFile(const char *path, GestureResult **results, unsigned int *num_results);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
@@ -0,0 +1,104 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+#include "mock_spi.h"
+
+#define SPI_READ_CMD 0x80
+#define SPI_WRITE_CMD 0x00
+
+void initMockSpiSensor(MockSpiSensor *dev, const int *frames, const unsigned int num_frames)
+{
+  memset(dev, 0, sizeof(MockSpiSensor));
+  dev->frames = frames;
+  dev->num_frames = num_frames;
+}
+
+int convertMockSpiFrame(MockSpiSensor *dev)
+{
+  if (dev->next_frame >= dev->num_frames) {
+    return 0;
+  }
+  const int *pixels = dev->frames + (size_t)dev->next_frame++ * NUM_SENSOR_PIXELS;
+  for (unsigned int i = 0; i < NUM_SENSOR_PIXELS; i++) {
+    dev->regs[FRAME_READER_PIXEL_REG + 2*i] = (pixels[i] >> 8) & 0xFF;
+    dev->regs[FRAME_READER_PIXEL_REG + 2*i + 1] = pixels[i] & 0xFF;
+  }
+  return 1;
+}
+
+void mockSpiTransfer(MockSpiSensor *dev, const uint8_t *tx, uint8_t *rx, const unsigned int length)
+{
+  memset(rx, 0, length < 2 ? length : 2);
+  if (length < 2) {
+    return;
+  }
+  const uint8_t addr = tx[0], cmd = tx[1];
+  for (unsigned int i = 2; i < length; i++) {
+    const uint8_t reg = (uint8_t)(addr + i - 2);
+    if (cmd == SPI_READ_CMD) {
+      rx[i] = dev->regs[reg];
+    }
+    else {
+      rx[i] = 0;
+      if (cmd == SPI_WRITE_CMD) {
+        dev->regs[reg] = tx[i];
+      }
+    }
+  }
+}
+
+int startMockSpiFrameRead(void *ctx, FrameReader *reader, uint8_t buffer[FRAME_READER_BUFFER_BYTES])
+{
+  MockSpiSensor *dev = (MockSpiSensor *)ctx;
+  if (dev->pending) {
+    return -1;
+  }
+  dev->reader = reader;
+  dev->rx = buffer;
+  dev->pending = 1;
+  return 0;
+}
+
+int completeMockSpiTransfer(MockSpiSensor *dev)
+{
+  if (!dev->pending) {
+    return 0;
+  }
+  mockSpiTransfer(dev, frameReadSpiCommand, dev->rx, FRAME_READER_BUFFER_BYTES);
+  dev->pending = 0;
+  dev->transfers++;
+  frameReaderTransferDone(dev->reader);
+  return 1;
+}
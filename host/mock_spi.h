@@ -0,0 +1,77 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+#ifndef MOCK_SPI_H_INCLUDED
+#define MOCK_SPI_H_INCLUDED
+
+#include "frame_reader.h"
+
+/*
+* Host model of the sensor's SPI register interface, for running the firmware frame acquisition path
+* (frame_reader.h) without hardware. A transfer is full duplex: byte 1 is the register address, byte 2 the
+* command (0x80 read, 0x00 write), then one data byte per register with auto-increment. Each simulated
+* conversion loads the next frame of a recording into the pixel registers as 16-bit big-endian values.
+*
+* startMockSpiFrameRead is a FrameReader transport like the asynchronous one in controller.cpp: it only
+* queues the transfer, which happens when the test calls completeMockSpiTransfer (the DMA complete interrupt).
+*/
+typedef struct {
+  uint8_t regs[256];
+  const int *frames;
+  unsigned int num_frames;
+  unsigned int next_frame;
+
+  // Transfer queued by startMockSpiFrameRead
+  FrameReader *reader;
+  uint8_t *rx;
+  int pending;
+
+  uint32_t transfers;               // Transfers completed
+} MockSpiSensor;
+
+void initMockSpiSensor(MockSpiSensor *dev, const int *frames, const unsigned int num_frames);
+
+// Loads the next frame into the pixel registers. Returns 0 when the recording is exhausted
+int convertMockSpiFrame(MockSpiSensor *dev);
+
+// Full duplex transfer of length bytes
+void mockSpiTransfer(MockSpiSensor *dev, const uint8_t *tx, uint8_t *rx, const unsigned int length);
+
+int startMockSpiFrameRead(void *ctx, FrameReader *reader, uint8_t buffer[FRAME_READER_BUFFER_BYTES]);
+
+// Performs the queued transfer and signals its completion. Returns 0 if no transfer was queued
+int completeMockSpiTransfer(MockSpiSensor *dev);
+
+#endif
@@ -0,0 +1,173 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+/*
+* Converts a recording in any of the formats the host tools read into the fixed record recording format
+* (recording.h): runs it through the gesture library frame by frame, stores the raw frames with their results
+* and writes the active segment index. Lists the header and the segments of a recording.
+*/
+
+#include <stdio.h>
+#include <unistd.h>
+#include "frame_io.h"
+#include "recording.h"
+
+static void usage(const char *prog)
+{
+  fprintf(stderr,
+    "usage: %s [-s] [-d] [-m mode] [-i factor] -o recording <frames|->\n"
+    "       %s -l recording\n"
+    "  -s         input is a raw serial data stream capture (default: text, one frame per line)\n"
+    "  -d         input is a raw frame capture dump (capture dump command)\n"
+    "  -m mode    dynamic, tracking or dual (default from gesture_config.h)\n"
+    "  -i factor  interpolation factor (1, 2, 4 or 8, default from gesture_config.h)\n"
+    "  -o file    recording to write; the index is written next to it\n"
+    "  -l         list the header and active segments of a recording\n", prog, prog);
+}
+
+static int record(const char *path, const FrameFormat format, const GestureConfig *cfg, const char *out_path)
+{
+  int *frames;
+  unsigned int num_frames;
+  if (loadFrameFile(path, format, &frames, &num_frames)) {
+    return 1;
+  }
+  GestureEngine *eng = createGestureEngine();
+  if (!eng) {
+    fprintf(stderr, "out of memory\n");
+    free(frames);
+    return 1;
+  }
+  configGestureEngine(eng, cfg);
+
+  RecordingWriter writer;
+  if (createRecording(&writer, out_path, cfg)) {
+    destroyGestureEngine(eng);
+    free(frames);
+    return 1;
+  }
+  const uint32_t period_us = (uint32_t)(cfg->sample_period_ms * 1000);
+  int status = 0;
+  for (unsigned int f = 0; f < num_frames && !status; f++) {
+    // The algorithm processes the pixels in place, the recording keeps the raw frame
+    const int *raw = frames + (size_t)f * NUM_SENSOR_PIXELS;
+    int pixels[NUM_SENSOR_PIXELS];
+    GestureResult result;
+    memcpy(pixels, raw, sizeof(pixels));
+    runGestureEngine(eng, pixels, &result);
+    status = appendRecordingFrame(&writer, f, f * period_us, raw, &result);
+  }
+  const RecordingIndexHeader index = writer.index.header;
+  if (closeRecording(&writer)) {
+    status = -1;
+  }
+  if (!status) {
+    fprintf(stderr, "%u frames, %u active in %u segments\n", num_frames, index.active_frames, index.num_segments);
+  }
+  destroyGestureEngine(eng);
+  free(frames);
+  return status ? 1 : 0;
+}
+
+static int list(const char *path)
+{
+  Recording rec;
+  RecordingIndex index;
+  if (mapRecording(path, &rec)) {
+    return 1;
+  }
+  if (loadRecordingIndex(path, &rec, &index)) {
+    unmapRecording(&rec);
+    return 1;
+  }
+  const GestureConfig *cfg = &rec.header->config;
+  printf("frames %u, %ux%u pixels, %u bytes per frame\n", rec.num_frames, rec.header->xres, rec.header->yres,
+    rec.header->record_bytes);
+  printf("mode %u, interpolation x%u, sample period %.2f ms\n", cfg->gesture_mode, cfg->interp_factor, cfg->sample_period_ms);
+  printf("active (maxpixel >= %d): %u frames (%.1f%%) in %u segments\n", index.header.threshold, index.header.active_frames,
+    rec.num_frames ? 100.0 * index.header.active_frames / rec.num_frames : 0.0, index.header.num_segments);
+  for (uint32_t s = 0; s < index.header.num_segments; s++) {
+    printf("%u,%u\n", index.segments[s].first, index.segments[s].count);
+  }
+  freeRecordingIndex(&index);
+  unmapRecording(&rec);
+  return 0;
+}
+
+int main(int argc, char *argv[])
+{
+  FrameFormat format = FRAME_FORMAT_TEXT;
+  unsigned int interp_factor = 0;
+  int gesture_mode = -1;
+  int list_only = 0;
+  const char *out_path = NULL;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "sdlm:i:o:h")) != -1) {
+    switch (opt) {
+      case 's': format = FRAME_FORMAT_STREAM; break;
+      case 'd': format = FRAME_FORMAT_CAPTURE; break;
+      case 'l': list_only = 1; break;
+      case 'm':
+        gesture_mode = parseGestureMode(optarg);
+        if (gesture_mode < 0) {
+          usage(argv[0]);
+          return 2;
+        }
+        break;
+      case 'i': interp_factor = strtoul(optarg, NULL, 0); break;
+      case 'o': out_path = optarg; break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if (optind != argc - 1 || list_only == (out_path != NULL)) {
+    usage(argv[0]);
+    return 2;
+  }
+  if (list_only) {
+    return list(argv[optind]);
+  }
+
+  // Same configuration as main.cpp
+  GestureConfig gestCfg;
+  initConfigStructToDefaults(&gestCfg);
+  if (interp_factor) {
+    gestCfg.interp_factor = interp_factor;
+  }
+  if (gesture_mode >= 0) {
+    gestCfg.gesture_mode = gesture_mode;
+  }
+  return record(argv[optind], format, &gestCfg, out_path);
+}
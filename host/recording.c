@@ -0,0 +1,353 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "recording.h"
+
+// Returns the sidecar index path of a recording, allocated with malloc
+static char * indexPath(const char *rec_path)
+{
+  const size_t len = strlen(rec_path);
+  char *path = (char *)malloc(len + sizeof(RECORDING_INDEX_SUFFIX));
+  if (path) {
+    memcpy(path, rec_path, len);
+    memcpy(path + len, RECORDING_INDEX_SUFFIX, sizeof(RECORDING_INDEX_SUFFIX));
+  }
+  return path;
+}
+
+// The result maxpixel is the tracking max pixel in tracking mode
+static int indexThreshold(const GestureConfig *cfg)
+{
+  return cfg->gesture_mode == GESTURE_MODE_TRACKING ? cfg->trackingConfig.end_detection_threshold : cfg->end_detection_threshold;
+}
+
+int createRecording(RecordingWriter *writer, const char *path, const GestureConfig *cfg)
+{
+  memset(writer, 0, sizeof(RecordingWriter));
+  writer->header.magic = RECORDING_MAGIC;
+  writer->header.version = RECORDING_VERSION;
+  writer->header.header_bytes = RECORDING_HEADER_BYTES;
+  writer->header.record_bytes = sizeof(RecordingFrame);
+  writer->header.config_bytes = sizeof(GestureConfig);
+  writer->header.xres = SENSOR_XRES;
+  writer->header.yres = SENSOR_YRES;
+  writer->header.config = *cfg;
+  initRecordingIndex(&writer->index, indexThreshold(cfg), RECORDING_INDEX_MERGE_FRAMES);
+
+  writer->path = (char *)malloc(strlen(path) + 1);
+  if (!writer->path) {
+    fprintf(stderr, "out of memory\n");
+    return -1;
+  }
+  strcpy(writer->path, path);
+  writer->fp = fopen(path, "wb");
+  if (!writer->fp) {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    free(writer->path);
+    return -1;
+  }
+  // The header is written again with the number of frames when the recording is closed
+  uint8_t header[RECORDING_HEADER_BYTES] = {0};
+  memcpy(header, &writer->header, sizeof(RecordingHeader));
+  if (fwrite(header, 1, sizeof(header), writer->fp) != sizeof(header)) {
+    fprintf(stderr, "%s: write error\n", path);
+    fclose(writer->fp);
+    free(writer->path);
+    return -1;
+  }
+  return 0;
+}
+
+int appendRecordingFrame(RecordingWriter *writer, const uint32_t frame, const uint32_t timestamp_us, const int pixels[NUM_SENSOR_PIXELS], const GestureResult *result)
+{
+  RecordingFrame record;
+  record.frame = frame;
+  record.timestamp_us = timestamp_us;
+  for (uint32_t i=0; i<NUM_SENSOR_PIXELS; i++) {
+    record.pixels[i] = pixels[i];
+  }
+  record.result = *result;
+  if (fwrite(&record, sizeof(record), 1, writer->fp) != 1) {
+    fprintf(stderr, "%s: write error\n", writer->path);
+    return -1;
+  }
+  writer->header.num_frames++;
+  return addRecordingIndexFrame(&writer->index, result->maxpixel);
+}
+
+int closeRecording(RecordingWriter *writer)
+{
+  int status = 0;
+  if (fseek(writer->fp, 0, SEEK_SET) || fwrite(&writer->header, sizeof(RecordingHeader), 1, writer->fp) != 1) {
+    status = -1;
+  }
+  if (fclose(writer->fp)) {
+    status = -1;
+  }
+  if (status) {
+    fprintf(stderr, "%s: write error\n", writer->path);
+  }
+  else {
+    status = writeRecordingIndex(writer->path, &writer->index);
+  }
+  freeRecordingIndex(&writer->index);
+  free(writer->path);
+  return status;
+}
+
+int mapRecording(const char *path, Recording *rec)
+{
+  memset(rec, 0, sizeof(Recording));
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    return -1;
+  }
+  struct stat st;
+  if (fstat(fd, &st) || st.st_size < (off_t)sizeof(RecordingHeader)) {
+    fprintf(stderr, "%s: not a recording\n", path);
+    close(fd);
+    return -1;
+  }
+  void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    return -1;
+  }
+
+  const RecordingHeader *header = (const RecordingHeader *)map;
+  const char *error = NULL;
+  if (header->magic != RECORDING_MAGIC) {
+    error = "not a recording";
+  }
+  else if (header->version != RECORDING_VERSION || header->header_bytes < sizeof(RecordingHeader) ||
+           header->header_bytes % sizeof(uint32_t) || header->record_bytes != sizeof(RecordingFrame) ||
+           header->config_bytes != sizeof(GestureConfig)) {
+    error = "unsupported recording version";
+  }
+  else if (header->xres != SENSOR_XRES || header->yres != SENSOR_YRES) {
+    error = "recorded with a different sensor geometry";
+  }
+  else if ((size_t)st.st_size < header->header_bytes + (size_t)header->num_frames * header->record_bytes) {
+    error = "truncated recording";
+  }
+  if (error) {
+    fprintf(stderr, "%s: %s\n", path, error);
+    munmap(map, (size_t)st.st_size);
+    return -1;
+  }
+
+  rec->header = header;
+  rec->frames = (const RecordingFrame *)((const uint8_t *)map + header->header_bytes);
+  rec->num_frames = header->num_frames;
+  rec->map = map;
+  rec->map_bytes = (size_t)st.st_size;
+  // Replays read the frames in order, a segment at a time
+  posix_madvise(map, rec->map_bytes, POSIX_MADV_SEQUENTIAL);
+  return 0;
+}
+
+void unmapRecording(Recording *rec)
+{
+  if (rec->map) {
+    munmap(rec->map, rec->map_bytes);
+  }
+  memset(rec, 0, sizeof(Recording));
+}
+
+void initRecordingIndex(RecordingIndex *index, const int threshold, const unsigned int merge_frames)
+{
+  memset(index, 0, sizeof(RecordingIndex));
+  index->header.magic = RECORDING_INDEX_MAGIC;
+  index->header.version = RECORDING_VERSION;
+  index->header.segment_bytes = sizeof(RecordingSegment);
+  index->header.threshold = threshold;
+  index->header.merge_frames = merge_frames;
+}
+
+void freeRecordingIndex(RecordingIndex *index)
+{
+  free(index->segments);
+  index->segments = NULL;
+  index->capacity = 0;
+}
+
+int addRecordingIndexFrame(RecordingIndex *index, const int maxpixel)
+{
+  RecordingIndexHeader *header = &index->header;
+  const uint32_t f = header->num_frames++;
+  if (maxpixel < header->threshold) {
+    return 0;
+  }
+
+  if (index->last_active && f - index->last_active <= header->merge_frames) {
+    // Close enough to the last segment to continue it, including the idle frames in between
+    RecordingSegment *last = &index->segments[header->num_segments - 1];
+    header->active_frames += f + 1 - (last->first + last->count);
+    last->count = f + 1 - last->first;
+  }
+  else {
+    if (header->num_segments == index->capacity) {
+      unsigned int new_capacity = index->capacity ? index->capacity * 2 : 64;
+      RecordingSegment *new_segments = (RecordingSegment *)realloc(index->segments, new_capacity * sizeof(RecordingSegment));
+      if (!new_segments) {
+        return -1;
+      }
+      index->segments = new_segments;
+      index->capacity = new_capacity;
+    }
+    index->segments[header->num_segments].first = f;
+    index->segments[header->num_segments].count = 1;
+    header->num_segments++;
+    header->active_frames++;
+  }
+  index->last_active = f + 1;
+  return 0;
+}
+
+int buildRecordingIndex(const Recording *rec, RecordingIndex *index)
+{
+  initRecordingIndex(index, indexThreshold(&rec->header->config), RECORDING_INDEX_MERGE_FRAMES);
+  for (unsigned int f = 0; f < rec->num_frames; f++) {
+    if (addRecordingIndexFrame(index, rec->frames[f].result.maxpixel)) {
+      freeRecordingIndex(index);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int writeRecordingIndex(const char *rec_path, const RecordingIndex *index)
+{
+  char *path = indexPath(rec_path);
+  if (!path) {
+    fprintf(stderr, "out of memory\n");
+    return -1;
+  }
+  FILE *fp = fopen(path, "wb");
+  if (!fp) {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    free(path);
+    return -1;
+  }
+  int status = 0;
+  if (fwrite(&index->header, sizeof(RecordingIndexHeader), 1, fp) != 1 ||
+      fwrite(index->segments, sizeof(RecordingSegment), index->header.num_segments, fp) != index->header.num_segments) {
+    status = -1;
+  }
+  if (fclose(fp) || status) {
+    fprintf(stderr, "%s: write error\n", path);
+    status = -1;
+  }
+  free(path);
+  return status;
+}
+
+// Whether the segments of an index are non-empty, ordered, non-overlapping runs of the frames of the recording
+// that add up to the active frames of the index
+static int validRecordingSegments(const RecordingIndexHeader *header, const RecordingSegment segments[])
+{
+  const uint32_t num_frames = header->num_frames;
+  uint32_t next = 0, active_frames = 0;
+  for (uint32_t s = 0; s < header->num_segments; s++) {
+    const RecordingSegment *segment = &segments[s];
+    if (segment->first < next || segment->first >= num_frames || segment->count == 0 ||
+        segment->count > num_frames - segment->first) {
+      return FALSE;
+    }
+    next = segment->first + segment->count;
+    active_frames += segment->count;
+  }
+  return active_frames == header->active_frames;
+}
+
+// Reads a sidecar index. Returns -1 if it is missing or does not match the recording
+static int readRecordingIndex(const char *path, const Recording *rec, RecordingIndex *index)
+{
+  FILE *fp = fopen(path, "rb");
+  if (!fp) {
+    return -1;
+  }
+  RecordingIndexHeader header;
+  int status = -1;
+  if (fread(&header, sizeof(header), 1, fp) == 1 && header.magic == RECORDING_INDEX_MAGIC &&
+      header.version == RECORDING_VERSION && header.segment_bytes == sizeof(RecordingSegment) &&
+      header.num_frames == rec->num_frames && header.threshold == indexThreshold(&rec->header->config) &&
+      header.num_segments <= header.num_frames) {
+    initRecordingIndex(index, header.threshold, header.merge_frames);
+    index->segments = (RecordingSegment *)malloc((header.num_segments ? header.num_segments : 1) * sizeof(RecordingSegment));
+    if (index->segments && fread(index->segments, sizeof(RecordingSegment), header.num_segments, fp) == header.num_segments &&
+        validRecordingSegments(&header, index->segments)) {
+      index->header = header;
+      index->capacity = header.num_segments;
+      index->last_active = header.num_segments ? index->segments[header.num_segments - 1].first + index->segments[header.num_segments - 1].count : 0;
+      status = 0;
+    }
+    else {
+      freeRecordingIndex(index);
+    }
+  }
+  fclose(fp);
+  return status;
+}
+
+int loadRecordingIndex(const char *rec_path, const Recording *rec, RecordingIndex *index)
+{
+  char *path = indexPath(rec_path);
+  if (!path) {
+    fprintf(stderr, "out of memory\n");
+    return -1;
+  }
+  int status = readRecordingIndex(path, rec, index);
+  free(path);
+  if (status == 0) {
+    return 0;
+  }
+  if (buildRecordingIndex(rec, index)) {
+    fprintf(stderr, "out of memory\n");
+    return -1;
+  }
+  // A recording that cannot be indexed on disk, e.g. in a read-only directory, is still replayed
+  writeRecordingIndex(rec_path, index);
+  return 0;
+}
@@ -0,0 +1,189 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+/*
+* Fixed record recording format for the host tools. A recording holds the raw sensor frames together with the
+* GestureResult of each frame and the configuration that produced them, in records of one size, so a tool maps
+* the file and reads any frame directly instead of parsing a data stream capture from its start.
+* A sidecar index (the recording path with RECORDING_INDEX_SUFFIX) lists the active segments, the runs of frames
+* with maxpixel at or above the end detection threshold of the gesture mode, so replays can go straight to the
+* gestures of a long, mostly idle recording. All fields are in host byte order (little-endian on the supported hosts).
+*/
+
+#ifndef RECORDING_H_INCLUDED
+#define RECORDING_H_INCLUDED
+
+#include <stdio.h>
+#include "gesture_common.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define RECORDING_MAGIC 0x43455247        // "GREC"
+#define RECORDING_INDEX_MAGIC 0x58495247  // "GRIX"
+#define RECORDING_VERSION 1
+#define RECORDING_HEADER_BYTES 256        // The first frame record starts here
+#define RECORDING_INDEX_SUFFIX ".idx"
+
+// Active runs separated by at most this many idle frames are one segment, so noise around the threshold
+// does not split a gesture
+#define RECORDING_INDEX_MERGE_FRAMES 8
+
+// File header, zero padded to RECORDING_HEADER_BYTES
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t header_bytes;      // Offset of the first frame record
+  uint16_t record_bytes;      // sizeof(RecordingFrame)
+  uint16_t config_bytes;      // sizeof(GestureConfig), to detect a header written with another GestureConfig
+  uint8_t xres;               // Sensor geometry of the pixels in each record
+  uint8_t yres;
+  uint16_t reserved;
+  uint32_t num_frames;        // Frame records following the header
+  GestureConfig config;       // Configuration the results were produced with
+} RecordingHeader;
+
+// The header must fit in RECORDING_HEADER_BYTES; otherwise this array has a negative size and does not compile
+typedef char RecordingHeaderFits[sizeof(RecordingHeader) <= RECORDING_HEADER_BYTES ? 1 : -1];
+
+// One frame record
+typedef struct {
+  uint32_t frame;                       // Frame number in the source recording
+  uint32_t timestamp_us;                // Frame time. Sources without timestamps count sample periods
+  int32_t pixels[NUM_SENSOR_PIXELS];    // Raw pixels, before processing
+  GestureResult result;
+} RecordingFrame;
+
+// Run of consecutive frames
+typedef struct {
+  uint32_t first;
+  uint32_t count;
+} RecordingSegment;
+
+// Sidecar index header, followed by num_segments RecordingSegments
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t segment_bytes;     // sizeof(RecordingSegment)
+  uint32_t num_frames;        // Frames of the recording when the index was built, to detect a stale index
+  int32_t threshold;          // Frames with maxpixel at or above this are active
+  uint32_t merge_frames;      // RECORDING_INDEX_MERGE_FRAMES the index was built with
+  uint32_t active_frames;     // Frames in all segments
+  uint32_t num_segments;
+} RecordingIndexHeader;
+
+// Active segments of a recording, built frame by frame
+typedef struct {
+  RecordingIndexHeader header;
+  RecordingSegment *segments;
+  unsigned int capacity;
+  uint32_t last_active;       // Index + 1 of the last active frame, 0 before the first
+} RecordingIndex;
+
+// Recording open for writing
+typedef struct {
+  FILE *fp;
+  char *path;
+  RecordingHeader header;
+  RecordingIndex index;
+} RecordingWriter;
+
+// Recording mapped for reading
+typedef struct {
+  const RecordingHeader *header;
+  const RecordingFrame *frames;
+  unsigned int num_frames;
+  void *map;
+  size_t map_bytes;
+} Recording;
+
+/**
+* Creates a recording file. The header is completed and the index is written by closeRecording.
+*
+* Parameters
+* writer: A pointer to a RecordingWriter structure
+* path:   File to create
+* cfg:    Configuration the results appended to the recording are produced with
+*
+* Return Value
+* 0 on success, -1 if the file could not be created
+*/
+int createRecording(RecordingWriter *writer, const char *path, const GestureConfig *cfg);
+
+// Appends one frame record and adds the frame to the index. Returns -1 on a write error
+int appendRecordingFrame(RecordingWriter *writer, const uint32_t frame, const uint32_t timestamp_us, const int pixels[NUM_SENSOR_PIXELS], const GestureResult *result);
+
+// Writes the number of frames to the header, closes the file and writes the sidecar index. Returns -1 on a write error
+int closeRecording(RecordingWriter *writer);
+
+/**
+* Maps a recording read-only. The frame records are used in place: rec->frames[i] is frame record i.
+*
+* Return Value
+* 0 on success, -1 if the file could not be mapped or is not a recording of this version and geometry
+*/
+int mapRecording(const char *path, Recording *rec);
+void unmapRecording(Recording *rec);
+
+// Starts an empty index of the frames with maxpixel at or above threshold
+void initRecordingIndex(RecordingIndex *index, const int threshold, const unsigned int merge_frames);
+void freeRecordingIndex(RecordingIndex *index);
+
+// Adds the next frame of the recording to the index. Returns -1 if out of memory
+int addRecordingIndexFrame(RecordingIndex *index, const int maxpixel);
+
+// Builds the index of a mapped recording from the results it holds, with the threshold of its configuration
+int buildRecordingIndex(const Recording *rec, RecordingIndex *index);
+
+// Writes the index to the sidecar file of the recording at rec_path. Returns -1 on a write error
+int writeRecordingIndex(const char *rec_path, const RecordingIndex *index);
+
+/**
+* Loads the sidecar index of a mapped recording, or builds it from the recording and writes it if the sidecar
+* is missing, was built for a different number of frames, or has segments that are not ordered runs of frames
+* within the recording.
+*
+* Return Value
+* 0 on success, -1 if out of memory
+*/
+int loadRecordingIndex(const char *rec_path, const Recording *rec, RecordingIndex *index);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
@@ -0,0 +1,369 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+/*
+* Host replay tool for the gesture library.
+* Reads recorded sensor frames, runs them through the gesture algorithm with the firmware configuration,
+* and writes the GestureResult stream as CSV together with the processing rate. The recording is processed
+* with runGestureEngineBatch, or frame by frame with runGestureEngine (-f) like the firmware does.
+* With -a the frames are acquired like the firmware does, through the frame reader from a mock SPI sensor.
+* With -P the time of each pipeline stage is reported, in a build with the GESTURE_PROFILE option.
+* With -r the input is a mapped recording (recording.h), of which -g replays only the active segments.
+*/
+
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include "frame_io.h"
+#include "img_utils.h"
+#include "mock_spi.h"
+#include "profiler.h"
+#include "recording.h"
+
+static void usage(const char *prog)
+{
+  fprintf(stderr,
+    "usage: %s [-s] [-d] [-r [-g margin] [-c]] [-q] [-f] [-a] [-P] [-m mode] [-i factor] [-k kernels] [-n repeat] [-o output.csv] <frames|->\n"
+    "  -s         input is a raw serial data stream capture (default: text, one frame per line)\n"
+    "  -d         input is a raw frame capture dump (capture dump command)\n"
+    "  -r         input is a recording (gesture_record), replayed with the configuration it was recorded with\n"
+    "  -g margin  replay only the active segments of the recording, each from this many frames before it to this many\n"
+    "             frames after it, with the engine reset at the start\n"
+    "  -c         compare the results with the results stored in the recording\n"
+    "  -q         do not write results, only report timing\n"
+    "  -f         process frame by frame instead of as a batch\n"
+    "  -a         acquire the frames through the firmware frame reader from a mock SPI sensor, frame by frame\n"
+    "  -P         report the time of each pipeline stage (needs the GESTURE_PROFILE build option)\n"
+    "  -m mode    dynamic, tracking or dual (default from gesture_config.h)\n"
+    "  -i factor  interpolation factor (1, 2, 4 or 8, default from gesture_config.h)\n"
+    "  -k kernels image kernel set: scalar, sse2 or avx2 (default: best supported by this CPU)\n"
+    "  -n repeat  process the recording this many times (for profiling)\n"
+    "  -o file    write results to file instead of stdout\n", prog);
+}
+
+static void writeProfile(FILE *f)
+{
+  fprintf(f, "%-16s %10s %10s %10s %10s %10s  (%s)\n", "stage", "count", "min", "mean", "max", "p99", getProfileTickUnit());
+  for (int i = 0; i < PROFILE_NUM_STAGES; i++) {
+    ProfileSummary summary;
+    getProfileSummary((ProfileStage)i, &summary);
+    if (summary.count) {
+      fprintf(f, "%-16s %10u %10u %10u %10u %10u\n", getProfileStageName((ProfileStage)i),
+        summary.count, summary.min, summary.mean, summary.max, summary.p99);
+    }
+  }
+}
+
+// Frames to process: the whole input, or the active segments of a recording with margin frames on either side.
+// Segments whose margins overlap are processed as one run
+static RecordingSegment * replaySpans(const char *path, const Recording *rec, const int margin, const unsigned int num_frames, unsigned int *num_spans)
+{
+  if (margin < 0) {
+    RecordingSegment *spans = malloc(sizeof(RecordingSegment));
+    if (spans) {
+      spans->first = 0;
+      spans->count = num_frames;
+      *num_spans = num_frames ? 1 : 0;
+    }
+    return spans;
+  }
+  RecordingIndex index;
+  if (loadRecordingIndex(path, rec, &index)) {
+    return NULL;
+  }
+  RecordingSegment *spans = malloc((index.header.num_segments + 1) * sizeof(RecordingSegment));
+  if (!spans) {
+    freeRecordingIndex(&index);
+    return NULL;
+  }
+  unsigned int n = 0;
+  for (uint32_t s = 0; s < index.header.num_segments; s++) {
+    const RecordingSegment *seg = &index.segments[s];
+    const uint32_t first = seg->first > (uint32_t)margin ? seg->first - margin : 0;
+    const uint32_t end = seg->first + seg->count + margin < num_frames ? seg->first + seg->count + margin : num_frames;
+    if (n && first <= spans[n-1].first + spans[n-1].count) {
+      spans[n-1].count = end - spans[n-1].first;
+    }
+    else {
+      spans[n].first = first;
+      spans[n].count = end - first;
+      n++;
+    }
+  }
+  freeRecordingIndex(&index);
+  *num_spans = n;
+  return spans;
+}
+
+static double monotonicSeconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// The firmware main loop with asynchronous frame reads: the data ready interrupt of frame N+1 starts its readout,
+// frame N is processed while the transfer is in flight, then the transfer completes
+static void acquireAndRun(GestureEngine *eng, const int *frames, const unsigned int num_frames, GestureResult results[])
+{
+  MockSpiSensor dev;
+  FrameReader reader;
+  initMockSpiSensor(&dev, frames, num_frames);
+  initFrameReader(&reader, startMockSpiFrameRead, &dev);
+
+  // Simulated clock, in microseconds, advancing by one sample period per frame
+  GestureConfig cfg;
+  getGestureEngineConfig(eng, &cfg);
+  const uint32_t period_us = (uint32_t)(cfg.sample_period_ms * 1000);
+
+  unsigned int processed = 0;
+  int pixels[NUM_SENSOR_PIXELS];
+  for (uint32_t now_us = 0; ; now_us += period_us) {
+    // Data ready interrupt: the next frame starts reading into the next free slot
+    const int converted = convertMockSpiFrame(&dev);
+    if (converted) {
+      frameReaderDataReady(&reader, now_us);
+    }
+    // Main loop: the previous frame is processed while the transfer is in flight
+    const FrameSlot *slot = acquireFrameReaderSlot(&reader, now_us);
+    if (slot) {
+      frameBytesToPixels(slot->buffer + FRAME_READER_HEADROOM, pixels, 0);
+      releaseFrameReaderSlot(&reader);
+      runGestureEngine(eng, pixels, &results[processed++]);
+    }
+    // Transfer complete interrupt
+    if (!completeMockSpiTransfer(&dev) && !converted && !slot) {
+      break;
+    }
+  }
+  FrameReaderStats stats;
+  getFrameReaderStats(&reader, &stats);
+  if (processed != num_frames || stats.overruns || stats.dropped) {
+    fprintf(stderr, "frame reader processed %u of %u frames, %u overruns, %u dropped\n",
+      processed, num_frames, stats.overruns, stats.dropped);
+    exit(1);
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  FrameFormat format = FRAME_FORMAT_TEXT;
+  int quiet = 0;
+  int per_frame = 0;
+  int acquire = 0;
+  int profile = 0;
+  int recording = 0;
+  int margin = -1;
+  int compare = 0;
+  unsigned int repeat = 1;
+  unsigned int interp_factor = 0;
+  int gesture_mode = -1;
+  const char *out_path = NULL;
+  const char *kernels = NULL;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "sdrg:cqfaPm:i:k:n:o:h")) != -1) {
+    switch (opt) {
+      case 's': format = FRAME_FORMAT_STREAM; break;
+      case 'd': format = FRAME_FORMAT_CAPTURE; break;
+      case 'r': recording = 1; break;
+      case 'g': margin = (int)strtoul(optarg, NULL, 0); break;
+      case 'c': compare = 1; break;
+      case 'q': quiet = 1; break;
+      case 'f': per_frame = 1; break;
+      case 'a': acquire = 1; break;
+      case 'P': profile = 1; break;
+      case 'm':
+        gesture_mode = parseGestureMode(optarg);
+        if (gesture_mode < 0) {
+          usage(argv[0]);
+          return 2;
+        }
+        break;
+      case 'i': interp_factor = strtoul(optarg, NULL, 0); break;
+      case 'k': kernels = optarg; break;
+      case 'n': repeat = strtoul(optarg, NULL, 0); break;
+      case 'o': out_path = optarg; break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if (optind != argc - 1 || repeat == 0 || ((margin >= 0 || compare) && !recording)) {
+    usage(argv[0]);
+    return 2;
+  }
+  if (profile && !GESTURE_PROFILE) {
+    fprintf(stderr, "-P needs a build with the GESTURE_PROFILE option\n");
+    return 2;
+  }
+  if (selectImgUtilsKernels(kernels)) {
+    fprintf(stderr, "kernel set %s is not available\n", kernels);
+    return 2;
+  }
+
+  // A recording is used in place, the other formats are loaded into one buffer
+  Recording rec;
+  int *frames = NULL;
+  unsigned int num_frames;
+  if (recording) {
+    if (mapRecording(argv[optind], &rec)) {
+      return 1;
+    }
+    num_frames = rec.num_frames;
+  }
+  else if (loadFrameFile(argv[optind], format, &frames, &num_frames)) {
+    return 1;
+  }
+  unsigned int num_spans;
+  RecordingSegment *spans = replaySpans(argv[optind], &rec, margin, num_frames, &num_spans);
+  if (!spans) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+
+  FILE *out = stdout;
+  if (out_path && !quiet) {
+    out = fopen(out_path, "w");
+    if (!out) {
+      perror(out_path);
+      free(frames);
+      return 1;
+    }
+  }
+
+  // Same configuration as main.cpp, or as the recording was made with, on an engine of our own
+  GestureConfig gestCfg;
+  if (recording) {
+    gestCfg = rec.header->config;
+  }
+  else {
+    initConfigStructToDefaults(&gestCfg);
+  }
+  if (interp_factor) {
+    gestCfg.interp_factor = interp_factor;
+  }
+  if (gesture_mode >= 0) {
+    gestCfg.gesture_mode = gesture_mode;
+  }
+  GestureEngine *eng = createGestureEngine();
+  if (!eng) {
+    fprintf(stderr, "out of memory\n");
+    free(frames);
+    return 1;
+  }
+  configGestureEngine(eng, &gestCfg);
+
+  if (!quiet) {
+    writeResultHeader(out);
+  }
+  initProfiler();
+
+  // The algorithm processes the pixels in place, so always work on a copy of the recording
+  int *work = malloc((size_t)num_frames * NUM_SENSOR_PIXELS * sizeof(int));
+  GestureResult *results = malloc((size_t)num_frames * sizeof(GestureResult));
+  if (!work || !results) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+
+  double elapsed = 0;
+  unsigned long total = 0;
+  unsigned int mismatches = 0;
+  for (unsigned int r = 0; r < repeat; r++) {
+    for (unsigned int s = 0; s < num_spans; s++) {
+      const unsigned int first = spans[s].first;
+      const unsigned int count = spans[s].count;
+      if (recording) {
+        for (unsigned int f = 0; f < count; f++) {
+          memcpy(work + (size_t)f * NUM_SENSOR_PIXELS, rec.frames[first + f].pixels, NUM_SENSOR_PIXELS * sizeof(int));
+        }
+      }
+      else {
+        memcpy(work, frames + (size_t)first * NUM_SENSOR_PIXELS, (size_t)count * NUM_SENSOR_PIXELS * sizeof(int));
+      }
+      resetGestureEngine(eng);
+
+      double start = monotonicSeconds();
+      if (acquire) {
+        acquireAndRun(eng, work, count, results);
+      }
+      else if (per_frame) {
+        for (unsigned int f = 0; f < count; f++) {
+          runGestureEngine(eng, work + (size_t)f * NUM_SENSOR_PIXELS, &results[f]);
+        }
+      }
+      else {
+        runGestureEngineBatch(eng, work, count, results);
+      }
+      elapsed += monotonicSeconds() - start;
+      total += count;
+
+      if (compare) {
+        for (unsigned int f = 0; f < count; f++) {
+          mismatches += memcmp(&rec.frames[first + f].result, &results[f], sizeof(GestureResult)) != 0;
+        }
+      }
+      if (!quiet) {
+        for (unsigned int f = 0; f < count; f++) {
+          writeResult(out, r * num_frames + first + f, &results[f]);
+        }
+      }
+    }
+  }
+
+  GestureStats stats;
+  getGestureEngineStats(eng, &stats);
+  fprintf(stderr, "%lu frames in %.3f ms (%.0f frames/sec, %.3f us/frame), %u idle, %s kernels\n",
+    total, elapsed * 1e3, elapsed > 0 ? total / elapsed : 0.0, total ? elapsed * 1e6 / total : 0.0,
+    stats.idle_frames_skipped, getImgUtilsKernels()->name);
+  if (profile) {
+    writeProfile(stderr);
+  }
+  if (compare) {
+    fprintf(stderr, "%u of %lu frames differ from the recorded results\n", mismatches, total);
+  }
+
+  if (out != stdout) {
+    fclose(out);
+  }
+  destroyGestureEngine(eng);
+  free(results);
+  free(work);
+  free(frames);
+  free(spans);
+  if (recording) {
+    unmapRecording(&rec);
+  }
+  return mismatches ? 1 : 0;
+}
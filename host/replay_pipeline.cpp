@@ -0,0 +1,229 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+/*
+* Replays a recording through a compile-time composed pipeline (gesture_pipeline.h), the way the firmware runs
+* it, and writes the GestureResult stream as CSV together with the processing rate. With -c the results and
+* the rate are compared with runGestureEngine on an engine with the same configuration.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "frame_io.h"
+#include "gesture_pipeline.h"
+
+static void usage(const char *prog)
+{
+  fprintf(stderr,
+    "usage: %s [-s] [-q] [-c] [-w] [-m mode] [-i factor] [-n repeat] <frames|->\n"
+    "  -s         input is a raw serial data stream capture (default: text, one frame per line)\n"
+    "  -q         do not write results, only report timing\n"
+    "  -c         check the results against runGestureEngine and compare the processing rate\n"
+    "  -w         pipeline without the window filter stage\n"
+    "  -m mode    dynamic, tracking or dual (default from gesture_config.h)\n"
+    "  -i factor  interpolation factor (1, 2, 4 or 8, default from gesture_config.h)\n"
+    "  -n repeat  process the recording this many times (for profiling)\n", prog);
+}
+
+static double monotonicSeconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Runs every repetition of the recording frame by frame, returns the time taken
+template <class Pipeline>
+static double runPipeline(Pipeline &pipeline, const int *frames, int *work, const unsigned int num_frames, const unsigned int repeat, GestureResult results[])
+{
+  double elapsed = 0;
+  for (unsigned int r = 0; r < repeat; r++) {
+    memcpy(work, frames, (size_t)num_frames * NUM_SENSOR_PIXELS * sizeof(int));
+    resetGestureEngine(pipeline.engine());
+    double start = monotonicSeconds();
+    for (unsigned int f = 0; f < num_frames; f++) {
+      pipeline.run(work + (size_t)f * NUM_SENSOR_PIXELS, &results[f]);
+    }
+    elapsed += monotonicSeconds() - start;
+  }
+  return elapsed;
+}
+
+// Runs the chain of a gesture mode
+template <int gesture_mode>
+static double runStages(GestureEngine *eng, const int window_filter, const int *frames, int *work, const unsigned int num_frames, const unsigned int repeat, GestureResult results[])
+{
+  if (window_filter) {
+    GesturePipeline<typename GestureStages<gesture_mode, 1>::Stages> pipeline(eng);
+    return runPipeline(pipeline, frames, work, num_frames, repeat, results);
+  }
+  GesturePipeline<typename GestureStages<gesture_mode, 0>::Stages> pipeline(eng);
+  return runPipeline(pipeline, frames, work, num_frames, repeat, results);
+}
+
+static double runEngine(GestureEngine *eng, const int *frames, int *work, const unsigned int num_frames, const unsigned int repeat, GestureResult results[])
+{
+  double elapsed = 0;
+  for (unsigned int r = 0; r < repeat; r++) {
+    memcpy(work, frames, (size_t)num_frames * NUM_SENSOR_PIXELS * sizeof(int));
+    resetGestureEngine(eng);
+    double start = monotonicSeconds();
+    for (unsigned int f = 0; f < num_frames; f++) {
+      runGestureEngine(eng, work + (size_t)f * NUM_SENSOR_PIXELS, &results[f]);
+    }
+    elapsed += monotonicSeconds() - start;
+  }
+  return elapsed;
+}
+
+static void reportRate(const char *name, const unsigned long total, const double elapsed)
+{
+  fprintf(stderr, "%s: %lu frames in %.3f ms (%.0f frames/sec, %.3f us/frame)\n", name,
+    total, elapsed * 1e3, elapsed > 0 ? total / elapsed : 0.0, total ? elapsed * 1e6 / total : 0.0);
+}
+
+int main(int argc, char *argv[])
+{
+  FrameFormat format = FRAME_FORMAT_TEXT;
+  int quiet = 0;
+  int check = 0;
+  int window_filter = 1;
+  unsigned int repeat = 1;
+  unsigned int interp_factor = 0;
+  int gesture_mode = -1;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "sqcwm:i:n:h")) != -1) {
+    switch (opt) {
+      case 's': format = FRAME_FORMAT_STREAM; break;
+      case 'q': quiet = 1; break;
+      case 'c': check = 1; break;
+      case 'w': window_filter = 0; break;
+      case 'm':
+        gesture_mode = parseGestureMode(optarg);
+        if (gesture_mode < 0) {
+          usage(argv[0]);
+          return 2;
+        }
+        break;
+      case 'i': interp_factor = strtoul(optarg, NULL, 0); break;
+      case 'n': repeat = strtoul(optarg, NULL, 0); break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if (optind != argc - 1 || repeat == 0) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  int *frames;
+  unsigned int num_frames;
+  if (loadFrameFile(argv[optind], format, &frames, &num_frames)) {
+    return 1;
+  }
+
+  // Same configuration as main.cpp. The window filter setting only matters to runGestureEngine
+  GestureConfig gestCfg;
+  initConfigStructToDefaults(&gestCfg);
+  gestCfg.enable_window_filter = window_filter;
+  if (interp_factor) {
+    gestCfg.interp_factor = interp_factor;
+  }
+  if (gesture_mode >= 0) {
+    gestCfg.gesture_mode = gesture_mode;
+  }
+  GestureEngine *eng = createGestureEngine();
+  int *work = (int *)malloc((size_t)num_frames * NUM_SENSOR_PIXELS * sizeof(int));
+  GestureResult *results = (GestureResult *)malloc((size_t)num_frames * sizeof(GestureResult));
+  if (!eng || !work || !results) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+  configGestureEngine(eng, &gestCfg);
+
+  double elapsed;
+  switch (gestCfg.gesture_mode) {
+    case GESTURE_MODE_TRACKING:
+      elapsed = runStages<GESTURE_MODE_TRACKING>(eng, window_filter, frames, work, num_frames, repeat, results);
+      break;
+    case GESTURE_MODE_DUAL:
+      elapsed = runStages<GESTURE_MODE_DUAL>(eng, window_filter, frames, work, num_frames, repeat, results);
+      break;
+    default:
+      elapsed = runStages<GESTURE_MODE_DYNAMIC>(eng, window_filter, frames, work, num_frames, repeat, results);
+      break;
+  }
+
+  if (!quiet) {
+    writeResultHeader(stdout);
+    for (unsigned int f = 0; f < num_frames; f++) {
+      writeResult(stdout, f, &results[f]);
+    }
+  }
+  unsigned long total = (unsigned long)repeat * num_frames;
+  reportRate("pipeline", total, elapsed);
+
+  int status = 0;
+  if (check) {
+    // A fresh engine, since the tracking bias calibration survives resetGestureEngine
+    GestureEngine *ref = createGestureEngine();
+    GestureResult *expected = (GestureResult *)malloc((size_t)num_frames * sizeof(GestureResult));
+    if (!ref || !expected) {
+      fprintf(stderr, "out of memory\n");
+      return 1;
+    }
+    configGestureEngine(ref, &gestCfg);
+    reportRate("runGestureEngine", total, runEngine(ref, frames, work, num_frames, repeat, expected));
+    unsigned int mismatches = 0;
+    for (unsigned int f = 0; f < num_frames; f++) {
+      mismatches += memcmp(&expected[f], &results[f], sizeof(GestureResult)) != 0;
+    }
+    if (mismatches) {
+      fprintf(stderr, "%u of %u frames differ from runGestureEngine\n", mismatches, num_frames);
+      status = 1;
+    }
+    free(expected);
+    destroyGestureEngine(ref);
+  }
+
+  destroyGestureEngine(eng);
+  free(results);
+  free(work);
+  free(frames);
+  return status;
+}
@@ -0,0 +1,213 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+/*
+* Replays many recordings at once on the stream group engine (stream_group.h), GESTURE_STREAM_LANES recordings
+* per group, and reports the processing rate. Results can be written per recording and checked against the
+* single stream engine.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "frame_io.h"
+#include "stream_group.h"
+
+static void usage(const char *prog)
+{
+  fprintf(stderr,
+    "usage: %s [-s] [-c] [-i factor] [-n repeat] [-d outdir] <recording>...\n"
+    "  -s         inputs are raw serial data stream captures (default: text, one frame per line)\n"
+    "  -c         check the results of every recording against runGestureEngineBatch\n"
+    "  -i factor  interpolation factor (1, 2, 4 or 8, default from gesture_config.h)\n"
+    "  -n repeat  process every group this many times (for profiling)\n"
+    "  -d outdir  write the results of each recording to outdir/<recording name>.csv\n", prog);
+}
+
+static double monotonicSeconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int writeResultFile(const char *outdir, const char *path, const GestureResult *results, const unsigned int num_frames)
+{
+  const char *name = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+  char out_path[4096];
+  snprintf(out_path, sizeof(out_path), "%s/%s.csv", outdir, name);
+  FILE *out = fopen(out_path, "w");
+  if (!out) {
+    perror(out_path);
+    return -1;
+  }
+  writeResultHeader(out);
+  for (unsigned int f = 0; f < num_frames; f++) {
+    writeResult(out, f, &results[f]);
+  }
+  fclose(out);
+  return 0;
+}
+
+// Runs a recording through its own engine and counts the frames whose result differs
+static unsigned int checkResults(const GestureConfig *cfg, const int *frames, const unsigned int num_frames, const GestureResult *results)
+{
+  GestureEngine *eng = createGestureEngine();
+  int *work = malloc((size_t)num_frames * NUM_SENSOR_PIXELS * sizeof(int));
+  GestureResult *expected = malloc((size_t)num_frames * sizeof(GestureResult));
+  unsigned int mismatches = 0;
+  if (!eng || !work || !expected) {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+  }
+  configGestureEngine(eng, cfg);
+  memcpy(work, frames, (size_t)num_frames * NUM_SENSOR_PIXELS * sizeof(int));
+  runGestureEngineBatch(eng, work, num_frames, expected);
+  for (unsigned int f = 0; f < num_frames; f++) {
+    mismatches += memcmp(&expected[f], &results[f], sizeof(GestureResult)) != 0;
+  }
+  free(expected);
+  free(work);
+  destroyGestureEngine(eng);
+  return mismatches;
+}
+
+int main(int argc, char *argv[])
+{
+  FrameFormat format = FRAME_FORMAT_TEXT;
+  int check = 0;
+  unsigned int repeat = 1;
+  unsigned int interp_factor = 0;
+  const char *outdir = NULL;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "sci:n:d:h")) != -1) {
+    switch (opt) {
+      case 's': format = FRAME_FORMAT_STREAM; break;
+      case 'c': check = 1; break;
+      case 'i': interp_factor = strtoul(optarg, NULL, 0); break;
+      case 'n': repeat = strtoul(optarg, NULL, 0); break;
+      case 'd': outdir = optarg; break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if (optind >= argc || repeat == 0) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  GestureConfig gestCfg;
+  initConfigStructToDefaults(&gestCfg);
+  if (interp_factor) {
+    gestCfg.interp_factor = interp_factor;
+  }
+  GestureStreamGroup *grp = createGestureStreamGroup(&gestCfg);
+  if (!grp) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+
+  double elapsed = 0;
+  unsigned long total_frames = 0;
+  unsigned int num_recordings = argc - optind, failed = 0;
+  for (unsigned int first = 0; first < num_recordings; first += GESTURE_STREAM_LANES) {
+    // Load the next group of recordings, one per lane
+    int *frames[GESTURE_STREAM_LANES] = {NULL};
+    unsigned int num_frames[GESTURE_STREAM_LANES] = {0};
+    GestureResult *results[GESTURE_STREAM_LANES] = {NULL};
+    unsigned int lanes = num_recordings - first < GESTURE_STREAM_LANES ? num_recordings - first : GESTURE_STREAM_LANES;
+    unsigned int longest = 0;
+    for (unsigned int l = 0; l < lanes; l++) {
+      if (loadFrameFile(argv[optind + first + l], format, &frames[l], &num_frames[l])) {
+        return 1;
+      }
+      results[l] = malloc(((size_t)num_frames[l] + 1) * sizeof(GestureResult));
+      if (!results[l]) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+      }
+      longest = num_frames[l] > longest ? num_frames[l] : longest;
+    }
+
+    for (unsigned int r = 0; r < repeat; r++) {
+      for (unsigned int l = 0; l < GESTURE_STREAM_LANES; l++) {
+        resetGestureStream(grp, l);
+      }
+      double start = monotonicSeconds();
+      for (unsigned int f = 0; f < longest; f++) {
+        const int *lane_frames[GESTURE_STREAM_LANES] = {NULL};
+        GestureResult lane_results[GESTURE_STREAM_LANES];
+        for (unsigned int l = 0; l < lanes; l++) {
+          lane_frames[l] = f < num_frames[l] ? frames[l] + (size_t)f * NUM_SENSOR_PIXELS : NULL;
+        }
+        runGestureStreams(grp, lane_frames, lane_results);
+        for (unsigned int l = 0; l < lanes; l++) {
+          if (lane_frames[l]) {
+            results[l][f] = lane_results[l];
+          }
+        }
+      }
+      elapsed += monotonicSeconds() - start;
+    }
+
+    for (unsigned int l = 0; l < lanes; l++) {
+      const char *path = argv[optind + first + l];
+      total_frames += (unsigned long)repeat * num_frames[l];
+      if (outdir && writeResultFile(outdir, path, results[l], num_frames[l])) {
+        return 1;
+      }
+      if (check) {
+        unsigned int mismatches = checkResults(&gestCfg, frames[l], num_frames[l], results[l]);
+        if (mismatches) {
+          fprintf(stderr, "%s: %u of %u frames differ from the single stream engine\n", path, mismatches, num_frames[l]);
+          failed++;
+        }
+      }
+      free(results[l]);
+      free(frames[l]);
+    }
+  }
+
+  fprintf(stderr, "%u recordings, %lu frames in %.3f ms (%.0f frames/sec, %.3f us/frame)\n",
+    num_recordings, total_frames, elapsed * 1e3, elapsed > 0 ? total_frames / elapsed : 0.0,
+    total_frames ? elapsed * 1e6 / total_frames : 0.0);
+  if (check) {
+    fprintf(stderr, "%u of %u recordings differ from the single stream engine\n", failed, num_recordings);
+  }
+
+  destroyGestureStreamGroup(grp);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,318 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+#include <stdlib.h>
+#include "stream_group.h"
+
+#define LANES GESTURE_STREAM_LANES
+
+// One value per stream. GCC vector extensions map these to the widest vectors of the target, splitting them as needed
+typedef int lane_i __attribute__((vector_size(LANES * sizeof(int))));
+typedef unsigned int lane_u __attribute__((vector_size(LANES * sizeof(unsigned int))));
+typedef float lane_f __attribute__((vector_size(LANES * sizeof(float))));
+typedef int64_t lane_l __attribute__((vector_size(LANES * sizeof(int64_t))));
+
+#if GESTURE_FIXED_POINT
+  typedef lane_i lane_filt;
+#else
+  typedef lane_f lane_filt;
+#endif
+
+// Lane loops are compiled for the widest vector extension of the host CPU, selected at load time
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__)
+  #define LANE_TARGETS __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+  #define LANE_TARGETS
+#endif
+
+// Lane helpers pass vectors by value, so they must be inlined into the clones rather than called across their ABIs
+#define LANE_INLINE static inline __attribute__((always_inline))
+
+struct GestureStreamGroup {
+  // Interleaved per pixel state and buffers
+  lane_i nwin[3][NUM_SENSOR_PIXELS];
+  lane_filt foreground_pixels[NUM_SENSOR_PIXELS];
+  lane_filt background_pixels[NUM_SENSOR_PIXELS];
+  lane_i pixels[NUM_SENSOR_PIXELS];
+  lane_i interp_pixels[MAX_NUM_INTERP_PIXELS];
+
+  lane_i reset_mask;        // All ones for the streams whose filters are cleared by the next frame
+  uint32_t n_frame[LANES];
+  uint32_t n_idle_frame[LANES];
+  SwipeContext swipe[LANES];  // The swipe recognizer is per frame and scalar, so its state is not interleaved
+
+  GestureEngine proto;      // Configuration and coefficients shared by all streams. Its own state is unused
+};
+
+GestureStreamGroup * createGestureStreamGroup(const GestureConfig *cfg)
+{
+  GestureStreamGroup *grp;
+  if (posix_memalign((void **)&grp, sizeof(lane_l), sizeof(GestureStreamGroup))) {
+    return NULL;
+  }
+  memset(grp, 0, sizeof(GestureStreamGroup));
+  initGestureEngine(&grp->proto);
+  configGestureEngine(&grp->proto, cfg);
+  for (unsigned int l = 0; l < LANES; l++) {
+    grp->swipe[l] = grp->proto.dynamic.swipe; // configured and reset
+  }
+  grp->reset_mask = grp->reset_mask == 0; // all lanes
+  return grp;
+}
+
+void destroyGestureStreamGroup(GestureStreamGroup *grp)
+{
+  free(grp);
+}
+
+void resetGestureStream(GestureStreamGroup *grp, const unsigned int lane)
+{
+  grp->reset_mask[lane] = -1;
+}
+
+void getGestureStreamStats(const GestureStreamGroup *grp, const unsigned int lane, GestureStats *stats)
+{
+  stats->frames = grp->n_frame[lane];
+  stats->idle_frames_skipped = grp->n_idle_frame[lane];
+}
+
+// mask ? a : b for each lane, mask being all ones or zero
+LANE_INLINE lane_i selectLanes(const lane_i mask, const lane_i a, const lane_i b)
+{
+  return (mask & a) | (~mask & b);
+}
+
+LANE_INLINE lane_f selectLanesFloat(const lane_i mask, const lane_f a, const lane_f b)
+{
+  return (lane_f)selectLanes(mask, (lane_i)a, (lane_i)b);
+}
+
+LANE_INLINE lane_i lanesToInt(const lane_f value)
+{
+  return __builtin_convertvector(value, lane_i);
+}
+
+LANE_INLINE lane_f lanesToFloat(const lane_i value)
+{
+  return __builtin_convertvector(value, lane_f);
+}
+
+#if GESTURE_FIXED_POINT
+// updateAverageQ16 and q16ToInt on every lane
+LANE_INLINE lane_i updateAverageLanesQ16(const lane_i state, const lane_i pixel, const q16_t alpha)
+{
+  lane_l delta = __builtin_convertvector(pixel, lane_l) * Q16_ONE - __builtin_convertvector(state, lane_l);
+  return state + __builtin_convertvector((delta * alpha + (Q16_ONE >> 1)) >> Q16_SHIFT, lane_i);
+}
+
+LANE_INLINE lane_i q16ToIntLanes(const lane_i value)
+{
+  return selectLanes(value >= 0, value >> Q16_SHIFT, -(-value >> Q16_SHIFT));
+}
+#endif
+
+// windowFilterPixel and backgroundPixel on every lane. Lanes not in active compute on zeros and keep their state
+LANE_INLINE void filterStreams(GestureStreamGroup *grp, const lane_i active)
+{
+  const GestureEngine *eng = &grp->proto;
+  const GestureConfig *cfg = &eng->cfg;
+  const lane_i reset = grp->reset_mask;
+  for (unsigned int i = 0; i < NUM_SENSOR_PIXELS; i++) {
+    lane_i pixel = grp->pixels[i];
+
+    // Noise window filter, see windowFilterStep
+    if (cfg->enable_window_filter) {
+      lane_i win0 = grp->nwin[1][i], win1 = grp->nwin[2][i], win2 = pixel;
+      #if GESTURE_FIXED_POINT
+        const q16_t alpha = eng->window_filter_alpha_q16;
+        lane_l sum = __builtin_convertvector(win1, lane_l) * (2 * (int64_t)alpha) + __builtin_convertvector(win0 + win2, lane_l) * (int64_t)(Q16_ONE - alpha);
+        lane_i filtered = __builtin_convertvector(sum / (2 * Q16_ONE), lane_i);
+      #else
+        const float alpha = cfg->window_filter_alpha;
+        lane_i filtered = lanesToInt(alpha * lanesToFloat(win1) + (1-alpha)*lanesToFloat(win0 + win2)/2);
+      #endif
+      win0 = selectLanes(reset, pixel, win0);
+      win1 = selectLanes(reset, pixel, win1);
+      pixel = selectLanes(reset, pixel, filtered);
+      grp->nwin[0][i] = selectLanes(active, win0, grp->nwin[0][i]);
+      grp->nwin[1][i] = selectLanes(active, win1, grp->nwin[1][i]);
+      grp->nwin[2][i] = selectLanes(active, win2, grp->nwin[2][i]);
+    }
+
+    // Static background subtraction, see subtractBackgroundPixel
+    #if GESTURE_FIXED_POINT
+      lane_i foreground = selectLanes(reset, pixel * Q16_ONE, grp->foreground_pixels[i]);
+      lane_i background = selectLanes(reset, pixel * Q16_ONE, grp->background_pixels[i]);
+      background = updateAverageLanesQ16(background, pixel, eng->background_filter_alpha_q16);
+      foreground = updateAverageLanesQ16(foreground, pixel, eng->low_pass_filter_alpha_q16);
+      grp->pixels[i] = q16ToIntLanes(foreground - q16ToIntLanes(background) * Q16_ONE);
+      grp->foreground_pixels[i] = selectLanes(active, foreground, grp->foreground_pixels[i]);
+      grp->background_pixels[i] = selectLanes(active, background, grp->background_pixels[i]);
+    #else
+      const float alpha_short_avg = cfg->low_pass_filter_alpha, alpha_long_avg = cfg->background_filter_alpha;
+      lane_f foreground = selectLanesFloat(reset, lanesToFloat(pixel), grp->foreground_pixels[i]);
+      lane_f background = selectLanesFloat(reset, lanesToFloat(pixel), grp->background_pixels[i]);
+      background = (1.0f - alpha_long_avg) * background + alpha_long_avg * lanesToFloat(pixel);
+      foreground = (1.0f - alpha_short_avg) * foreground + alpha_short_avg * lanesToFloat(pixel);
+      grp->pixels[i] = lanesToInt(foreground - lanesToFloat(lanesToInt(background)));
+      grp->foreground_pixels[i] = selectLanesFloat(active, foreground, grp->foreground_pixels[i]);
+      grp->background_pixels[i] = selectLanesFloat(active, background, grp->background_pixels[i]);
+    #endif
+  }
+}
+
+// divPow2Trunc on every lane
+LANE_INLINE lane_i divPow2TruncLanes(const lane_i value, const unsigned int shift)
+{
+  return (value + ((value >> 31) & ((1 << shift) - 1))) >> shift;
+}
+
+// interpnTable on every lane
+LANE_INLINE void interpStreams(GestureStreamGroup *grp, const InterpTable *table)
+{
+  const unsigned int shift = table->shift, row_stride = table->w2 << shift;
+  lane_i *interp_pixels = grp->interp_pixels;
+
+  // Stretch in x-direction into every factor-th row, then in y-direction in place, like interpnTable
+  for (unsigned int i = 0; i < table->h; i++) {
+    const lane_i *src = &grp->pixels[i * table->w];
+    lane_i *dst = &interp_pixels[i * row_stride];
+    for (unsigned int j = 0; j < table->w2; j++) {
+      const lane_i *a = &src[table->x_src[j]];
+      if (table->x_wb[j] == 0)
+        dst[j] = a[0];
+      else
+        dst[j] = divPow2TruncLanes(a[0] * (int)table->x_wa[j] + a[1] * (int)table->x_wb[j], shift);
+    }
+  }
+  for (unsigned int i = 0; i < table->h2; i++) {
+    if (table->y_wb[i] == 0) {
+      continue;
+    }
+    const lane_i *a = &interp_pixels[table->y_src[i] * row_stride];
+    const lane_i *c = a + row_stride;
+    lane_i *dst = &interp_pixels[i * table->w2];
+    const int wa = table->y_wa[i], wb = table->y_wb[i];
+    for (unsigned int j = 0; j < table->w2; j++) {
+      dst[j] = divPow2TruncLanes(a[j] * wa + c[j] * wb, shift);
+    }
+  }
+}
+
+LANE_TARGETS void runGestureStreams(GestureStreamGroup *grp, const int *const frames[LANES], GestureResult gesResults[LANES])
+{
+  const GestureConfig *cfg = &grp->proto.cfg;
+  const InterpTable *interp = &grp->proto.interp_table;
+  lane_i active = {0};
+
+  // Interleave the frames
+  for (unsigned int l = 0; l < LANES; l++) {
+    active[l] = frames[l] ? -1 : 0;
+    for (unsigned int i = 0; i < NUM_SENSOR_PIXELS; i++) {
+      grp->pixels[i][l] = frames[l] ? frames[l][i] : 0;
+    }
+  }
+
+  // Noise filter, static background subtraction and post-filter max pixel
+  filterStreams(grp, active);
+  lane_i maxpixel = grp->pixels[0];
+  for (unsigned int i = 1; i < NUM_SENSOR_PIXELS; i++) {
+    maxpixel = selectLanes(grp->pixels[i] > maxpixel, grp->pixels[i], maxpixel);
+  }
+  const lane_i present = active & (maxpixel >= cfg->end_detection_threshold);
+
+  // Interpolation, thresholding and center of mass, for all lanes unless every stream is idle. The thresholded
+  // center of mass is computed over the whole frame, which gives the same result as the region of interest path
+  lane_u cmx_numer = {0}, cmy_numer = {0}, mass = {0};
+  int any_present = 0;
+  for (unsigned int l = 0; l < LANES; l++) {
+    any_present |= present[l];
+  }
+  if (any_present) {
+    lane_i clamp_threshold;
+    for (unsigned int l = 0; l < LANES; l++) {
+      const int peak_threshold = (int)(maxpixel[l]/cfg->zero_clamp_threshold_factor);
+      clamp_threshold[l] = peak_threshold > cfg->zero_clamp_threshold ? peak_threshold : cfg->zero_clamp_threshold;
+    }
+
+    const lane_i *interp_pixels = grp->pixels;
+    if (interp->factor > 1) {
+      interpStreams(grp, interp);
+      interp_pixels = grp->interp_pixels;
+    }
+    for (unsigned int y = 0; y < interp->h2; y++) {
+      const lane_i *row = &interp_pixels[y * interp->w2];
+      lane_u row_sum = {0};
+      for (unsigned int x = 0; x < interp->w2; x++) {
+        const lane_u v = (lane_u)(row[x] & ~(row[x] < clamp_threshold));
+        cmx_numer += x * v;
+        row_sum += v;
+      }
+      cmy_numer += y * row_sum;
+      mass += row_sum;
+    }
+  }
+
+  for (unsigned int l = 0; l < LANES; l++) {
+    if (!active[l]) {
+      continue;
+    }
+    float cmx = -1.0f, cmy = -1.0f;
+    if (maxpixel[l] < cfg->end_detection_threshold) {
+      grp->n_idle_frame[l]++;
+    }
+    else {
+      const int totalmass = mass[l] ? (int)mass[l] : 1; // avoid NaN
+      cmx = (float)(int)cmx_numer[l]/(float)totalmass;
+      cmy = (float)(int)cmy_numer[l]/(float)totalmass;
+      cmx = cmx/interp->factor;
+      cmy = cmy/interp->factor * DY_PIXEL_SCALE; // scale y so it has same unit dimension as x
+    }
+    grp->n_frame[l]++;
+    if (grp->reset_mask[l]) {
+      resetSwipe(&grp->swipe[l]);
+    }
+
+    GestureResult *gesResult = &gesResults[l];
+    memset(gesResult, 0, sizeof(GestureResult));
+    gesResult->gesture = runSwipe(&grp->swipe[l], maxpixel[l], cmx, cmy);
+    gesResult->n_sample = grp->swipe[l].n_sample;
+    gesResult->maxpixel = maxpixel[l];
+    gesResult->state = maxpixel[l] >= cfg->end_detection_threshold ? GESTURE_IN_PROGRESS : STATE_INACTIVE;
+    gesResult->x = cmx;
+    gesResult->y = cmy;
+  }
+  grp->reset_mask &= ~active;
+}
@@ -0,0 +1,82 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+/*
+* Host engine that runs the dynamic gesture algorithm on GESTURE_STREAM_LANES independent sensor streams at once.
+* The state of all streams is interleaved pixel by pixel, [pixel][lane], so every stage of the algorithm is a
+* loop over the lanes that the compiler turns into SIMD instructions with one stream per vector lane.
+* The results of each stream are identical to running it through its own GestureEngine.
+* Only the dynamic gesture path of runGestureEngine is implemented.
+*/
+
+#ifndef STREAM_GROUP_H_INCLUDED
+#define STREAM_GROUP_H_INCLUDED
+
+#include "gesture_common.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Streams per group: one AVX-512 vector of floats, or two AVX2 vectors
+#define GESTURE_STREAM_LANES 16
+
+typedef struct GestureStreamGroup GestureStreamGroup;
+
+// Allocates a group with all streams reset and configured with cfg (default values if NULL). NULL if out of memory
+GestureStreamGroup * createGestureStreamGroup(const GestureConfig *cfg);
+void destroyGestureStreamGroup(GestureStreamGroup *grp);
+
+// Clears the filters of one stream, like resetGestureEngine, e.g. before starting a new recording on its lane
+void resetGestureStream(GestureStreamGroup *grp, const unsigned int lane);
+
+/**
+* Runs one frame of every stream, like runGestureEngine.
+*
+* Parameters
+* frames:     The next frame of each stream (NUM_SENSOR_PIXELS ints, not modified). A NULL frame leaves the stream
+*             and its result untouched, for streams that have ended or have no frame yet
+* gesResults: The result of each stream
+*/
+void runGestureStreams(GestureStreamGroup *grp, const int *const frames[GESTURE_STREAM_LANES], GestureResult gesResults[GESTURE_STREAM_LANES]);
+
+void getGestureStreamStats(const GestureStreamGroup *grp, const unsigned int lane, GestureStats *stats);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
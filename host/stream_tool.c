@@ -0,0 +1,184 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+/*
+* Encodes recorded frames into a serial data stream capture the way the firmware streams them, and decodes
+* captures of either stream format version. Reports the size of the frames, to compare the formats.
+*/
+
+#include <stdio.h>
+#include <unistd.h>
+#include "frame_io.h"
+
+static void usage(const char *prog)
+{
+  fprintf(stderr,
+    "usage: %s -e <v1|v2|v2delta> [-r] [-x] [-o capture.bin] <frames|->\n"
+    "       %s [-p] [-o output.csv] <capture|->\n"
+    "  -e format  encode the text recording as a data stream capture in this format (default: decode a capture)\n"
+    "  -r         stream the raw pixels without running the gesture algorithm, to record captures for replay\n"
+    "  -x         do not stream pixel data (stream on nopixels)\n"
+    "  -p         write the pixels of every decoded frame after its results\n"
+    "  -o file    write to file instead of stdout\n", prog, prog);
+}
+
+// The version 1 frame built by processFrame() in main.cpp
+static unsigned int encodeStreamV1Frame(const GestureResult *gesResult, const int pixels[], const int send_pixels, uint8_t frm_data[])
+{
+  memset(frm_data, 0, STREAM_FRAME_BYTES);
+  frm_data[0] = 255;
+  frm_data[1] = 255;
+  frm_data[2] = gesResult->gesture;
+  frm_data[3] = gesResult->state;
+  frm_data[4] = gesResult->n_sample;
+  frm_data[6] = (gesResult->maxpixel>>8) & 0xFF;
+  frm_data[7] = gesResult->maxpixel & 0xFF;
+  memcpy(frm_data+10, &gesResult->x, 4);
+  memcpy(frm_data+15, &gesResult->y, 4);
+  for (uint32_t i=0; i<NUM_SENSOR_PIXELS; i++) {
+    frm_data[2*i + STREAM_INFO_BYTES] = (pixels[i]>>8) & 0xFF;
+    frm_data[2*i+1 + STREAM_INFO_BYTES] = pixels[i] & 0xFF;
+  }
+  return send_pixels ? STREAM_FRAME_BYTES : STREAM_INFO_BYTES;
+}
+
+static int encode(const char *path, const char *format, const int raw, const int send_pixels, FILE *out)
+{
+  const int v1 = strcmp(format, "v1") == 0;
+  if (!v1 && strcmp(format, "v2") != 0 && strcmp(format, "v2delta") != 0) {
+    fprintf(stderr, "unknown stream format %s\n", format);
+    return 2;
+  }
+
+  int *frames;
+  unsigned int num_frames;
+  if (loadFrameFile(path, FRAME_FORMAT_TEXT, &frames, &num_frames)) {
+    return 1;
+  }
+  GestureEngine *eng = createGestureEngine();
+  if (!eng) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+  StreamEncoder encoder;
+  initStreamEncoder(&encoder, send_pixels, strcmp(format, "v2delta") == 0);
+
+  unsigned long total_bytes = 0;
+  for (unsigned int f = 0; f < num_frames; f++) {
+    int *pixels = frames + (size_t)f * NUM_SENSOR_PIXELS;
+    GestureResult gesResult;
+    memset(&gesResult, 0, sizeof(GestureResult));
+    if (!raw) {
+      runGestureEngine(eng, pixels, &gesResult);
+    }
+    uint8_t frm_data[STREAM_V2_MAX_FRAME_BYTES > STREAM_FRAME_BYTES ? STREAM_V2_MAX_FRAME_BYTES : STREAM_FRAME_BYTES];
+    unsigned int num_bytes = v1 ? encodeStreamV1Frame(&gesResult, pixels, send_pixels, frm_data)
+                                : encodeStreamFrame(&encoder, &gesResult, pixels, frm_data);
+    fwrite(frm_data, 1, num_bytes, out);
+    total_bytes += num_bytes;
+  }
+  fprintf(stderr, "%u frames, %lu bytes (%.1f bytes/frame)\n",
+    num_frames, total_bytes, num_frames ? (double)total_bytes / num_frames : 0.0);
+
+  destroyGestureEngine(eng);
+  free(frames);
+  return 0;
+}
+
+static int decode(const char *path, const int write_pixels, FILE *out)
+{
+  StreamFrame *frames;
+  unsigned int num_frames;
+  StreamCaptureStats stats;
+  if (loadStreamCapture(path, &frames, &num_frames, &stats)) {
+    return 1;
+  }
+
+  fprintf(out, "frame,seq,gesture,state,n_sample,maxpixel,x,y%s\n", write_pixels ? ",pixels..." : "");
+  for (unsigned int f = 0; f < num_frames; f++) {
+    const GestureResult *result = &frames[f].result;
+    fprintf(out, "%u,%u,%d,%u,%u,%d,%.9g,%.9g", f, frames[f].seq, (int)result->gesture, result->state,
+      result->n_sample, result->maxpixel, result->x, result->y);
+    if (write_pixels && frames[f].encoding != STREAM_PIXELS_NONE) {
+      for (unsigned int i = 0; i < NUM_SENSOR_PIXELS; i++) {
+        fprintf(out, ",%d", frames[f].pixels[i]);
+      }
+    }
+    fprintf(out, "\n");
+  }
+  unsigned int decoded = stats.v1_frames + stats.v2_frames;
+  fprintf(stderr, "%u v1 frames, %u v2 frames, %u v2 frames skipped, %.1f bytes/frame, %lu bytes of garbage\n",
+    stats.v1_frames, stats.v2_frames, stats.v2_skipped, decoded ? (double)stats.frame_bytes / decoded : 0.0, stats.garbage_bytes);
+
+  free(frames);
+  return 0;
+}
+
+int main(int argc, char *argv[])
+{
+  const char *format = NULL;
+  const char *out_path = NULL;
+  int raw = 0, send_pixels = 1, write_pixels = 0;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "e:rxpo:h")) != -1) {
+    switch (opt) {
+      case 'e': format = optarg; break;
+      case 'r': raw = 1; break;
+      case 'x': send_pixels = 0; break;
+      case 'p': write_pixels = 1; break;
+      case 'o': out_path = optarg; break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if (optind != argc - 1) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  FILE *out = stdout;
+  if (out_path) {
+    out = fopen(out_path, format ? "wb" : "w");
+    if (!out) {
+      perror(out_path);
+      return 1;
+    }
+  }
+  int status = format ? encode(argv[optind], format, raw, send_pixels, out) : decode(argv[optind], write_pixels, out);
+  if (out != stdout) {
+    fclose(out);
+  }
+  return status;
+}
@@ -0,0 +1,220 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+/*
+* Test of the pre/post-trigger frame capture (capture.h). Frames carry their frame number in their pixel bytes,
+* so a dump, assembled like sendCaptureDump does and decoded with decodeCaptureDump, shows exactly which frames
+* were kept. Triggers are placed so the window wraps around the ring, is clipped at the start of the recording
+* and at the frame the capture was armed, and the capture is re-armed and triggered again.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "capture.h"
+
+#define DUMP_BYTES (CAPTURE_DUMP_HEADER_BYTES + CAPTURE_FRAMES * CAPTURE_RECORD_BYTES + 1)
+
+static unsigned int failures;
+static unsigned int checks;
+
+static void check(const int ok, const char *test, const char *what, const unsigned int n)
+{
+  checks++;
+  if (!ok) {
+    failures++;
+    if (failures <= 20) {
+      fprintf(stderr, "FAIL %s: %s (%u)\n", test, what, n);
+    }
+  }
+}
+
+static void recordFrame(CaptureBuffer *cap, const uint32_t frame)
+{
+  uint8_t bytes[FRAME_READER_FRAME_BYTES];
+  for (unsigned int i = 0; i < FRAME_READER_FRAME_BYTES; i++) {
+    bytes[i] = (uint8_t)(frame + i);
+  }
+  captureFrame(cap, bytes, 1000 * frame, frame);
+}
+
+// Assembles the dump and decodes it. Returns the number of records, or -1 if the dump does not decode
+static int dumpCapture(const CaptureBuffer *cap, const char *test, CaptureDump *dump)
+{
+  static uint8_t data[3 + DUMP_BYTES];
+  const CaptureRecord *runs[2];
+  unsigned int counts[2];
+  uint8_t checksum;
+  const unsigned int count = getCaptureDump(cap, data + 3, runs, counts, &checksum);
+  check(counts[0] + counts[1] == count && count <= CAPTURE_FRAMES, test, "runs", count);
+
+  // Other stream bytes ahead of the dump, as on the serial port
+  data[0] = 0xFF;
+  data[1] = 0xFF;
+  data[2] = 0x00;
+  unsigned int length = 3 + CAPTURE_DUMP_HEADER_BYTES;
+  for (unsigned int r = 0; r < 2; r++) {
+    memcpy(data + length, runs[r], counts[r] * CAPTURE_RECORD_BYTES);
+    length += counts[r] * CAPTURE_RECORD_BYTES;
+  }
+  data[length++] = checksum;
+  check(decodeCaptureDump(data, length - 1, dump) == -1, test, "truncated dump rejected", count);
+  data[length / 2] ^= 0x01;
+  check(decodeCaptureDump(data, length, dump) == -1, test, "corrupt dump rejected", count);
+  data[length / 2] ^= 0x01;
+  return decodeCaptureDump(data, length, dump) == 0 ? (int)dump->num_records : -1;
+}
+
+// The dump holds frames first..first+count-1 with the trigger at frame trigger
+static void checkDump(const CaptureBuffer *cap, const char *test, const uint32_t first, const unsigned int count,
+                      const uint32_t trigger, const CaptureCause cause)
+{
+  CaptureDump dump;
+  const int num_records = dumpCapture(cap, test, &dump);
+  check(num_records == (int)count, test, "record count", num_records);
+  if (num_records != (int)count) {
+    return;
+  }
+  check(dump.cause == (uint32_t)cause, test, "cause", dump.cause);
+  check(count == 0 || dump.trigger_record == trigger - first, test, "trigger record", dump.trigger_record);
+  for (unsigned int i = 0; i < count; i++) {
+    uint32_t timestamp_us, frame;
+    const uint8_t *bytes = getCaptureDumpRecord(&dump, i, &timestamp_us, &frame);
+    int same = frame == first + i && timestamp_us == 1000 * (first + i);
+    for (unsigned int b = 0; b < FRAME_READER_FRAME_BYTES; b++) {
+      same &= bytes[b] == (uint8_t)(first + i + b);
+    }
+    check(same, test, "record", i);
+  }
+}
+
+// Windows around triggers that wrap the ring, are clipped at the first frame, and fill the whole ring
+static void testWindow()
+{
+  static CaptureBuffer cap;
+  uint32_t frame = 0;
+
+  // The window wraps: frames 30..90 are ring records 30..63 and 0..26
+  initCaptureBuffer(&cap, 40, 20, 0, 0);
+  for (; frame <= 70; frame++) {
+    recordFrame(&cap, frame);
+  }
+  check(triggerCapture(&cap, CAPTURE_CAUSE_COMMAND) == 1 && cap.state == CAPTURE_TRIGGERED, "wrap", "triggered", 70);
+  check(triggerCapture(&cap, CAPTURE_CAUSE_MAXPIXEL) == 0, "wrap", "second trigger ignored", 70);
+  for (; frame < 200; frame++) {
+    recordFrame(&cap, frame);
+    check(cap.state == (frame < 90 ? CAPTURE_TRIGGERED : CAPTURE_FROZEN), "wrap", "frozen after post frames", frame);
+  }
+  checkDump(&cap, "wrap", 30, 61, 70, CAPTURE_CAUSE_COMMAND);
+
+  // pre is reduced so pre + 1 + post fits the ring
+  initCaptureBuffer(&cap, 100, 10, 0, 0);
+  check(cap.pre == CAPTURE_FRAMES - 11 && cap.post == 10, "full", "pre limited", cap.pre);
+  for (frame = 0; frame <= 100; frame++) {
+    recordFrame(&cap, frame);
+  }
+  triggerCapture(&cap, CAPTURE_CAUSE_COMMAND);
+  for (; frame <= 120; frame++) {
+    recordFrame(&cap, frame);
+  }
+  checkDump(&cap, "full", 100 - (CAPTURE_FRAMES - 11), CAPTURE_FRAMES, 100, CAPTURE_CAUSE_COMMAND);
+
+  // A trigger early in the recording keeps the frames there are; without post frames the ring freezes at once
+  initCaptureBuffer(&cap, 10, 0, 0, 0);
+  check(triggerCapture(&cap, CAPTURE_CAUSE_COMMAND) == 0, "early", "no trigger before the first frame", 0);
+  for (frame = 0; frame < 4; frame++) {
+    recordFrame(&cap, frame);
+  }
+  check(triggerCapture(&cap, CAPTURE_CAUSE_COMMAND) == 1 && cap.state == CAPTURE_FROZEN, "early", "frozen", frame);
+  recordFrame(&cap, frame);
+  checkDump(&cap, "early", 0, 4, 3, CAPTURE_CAUSE_COMMAND);
+
+  // Without a trigger, the whole ring up to the last frame
+  initCaptureBuffer(&cap, 10, 10, 0, 0);
+  checkDump(&cap, "armed", 0, 0, 0, CAPTURE_CAUSE_NONE);
+  for (frame = 0; frame < 100; frame++) {
+    recordFrame(&cap, frame);
+  }
+  checkDump(&cap, "armed", 100 - CAPTURE_FRAMES, CAPTURE_FRAMES, 99, CAPTURE_CAUSE_NONE);
+}
+
+// The automatic triggers, and a re-armed capture that only holds frames recorded since it was armed
+static void testRearm()
+{
+  static CaptureBuffer cap;
+  uint32_t frame = 0;
+
+  initCaptureBuffer(&cap, 8, 4, CAPTURE_ON_STATE | CAPTURE_ON_MAXPIXEL, 5000);
+  for (; frame < 20; frame++) {
+    recordFrame(&cap, frame);
+    checkCaptureTriggers(&cap, 0, 100);
+  }
+  check(cap.state == CAPTURE_ARMED, "rearm", "no trigger", cap.state);
+  recordFrame(&cap, frame);
+  checkCaptureTriggers(&cap, 1, 100); // object detected
+  check(cap.state == CAPTURE_TRIGGERED && cap.cause == CAPTURE_CAUSE_STATE, "rearm", "state trigger", cap.cause);
+  for (frame++; frame < 30; frame++) {
+    recordFrame(&cap, frame);
+  }
+  checkDump(&cap, "rearm", 12, 13, 20, CAPTURE_CAUSE_STATE);
+
+  // Armed again: a trigger needs a frame recorded since, and the window starts at the first one
+  armCapture(&cap);
+  check(cap.state == CAPTURE_ARMED && cap.cause == CAPTURE_CAUSE_NONE, "rearm", "armed", cap.state);
+  checkDump(&cap, "rearm", 0, 0, 0, CAPTURE_CAUSE_NONE);
+  check(triggerCapture(&cap, CAPTURE_CAUSE_COMMAND) == 0 && cap.state == CAPTURE_ARMED, "rearm",
+    "no trigger without a frame since arming", cap.state);
+  checkDump(&cap, "rearm", 0, 0, 0, CAPTURE_CAUSE_NONE);
+  for (; frame < 33; frame++) {
+    recordFrame(&cap, frame);
+    checkCaptureTriggers(&cap, 1, 100);
+  }
+  checkDump(&cap, "rearm", 30, 3, 32, CAPTURE_CAUSE_NONE);
+  recordFrame(&cap, frame);
+  checkCaptureTriggers(&cap, 1, 6000);
+  check(cap.state == CAPTURE_TRIGGERED && cap.cause == CAPTURE_CAUSE_MAXPIXEL, "rearm", "maxpixel trigger", cap.cause);
+  for (frame++; frame < 60; frame++) {
+    recordFrame(&cap, frame);
+  }
+  checkDump(&cap, "rearm", 30, 8, 33, CAPTURE_CAUSE_MAXPIXEL);
+  check(cap.triggers == 2, "rearm", "triggers", cap.triggers);
+}
+
+int main()
+{
+  testWindow();
+  testRearm();
+  printf("capture: %u checks, %u failed\n", checks, failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,218 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+/*
+* Test of the binary command channel (cmd_packet.h). Requests are fed to the parser byte by byte mixed with text
+* commands, stray bytes, requests with a bad checksum and a truncated request, and every valid request after
+* them must still be received whole. Responses and the packed GestureResult must survive a round trip bit for
+* bit, and corrupt or partial responses must be rejected or wait for more bytes.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "cmd_packet.h"
+
+#define STREAM_BYTES 4096
+
+static unsigned int failures;
+static unsigned int checks;
+
+static void check(const int ok, const char *test, const char *what, const unsigned int n)
+{
+  checks++;
+  if (!ok) {
+    failures++;
+    if (failures <= 20) {
+      fprintf(stderr, "FAIL %s: %s (%u)\n", test, what, n);
+    }
+  }
+}
+
+// Appends a request to data. Returns its length
+static unsigned int putRequest(uint8_t *data, const uint8_t opcode, const uint8_t *payload, const uint8_t length)
+{
+  uint8_t sum = opcode + length;
+  data[0] = CMD_PACKET_SYNC;
+  data[1] = opcode;
+  data[2] = length;
+  for (unsigned int i = 0; i < length; i++) {
+    data[3 + i] = payload[i];
+    sum += payload[i];
+  }
+  data[3 + length] = sum;
+  return 4 + length;
+}
+
+typedef struct {
+  uint8_t opcode;
+  uint8_t length;
+  uint8_t first;              // First payload byte, 0 without payload
+} Received;
+
+// Feeds bytes to the parser, dt_us apart. Returns the number of complete requests, and counts bad checksums
+static unsigned int feed(CmdPacketParser *parser, const uint8_t *data, const unsigned int length, uint32_t *now_us,
+                         const uint32_t dt_us, Received received[], unsigned int *bad)
+{
+  unsigned int count = 0;
+  for (unsigned int i = 0; i < length; i++) {
+    cmdPacketInProgress(parser, *now_us);
+    const int status = parseCmdPacketByte(parser, data[i], *now_us);
+    *now_us += dt_us;
+    if (status == 1) {
+      received[count].opcode = parser->opcode;
+      received[count].length = parser->length;
+      received[count].first = parser->length ? parser->payload[0] : 0;
+      count++;
+    }
+    else if (status < 0) {
+      (*bad)++;
+    }
+  }
+  return count;
+}
+
+// After stray bytes, text, a bad checksum or a truncated request the parser picks up the next request
+static void testResync()
+{
+  static uint8_t data[STREAM_BYTES];
+  static uint8_t payload[CMD_PACKET_MAX_PAYLOAD];
+  Received received[16];
+  CmdPacketParser parser;
+  uint32_t now_us = 0;
+  unsigned int n = 0, bad = 0;
+
+  for (unsigned int i = 0; i < sizeof(payload); i++) {
+    payload[i] = (uint8_t)(i * 5 + 1);
+  }
+  initCmdPacketParser(&parser);
+
+  const char *text = "ping\r\nstream on\n";
+  memcpy(data + n, text, strlen(text));
+  n += strlen(text);
+  data[n++] = CMD_RESPONSE_SYNC; // not a request sync byte
+  data[n++] = 0x00;
+  n += putRequest(data + n, CMD_OP_PING, NULL, 0);
+  const unsigned int corrupt = n + 3 + 2;
+  n += putRequest(data + n, CMD_OP_REG_WRITE, payload, 3);
+  data[corrupt] ^= 0x01; // payload byte: checksum no longer matches
+  n += putRequest(data + n, CMD_OP_REG_READ, payload, 2);
+  n += putRequest(data + n, CMD_OP_REG_WRITE, payload, CMD_PACKET_MAX_PAYLOAD);
+  const unsigned int checksum_pos = n + 3 + 10;
+  n += putRequest(data + n, CMD_OP_STREAM, payload + 10, 10);
+  data[checksum_pos] ^= 0x80; // the checksum byte itself
+  n += putRequest(data + n, CMD_OP_POLL, NULL, 0);
+
+  unsigned int count = feed(&parser, data, n, &now_us, 100, received, &bad);
+  check(count == 4 && bad == 2, "resync", "requests received and bad checksums", count);
+  check(received[0].opcode == CMD_OP_PING && received[0].length == 0, "resync", "ping after text", 0);
+  check(received[1].opcode == CMD_OP_REG_READ && received[1].length == 2 && received[1].first == payload[0],
+    "resync", "request after a bad checksum", 1);
+  check(received[2].opcode == CMD_OP_REG_WRITE && received[2].length == CMD_PACKET_MAX_PAYLOAD, "resync", "longest payload", 2);
+  check(received[3].opcode == CMD_OP_POLL, "resync", "poll after a bad checksum", 3);
+  check(!cmdPacketInProgress(&parser, now_us), "resync", "idle between requests", 0);
+
+  // A request cut off after its length byte: the parser gives up after the byte timeout, and the text and the
+  // request that follow are read normally
+  n = putRequest(data, CMD_OP_REG_WRITE, payload, 8) - 6;
+  bad = 0;
+  count = feed(&parser, data, n, &now_us, 100, received, &bad);
+  check(count == 0 && cmdPacketInProgress(&parser, now_us), "resync", "truncated request in progress", count);
+  check(cmdPacketInProgress(&parser, now_us + CMD_PACKET_BYTE_TIMEOUT_US / 2), "resync", "still waiting", 0);
+  now_us += CMD_PACKET_BYTE_TIMEOUT_US + 1;
+  check(!cmdPacketInProgress(&parser, now_us), "resync", "abandoned after the byte timeout", 0);
+  n = putRequest(data, CMD_OP_FRAMES, NULL, 0);
+  count = feed(&parser, data, n, &now_us, 100, received, &bad);
+  check(count == 1 && bad == 0 && received[0].opcode == CMD_OP_FRAMES, "resync", "request after a timeout", count);
+}
+
+static void testResponses()
+{
+  uint8_t response[CMD_RESPONSE_MAX_BYTES];
+  uint8_t opcode, status;
+  const uint8_t *payload;
+  unsigned int payload_length;
+
+  for (unsigned int length = 0; length <= CMD_PACKET_MAX_PAYLOAD; length += 51) {
+    for (unsigned int i = 0; i < length; i++) {
+      response[CMD_RESPONSE_HEADER_BYTES + i] = (uint8_t)(i * 3 + length);
+    }
+    const int total = finishCmdResponse(response, CMD_OP_REG_READ, CMD_STATUS_OK, (uint8_t)length);
+    check(total == (int)(CMD_RESPONSE_HEADER_BYTES + length + 1), "response", "length", length);
+    check(decodeCmdResponse(response, total - 1, &opcode, &status, &payload, &payload_length) == 0, "response", "partial", length);
+    check(decodeCmdResponse(response, total, &opcode, &status, &payload, &payload_length) == total
+      && opcode == CMD_OP_REG_READ && status == CMD_STATUS_OK && payload_length == length
+      && payload == response + CMD_RESPONSE_HEADER_BYTES, "response", "decoded", length);
+    response[total - 1] ^= 0x01;
+    check(decodeCmdResponse(response, total, &opcode, &status, &payload, &payload_length) == -1, "response", "bad checksum", length);
+    response[total - 1] ^= 0x01;
+    response[0] = CMD_PACKET_SYNC;
+    check(decodeCmdResponse(response, total, &opcode, &status, &payload, &payload_length) == -1, "response", "bad sync", length);
+  }
+
+  GestureResult result, unpacked;
+  uint8_t packed[CMD_POLL_PAYLOAD_BYTES];
+  memset(&result, 0, sizeof(result));
+  result.gesture = (GestureEvent)3;
+  result.state = 2;
+  result.n_sample = 123456;
+  result.maxpixel = -8000;
+  result.x = 3.14159f;
+  result.y = -1.0f;
+  result.float_placeholder = 1e-30f;
+  result.int_placeholder = 0xDEADBEEFu;
+  result.tracking_state = 1;
+  result.tracking_maxpixel = 16383;
+  result.tracking_x = 0.1f;
+  result.tracking_y = 7.75f;
+  check(packGestureResult(packed, &result) == CMD_POLL_PAYLOAD_BYTES, "poll", "packed length", 0);
+  memset(&unpacked, 0xFF, sizeof(unpacked));
+  unpackGestureResult(&unpacked, packed);
+  check(unpacked.gesture == result.gesture && unpacked.state == result.state && unpacked.n_sample == result.n_sample
+    && unpacked.maxpixel == result.maxpixel && unpacked.int_placeholder == result.int_placeholder
+    && unpacked.tracking_state == result.tracking_state && unpacked.tracking_maxpixel == result.tracking_maxpixel,
+    "poll", "integer fields", 0);
+  check(memcmp(&unpacked.x, &result.x, sizeof(float)) == 0 && memcmp(&unpacked.y, &result.y, sizeof(float)) == 0
+    && memcmp(&unpacked.float_placeholder, &result.float_placeholder, sizeof(float)) == 0
+    && memcmp(&unpacked.tracking_x, &result.tracking_x, sizeof(float)) == 0
+    && memcmp(&unpacked.tracking_y, &result.tracking_y, sizeof(float)) == 0, "poll", "float fields bit for bit", 0);
+}
+
+int main()
+{
+  testResync();
+  testResponses();
+  printf("cmd packet: %u checks, %u failed\n", checks, failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,277 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+/*
+* Test of the frame acquisition ring (frame_reader.h). A test transport stands in for the SPI DMA transfer: it
+* fills the slot with a pattern derived from the frame number and completes when the test says so. The test
+* checks that frames come out in order with their frame numbers and timestamps while head and tail wrap, both
+* around the ring and around 2^32, and that a full ring and a readout still in progress lose frames only as
+* counted drops and overruns. The SPI readout is checked as well, with the mock sensor of host/mock_spi.h: the
+* transfer of the next frame overlaps the processing of the previous one, and the pixels come out as they were
+* loaded into the sensor's registers.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "frame_reader.h"
+#include "mock_spi.h"
+
+#define SPI_TEST_FRAMES 20
+
+typedef struct {
+  FrameReader *reader;
+  uint8_t *buffer;
+  int pending;
+  int fail;                 // Refuse to start the next transfer
+} TestTransport;
+
+static unsigned int failures;
+static unsigned int checks;
+
+static void check(const int ok, const char *test, const char *what, const unsigned int n)
+{
+  checks++;
+  if (!ok) {
+    failures++;
+    if (failures <= 20) {
+      fprintf(stderr, "FAIL %s: %s (%u)\n", test, what, n);
+    }
+  }
+}
+
+static uint8_t patternByte(const uint32_t frame, const unsigned int i)
+{
+  return (uint8_t)(frame * 7 + i);
+}
+
+static int startTestRead(void *ctx, FrameReader *reader, uint8_t buffer[FRAME_READER_BUFFER_BYTES])
+{
+  TestTransport *t = (TestTransport *)ctx;
+  if (t->fail || t->pending) {
+    return -1;
+  }
+  t->reader = reader;
+  t->buffer = buffer;
+  t->pending = 1;
+  return 0;
+}
+
+// Completes the transfer of the frame numbered frame, like the DMA complete interrupt
+static void completeTestRead(TestTransport *t, const uint32_t frame)
+{
+  if (!t->pending) {
+    return;
+  }
+  for (unsigned int i = 0; i < FRAME_READER_FRAME_BYTES; i++) {
+    t->buffer[FRAME_READER_HEADROOM + i] = patternByte(frame, i);
+  }
+  t->pending = 0;
+  frameReaderTransferDone(t->reader);
+}
+
+static int slotHasPattern(const FrameSlot *slot, const uint32_t frame)
+{
+  for (unsigned int i = 0; i < FRAME_READER_FRAME_BYTES; i++) {
+    if (slot->buffer[FRAME_READER_HEADROOM + i] != patternByte(frame, i)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// Consumes one frame and checks it is the expected one
+static void consumeFrame(FrameReader *reader, const char *test, const uint32_t frame, const uint32_t now_us)
+{
+  const FrameSlot *slot = acquireFrameReaderSlot(reader, now_us);
+  check(slot != NULL, test, "frame available", frame);
+  if (!slot) {
+    return;
+  }
+  check(acquireFrameReaderSlot(reader, now_us) == slot, test, "acquire again returns the same slot", frame);
+  check(slot->frame == frame, test, "frame number", frame);
+  check(slot->timestamp_us == 1000 * frame, test, "timestamp", frame);
+  check(slotHasPattern(slot, frame), test, "frame data", frame);
+  releaseFrameReaderSlot(reader);
+}
+
+// Frames read and consumed with up to a full ring in between, so the slots wrap several times, starting with
+// head and tail just below 2^32
+static void testWrap()
+{
+  FrameReader reader;
+  TestTransport t = {0};
+  FrameReaderStats stats;
+  initFrameReader(&reader, startTestRead, &t);
+  reader.head = reader.tail = 0xFFFFFFFDu;
+
+  uint32_t produced = 0, consumed = 0;
+  for (unsigned int round = 0; round < 4 * FRAME_READER_SLOTS; round++) {
+    const unsigned int burst = 1 + round % FRAME_READER_SLOTS;
+    for (unsigned int i = 0; i < burst; i++) {
+      check(frameReaderDataReady(&reader, 1000 * produced) == 1, "wrap", "readout started", produced);
+      completeTestRead(&t, produced);
+      produced++;
+    }
+    while (consumed < produced) {
+      consumeFrame(&reader, "wrap", consumed, 1000 * consumed + 50);
+      consumed++;
+    }
+    check(acquireFrameReaderSlot(&reader, 0) == NULL, "wrap", "ring empty", round);
+  }
+  getFrameReaderStats(&reader, &stats);
+  check(stats.data_ready == produced, "wrap", "data_ready", stats.data_ready);
+  check(stats.frames_read - stats.frames_processed == 0 && stats.queued == 0, "wrap", "queued", stats.queued);
+  check(stats.frames_read - 0xFFFFFFFDu == produced, "wrap", "frames_read", stats.frames_read);
+  check(stats.overruns == 0 && stats.dropped == 0, "wrap", "no frame lost", stats.dropped);
+  check(stats.max_queued == FRAME_READER_SLOTS, "wrap", "max_queued", stats.max_queued);
+  check(stats.max_latency_us == 50, "wrap", "max_latency_us", stats.max_latency_us);
+}
+
+// A ring full of unprocessed frames drops the next ones, a readout in progress or a transport that does not
+// start counts overruns, and the frame numbers after the loss show the gap
+static void testOverflow()
+{
+  FrameReader reader;
+  TestTransport t = {0};
+  FrameReaderStats stats;
+  initFrameReader(&reader, startTestRead, &t);
+
+  uint32_t frame = 0;
+  for (; frame < FRAME_READER_SLOTS; frame++) {
+    frameReaderDataReady(&reader, 1000 * frame);
+    completeTestRead(&t, frame);
+  }
+  check(frameReaderDataReady(&reader, 1000 * frame) == 0, "overflow", "full ring drops the frame", frame);
+  frame++;
+  getFrameReaderStats(&reader, &stats);
+  check(stats.dropped == 1 && stats.overruns == 0, "overflow", "dropped", stats.dropped);
+  check(stats.queued == FRAME_READER_SLOTS, "overflow", "queued", stats.queued);
+
+  // The slot the main loop holds is not reused until it is released
+  consumeFrame(&reader, "overflow", 0, 0);
+  check(acquireFrameReaderSlot(&reader, 0) != NULL, "overflow", "acquire", 1);
+  check(frameReaderDataReady(&reader, 1000 * frame) == 1, "overflow", "readout into the freed slot", frame);
+  check(frameReaderDataReady(&reader, 1000 * (frame + 1)) == 0, "overflow", "overrun while busy", frame + 1);
+  completeTestRead(&t, frame);
+  const uint32_t after_gap = frame;
+  frame += 2;
+  check(frameReaderDataReady(&reader, 1000 * frame) == 0, "overflow", "full again", frame);
+  frame++;
+  releaseFrameReaderSlot(&reader);
+  releaseFrameReaderSlot(&reader); // without an acquired slot: no effect
+
+  t.fail = 1;
+  check(frameReaderDataReady(&reader, 1000 * frame) == 0, "overflow", "transport refused", frame);
+  check(reader.busy == 0, "overflow", "not busy after a refused transfer", frame);
+  frame++;
+  t.fail = 0;
+
+  getFrameReaderStats(&reader, &stats);
+  check(stats.data_ready == frame, "overflow", "data_ready", stats.data_ready);
+  check(stats.dropped == 2 && stats.overruns == 2, "overflow", "dropped and overruns", stats.overruns);
+  check(stats.frames_processed == 2, "overflow", "frames_processed", stats.frames_processed);
+  check(stats.data_ready == stats.frames_read + stats.dropped + stats.overruns, "overflow", "every frame counted", frame);
+
+  for (uint32_t f = 2; f < FRAME_READER_SLOTS; f++) {
+    consumeFrame(&reader, "overflow", f, 0);
+  }
+  consumeFrame(&reader, "overflow", after_gap, 0);
+  check(acquireFrameReaderSlot(&reader, 0) == NULL, "overflow", "ring empty", 0);
+}
+
+// The asynchronous SPI readout: each frame is read while the main loop still holds the previous one
+static void testSpiReadout()
+{
+  static int frames[SPI_TEST_FRAMES * NUM_SENSOR_PIXELS];
+  for (unsigned int i = 0; i < SPI_TEST_FRAMES * NUM_SENSOR_PIXELS; i++) {
+    frames[i] = (int)(((i * 2654435761u) >> 16) % 65535) - 32767; // 0x8000 would read as +32768
+  }
+  frames[0] = -32767;
+  frames[1] = 32767;
+  frames[2] = -1;
+
+  MockSpiSensor dev;
+  FrameReader reader;
+  FrameReaderStats stats;
+  initMockSpiSensor(&dev, frames, SPI_TEST_FRAMES);
+  initFrameReader(&reader, startMockSpiFrameRead, &dev);
+
+  unsigned int f = 0;
+  convertMockSpiFrame(&dev);
+  frameReaderDataReady(&reader, 0);
+  completeMockSpiTransfer(&dev);
+  while (1) {
+    const FrameSlot *slot = acquireFrameReaderSlot(&reader, 0);
+    check(slot != NULL && slot->frame == f, "spi", "frame in order", f);
+    if (!slot) {
+      break;
+    }
+    // The next conversion and readout run while frame f is processed
+    const int more = convertMockSpiFrame(&dev);
+    if (more) {
+      check(frameReaderDataReady(&reader, 1000 * (f + 1)) == 1, "spi", "readout started", f + 1);
+      check(dev.pending, "spi", "transfer pending", f + 1);
+    }
+    int pixels[NUM_SENSOR_PIXELS], flipped[NUM_SENSOR_PIXELS];
+    frameBytesToPixels(slot->buffer + FRAME_READER_HEADROOM, pixels, 0);
+    frameBytesToPixels(slot->buffer + FRAME_READER_HEADROOM, flipped, 1);
+    const int *expected = frames + (size_t)f * NUM_SENSOR_PIXELS;
+    int same = 1;
+    for (unsigned int i = 0; i < NUM_SENSOR_PIXELS; i++) {
+      same &= pixels[i] == expected[i] && flipped[NUM_SENSOR_PIXELS - 1 - i] == expected[i];
+    }
+    check(same, "spi", "pixels", f);
+    releaseFrameReaderSlot(&reader);
+    f++;
+    if (!more) {
+      break;
+    }
+    completeMockSpiTransfer(&dev);
+  }
+  check(f == SPI_TEST_FRAMES, "spi", "all frames read", f);
+  check(dev.transfers == SPI_TEST_FRAMES, "spi", "one transfer per frame", dev.transfers);
+  getFrameReaderStats(&reader, &stats);
+  check(stats.overruns == 0 && stats.dropped == 0, "spi", "no frame lost", stats.overruns);
+  check(stats.max_queued == 1, "spi", "max_queued", stats.max_queued);
+}
+
+int main()
+{
+  testWrap();
+  testOverflow();
+  testSpiReadout();
+  printf("frame reader: %u checks, %u failed\n", checks, failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,238 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+/*
+* Equivalence test of the image kernel sets (img_utils.h). Runs every kernel of every kernel set this CPU supports
+* on random and edge case inputs and compares the results with the scalar kernels. Any difference fails the test:
+* the kernel sets are documented to give identical results, so floats are compared bit for bit.
+* Lengths cover every tail of the vector loops, values the full signed 14/15-bit range including the ADC
+* saturation values, and the interpolation every supported factor on frames up to the table limit.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "img_utils.h"
+
+#define MAX_TEST_PIXELS (MAX_INTERP_TABLE_LENGTH * MAX_INTERP_TABLE_LENGTH)
+#define RANDOM_ROUNDS 20
+
+static const char *kernelNames[] = {"sse2", "avx2"};
+static const unsigned int interpFactors[] = {1, 2, 4, 8};
+
+static unsigned int failures;
+static unsigned int checks;
+static uint32_t randomState = 0x9E3779B9u;
+
+static uint32_t nextRandom()
+{
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+static int randomRange(const int lo, const int hi)
+{
+  return lo + (int)(nextRandom() % (uint32_t)(hi - lo + 1));
+}
+
+typedef enum { FILL_RANDOM, FILL_SMALL, FILL_ZERO, FILL_MAX, FILL_MIN, FILL_ALTERNATE, FILL_RAMP, NUM_FILLS } FillPattern;
+
+static const char *fillNames[] = {"random", "small", "zero", "max", "min", "alternate", "ramp"};
+
+// Fills pixels with a pattern. Values stay within [-range, range-1], range being a power of two
+static void fillPixels(int pixels[], const unsigned int n, const FillPattern fill, const int range)
+{
+  for (unsigned int i = 0; i < n; i++) {
+    switch (fill) {
+      case FILL_RANDOM: pixels[i] = randomRange(-range, range - 1); break;
+      case FILL_SMALL: pixels[i] = randomRange(-3, 3); break;
+      case FILL_ZERO: pixels[i] = 0; break;
+      case FILL_MAX: pixels[i] = range - 1; break;
+      case FILL_MIN: pixels[i] = -range; break;
+      case FILL_ALTERNATE: pixels[i] = i & 1 ? range - 1 : -range; break;
+      default: pixels[i] = (int)(i % (2 * (unsigned int)range)) - range; break;
+    }
+  }
+}
+
+static void check(const int equal, const char *kernels, const char *kernel, const char *fill, const unsigned int n, const unsigned int extra)
+{
+  checks++;
+  if (!equal) {
+    failures++;
+    if (failures <= 20) {
+      fprintf(stderr, "FAIL %s %s: %s input, %u pixels (%u)\n", kernels, kernel, fill, n, extra);
+    }
+  }
+}
+
+// Kernels over a pixel array: max, min, zero below threshold, low pass and background subtraction
+static void testArrayKernels(const ImgUtilsKernels *k, const unsigned int n, const FillPattern fill)
+{
+  static int pixels[MAX_TEST_PIXELS], ref[MAX_TEST_PIXELS], out[MAX_TEST_PIXELS];
+  static float state_a[MAX_TEST_PIXELS], state_b[MAX_TEST_PIXELS], ref_a[MAX_TEST_PIXELS], ref_b[MAX_TEST_PIXELS];
+  const ImgUtilsKernels *s = &imgUtilsKernelsScalar;
+  const char *fname = fillNames[fill];
+  static const float alphas[] = {0.05f, 0.3f, 1.0f};
+
+  fillPixels(pixels, n, fill, 16384);
+  check(k->getMaxPixelValue(pixels, n) == s->getMaxPixelValue(pixels, n), k->name, "getMaxPixelValue", fname, n, 0);
+  check(k->getMinPixelValue(pixels, n) == s->getMinPixelValue(pixels, n), k->name, "getMinPixelValue", fname, n, 0);
+
+  const int thresholds[] = {-16384, -1, 0, 1, 100, 16383, randomRange(-16384, 16383)};
+  for (unsigned int t = 0; t < sizeof(thresholds)/sizeof(thresholds[0]); t++) {
+    memcpy(ref, pixels, n * sizeof(int));
+    memcpy(out, pixels, n * sizeof(int));
+    const unsigned int count_ref = s->zeroPixelsBelowThreshold(ref, n, thresholds[t]);
+    const unsigned int count = k->zeroPixelsBelowThreshold(out, n, thresholds[t]);
+    check(count == count_ref && memcmp(out, ref, n * sizeof(int)) == 0, k->name, "zeroPixelsBelowThreshold", fname, n, t);
+  }
+
+  for (unsigned int a = 0; a < sizeof(alphas)/sizeof(alphas[0]); a++) {
+    for (unsigned int i = 0; i < n; i++) {
+      ref_a[i] = state_a[i] = (float)randomRange(-16384, 16383) + (float)randomRange(0, 255) / 256.0f;
+      ref_b[i] = state_b[i] = (float)randomRange(-16384, 16383) + (float)randomRange(0, 255) / 256.0f;
+    }
+    memcpy(ref, pixels, n * sizeof(int));
+    memcpy(out, pixels, n * sizeof(int));
+    s->filterLowPassPixels(ref, ref_a, n, alphas[a]);
+    k->filterLowPassPixels(out, state_a, n, alphas[a]);
+    check(memcmp(out, ref, n * sizeof(int)) == 0 && memcmp(state_a, ref_a, n * sizeof(float)) == 0, k->name, "filterLowPassPixels", fname, n, a);
+
+    memcpy(ref, pixels, n * sizeof(int));
+    memcpy(out, pixels, n * sizeof(int));
+    const int max_ref = s->subtractBackgroundMax(ref, ref_a, ref_b, n, alphas[a], alphas[a] / 10.0f);
+    const int max = k->subtractBackgroundMax(out, state_a, state_b, n, alphas[a], alphas[a] / 10.0f);
+    check(max == max_ref && memcmp(out, ref, n * sizeof(int)) == 0
+      && memcmp(state_a, ref_a, n * sizeof(float)) == 0 && memcmp(state_b, ref_b, n * sizeof(float)) == 0,
+      k->name, "subtractBackgroundMax", fname, n, a);
+  }
+}
+
+// Center of mass kernels on an xres x yres frame. Frames are kept small enough that the moment sums of
+// full-scale pixels do not overflow
+static void testCenterOfMass(const ImgUtilsKernels *k, const unsigned int xres, const unsigned int yres, const FillPattern fill)
+{
+  static int pixels[MAX_TEST_PIXELS], ref[MAX_TEST_PIXELS], out[MAX_TEST_PIXELS];
+  const ImgUtilsKernels *s = &imgUtilsKernelsScalar;
+  const unsigned int n = xres * yres;
+  const char *fname = fillNames[fill];
+  float cmx_ref, cmy_ref, cmx, cmy;
+  int mass_ref = 0, mass = 0;
+
+  fillPixels(pixels, n, fill, 16384);
+  s->calcCenterOfMass(pixels, xres, yres, &cmx_ref, &cmy_ref, &mass_ref);
+  k->calcCenterOfMass(pixels, xres, yres, &cmx, &cmy, &mass);
+  check(mass == mass_ref && memcmp(&cmx, &cmx_ref, sizeof(float)) == 0 && memcmp(&cmy, &cmy_ref, sizeof(float)) == 0,
+    k->name, "calcCenterOfMass", fname, n, xres);
+
+  const int thresholds[] = {-16384, 0, 1, 8000, 16383};
+  for (unsigned int t = 0; t < sizeof(thresholds)/sizeof(thresholds[0]); t++) {
+    memcpy(ref, pixels, n * sizeof(int));
+    memcpy(out, pixels, n * sizeof(int));
+    mass_ref = mass = 0;
+    const unsigned int count_ref = s->clampCenterOfMass(ref, xres, yres, thresholds[t], &cmx_ref, &cmy_ref, &mass_ref);
+    const unsigned int count = k->clampCenterOfMass(out, xres, yres, thresholds[t], &cmx, &cmy, &mass);
+    check(count == count_ref && mass == mass_ref && memcmp(out, ref, n * sizeof(int)) == 0
+      && memcmp(&cmx, &cmx_ref, sizeof(float)) == 0 && memcmp(&cmy, &cmy_ref, sizeof(float)) == 0,
+      k->name, "clampCenterOfMass", fname, n, xres);
+  }
+}
+
+static void testInterpolation(const ImgUtilsKernels *k, const unsigned int w, const unsigned int h, const FillPattern fill)
+{
+  static int pixels[MAX_TEST_PIXELS], ref[MAX_TEST_PIXELS], out[MAX_TEST_PIXELS];
+  const ImgUtilsKernels *s = &imgUtilsKernelsScalar;
+  InterpTable table;
+
+  fillPixels(pixels, w * h, fill, 16384);
+  for (unsigned int f = 0; f < sizeof(interpFactors)/sizeof(interpFactors[0]); f++) {
+    if (buildInterpTable(&table, w, h, interpFactors[f])) {
+      continue; // Does not fit the table
+    }
+    const unsigned int n2 = table.w2 * table.h2;
+    memset(ref, 0, n2 * sizeof(int));
+    memset(out, 0, n2 * sizeof(int));
+    s->interpnTable(pixels, ref, &table);
+    k->interpnTable(pixels, out, &table);
+    check(memcmp(out, ref, n2 * sizeof(int)) == 0, k->name, "interpnTable", fillNames[fill], w * h, interpFactors[f]);
+  }
+}
+
+static void testKernelSet(const ImgUtilsKernels *k)
+{
+  for (int fill = 0; fill < NUM_FILLS; fill++) {
+    const unsigned int rounds = fill == FILL_RANDOM || fill == FILL_SMALL ? RANDOM_ROUNDS : 1;
+    for (unsigned int r = 0; r < rounds; r++) {
+      // Every length up to a few vectors, then sensor and interpolated frame sizes
+      for (unsigned int n = 0; n <= 70; n++) {
+        testArrayKernels(k, n, (FillPattern)fill);
+      }
+      const unsigned int lengths[] = {60, 73 * 41, 127, 1001, MAX_TEST_PIXELS - 1, MAX_TEST_PIXELS};
+      for (unsigned int i = 0; i < sizeof(lengths)/sizeof(lengths[0]); i++) {
+        testArrayKernels(k, lengths[i], (FillPattern)fill);
+      }
+      for (unsigned int yres = 1; yres <= 12; yres++) {
+        for (unsigned int xres = 1; xres <= 20; xres++) {
+          testCenterOfMass(k, xres, yres, (FillPattern)fill);
+        }
+      }
+      for (unsigned int h = 1; h <= 16; h++) {
+        for (unsigned int w = 1; w <= 17; w++) {
+          testInterpolation(k, w, h, (FillPattern)fill);
+        }
+      }
+    }
+  }
+}
+
+int main()
+{
+  unsigned int sets = 0;
+  for (unsigned int i = 0; i < sizeof(kernelNames)/sizeof(kernelNames[0]); i++) {
+    if (selectImgUtilsKernels(kernelNames[i])) {
+      printf("%s kernels not supported, skipped\n", kernelNames[i]);
+      continue;
+    }
+    const unsigned int failures_before = failures;
+    testKernelSet(getImgUtilsKernels());
+    printf("%s kernels: %s\n", kernelNames[i], failures == failures_before ? "identical to scalar" : "DIFFERENT");
+    sets++;
+  }
+  printf("%u kernel sets, %u checks, %u failed\n", sets, checks, failures);
+  return failures ? 1 : 0;
+}
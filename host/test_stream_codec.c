@@ -0,0 +1,211 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+/*
+* Round trip test of the version 2 data stream format (stream_codec.h). A sequence of frames with moving,
+* still, jumping and out-of-range pixels is encoded with and without pixels and delta encoding, and every frame
+* must decode to the pixels sent (saturated to int16) and to the header fields within their wire precision.
+* Corrupt frames must be rejected, and after a lost frame the delta frames up to the next keyframe are skipped.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "stream_codec.h"
+
+#define TEST_FRAMES 200
+
+static unsigned int failures;
+static unsigned int checks;
+static uint32_t randomState = 0x2545F491u;
+
+static uint32_t nextRandom()
+{
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+static int randomRange(const int lo, const int hi)
+{
+  return lo + (int)(nextRandom() % (uint32_t)(hi - lo + 1));
+}
+
+static void check(const int ok, const char *test, const char *what, const unsigned int n)
+{
+  checks++;
+  if (!ok) {
+    failures++;
+    if (failures <= 20) {
+      fprintf(stderr, "FAIL %s: %s (frame %u)\n", test, what, n);
+    }
+  }
+}
+
+static int saturate16(const int value)
+{
+  return value < INT16_MIN ? INT16_MIN : value > INT16_MAX ? INT16_MAX : value;
+}
+
+// Frame f of the test sequence: a slow drift with noise, a few still frames, jumps across the 14-bit range
+// and frames with pixels outside it
+static void makeFrame(const unsigned int f, int pixels[], GestureResult *result)
+{
+  const unsigned int phase = f % 50;
+  for (unsigned int i = 0; i < NUM_SENSOR_PIXELS; i++) {
+    if (phase >= 10 && phase < 14) {
+      continue; // unchanged
+    }
+    if (phase == 20) {
+      pixels[i] = randomRange(-8192, 8191);
+    }
+    else if (phase == 30) {
+      pixels[i] = i & 1 ? 8191 : -8192;
+    }
+    else if (phase == 40) {
+      pixels[i] = randomRange(-70000, 70000);
+    }
+    else {
+      int p = pixels[i] + randomRange(-40, 40);
+      pixels[i] = p < -8192 ? -8192 : p > 8191 ? 8191 : p;
+    }
+  }
+  memset(result, 0, sizeof(GestureResult));
+  result->state = f % 3;
+  result->gesture = (GestureEvent)(f % 5);
+  result->n_sample = f * 3;
+  result->maxpixel = phase == 40 ? 70000 : randomRange(-8192, 8191);
+  result->x = f % 7 == 0 ? -1.0f : randomRange(0, 2000) / 256.0f + 0.001f;
+  result->y = randomRange(-100, 2000) / 100.0f;
+}
+
+static void checkDecoded(const char *test, const unsigned int f, const StreamFrame *frame, const GestureResult *sent,
+                         const int pixels[], const int with_pixels)
+{
+  check(frame->result.state == sent->state && frame->result.gesture == sent->gesture, test, "state and gesture", f);
+  check(frame->result.n_sample == (sent->n_sample > 255 ? 255 : sent->n_sample), test, "n_sample", f);
+  check(frame->result.maxpixel == saturate16(sent->maxpixel), test, "maxpixel", f);
+  check(fabsf(frame->result.x - sent->x) <= 0.5f / 256 && fabsf(frame->result.y - sent->y) <= 0.5f / 256, test, "x and y", f);
+  check((frame->encoding != STREAM_PIXELS_NONE) == with_pixels, test, "encoding", f);
+  if (with_pixels) {
+    int same = 1;
+    for (unsigned int i = 0; i < NUM_SENSOR_PIXELS; i++) {
+      same &= frame->pixels[i] == saturate16(pixels[i]);
+    }
+    check(same, test, "pixels", f);
+  }
+}
+
+static void testRoundTrip(const char *test, const uint32_t with_pixels, const uint32_t delta)
+{
+  StreamEncoder enc;
+  StreamDecoder dec;
+  StreamFrame frame;
+  GestureResult result;
+  int pixels[NUM_SENSOR_PIXELS] = {0};
+  uint8_t data[STREAM_V2_MAX_FRAME_BYTES];
+  unsigned int counts[4] = {0}, since_key = 0;
+
+  initStreamEncoder(&enc, with_pixels, delta);
+  initStreamDecoder(&dec);
+  for (unsigned int f = 0; f < TEST_FRAMES; f++) {
+    makeFrame(f, pixels, &result);
+    const unsigned int length = encodeStreamFrame(&enc, &result, pixels, data);
+    check(length <= STREAM_V2_MAX_FRAME_BYTES, test, "frame length", f);
+    check(decodeStreamFrame(&dec, data, length - 1, &frame) == 0, test, "partial frame needs more bytes", f);
+    check(decodeStreamFrame(&dec, data, length, &frame) == (int)length, test, "decoded", f);
+    check(frame.seq == (uint8_t)f, test, "seq", f);
+    checkDecoded(test, f, &frame, &result, pixels, with_pixels != 0);
+    counts[frame.encoding]++;
+    since_key = frame.encoding == STREAM_PIXELS_DELTA ? since_key + 1 : 0;
+    check(since_key < STREAM_V2_KEYFRAME_INTERVAL, test, "keyframe interval", f);
+  }
+  check(!with_pixels || counts[STREAM_PIXELS_WIDE] == TEST_FRAMES / 50, test, "wide frames", counts[STREAM_PIXELS_WIDE]);
+  check((counts[STREAM_PIXELS_DELTA] > 0) == (with_pixels && delta), test, "delta frames", counts[STREAM_PIXELS_DELTA]);
+}
+
+// Bad sync, length and checksum are rejected, and a lost frame stops delta decoding until the next keyframe
+static void testCorruptFrames()
+{
+  StreamEncoder enc;
+  StreamDecoder dec;
+  StreamFrame frame;
+  GestureResult result;
+  int pixels[NUM_SENSOR_PIXELS] = {0};
+  uint8_t data[STREAM_V2_MAX_FRAME_BYTES], bad[STREAM_V2_MAX_FRAME_BYTES];
+
+  initStreamEncoder(&enc, 1, 1);
+  initStreamDecoder(&dec);
+  unsigned int skipped = 0, keyframe_after_loss = 0;
+  for (unsigned int f = 0; f < 3 * STREAM_V2_KEYFRAME_INTERVAL; f++) {
+    makeFrame(f % 10, pixels, &result); // no jumps or wide frames, so every frame but the keyframes is a delta frame
+    const unsigned int length = encodeStreamFrame(&enc, &result, pixels, data);
+    const StreamPixelEncoding encoding = (StreamPixelEncoding)data[3];
+
+    for (unsigned int i = 0; i < length; i++) {
+      memcpy(bad, data, length);
+      bad[i] ^= 0x10;
+      const int status = decodeStreamFrame(&dec, bad, length, &frame);
+      // A change of the length byte makes the frame longer (more bytes needed) or leaves the checksum wrong
+      check(status == -1 || (i == 13 && status == 0), "corrupt", "changed byte rejected", f);
+    }
+    if (f == 5) {
+      continue; // lost
+    }
+    const int status = decodeStreamFrame(&dec, data, length, &frame);
+    if (f > 5 && !keyframe_after_loss) {
+      if (encoding == STREAM_PIXELS_DELTA) {
+        check(status == -2, "corrupt", "delta frame after a loss skipped", f);
+        skipped++;
+        continue;
+      }
+      keyframe_after_loss = f;
+    }
+    check(status == (int)length, "corrupt", "decoded", f);
+    checkDecoded("corrupt", f, &frame, &result, pixels, 1);
+  }
+  check(skipped > 0 && keyframe_after_loss == STREAM_V2_KEYFRAME_INTERVAL, "corrupt", "resumed at the keyframe", keyframe_after_loss);
+}
+
+int main()
+{
+  testRoundTrip("nopixels", 0, 0);
+  testRoundTrip("packed", 1, 0);
+  testRoundTrip("delta", 1, 1);
+  testCorruptFrames();
+  printf("stream codec: %u checks, %u failed\n", checks, failures);
+  return failures ? 1 : 0;
+}
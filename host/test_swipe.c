@@ -0,0 +1,170 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+/*
+* Test of the swipe recognizer (runSwipe in swipe.c) with synthetic trajectories at the default configuration.
+* A pass over the sensor in each direction must be reported once, with its direction, exactly exit_frames + 1
+* frames after the object left, and nothing while it is present. Diagonal, short, slow and hovering motion must
+* not be reported, a dropout shorter than the exit time must not split a swipe, and the detection thresholds
+* must apply with their hysteresis.
+*/
+
+#include <stdio.h>
+#include "gesture_common.h"
+
+#define PRESENT 1000              // maxpixel of an object over the sensor, above the start threshold
+
+static unsigned int failures;
+static unsigned int checks;
+
+static void check(const int ok, const char *test, const char *what, const int value)
+{
+  checks++;
+  if (!ok) {
+    failures++;
+    if (failures <= 20) {
+      fprintf(stderr, "FAIL %s: %s (%d)\n", test, what, value);
+    }
+  }
+}
+
+// Moves the object from (x0, y0) to (x1, y1) over frames frames. Returns the number of events reported meanwhile
+static unsigned int move(SwipeContext *ctx, const float x0, const float y0, const float x1, const float y1,
+                         const unsigned int frames, const int maxpixel)
+{
+  unsigned int events = 0;
+  for (unsigned int f = 0; f < frames; f++) {
+    const float t = frames > 1 ? (float)f / (frames - 1) : 0;
+    events += runSwipe(ctx, maxpixel, x0 + t*(x1 - x0), y0 + t*(y1 - y0)) != GEST_NONE;
+  }
+  return events;
+}
+
+// Runs frames without the object until an event is reported or max_frames have passed. Returns the event and
+// the number of frames it took
+static GestureEvent leave(SwipeContext *ctx, const unsigned int max_frames, unsigned int *frames)
+{
+  for (*frames = 1; *frames <= max_frames; (*frames)++) {
+    const GestureEvent event = runSwipe(ctx, 0, -1.0f, -1.0f);
+    if (event != GEST_NONE) {
+      return event;
+    }
+  }
+  return GEST_NONE;
+}
+
+static void checkPass(SwipeContext *ctx, const char *test, const float x0, const float y0, const float x1,
+                      const float y1, const unsigned int frames, const GestureEvent expected)
+{
+  unsigned int latency;
+  check(move(ctx, x0, y0, x1, y1, frames, PRESENT) == 0, test, "no event while the object is present", 0);
+  const GestureEvent event = leave(ctx, 20, &latency);
+  check(event == expected, test, "event", event);
+  if (expected != GEST_NONE) {
+    check(latency == ctx->exit_frames + 1, test, "reported exit_frames + 1 frames after leaving", latency);
+  }
+  check(ctx->state == STATE_INACTIVE, test, "inactive after the object left", ctx->state);
+  check(leave(ctx, 20, &latency) == GEST_NONE, test, "reported once", 0);
+}
+
+static void testSwipes(SwipeContext *ctx)
+{
+  checkPass(ctx, "left", 9.0f, 2.5f, 0.0f, 2.5f, 10, GEST_SWIPE_LEFT);
+  checkPass(ctx, "right", 0.0f, 2.0f, 9.0f, 3.0f, 10, GEST_SWIPE_RIGHT);
+  checkPass(ctx, "up", 4.5f, 5.0f, 4.5f, 0.0f, 6, GEST_SWIPE_UP);
+  checkPass(ctx, "down", 5.0f, 0.0f, 4.0f, 5.0f, 6, GEST_SWIPE_DOWN);
+  checkPass(ctx, "fast", 0.0f, 2.5f, 9.0f, 2.5f, 3, GEST_SWIPE_RIGHT);
+  checkPass(ctx, "diagonal", 0.0f, 0.0f, 5.0f, 5.0f, 8, GEST_NONE);
+  checkPass(ctx, "short", 3.0f, 2.5f, 5.0f, 2.5f, 6, GEST_NONE);
+  checkPass(ctx, "slow", 2.0f, 2.5f, 7.0f, 2.5f, 200, GEST_NONE);
+  checkPass(ctx, "tap", 4.5f, 2.5f, 4.5f, 2.5f, 10, GEST_NONE);
+
+  // Back and forth over the sensor, ending far from the start: the path is too long for a swipe
+  check(move(ctx, 0.0f, 2.5f, 9.0f, 2.5f, 8, PRESENT) + move(ctx, 9.0f, 2.5f, 0.0f, 2.5f, 8, PRESENT)
+    + move(ctx, 0.0f, 2.5f, 9.0f, 2.5f, 8, PRESENT) == 0, "hover", "no event while present", 0);
+  unsigned int latency;
+  check(leave(ctx, 20, &latency) == GEST_NONE, "hover", "rejected", 0);
+}
+
+// A dropout of exit_frames frames continues the gesture; the swipe is reported once, after the object left
+static void testDropout(SwipeContext *ctx)
+{
+  unsigned int latency;
+  check(move(ctx, 0.0f, 2.5f, 4.0f, 2.5f, 5, PRESENT) == 0, "dropout", "first half", 0);
+  for (unsigned int f = 0; f < ctx->exit_frames; f++) {
+    check(runSwipe(ctx, 0, -1.0f, -1.0f) == GEST_NONE, "dropout", "no event during the dropout", f);
+  }
+  check(move(ctx, 5.0f, 2.5f, 9.0f, 2.5f, 5, PRESENT) == 0, "dropout", "second half", 0);
+  check(ctx->n_sample == 10, "dropout", "one gesture", ctx->n_sample);
+  const GestureEvent event = leave(ctx, 20, &latency);
+  check(event == GEST_SWIPE_RIGHT && latency == ctx->exit_frames + 1, "dropout", "one swipe", latency);
+}
+
+// Starts above the start threshold only, continues down to the end threshold
+static void testThresholds(SwipeContext *ctx)
+{
+  const int between = (ctx->start_detection_threshold + ctx->end_detection_threshold) / 2;
+  unsigned int latency;
+  check(move(ctx, 0.0f, 2.5f, 9.0f, 2.5f, 10, between) == 0 && ctx->state == STATE_INACTIVE, "thresholds",
+    "no start below the start threshold", ctx->state);
+  check(leave(ctx, 20, &latency) == GEST_NONE, "thresholds", "no swipe without a start", 0);
+
+  check(move(ctx, 0.0f, 2.5f, 0.0f, 2.5f, 1, ctx->start_detection_threshold) == 0 && ctx->state != STATE_INACTIVE,
+    "thresholds", "start at the start threshold", ctx->state);
+  check(move(ctx, 1.0f, 2.5f, 9.0f, 2.5f, 9, ctx->end_detection_threshold) == 0 && ctx->n_sample == 10,
+    "thresholds", "continued at the end threshold", ctx->n_sample);
+  check(leave(ctx, 20, &latency) == GEST_SWIPE_RIGHT, "thresholds", "swipe", 0);
+}
+
+int main()
+{
+  GestureConfig cfg;
+  SwipeContext ctx;
+  initConfigStructToDefaults(&cfg);
+  configSwipe(&ctx, &cfg);
+  testSwipes(&ctx);
+  testDropout(&ctx);
+  testThresholds(&ctx);
+
+  // A longer exit time at the same frame rate
+  cfg.swipe_exit_ms = 5 * cfg.sample_period_ms;
+  setSwipeSamplePeriod(&ctx, &cfg);
+  check(ctx.exit_frames == 5, "exit time", "exit_frames", ctx.exit_frames);
+  testSwipes(&ctx);
+  testDropout(&ctx);
+
+  printf("swipe: %u checks, %u failed\n", checks, failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,251 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+/*
+* Test of the transmit queue (tx_queue.h) with a simulated transmitter that can be busy. Every frame is
+* self-describing (marker, number, length, then its number repeated), so the received byte stream shows whether
+* frames arrived whole and in order and which ones were dropped. Each policy is run against a transmitter that
+* stalls: drop oldest, drop newest, block until the transmitter drains, and block with a timeout against a
+* transmitter that never drains.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "tx_queue.h"
+
+#define FRAME_MARKER 0xA5
+#define TEST_FRAMES 100
+#define RECEIVED_BYTES 65536
+
+typedef struct {
+  int busy;                   // Accept nothing
+  unsigned int accept_every;  // Accept only every n-th write, 0 for every write
+  unsigned int calls;
+  uint8_t received[RECEIVED_BYTES];
+  unsigned int length;
+} TestTransmitter;
+
+static unsigned int failures;
+static unsigned int checks;
+static uint32_t clockUs;
+
+static void check(const int ok, const char *test, const char *what, const unsigned int n)
+{
+  checks++;
+  if (!ok) {
+    failures++;
+    if (failures <= 20) {
+      fprintf(stderr, "FAIL %s: %s (%u)\n", test, what, n);
+    }
+  }
+}
+
+static unsigned int writeTest(void *ctx, const uint8_t *data, const unsigned int length)
+{
+  TestTransmitter *tx = (TestTransmitter *)ctx;
+  tx->calls++;
+  if (tx->busy || (tx->accept_every && tx->calls % tx->accept_every) || tx->length + length > RECEIVED_BYTES) {
+    return 0;
+  }
+  memcpy(tx->received + tx->length, data, length);
+  tx->length += length;
+  return length;
+}
+
+// Advances 10 us per call, so a wait for the transmitter times out after a bounded number of tries
+static uint32_t testClock()
+{
+  clockUs += 10;
+  return clockUs;
+}
+
+static unsigned int frameLength(const unsigned int n)
+{
+  return 3 + (n * 37) % 150;
+}
+
+static int pushTestFrame(TxQueue *txq, const unsigned int n, const TxQueuePolicy policy)
+{
+  uint8_t frame[160];
+  const unsigned int length = frameLength(n);
+  frame[0] = FRAME_MARKER;
+  frame[1] = (uint8_t)n;
+  frame[2] = (uint8_t)length;
+  memset(frame + 3, (uint8_t)n, length - 3);
+  return txQueuePushWithPolicy(txq, frame, length, policy);
+}
+
+// Parses the received stream into frame numbers. Returns the number of frames, or -1 if a frame is broken
+static int receivedFrames(const TestTransmitter *tx, unsigned int numbers[])
+{
+  unsigned int count = 0;
+  for (unsigned int pos = 0; pos < tx->length; ) {
+    if (pos + 3 > tx->length || tx->received[pos] != FRAME_MARKER) {
+      return -1;
+    }
+    const uint8_t n = tx->received[pos + 1];
+    const unsigned int length = tx->received[pos + 2];
+    if (pos + length > tx->length || length != frameLength(n)) {
+      return -1;
+    }
+    for (unsigned int i = 3; i < length; i++) {
+      if (tx->received[pos + i] != n) {
+        return -1;
+      }
+    }
+    numbers[count++] = n;
+    pos += length;
+  }
+  return count;
+}
+
+// Frames arrive whole, in increasing order, and every frame not received was counted as dropped
+static void checkReceived(const char *test, const TestTransmitter *tx, const TxQueue *txq, const unsigned int pushed)
+{
+  static unsigned int numbers[TEST_FRAMES];
+  TxQueueStats stats;
+  getTxQueueStats(txq, &stats);
+  const int count = receivedFrames(tx, numbers);
+  check(count >= 0, test, "frames arrive whole", tx->length);
+  for (int i = 1; i < count; i++) {
+    check(numbers[i] > numbers[i - 1], test, "frames in order", numbers[i]);
+  }
+  check(count >= 0 && (unsigned int)count + stats.frames_dropped == pushed, test, "lost frames counted", count);
+  check(stats.queued_bytes == 0 && stats.queued_frames == 0, test, "queue drained", stats.queued_bytes);
+  check(stats.bytes_sent == tx->length, test, "bytes_sent", stats.bytes_sent);
+  check(stats.max_queued_bytes <= TX_QUEUE_BYTES + TX_BLOCK_BYTES + TX_MAX_FRAME_BYTES, test, "max_queued_bytes", stats.max_queued_bytes);
+}
+
+// A stalled transmitter: the drop policies keep the newest or the oldest frames, blocking waits for it
+static void testPolicy(const char *test, const TxQueuePolicy policy)
+{
+  static TxQueue txq;
+  static TestTransmitter tx;
+  TxQueueStats stats;
+  memset(&tx, 0, sizeof(tx));
+  initTxQueue(&txq, writeTest, &tx, policy);
+
+  tx.busy = policy != TX_BLOCK;
+  tx.accept_every = policy == TX_BLOCK ? 3 : 0;
+  int rejected = 0;
+  for (unsigned int n = 0; n < TEST_FRAMES; n++) {
+    rejected += pushTestFrame(&txq, n, policy) != 0;
+    txQueuePump(&txq, 0);
+  }
+  tx.busy = 0;
+  check(txQueueFlush(&txq, NULL, 0) == 0, test, "flushed", 0);
+  checkReceived(test, &tx, &txq, TEST_FRAMES);
+
+  static unsigned int numbers[TEST_FRAMES];
+  const int count = receivedFrames(&tx, numbers);
+  getTxQueueStats(&txq, &stats);
+  if (policy == TX_DROP_OLDEST) {
+    check(rejected == 0 && stats.frames_dropped > 0, test, "oldest dropped", stats.frames_dropped);
+    check(count > 0 && numbers[count - 1] == TEST_FRAMES - 1, test, "newest frame kept", count);
+  }
+  else if (policy == TX_DROP_NEWEST) {
+    check(rejected > 0 && (unsigned int)rejected == stats.frames_dropped, test, "newest dropped", stats.frames_dropped);
+    check(count > 0 && numbers[0] == 0 && numbers[count - 1] < TEST_FRAMES - 1, test, "oldest frames kept", count);
+  }
+  else {
+    check(rejected == 0 && stats.frames_dropped == 0 && count == TEST_FRAMES, test, "nothing dropped", stats.frames_dropped);
+    check(stats.blocked > 0 && stats.block_timeouts == 0, test, "blocked", stats.blocked);
+  }
+}
+
+// A blocking push gives up after the block timeout, the flush after its timeout, and what is left over is
+// discarded as whole frames
+static void testBlockTimeout()
+{
+  static TxQueue txq;
+  static TestTransmitter tx;
+  TxQueueStats stats;
+  memset(&tx, 0, sizeof(tx));
+  initTxQueue(&txq, writeTest, &tx, TX_BLOCK);
+  setTxQueueBlockTimeout(&txq, testClock, 1000);
+
+  tx.busy = 1;
+  unsigned int n = 0, rejected = 0;
+  for (; n < TEST_FRAMES / 2; n++) {
+    const uint32_t start_us = clockUs;
+    rejected += pushTestFrame(&txq, n, TX_BLOCK) != 0;
+    check(clockUs - start_us <= 1000 + 20, "timeout", "push waited for the timeout at most", n);
+  }
+  getTxQueueStats(&txq, &stats);
+  check(rejected > 0 && stats.block_timeouts == rejected && stats.frames_dropped == rejected, "timeout", "timeouts counted", rejected);
+
+  const uint32_t start_us = clockUs;
+  check(txQueueFlush(&txq, testClock, 500) > 0, "timeout", "flush timed out", 0);
+  check(clockUs - start_us <= 500 + 20, "timeout", "flush waited for the timeout at most", clockUs - start_us);
+  const unsigned int queued = txq.num_frames;
+  check(txQueueDiscard(&txq) == queued, "timeout", "discarded", queued);
+  getTxQueueStats(&txq, &stats);
+  check(stats.frames_dropped == rejected + queued && stats.queued_frames == 0, "timeout", "discarded frames counted", stats.frames_dropped);
+
+  tx.busy = 0;
+  for (; n < TEST_FRAMES; n++) {
+    check(pushTestFrame(&txq, n, TX_BLOCK) == 0, "timeout", "push after the transmitter recovered", n);
+  }
+  check(txQueueFlush(&txq, testClock, 1000) == 0, "timeout", "flushed", 0);
+  checkReceived("timeout", &tx, &txq, TEST_FRAMES);
+}
+
+// A partial block waits for the hold time before it is sent short
+static void testShortBlockHold()
+{
+  static TxQueue txq;
+  static TestTransmitter tx;
+  TxQueueStats stats;
+  memset(&tx, 0, sizeof(tx));
+  initTxQueue(&txq, writeTest, &tx, TX_DROP_OLDEST);
+
+  pushTestFrame(&txq, 1, TX_DROP_OLDEST); // 40 bytes
+  check(txQueuePump(&txq, 5000) == frameLength(1) && tx.length == 0, "hold", "partial block held", 0);
+  check(txQueuePump(&txq, 5000 + TX_SHORT_BLOCK_HOLD_US - 1) > 0 && tx.length == 0, "hold", "still held", 0);
+  check(txQueuePump(&txq, 5000 + TX_SHORT_BLOCK_HOLD_US) == 0 && tx.length == frameLength(1), "hold", "sent after the hold time", 0);
+  getTxQueueStats(&txq, &stats);
+  check(stats.blocks_sent == 1 && stats.short_blocks_sent == 1, "hold", "short block counted", stats.short_blocks_sent);
+}
+
+int main()
+{
+  testPolicy("drop oldest", TX_DROP_OLDEST);
+  testPolicy("drop newest", TX_DROP_NEWEST);
+  testPolicy("block", TX_BLOCK);
+  testBlockTimeout();
+  testShortBlockHold();
+  printf("tx queue: %u checks, %u failed\n", checks, failures);
+  return failures ? 1 : 0;
+}
@@ -33,9 +33,10 @@
 *******************************************************************************
 */
 
+#include <string.h>
 #include "img_utils.h"
 
-int getMaxPixelValue(const int pixels[], const unsigned int num_pixels)
+static int getMaxPixelValueScalar(const int pixels[], const unsigned int num_pixels)
 {
   int maxpixel=-99999;
   for (unsigned int i = 0; i < num_pixels; i++) {
@@ -46,7 +47,7 @@ int getMaxPixelValue(const int pixels[], const unsigned int num_pixels)
   return maxpixel;
 }
 
-int getMinPixelValue(const int pixels[], const unsigned int num_pixels)
+static int getMinPixelValueScalar(const int pixels[], const unsigned int num_pixels)
 {
   int minpixel=99999;
   for (unsigned int i = 0; i < num_pixels; i++) {
@@ -58,7 +59,7 @@ int getMinPixelValue(const int pixels[], const unsigned int num_pixels)
 }
 
 // Zero out pixels below threshold value. Returns the number of pixels above the threshold
-unsigned int zeroPixelsBelowThreshold(int pixels[], const unsigned int num_pixels, const int threshold)
+static unsigned int zeroPixelsBelowThresholdScalar(int pixels[], const unsigned int num_pixels, const int threshold)
 {
   int pixelsAboveThresholdCount = num_pixels;
   for (unsigned int i = 0; i < num_pixels; i++) {
@@ -71,10 +72,10 @@ unsigned int zeroPixelsBelowThreshold(int pixels[], const unsigned int num_pixel
 }
 
 // Caller must keep static filtpixels array
-void filterLowPassPixels(int pixels[], float filtpixels[], const unsigned int num_pixels, const float alpha)
+static void filterLowPassPixelsScalar(int pixels[], float filtpixels[], const unsigned int num_pixels, const float alpha)
 {
   for (unsigned int i=0; i< num_pixels; i++) {
-    filtpixels[i] = (1.0 - alpha) * filtpixels[i] + alpha * pixels[i];
+    filtpixels[i] = (1.0f - alpha) * filtpixels[i] + alpha * pixels[i];
   }
   for (unsigned int i=0; i< num_pixels; i++) {
     pixels[i] = (int)filtpixels[i];
@@ -86,20 +87,20 @@ void filterLowPassPixels(int pixels[], float filtpixels[], const unsigned int nu
 // alpha_long_avg should be smaller than alpha_short_avg
 // Caller must keep static shart_avg_pixels[] and long_avg_pixels[]
 // The bigger alpha long is, the more aggressive the high pass filter.
-void subtractBackground(int pixels[], float short_avg_pixels[], float long_avg_pixels[], const unsigned int num_pixels, const float alpha_short_avg, const float alpha_long_avg)
+// Returns the max pixel of the result
+static int subtractBackgroundMaxScalar(int pixels[], float short_avg_pixels[], float long_avg_pixels[], const unsigned int num_pixels, const float alpha_short_avg, const float alpha_long_avg)
 {
+  int maxpixel=-99999;
   for (unsigned int i=0; i< num_pixels; i++) {
-    long_avg_pixels[i] = (1.0f - alpha_long_avg) * long_avg_pixels[i] + alpha_long_avg * pixels[i];
-  }
-  for (unsigned int i=0; i< num_pixels; i++) {
-    short_avg_pixels[i] = (1.0f - alpha_short_avg) * short_avg_pixels[i] + alpha_short_avg * pixels[i];
-  }
-  for (unsigned int i=0; i< num_pixels; i++) {
-    pixels[i] = short_avg_pixels[i] - (int)long_avg_pixels[i];
+    pixels[i] = subtractBackgroundPixel(pixels[i], &short_avg_pixels[i], &long_avg_pixels[i], alpha_short_avg, alpha_long_avg);
+    if (maxpixel < pixels[i]) {
+        maxpixel = pixels[i];
+    }
   }
+  return maxpixel;
 }
 
-void calcCenterOfMass(const int pixels[], const unsigned int xres, const unsigned int yres, float *cmx, float *cmy, int *totalmass)
+static void calcCenterOfMassScalar(const int pixels[], const unsigned int xres, const unsigned int yres, float *cmx, float *cmy, int *totalmass)
 {
   int cmx_numer=0, cmy_numer=0;
   for (unsigned int i = 0; i < xres*yres; i++) {
@@ -114,6 +115,32 @@ void calcCenterOfMass(const int pixels[], const unsigned int xres, const unsigne
   *cmy = (float)cmy_numer/(float)(*totalmass);
 }
 
+static unsigned int clampCenterOfMassScalar(int pixels[], const unsigned int xres, const unsigned int yres, const int threshold, float *cmx, float *cmy, int *totalmass)
+{
+  int cmx_numer=0, cmy_numer=0;
+  unsigned int pixelsAboveThresholdCount = 0;
+  for (unsigned int y = 0; y < yres; y++) {
+    int *row = &pixels[y * xres];
+    for (unsigned int x = 0; x < xres; x++) {
+      if (row[x] < threshold) {
+        row[x] = 0;
+      }
+      else {
+        cmx_numer += x*row[x];
+        cmy_numer += y*row[x];
+        *totalmass += row[x];
+        pixelsAboveThresholdCount++;
+      }
+    }
+  }
+  if (*totalmass == 0) {
+    *totalmass = 1; // avoid NaN
+  }
+  *cmx = (float)cmx_numer/(float)(*totalmass);
+  *cmy = (float)cmy_numer/(float)(*totalmass);
+  return pixelsAboveThresholdCount;
+}
+
 void interpn(const int pixels[], int interp_pixels[], const int w, const int h, const int interpolation_factor)
 {
   int w2 = (w - 1) * interpolation_factor + 1;
@@ -153,3 +180,345 @@ void interpn(const int pixels[], int interp_pixels[], const int w, const int h,
     }
   }
 }
+
+int buildInterpTable(InterpTable *table, const unsigned int w, const unsigned int h, const unsigned int interpolation_factor)
+{
+  unsigned int shift = 0;
+  while ((1u << shift) < interpolation_factor) {
+    shift++;
+  }
+  if (w < 1 || h < 1 || interpolation_factor < 1 || (1u << shift) != interpolation_factor) {
+    return -1;
+  }
+  unsigned int w2 = (w - 1) * interpolation_factor + 1;
+  unsigned int h2 = (h - 1) * interpolation_factor + 1;
+  if (w2 > MAX_INTERP_TABLE_LENGTH || h2 > MAX_INTERP_TABLE_LENGTH) {
+    return -1;
+  }
+
+  table->w = w;
+  table->h = h;
+  table->factor = interpolation_factor;
+  table->shift = shift;
+  table->w2 = w2;
+  table->h2 = h2;
+  for (unsigned int j = 0; j < w2; j++) {
+    table->x_src[j] = j >> shift;
+    table->x_wb[j] = j & (interpolation_factor - 1);
+    table->x_wa[j] = interpolation_factor - table->x_wb[j];
+  }
+  for (unsigned int i = 0; i < h2; i++) {
+    table->y_src[i] = i >> shift;
+    table->y_wb[i] = i & (interpolation_factor - 1);
+    table->y_wa[i] = interpolation_factor - table->y_wb[i];
+  }
+  return 0;
+}
+
+static void interpnTableScalar(const int pixels[], int interp_pixels[], const InterpTable *table)
+{
+  const unsigned int w = table->w, h = table->h, w2 = table->w2, h2 = table->h2;
+  const unsigned int shift = table->shift, row_stride = w2 << shift;
+
+  // First stretch in x-direction into every factor-th row of the destination array, like interpn
+  for (unsigned int i = 0; i < h; i++) {
+    const int *src = &pixels[i * w];
+    int *dst = &interp_pixels[i * row_stride];
+    for (unsigned int j = 0; j < w2; j++) {
+      const int *a = &src[table->x_src[j]];
+      if (table->x_wb[j] == 0) // pixel of the original frame, also covers the right edge
+        dst[j] = a[0];
+      else
+        dst[j] = divPow2Trunc(a[0] * table->x_wa[j] + a[1] * table->x_wb[j], shift);
+    }
+  }
+  // Then stretch in y-direction. Rows of the original frame are already in place
+  for (unsigned int i = 0; i < h2; i++) {
+    if (table->y_wb[i] == 0) {
+      continue;
+    }
+    const int *a = &interp_pixels[table->y_src[i] * row_stride];
+    const int *c = a + row_stride;
+    int *dst = &interp_pixels[i * w2];
+    const int wa = table->y_wa[i], wb = table->y_wb[i];
+    for (unsigned int j = 0; j < w2; j++) {
+      dst[j] = divPow2Trunc(a[j] * wa + c[j] * wb, shift);
+    }
+  }
+}
+
+unsigned int findPixelBoundingBox(const int pixels[], const unsigned int xres, const unsigned int yres, const int threshold, PixelRect *rect)
+{
+  unsigned int count = 0;
+  unsigned int x0 = xres, y0 = yres, x1 = 0, y1 = 0;
+  for (unsigned int y = 0; y < yres; y++) {
+    for (unsigned int x = 0; x < xres; x++) {
+      if (pixels[y * xres + x] >= threshold) {
+        x0 = x < x0 ? x : x0;
+        x1 = x > x1 ? x : x1;
+        y0 = y < y0 ? y : y0;
+        y1 = y;
+        count++;
+      }
+    }
+  }
+  if (count) {
+    rect->x0 = x0;
+    rect->y0 = y0;
+    rect->x1 = x1;
+    rect->y1 = y1;
+  }
+  return count;
+}
+
+// A source pixel contributes to the interpolated pixels up to (but excluding) its neighbours' positions
+void interpRectFromSourceRect(const InterpTable *table, const PixelRect *src_rect, PixelRect *interp_rect)
+{
+  const unsigned int f = table->factor;
+  interp_rect->x0 = src_rect->x0 > 0 ? (src_rect->x0 - 1) * f + 1 : 0;
+  interp_rect->y0 = src_rect->y0 > 0 ? (src_rect->y0 - 1) * f + 1 : 0;
+  interp_rect->x1 = src_rect->x1 < table->w - 1 ? (src_rect->x1 + 1) * f - 1 : table->w2 - 1;
+  interp_rect->y1 = src_rect->y1 < table->h - 1 ? (src_rect->y1 + 1) * f - 1 : table->h2 - 1;
+}
+
+// Same as interpnTable, restricted to the output pixels inside interp_rect
+void interpnTableRect(const int pixels[], int interp_pixels[], const InterpTable *table, const PixelRect *interp_rect)
+{
+  const unsigned int w = table->w, w2 = table->w2;
+  const unsigned int shift = table->shift, row_stride = w2 << shift;
+  const unsigned int x0 = interp_rect->x0, x1 = interp_rect->x1;
+
+  // Source rows needed by the output rows of the region
+  const unsigned int src_y0 = table->y_src[interp_rect->y0];
+  const unsigned int src_y1 = table->y_src[interp_rect->y1] + (table->y_wb[interp_rect->y1] ? 1 : 0);
+
+  for (unsigned int i = src_y0; i <= src_y1; i++) {
+    const int *src = &pixels[i * w];
+    int *dst = &interp_pixels[i * row_stride];
+    for (unsigned int j = x0; j <= x1; j++) {
+      const int *a = &src[table->x_src[j]];
+      if (table->x_wb[j] == 0)
+        dst[j] = a[0];
+      else
+        dst[j] = divPow2Trunc(a[0] * table->x_wa[j] + a[1] * table->x_wb[j], shift);
+    }
+  }
+  for (unsigned int i = interp_rect->y0; i <= interp_rect->y1; i++) {
+    if (table->y_wb[i] == 0) {
+      continue;
+    }
+    const int *a = &interp_pixels[table->y_src[i] * row_stride];
+    const int *c = a + row_stride;
+    int *dst = &interp_pixels[i * w2];
+    const int wa = table->y_wa[i], wb = table->y_wb[i];
+    for (unsigned int j = x0; j <= x1; j++) {
+      dst[j] = divPow2Trunc(a[j] * wa + c[j] * wb, shift);
+    }
+  }
+}
+
+unsigned int zeroPixelsBelowThresholdRect(int pixels[], const unsigned int xres, const PixelRect *rect, const int threshold)
+{
+  unsigned int pixelsAboveThresholdCount = 0;
+  for (unsigned int y = rect->y0; y <= rect->y1; y++) {
+    int *row = &pixels[y * xres];
+    for (unsigned int x = rect->x0; x <= rect->x1; x++) {
+      if (row[x] < threshold) {
+        row[x] = 0;
+      }
+      else {
+        pixelsAboveThresholdCount++;
+      }
+    }
+  }
+  return pixelsAboveThresholdCount;
+}
+
+// Same as calcCenterOfMass for a frame that is zero outside rect. Coordinates are relative to the full frame
+void calcCenterOfMassRect(const int pixels[], const unsigned int xres, const PixelRect *rect, float *cmx, float *cmy, int *totalmass)
+{
+  int cmx_numer=0, cmy_numer=0;
+  for (unsigned int y = rect->y0; y <= rect->y1; y++) {
+    const int *row = &pixels[y * xres];
+    for (unsigned int x = rect->x0; x <= rect->x1; x++) {
+      cmx_numer += x*row[x];
+      cmy_numer += y*row[x];
+      *totalmass += row[x];
+    }
+  }
+  if (*totalmass == 0) {
+    *totalmass = 1; // avoid NaN
+  }
+  *cmx = (float)cmx_numer/(float)(*totalmass);
+  *cmy = (float)cmy_numer/(float)(*totalmass);
+}
+
+// Same as clampCenterOfMass for a frame that is zero outside rect. Coordinates are relative to the full frame
+unsigned int clampCenterOfMassRect(int pixels[], const unsigned int xres, const PixelRect *rect, const int threshold, float *cmx, float *cmy, int *totalmass)
+{
+  int cmx_numer=0, cmy_numer=0;
+  unsigned int pixelsAboveThresholdCount = 0;
+  for (unsigned int y = rect->y0; y <= rect->y1; y++) {
+    int *row = &pixels[y * xres];
+    for (unsigned int x = rect->x0; x <= rect->x1; x++) {
+      if (row[x] < threshold) {
+        row[x] = 0;
+      }
+      else {
+        cmx_numer += x*row[x];
+        cmy_numer += y*row[x];
+        *totalmass += row[x];
+        pixelsAboveThresholdCount++;
+      }
+    }
+  }
+  if (*totalmass == 0) {
+    *totalmass = 1; // avoid NaN
+  }
+  *cmx = (float)cmx_numer/(float)(*totalmass);
+  *cmy = (float)cmy_numer/(float)(*totalmass);
+  return pixelsAboveThresholdCount;
+}
+
+q16_t floatToQ16(const float value)
+{
+  return (q16_t)(value * Q16_ONE + (value < 0 ? -0.5f : 0.5f));
+}
+
+// Caller must keep static filtpixels array. Same filter as filterLowPassPixels
+void filterLowPassPixelsQ16(int pixels[], q16_t filtpixels[], const unsigned int num_pixels, const q16_t alpha)
+{
+  for (unsigned int i=0; i< num_pixels; i++) {
+    filtpixels[i] = updateAverageQ16(filtpixels[i], pixels[i], alpha);
+    pixels[i] = q16ToInt(filtpixels[i]);
+  }
+}
+
+// Caller must keep static short_avg_pixels[] and long_avg_pixels[]. Same filter as subtractBackground
+void subtractBackgroundQ16(int pixels[], q16_t short_avg_pixels[], q16_t long_avg_pixels[], const unsigned int num_pixels, const q16_t alpha_short_avg, const q16_t alpha_long_avg)
+{
+  for (unsigned int i=0; i< num_pixels; i++) {
+    pixels[i] = subtractBackgroundPixelQ16(pixels[i], &short_avg_pixels[i], &long_avg_pixels[i], alpha_short_avg, alpha_long_avg);
+  }
+}
+
+int subtractBackgroundMaxQ16(int pixels[], q16_t short_avg_pixels[], q16_t long_avg_pixels[], const unsigned int num_pixels, const q16_t alpha_short_avg, const q16_t alpha_long_avg)
+{
+  int maxpixel=-99999;
+  for (unsigned int i=0; i< num_pixels; i++) {
+    pixels[i] = subtractBackgroundPixelQ16(pixels[i], &short_avg_pixels[i], &long_avg_pixels[i], alpha_short_avg, alpha_long_avg);
+    if (maxpixel < pixels[i]) {
+        maxpixel = pixels[i];
+    }
+  }
+  return maxpixel;
+}
+
+// -----------------------------------------
+// Kernel dispatch
+// -----------------------------------------
+
+const ImgUtilsKernels imgUtilsKernelsScalar = {
+  "scalar",
+  getMaxPixelValueScalar,
+  getMinPixelValueScalar,
+  zeroPixelsBelowThresholdScalar,
+  filterLowPassPixelsScalar,
+  subtractBackgroundMaxScalar,
+  calcCenterOfMassScalar,
+  clampCenterOfMassScalar,
+  interpnTableScalar
+};
+
+#if IMG_UTILS_DISPATCH
+
+static const ImgUtilsKernels *activeKernels = NULL;
+
+// Kernel sets in order of preference
+static const ImgUtilsKernels *kernelSets[] = {
+  &imgUtilsKernelsAvx2,
+  &imgUtilsKernelsSse2,
+  &imgUtilsKernelsScalar
+};
+
+int selectImgUtilsKernels(const char *name)
+{
+  for (unsigned int i = 0; i < sizeof(kernelSets)/sizeof(kernelSets[0]); i++) {
+    if ((name == NULL || strcmp(name, kernelSets[i]->name) == 0) && imgUtilsKernelsSupported(kernelSets[i])) {
+      activeKernels = kernelSets[i];
+      return 0;
+    }
+  }
+  return -1;
+}
+
+const ImgUtilsKernels * getImgUtilsKernels()
+{
+  if (!activeKernels) {
+    selectImgUtilsKernels(NULL);
+  }
+  return activeKernels;
+}
+
+#define IMG_KERNEL(name) (getImgUtilsKernels()->name)
+
+#else
+
+int selectImgUtilsKernels(const char *name)
+{
+  return (name == NULL || strcmp(name, imgUtilsKernelsScalar.name) == 0) ? 0 : -1;
+}
+
+const ImgUtilsKernels * getImgUtilsKernels()
+{
+  return &imgUtilsKernelsScalar;
+}
+
+#define IMG_KERNEL(name) name##Scalar
+
+#endif
+
+int getMaxPixelValue(const int pixels[], const unsigned int num_pixels)
+{
+  return IMG_KERNEL(getMaxPixelValue)(pixels, num_pixels);
+}
+
+int getMinPixelValue(const int pixels[], const unsigned int num_pixels)
+{
+  return IMG_KERNEL(getMinPixelValue)(pixels, num_pixels);
+}
+
+unsigned int zeroPixelsBelowThreshold(int pixels[], const unsigned int num_pixels, const int threshold)
+{
+  return IMG_KERNEL(zeroPixelsBelowThreshold)(pixels, num_pixels, threshold);
+}
+
+void filterLowPassPixels(int pixels[], float filtpixels[], const unsigned int num_pixels, const float alpha)
+{
+  IMG_KERNEL(filterLowPassPixels)(pixels, filtpixels, num_pixels, alpha);
+}
+
+void subtractBackground(int pixels[], float short_avg_pixels[], float long_avg_pixels[], const unsigned int num_pixels, const float alpha_short_avg, const float alpha_long_avg)
+{
+  IMG_KERNEL(subtractBackgroundMax)(pixels, short_avg_pixels, long_avg_pixels, num_pixels, alpha_short_avg, alpha_long_avg);
+}
+
+int subtractBackgroundMax(int pixels[], float short_avg_pixels[], float long_avg_pixels[], const unsigned int num_pixels, const float alpha_short_avg, const float alpha_long_avg)
+{
+  return IMG_KERNEL(subtractBackgroundMax)(pixels, short_avg_pixels, long_avg_pixels, num_pixels, alpha_short_avg, alpha_long_avg);
+}
+
+void calcCenterOfMass(const int pixels[], const unsigned int xres, const unsigned int yres, float *cmx, float *cmy, int *totalmass)
+{
+  IMG_KERNEL(calcCenterOfMass)(pixels, xres, yres, cmx, cmy, totalmass);
+}
+
+unsigned int clampCenterOfMass(int pixels[], const unsigned int xres, const unsigned int yres, const int threshold, float *cmx, float *cmy, int *totalmass)
+{
+  return IMG_KERNEL(clampCenterOfMass)(pixels, xres, yres, threshold, cmx, cmy, totalmass);
+}
+
+void interpnTable(const int pixels[], int interp_pixels[], const InterpTable *table)
+{
+  IMG_KERNEL(interpnTable)(pixels, interp_pixels, table);
+}
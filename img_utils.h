@@ -38,6 +38,11 @@
 
 #include <stdint.h>
 
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
 int getMaxPixelValue(const int pixels[], const unsigned int num_pixels);
 int getMinPixelValue(const int pixels[], const unsigned int num_pixels);
 unsigned int zeroPixelsBelowThreshold(int pixels[], const unsigned int num_pixels, const int threshold);
@@ -46,4 +51,169 @@ void subtractBackground(int pixels[], float short_avg_pixels[], float long_avg_p
 void calcCenterOfMass(const int pixels[], const unsigned int xres, const unsigned int yres, float *cmx, float *cmy, int *totalmass);
 void interpn(const int pixels[], int interp_pixels[], const int w, const int h, const int interpolation_factor);
 
+/*
+* Table driven version of interpn for interpolation factors that are a power of two.
+* The source pixel index and the pair of integer weights of every output column and row are computed once
+* by buildInterpTable, so the per pixel work is two multiplies and a shift. The results are identical to
+* interpn, since for a power-of-two factor its float weights are exact.
+*/
+#define MAX_INTERP_TABLE_LENGTH 128   // Maximum interpolated width or height
+
+typedef struct {
+  unsigned int w, h;              // Source resolution
+  unsigned int factor;            // Interpolation factor
+  unsigned int shift;             // log2(factor)
+  unsigned int w2, h2;            // Interpolated resolution
+  uint8_t x_src[MAX_INTERP_TABLE_LENGTH];   // Source column of each output column
+  uint8_t x_wa[MAX_INTERP_TABLE_LENGTH];    // Weight of source column x_src
+  uint8_t x_wb[MAX_INTERP_TABLE_LENGTH];    // Weight of source column x_src+1
+  uint8_t y_src[MAX_INTERP_TABLE_LENGTH];   // Source row of each output row
+  uint8_t y_wa[MAX_INTERP_TABLE_LENGTH];    // Weight of source row y_src
+  uint8_t y_wb[MAX_INTERP_TABLE_LENGTH];    // Weight of source row y_src+1
+} InterpTable;
+
+// Returns 0 on success, -1 if the factor is not a power of two or the output does not fit the table
+int buildInterpTable(InterpTable *table, const unsigned int w, const unsigned int h, const unsigned int interpolation_factor);
+void interpnTable(const int pixels[], int interp_pixels[], const InterpTable *table);
+
+// Divide by 2^shift, truncating toward zero like the float to int conversion in interpn
+static inline int divPow2Trunc(const int value, const unsigned int shift)
+{
+  return (value + ((value >> 31) & ((1 << shift) - 1))) >> shift;
+}
+
+/*
+* Region of interest versions of the interpolation, clamp and center of mass kernels.
+* Every interpolated pixel is a weighted average of the (up to four) source pixels around it, so with a
+* clamp threshold of 1 or more it can only survive the clamp if one of those source pixels reaches the
+* threshold. findPixelBoundingBox and interpRectFromSourceRect give the region of the interpolated frame
+* that can hold such pixels; running the kernels only inside it gives the same center of mass as the full
+* frame. Pixels of interp_pixels outside the region are left untouched.
+*/
+typedef struct {
+  unsigned int x0, y0;            // First column and row
+  unsigned int x1, y1;            // Last column and row (inclusive)
+} PixelRect;
+
+// Returns the number of pixels >= threshold. rect is only written if there is at least one
+unsigned int findPixelBoundingBox(const int pixels[], const unsigned int xres, const unsigned int yres, const int threshold, PixelRect *rect);
+void interpRectFromSourceRect(const InterpTable *table, const PixelRect *src_rect, PixelRect *interp_rect);
+void interpnTableRect(const int pixels[], int interp_pixels[], const InterpTable *table, const PixelRect *interp_rect);
+unsigned int zeroPixelsBelowThresholdRect(int pixels[], const unsigned int xres, const PixelRect *rect, const int threshold);
+void calcCenterOfMassRect(const int pixels[], const unsigned int xres, const PixelRect *rect, float *cmx, float *cmy, int *totalmass);
+
+/*
+* Fixed point versions of the filter kernels, used when GESTURE_FIXED_POINT is set (see gesture_common.h).
+* Filter states and coefficients are Q16 values: int32_t with 16 fractional bits. Pixel magnitudes must
+* therefore stay below 32768, which holds for the 14-bit ADC output and the differences derived from it.
+* Products are formed in 64 bits (a single SMULL/SMLAL on Cortex-M) and rounded to nearest.
+*
+* Error bound against the float kernels:
+* - Coefficients are rounded to 1/65536, an error of at most 7.6e-6 (e.g. 0.05 becomes 3277/65536).
+* - Each filter update rounds to 1/65536 of a count, so after n updates the rounding error is below
+*   min(n, 1/alpha)/131072 counts; 2.0e-4 counts for alpha = 0.05.
+* - The coefficient error only shows while a filter settles after a step of size S and is below
+*   S*7.6e-6/(alpha*e) counts; 0.9 counts for a full-scale (16384) step at alpha = 0.05, 0 in steady state.
+* - Filter outputs are truncated toward zero to int like the float kernels. A state error below one count
+*   moves a truncated output by at most one count, so filterLowPassPixelsQ16 outputs differ from the float
+*   path by at most 1 count and subtractBackgroundQ16 outputs (two truncated terms) by at most 2 counts.
+* - Window filter and gain stage results are exact when their coefficients are multiples of 1/65536
+*   (0.5, 0.75 and 1.0 by default) and otherwise differ by at most 1 count.
+* The resulting maxpixel differs by the same number of counts as the pixels, and the center of mass x/y
+* by at most 2*(xres-1)*num_pixels/totalmass pixels, typically well below 0.01 pixels for a detected hand.
+*/
+typedef int32_t q16_t;
+#define Q16_SHIFT 16
+#define Q16_ONE (1 << Q16_SHIFT)
+
+q16_t floatToQ16(const float value);
+void filterLowPassPixelsQ16(int pixels[], q16_t filtpixels[], const unsigned int num_pixels, const q16_t alpha);
+void subtractBackgroundQ16(int pixels[], q16_t short_avg_pixels[], q16_t long_avg_pixels[], const unsigned int num_pixels, const q16_t alpha_short_avg, const q16_t alpha_long_avg);
+
+// Converts a Q16 value to int, truncating toward zero like a float to int conversion
+static inline int q16ToInt(const q16_t value)
+{
+  return value >= 0 ? (int)(value >> Q16_SHIFT) : -(int)(-value >> Q16_SHIFT);
+}
+
+// Exponential smoothing step in Q16: state + alpha*(pixel - state), rounded to nearest
+static inline q16_t updateAverageQ16(const q16_t state, const int pixel, const q16_t alpha)
+{
+  int64_t delta = (int64_t)pixel * Q16_ONE - state;
+  return state + (q16_t)((delta * alpha + (Q16_ONE >> 1)) >> Q16_SHIFT);
+}
+
+/*
+* Fused kernels. Each one gives the same results as the sequence of kernels it replaces, in a single pass
+* over the pixels instead of one per kernel.
+*/
+// subtractBackground, then getMaxPixelValue of the result. Returns the max pixel
+int subtractBackgroundMax(int pixels[], float short_avg_pixels[], float long_avg_pixels[], const unsigned int num_pixels, const float alpha_short_avg, const float alpha_long_avg);
+int subtractBackgroundMaxQ16(int pixels[], q16_t short_avg_pixels[], q16_t long_avg_pixels[], const unsigned int num_pixels, const q16_t alpha_short_avg, const q16_t alpha_long_avg);
+
+// zeroPixelsBelowThreshold, then calcCenterOfMass of the result. Returns the number of pixels above the threshold.
+// Zeroing below one threshold and then below another is the same as zeroing below the larger of the two
+unsigned int clampCenterOfMass(int pixels[], const unsigned int xres, const unsigned int yres, const int threshold, float *cmx, float *cmy, int *totalmass);
+unsigned int clampCenterOfMassRect(int pixels[], const unsigned int xres, const PixelRect *rect, const int threshold, float *cmx, float *cmy, int *totalmass);
+
+// Single pixel steps of subtractBackground and subtractBackgroundQ16, to fuse them with other per pixel stages
+static inline int subtractBackgroundPixel(const int pixel, float *short_avg, float *long_avg, const float alpha_short_avg, const float alpha_long_avg)
+{
+  *long_avg = (1.0f - alpha_long_avg) * *long_avg + alpha_long_avg * pixel;
+  *short_avg = (1.0f - alpha_short_avg) * *short_avg + alpha_short_avg * pixel;
+  return *short_avg - (int)*long_avg;
+}
+
+static inline int subtractBackgroundPixelQ16(const int pixel, q16_t *short_avg, q16_t *long_avg, const q16_t alpha_short_avg, const q16_t alpha_long_avg)
+{
+  *long_avg = updateAverageQ16(*long_avg, pixel, alpha_long_avg);
+  *short_avg = updateAverageQ16(*short_avg, pixel, alpha_short_avg);
+  return q16ToInt(*short_avg - q16ToInt(*long_avg) * Q16_ONE);
+}
+
+/*
+* Kernel dispatch.
+* On x86 hosts the frame kernels above are selected at run time among scalar, SSE2 and AVX2 implementations
+* (img_utils_simd.c), picking the best one the CPU supports. All implementations give results identical to
+* the scalar code. On other targets, including the Cortex-M firmware, the scalar code is called directly:
+* the pixel buffers are 32-bit, so the packed 16-bit DSP instructions would need repacking on every access.
+*/
+#if !defined(IMG_UTILS_DISPATCH)
+  #if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+    #define IMG_UTILS_DISPATCH 1
+  #else
+    #define IMG_UTILS_DISPATCH 0
+  #endif
+#endif
+
+typedef struct {
+  const char *name;
+  int (*getMaxPixelValue)(const int pixels[], const unsigned int num_pixels);
+  int (*getMinPixelValue)(const int pixels[], const unsigned int num_pixels);
+  unsigned int (*zeroPixelsBelowThreshold)(int pixels[], const unsigned int num_pixels, const int threshold);
+  void (*filterLowPassPixels)(int pixels[], float filtpixels[], const unsigned int num_pixels, const float alpha);
+  int (*subtractBackgroundMax)(int pixels[], float short_avg_pixels[], float long_avg_pixels[], const unsigned int num_pixels, const float alpha_short_avg, const float alpha_long_avg);
+  void (*calcCenterOfMass)(const int pixels[], const unsigned int xres, const unsigned int yres, float *cmx, float *cmy, int *totalmass);
+  unsigned int (*clampCenterOfMass)(int pixels[], const unsigned int xres, const unsigned int yres, const int threshold, float *cmx, float *cmy, int *totalmass);
+  void (*interpnTable)(const int pixels[], int interp_pixels[], const InterpTable *table);
+} ImgUtilsKernels;
+
+extern const ImgUtilsKernels imgUtilsKernelsScalar;
+#if IMG_UTILS_DISPATCH
+extern const ImgUtilsKernels imgUtilsKernelsSse2;
+extern const ImgUtilsKernels imgUtilsKernelsAvx2;
+int imgUtilsKernelsSupported(const ImgUtilsKernels *kernels);
+#endif
+
+// Returns the kernel set in use
+const ImgUtilsKernels * getImgUtilsKernels();
+
+// Selects a kernel set by name ("scalar", "sse2" or "avx2"), or the best supported one if name is NULL.
+// Returns -1 if the kernel set is not available on this CPU
+int selectImgUtilsKernels(const char *name);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
 #endif
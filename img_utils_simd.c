@@ -0,0 +1,564 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+/*
+* SSE2 and AVX2 versions of the img_utils kernels for x86 hosts, selected at run time (see img_utils.h).
+* They give the same results as the scalar kernels in img_utils.c: float kernels do the same multiplies
+* and adds per pixel without fusing them and convert with truncation, and integer sums are formed
+* modulo 2^32 like the scalar int arithmetic, just in a different order. Array tails use scalar code.
+*/
+
+#include "img_utils.h"
+
+#if IMG_UTILS_DISPATCH
+
+#include <immintrin.h>
+
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+int imgUtilsKernelsSupported(const ImgUtilsKernels *kernels)
+{
+  __builtin_cpu_init();
+  if (kernels == &imgUtilsKernelsAvx2) {
+    return __builtin_cpu_supports("avx2");
+  }
+  if (kernels == &imgUtilsKernelsSse2) {
+    return __builtin_cpu_supports("sse2");
+  }
+  return kernels == &imgUtilsKernelsScalar;
+}
+
+// Center of mass from column and row sums: sum of x*p over all pixels equals sum of x*colsum[x]
+static void centerOfMassFromSums(const unsigned int colsum[], const unsigned int rowsum[], const unsigned int xres, const unsigned int yres, float *cmx, float *cmy, int *totalmass)
+{
+  unsigned int cmx_numer = 0, cmy_numer = 0, mass = (unsigned int)*totalmass;
+  for (unsigned int x = 0; x < xres; x++) {
+    cmx_numer += x * colsum[x];
+  }
+  for (unsigned int y = 0; y < yres; y++) {
+    cmy_numer += y * rowsum[y];
+    mass += rowsum[y];
+  }
+  *totalmass = (int)mass;
+  if (*totalmass == 0) {
+    *totalmass = 1; // avoid NaN
+  }
+  *cmx = (float)(int)cmx_numer/(float)(*totalmass);
+  *cmy = (float)(int)cmy_numer/(float)(*totalmass);
+}
+
+// x-direction pass of interpnTable. It gathers from the source rows, so it stays scalar
+static void interpnTableRows(const int pixels[], int interp_pixels[], const InterpTable *table)
+{
+  const unsigned int shift = table->shift, row_stride = table->w2 << shift;
+  for (unsigned int i = 0; i < table->h; i++) {
+    const int *src = &pixels[i * table->w];
+    int *dst = &interp_pixels[i * row_stride];
+    for (unsigned int j = 0; j < table->w2; j++) {
+      const int *a = &src[table->x_src[j]];
+      if (table->x_wb[j] == 0)
+        dst[j] = a[0];
+      else
+        dst[j] = divPow2Trunc(a[0] * table->x_wa[j] + a[1] * table->x_wb[j], shift);
+    }
+  }
+}
+
+// -----------------------------------------
+// SSE2
+// -----------------------------------------
+
+TARGET_SSE2 static inline __m128i blendSse2(const __m128i mask, const __m128i a, const __m128i b)
+{
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+TARGET_SSE2 static inline int sumLanesSse2(const __m128i v)
+{
+  __m128i sum = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(sum);
+}
+
+TARGET_SSE2 static inline __m128i divPow2TruncSse2(const __m128i v, const __m128i shift, const __m128i mask)
+{
+  return _mm_sra_epi32(_mm_add_epi32(v, _mm_and_si128(_mm_srai_epi32(v, 31), mask)), shift);
+}
+
+TARGET_SSE2 static int getMaxPixelValueSse2(const int pixels[], const unsigned int num_pixels)
+{
+  __m128i vmax = _mm_set1_epi32(-99999);
+  unsigned int i = 0;
+  for (; i + 4 <= num_pixels; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i *)&pixels[i]);
+    vmax = blendSse2(_mm_cmpgt_epi32(v, vmax), v, vmax);
+  }
+  int lanes[4];
+  _mm_storeu_si128((__m128i *)lanes, vmax);
+  int maxpixel = lanes[0];
+  for (unsigned int k = 1; k < 4; k++) {
+    maxpixel = lanes[k] > maxpixel ? lanes[k] : maxpixel;
+  }
+  for (; i < num_pixels; i++) {
+    maxpixel = pixels[i] > maxpixel ? pixels[i] : maxpixel;
+  }
+  return maxpixel;
+}
+
+TARGET_SSE2 static int getMinPixelValueSse2(const int pixels[], const unsigned int num_pixels)
+{
+  __m128i vmin = _mm_set1_epi32(99999);
+  unsigned int i = 0;
+  for (; i + 4 <= num_pixels; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i *)&pixels[i]);
+    vmin = blendSse2(_mm_cmplt_epi32(v, vmin), v, vmin);
+  }
+  int lanes[4];
+  _mm_storeu_si128((__m128i *)lanes, vmin);
+  int minpixel = lanes[0];
+  for (unsigned int k = 1; k < 4; k++) {
+    minpixel = lanes[k] < minpixel ? lanes[k] : minpixel;
+  }
+  for (; i < num_pixels; i++) {
+    minpixel = pixels[i] < minpixel ? pixels[i] : minpixel;
+  }
+  return minpixel;
+}
+
+TARGET_SSE2 static unsigned int zeroPixelsBelowThresholdSse2(int pixels[], const unsigned int num_pixels, const int threshold)
+{
+  const __m128i vthreshold = _mm_set1_epi32(threshold);
+  __m128i below = _mm_setzero_si128(); // -1 per lane for every pixel zeroed
+  unsigned int i = 0;
+  for (; i + 4 <= num_pixels; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i *)&pixels[i]);
+    __m128i mask = _mm_cmplt_epi32(v, vthreshold);
+    _mm_storeu_si128((__m128i *)&pixels[i], _mm_andnot_si128(mask, v));
+    below = _mm_add_epi32(below, mask);
+  }
+  int pixelsAboveThresholdCount = num_pixels + sumLanesSse2(below);
+  for (; i < num_pixels; i++) {
+    if (pixels[i] < threshold) {
+      pixels[i] = 0;
+      pixelsAboveThresholdCount--;
+    }
+  }
+  return pixelsAboveThresholdCount;
+}
+
+TARGET_SSE2 static void filterLowPassPixelsSse2(int pixels[], float filtpixels[], const unsigned int num_pixels, const float alpha)
+{
+  const __m128 va = _mm_set1_ps(alpha), vb = _mm_set1_ps(1.0f - alpha);
+  unsigned int i = 0;
+  for (; i + 4 <= num_pixels; i += 4) {
+    __m128 p = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)&pixels[i]));
+    __m128 f = _mm_add_ps(_mm_mul_ps(vb, _mm_loadu_ps(&filtpixels[i])), _mm_mul_ps(va, p));
+    _mm_storeu_ps(&filtpixels[i], f);
+    _mm_storeu_si128((__m128i *)&pixels[i], _mm_cvttps_epi32(f));
+  }
+  for (; i < num_pixels; i++) {
+    filtpixels[i] = (1.0f - alpha) * filtpixels[i] + alpha * pixels[i];
+    pixels[i] = (int)filtpixels[i];
+  }
+}
+
+TARGET_SSE2 static int subtractBackgroundMaxSse2(int pixels[], float short_avg_pixels[], float long_avg_pixels[], const unsigned int num_pixels, const float alpha_short_avg, const float alpha_long_avg)
+{
+  const __m128 vla = _mm_set1_ps(alpha_long_avg), vlb = _mm_set1_ps(1.0f - alpha_long_avg);
+  const __m128 vsa = _mm_set1_ps(alpha_short_avg), vsb = _mm_set1_ps(1.0f - alpha_short_avg);
+  __m128i vmax = _mm_set1_epi32(-99999);
+  unsigned int i = 0;
+  for (; i + 4 <= num_pixels; i += 4) {
+    __m128 p = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)&pixels[i]));
+    __m128 l = _mm_add_ps(_mm_mul_ps(vlb, _mm_loadu_ps(&long_avg_pixels[i])), _mm_mul_ps(vla, p));
+    __m128 s = _mm_add_ps(_mm_mul_ps(vsb, _mm_loadu_ps(&short_avg_pixels[i])), _mm_mul_ps(vsa, p));
+    _mm_storeu_ps(&long_avg_pixels[i], l);
+    _mm_storeu_ps(&short_avg_pixels[i], s);
+    __m128 d = _mm_sub_ps(s, _mm_cvtepi32_ps(_mm_cvttps_epi32(l)));
+    __m128i v = _mm_cvttps_epi32(d);
+    _mm_storeu_si128((__m128i *)&pixels[i], v);
+    vmax = blendSse2(_mm_cmpgt_epi32(v, vmax), v, vmax);
+  }
+  int lanes[4];
+  _mm_storeu_si128((__m128i *)lanes, vmax);
+  int maxpixel = lanes[0];
+  for (unsigned int k = 1; k < 4; k++) {
+    maxpixel = lanes[k] > maxpixel ? lanes[k] : maxpixel;
+  }
+  for (; i < num_pixels; i++) {
+    long_avg_pixels[i] = (1.0f - alpha_long_avg) * long_avg_pixels[i] + alpha_long_avg * pixels[i];
+    short_avg_pixels[i] = (1.0f - alpha_short_avg) * short_avg_pixels[i] + alpha_short_avg * pixels[i];
+    pixels[i] = short_avg_pixels[i] - (int)long_avg_pixels[i];
+    maxpixel = pixels[i] > maxpixel ? pixels[i] : maxpixel;
+  }
+  return maxpixel;
+}
+
+TARGET_SSE2 static void calcCenterOfMassSse2(const int pixels[], const unsigned int xres, const unsigned int yres, float *cmx, float *cmy, int *totalmass)
+{
+  unsigned int colsum[MAX_INTERP_TABLE_LENGTH] = {0}, rowsum[MAX_INTERP_TABLE_LENGTH];
+  if (xres > MAX_INTERP_TABLE_LENGTH || yres > MAX_INTERP_TABLE_LENGTH) {
+    imgUtilsKernelsScalar.calcCenterOfMass(pixels, xres, yres, cmx, cmy, totalmass);
+    return;
+  }
+  for (unsigned int y = 0; y < yres; y++) {
+    const int *row = &pixels[y * xres];
+    __m128i vrow = _mm_setzero_si128();
+    unsigned int x = 0;
+    for (; x + 4 <= xres; x += 4) {
+      __m128i v = _mm_loadu_si128((const __m128i *)&row[x]);
+      _mm_storeu_si128((__m128i *)&colsum[x], _mm_add_epi32(_mm_loadu_si128((const __m128i *)&colsum[x]), v));
+      vrow = _mm_add_epi32(vrow, v);
+    }
+    rowsum[y] = (unsigned int)sumLanesSse2(vrow);
+    for (; x < xres; x++) {
+      colsum[x] += row[x];
+      rowsum[y] += row[x];
+    }
+  }
+  centerOfMassFromSums(colsum, rowsum, xres, yres, cmx, cmy, totalmass);
+}
+
+TARGET_SSE2 static unsigned int clampCenterOfMassSse2(int pixels[], const unsigned int xres, const unsigned int yres, const int threshold, float *cmx, float *cmy, int *totalmass)
+{
+  unsigned int colsum[MAX_INTERP_TABLE_LENGTH] = {0}, rowsum[MAX_INTERP_TABLE_LENGTH];
+  if (xres > MAX_INTERP_TABLE_LENGTH || yres > MAX_INTERP_TABLE_LENGTH) {
+    return imgUtilsKernelsScalar.clampCenterOfMass(pixels, xres, yres, threshold, cmx, cmy, totalmass);
+  }
+  const __m128i vthreshold = _mm_set1_epi32(threshold);
+  __m128i below = _mm_setzero_si128(); // -1 per lane for every pixel zeroed
+  unsigned int pixelsBelowThresholdCount = 0;
+  for (unsigned int y = 0; y < yres; y++) {
+    int *row = &pixels[y * xres];
+    __m128i vrow = _mm_setzero_si128();
+    unsigned int x = 0;
+    for (; x + 4 <= xres; x += 4) {
+      __m128i v = _mm_loadu_si128((const __m128i *)&row[x]);
+      __m128i mask = _mm_cmplt_epi32(v, vthreshold);
+      v = _mm_andnot_si128(mask, v);
+      _mm_storeu_si128((__m128i *)&row[x], v);
+      _mm_storeu_si128((__m128i *)&colsum[x], _mm_add_epi32(_mm_loadu_si128((const __m128i *)&colsum[x]), v));
+      vrow = _mm_add_epi32(vrow, v);
+      below = _mm_add_epi32(below, mask);
+    }
+    rowsum[y] = (unsigned int)sumLanesSse2(vrow);
+    for (; x < xres; x++) {
+      if (row[x] < threshold) {
+        row[x] = 0;
+        pixelsBelowThresholdCount++;
+      }
+      colsum[x] += row[x];
+      rowsum[y] += row[x];
+    }
+  }
+  centerOfMassFromSums(colsum, rowsum, xres, yres, cmx, cmy, totalmass);
+  return xres * yres - pixelsBelowThresholdCount + sumLanesSse2(below);
+}
+
+TARGET_SSE2 static void interpnTableSse2(const int pixels[], int interp_pixels[], const InterpTable *table)
+{
+  const unsigned int w2 = table->w2, shift = table->shift, row_stride = w2 << shift;
+  const __m128i vshift = _mm_cvtsi32_si128(shift), vmask = _mm_set1_epi32((1 << shift) - 1);
+
+  interpnTableRows(pixels, interp_pixels, table);
+
+  // SSE2 has no 32-bit multiply: a*wa + c*wb is formed as (a << shift) + (c - a)*wb, the latter from
+  // the set bits of wb (at most three for factors up to 8). Both are equal modulo 2^32
+  for (unsigned int i = 0; i < table->h2; i++) {
+    const unsigned int wb = table->y_wb[i];
+    if (wb == 0) {
+      continue;
+    }
+    const int *a = &interp_pixels[table->y_src[i] * row_stride];
+    const int *c = a + row_stride;
+    int *dst = &interp_pixels[i * w2];
+    unsigned int j = 0;
+    for (; j + 4 <= w2; j += 4) {
+      __m128i va = _mm_loadu_si128((const __m128i *)&a[j]);
+      __m128i vd = _mm_sub_epi32(_mm_loadu_si128((const __m128i *)&c[j]), va);
+      __m128i v = _mm_sll_epi32(va, vshift);
+      for (unsigned int bit = 0; (wb >> bit) != 0; bit++) {
+        if ((wb >> bit) & 1) {
+          v = _mm_add_epi32(v, _mm_sll_epi32(vd, _mm_cvtsi32_si128(bit)));
+        }
+      }
+      _mm_storeu_si128((__m128i *)&dst[j], divPow2TruncSse2(v, vshift, vmask));
+    }
+    for (; j < w2; j++) {
+      dst[j] = divPow2Trunc(a[j] * table->y_wa[i] + c[j] * table->y_wb[i], shift);
+    }
+  }
+}
+
+const ImgUtilsKernels imgUtilsKernelsSse2 = {
+  "sse2",
+  getMaxPixelValueSse2,
+  getMinPixelValueSse2,
+  zeroPixelsBelowThresholdSse2,
+  filterLowPassPixelsSse2,
+  subtractBackgroundMaxSse2,
+  calcCenterOfMassSse2,
+  clampCenterOfMassSse2,
+  interpnTableSse2
+};
+
+// -----------------------------------------
+// AVX2
+// -----------------------------------------
+
+TARGET_AVX2 static inline int sumLanesAvx2(const __m256i v)
+{
+  __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(sum);
+}
+
+TARGET_AVX2 static int getMaxPixelValueAvx2(const int pixels[], const unsigned int num_pixels)
+{
+  __m256i vmax = _mm256_set1_epi32(-99999);
+  unsigned int i = 0;
+  for (; i + 8 <= num_pixels; i += 8) {
+    vmax = _mm256_max_epi32(vmax, _mm256_loadu_si256((const __m256i *)&pixels[i]));
+  }
+  int lanes[8];
+  _mm256_storeu_si256((__m256i *)lanes, vmax);
+  int maxpixel = lanes[0];
+  for (unsigned int k = 1; k < 8; k++) {
+    maxpixel = lanes[k] > maxpixel ? lanes[k] : maxpixel;
+  }
+  for (; i < num_pixels; i++) {
+    maxpixel = pixels[i] > maxpixel ? pixels[i] : maxpixel;
+  }
+  return maxpixel;
+}
+
+TARGET_AVX2 static int getMinPixelValueAvx2(const int pixels[], const unsigned int num_pixels)
+{
+  __m256i vmin = _mm256_set1_epi32(99999);
+  unsigned int i = 0;
+  for (; i + 8 <= num_pixels; i += 8) {
+    vmin = _mm256_min_epi32(vmin, _mm256_loadu_si256((const __m256i *)&pixels[i]));
+  }
+  int lanes[8];
+  _mm256_storeu_si256((__m256i *)lanes, vmin);
+  int minpixel = lanes[0];
+  for (unsigned int k = 1; k < 8; k++) {
+    minpixel = lanes[k] < minpixel ? lanes[k] : minpixel;
+  }
+  for (; i < num_pixels; i++) {
+    minpixel = pixels[i] < minpixel ? pixels[i] : minpixel;
+  }
+  return minpixel;
+}
+
+TARGET_AVX2 static unsigned int zeroPixelsBelowThresholdAvx2(int pixels[], const unsigned int num_pixels, const int threshold)
+{
+  const __m256i vthreshold = _mm256_set1_epi32(threshold);
+  __m256i below = _mm256_setzero_si256(); // -1 per lane for every pixel zeroed
+  unsigned int i = 0;
+  for (; i + 8 <= num_pixels; i += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)&pixels[i]);
+    __m256i mask = _mm256_cmpgt_epi32(vthreshold, v);
+    _mm256_storeu_si256((__m256i *)&pixels[i], _mm256_andnot_si256(mask, v));
+    below = _mm256_add_epi32(below, mask);
+  }
+  int pixelsAboveThresholdCount = num_pixels + sumLanesAvx2(below);
+  for (; i < num_pixels; i++) {
+    if (pixels[i] < threshold) {
+      pixels[i] = 0;
+      pixelsAboveThresholdCount--;
+    }
+  }
+  return pixelsAboveThresholdCount;
+}
+
+TARGET_AVX2 static void filterLowPassPixelsAvx2(int pixels[], float filtpixels[], const unsigned int num_pixels, const float alpha)
+{
+  const __m256 va = _mm256_set1_ps(alpha), vb = _mm256_set1_ps(1.0f - alpha);
+  unsigned int i = 0;
+  for (; i + 8 <= num_pixels; i += 8) {
+    __m256 p = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i *)&pixels[i]));
+    __m256 f = _mm256_add_ps(_mm256_mul_ps(vb, _mm256_loadu_ps(&filtpixels[i])), _mm256_mul_ps(va, p));
+    _mm256_storeu_ps(&filtpixels[i], f);
+    _mm256_storeu_si256((__m256i *)&pixels[i], _mm256_cvttps_epi32(f));
+  }
+  for (; i < num_pixels; i++) {
+    filtpixels[i] = (1.0f - alpha) * filtpixels[i] + alpha * pixels[i];
+    pixels[i] = (int)filtpixels[i];
+  }
+}
+
+TARGET_AVX2 static int subtractBackgroundMaxAvx2(int pixels[], float short_avg_pixels[], float long_avg_pixels[], const unsigned int num_pixels, const float alpha_short_avg, const float alpha_long_avg)
+{
+  const __m256 vla = _mm256_set1_ps(alpha_long_avg), vlb = _mm256_set1_ps(1.0f - alpha_long_avg);
+  const __m256 vsa = _mm256_set1_ps(alpha_short_avg), vsb = _mm256_set1_ps(1.0f - alpha_short_avg);
+  __m256i vmax = _mm256_set1_epi32(-99999);
+  unsigned int i = 0;
+  for (; i + 8 <= num_pixels; i += 8) {
+    __m256 p = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i *)&pixels[i]));
+    __m256 l = _mm256_add_ps(_mm256_mul_ps(vlb, _mm256_loadu_ps(&long_avg_pixels[i])), _mm256_mul_ps(vla, p));
+    __m256 s = _mm256_add_ps(_mm256_mul_ps(vsb, _mm256_loadu_ps(&short_avg_pixels[i])), _mm256_mul_ps(vsa, p));
+    _mm256_storeu_ps(&long_avg_pixels[i], l);
+    _mm256_storeu_ps(&short_avg_pixels[i], s);
+    __m256 d = _mm256_sub_ps(s, _mm256_cvtepi32_ps(_mm256_cvttps_epi32(l)));
+    __m256i v = _mm256_cvttps_epi32(d);
+    _mm256_storeu_si256((__m256i *)&pixels[i], v);
+    vmax = _mm256_max_epi32(vmax, v);
+  }
+  int lanes[8];
+  _mm256_storeu_si256((__m256i *)lanes, vmax);
+  int maxpixel = lanes[0];
+  for (unsigned int k = 1; k < 8; k++) {
+    maxpixel = lanes[k] > maxpixel ? lanes[k] : maxpixel;
+  }
+  for (; i < num_pixels; i++) {
+    long_avg_pixels[i] = (1.0f - alpha_long_avg) * long_avg_pixels[i] + alpha_long_avg * pixels[i];
+    short_avg_pixels[i] = (1.0f - alpha_short_avg) * short_avg_pixels[i] + alpha_short_avg * pixels[i];
+    pixels[i] = short_avg_pixels[i] - (int)long_avg_pixels[i];
+    maxpixel = pixels[i] > maxpixel ? pixels[i] : maxpixel;
+  }
+  return maxpixel;
+}
+
+TARGET_AVX2 static void calcCenterOfMassAvx2(const int pixels[], const unsigned int xres, const unsigned int yres, float *cmx, float *cmy, int *totalmass)
+{
+  unsigned int colsum[MAX_INTERP_TABLE_LENGTH] = {0}, rowsum[MAX_INTERP_TABLE_LENGTH];
+  if (xres > MAX_INTERP_TABLE_LENGTH || yres > MAX_INTERP_TABLE_LENGTH) {
+    imgUtilsKernelsScalar.calcCenterOfMass(pixels, xres, yres, cmx, cmy, totalmass);
+    return;
+  }
+  for (unsigned int y = 0; y < yres; y++) {
+    const int *row = &pixels[y * xres];
+    __m256i vrow = _mm256_setzero_si256();
+    unsigned int x = 0;
+    for (; x + 8 <= xres; x += 8) {
+      __m256i v = _mm256_loadu_si256((const __m256i *)&row[x]);
+      _mm256_storeu_si256((__m256i *)&colsum[x], _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)&colsum[x]), v));
+      vrow = _mm256_add_epi32(vrow, v);
+    }
+    rowsum[y] = (unsigned int)sumLanesAvx2(vrow);
+    for (; x < xres; x++) {
+      colsum[x] += row[x];
+      rowsum[y] += row[x];
+    }
+  }
+  centerOfMassFromSums(colsum, rowsum, xres, yres, cmx, cmy, totalmass);
+}
+
+TARGET_AVX2 static unsigned int clampCenterOfMassAvx2(int pixels[], const unsigned int xres, const unsigned int yres, const int threshold, float *cmx, float *cmy, int *totalmass)
+{
+  unsigned int colsum[MAX_INTERP_TABLE_LENGTH] = {0}, rowsum[MAX_INTERP_TABLE_LENGTH];
+  if (xres > MAX_INTERP_TABLE_LENGTH || yres > MAX_INTERP_TABLE_LENGTH) {
+    return imgUtilsKernelsScalar.clampCenterOfMass(pixels, xres, yres, threshold, cmx, cmy, totalmass);
+  }
+  const __m256i vthreshold = _mm256_set1_epi32(threshold);
+  __m256i below = _mm256_setzero_si256(); // -1 per lane for every pixel zeroed
+  unsigned int pixelsBelowThresholdCount = 0;
+  for (unsigned int y = 0; y < yres; y++) {
+    int *row = &pixels[y * xres];
+    __m256i vrow = _mm256_setzero_si256();
+    unsigned int x = 0;
+    for (; x + 8 <= xres; x += 8) {
+      __m256i v = _mm256_loadu_si256((const __m256i *)&row[x]);
+      __m256i mask = _mm256_cmpgt_epi32(vthreshold, v);
+      v = _mm256_andnot_si256(mask, v);
+      _mm256_storeu_si256((__m256i *)&row[x], v);
+      _mm256_storeu_si256((__m256i *)&colsum[x], _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)&colsum[x]), v));
+      vrow = _mm256_add_epi32(vrow, v);
+      below = _mm256_add_epi32(below, mask);
+    }
+    rowsum[y] = (unsigned int)sumLanesAvx2(vrow);
+    for (; x < xres; x++) {
+      if (row[x] < threshold) {
+        row[x] = 0;
+        pixelsBelowThresholdCount++;
+      }
+      colsum[x] += row[x];
+      rowsum[y] += row[x];
+    }
+  }
+  centerOfMassFromSums(colsum, rowsum, xres, yres, cmx, cmy, totalmass);
+  return xres * yres - pixelsBelowThresholdCount + sumLanesAvx2(below);
+}
+
+TARGET_AVX2 static void interpnTableAvx2(const int pixels[], int interp_pixels[], const InterpTable *table)
+{
+  const unsigned int w2 = table->w2, shift = table->shift, row_stride = w2 << shift;
+  const __m128i vshift = _mm_cvtsi32_si128(shift);
+  const __m256i vmask = _mm256_set1_epi32((1 << shift) - 1);
+
+  interpnTableRows(pixels, interp_pixels, table);
+
+  for (unsigned int i = 0; i < table->h2; i++) {
+    if (table->y_wb[i] == 0) {
+      continue;
+    }
+    const int *a = &interp_pixels[table->y_src[i] * row_stride];
+    const int *c = a + row_stride;
+    int *dst = &interp_pixels[i * w2];
+    const __m256i wa = _mm256_set1_epi32(table->y_wa[i]), wb = _mm256_set1_epi32(table->y_wb[i]);
+    unsigned int j = 0;
+    for (; j + 8 <= w2; j += 8) {
+      __m256i v = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_loadu_si256((const __m256i *)&a[j]), wa),
+                                   _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i *)&c[j]), wb));
+      v = _mm256_sra_epi32(_mm256_add_epi32(v, _mm256_and_si256(_mm256_srai_epi32(v, 31), vmask)), vshift);
+      _mm256_storeu_si256((__m256i *)&dst[j], v);
+    }
+    for (; j < w2; j++) {
+      dst[j] = divPow2Trunc(a[j] * table->y_wa[i] + c[j] * table->y_wb[i], shift);
+    }
+  }
+}
+
+const ImgUtilsKernels imgUtilsKernelsAvx2 = {
+  "avx2",
+  getMaxPixelValueAvx2,
+  getMinPixelValueAvx2,
+  zeroPixelsBelowThresholdAvx2,
+  filterLowPassPixelsAvx2,
+  subtractBackgroundMaxAvx2,
+  calcCenterOfMassAvx2,
+  clampCenterOfMassAvx2,
+  interpnTableAvx2
+};
+
+#else
+
+// Only the scalar kernels in img_utils.c exist on this target
+typedef int img_utils_simd_unused;
+
+#endif
@@ -37,6 +37,7 @@
 #include "USBSerial.h"
 #include "controller.h"
 #include "config.h"
+#include "profiler.h"
 
 // Serial port for full interface with streaming data. Select USB or UART with USE_UART_INTERFACE constant.
 // Files that use these objects should declare them as externs.
@@ -49,29 +50,81 @@ USBSerial *serial = new USBSerial(0x0b6a, 0x4360, 0x0001, false);
 // UART over daplink, 9600 baud. This can be used for debugging
 //Serial daplink(P2_1, P2_0);
 
-// USBSerial putc and printf are slow. Use writeBlock to stream data over USB
-void sendDataStream(uint8_t *str, const unsigned int num_chars)
+// Queue of data stream frames waiting for the serial port
+TxQueue txQueue;
+
+#if !USE_UART_INTERFACE
+// A packet handed to the bulk IN endpoint by writeSerial has not been reported complete yet. endpointWriteResult
+// reports the completion of the last write once and then clears it, so it is only asked while this is set
+static bool usbWriteOutstanding = false;
+#endif
+
+// Non-blocking write for the transmit queue
+static unsigned int writeSerial(void *ctx, const uint8_t *data, const unsigned int length)
 {
 #if USE_UART_INTERFACE
 
-  for (int i=0; i<num_chars; i++) {
-    (*serial).putc(str[i]);
+  unsigned int num_written = 0;
+  while (num_written < length && (*serial).writeable()) {
+    (*serial).putc(data[num_written++]);
   }
+  return num_written;
 
-#else // This section needs to be #defined because writeBlock does not exist for UART serial object
-  uint8_t *output_ptr = (uint8_t *)str; // writeBlock requires pointer to uint8_t
-  unsigned int bytes_remaining = num_chars;
-
-  while (bytes_remaining > 0) {
-    if (bytes_remaining < USB_BLOCK_SIZE) {
-      (*serial).writeBlock(output_ptr, bytes_remaining);
-      bytes_remaining = 0;
-    }
-    else {
-      (*serial).writeBlock(output_ptr, USB_BLOCK_SIZE);
-      bytes_remaining -= USB_BLOCK_SIZE;
-      output_ptr += USB_BLOCK_SIZE;
+#else // This section needs to be #defined because the USB endpoint functions do not exist for UART serial object
+  // USBSerial putc, printf and writeBlock wait until the host has read the packet. Hand the block (one packet,
+  // the queue hands out one block at a time) to the bulk IN endpoint only once its previous packet was taken,
+  // so a host that stops reading does not stall the main loop
+  if (!(*serial).configured()) {
+    usbWriteOutstanding = false;
+    return 0;
+  }
+  if (usbWriteOutstanding) {
+    if ((*serial).endpointWriteResult(EPBULK_IN) == EP_PENDING) {
+      return 0;
     }
+    usbWriteOutstanding = false;
   }
+  const EP_STATUS status = (*serial).endpointWrite(EPBULK_IN, (uint8_t *)data, length);
+  usbWriteOutstanding = status == EP_PENDING;
+  return status == EP_PENDING || status == EP_COMPLETED ? length : 0;
 #endif
 }
+
+void initDataStream()
+{
+  initTxQueue(&txQueue, writeSerial, NULL, TX_DROP_OLDEST);
+  setTxQueueBlockTimeout(&txQueue, us_ticker_read, DATA_STREAM_FLUSH_TIMEOUT_US);
+}
+
+void sendDataStream(uint8_t *str, const unsigned int num_chars)
+{
+  PROFILE_BEGIN(send_start);
+  txQueuePush(&txQueue, str, num_chars);
+  PROFILE_END(PROFILE_SEND_STREAM, send_start);
+}
+
+void sendCmdResponse(uint8_t *str, const unsigned int num_chars)
+{
+  txQueuePushWithPolicy(&txQueue, str, num_chars, TX_BLOCK);
+  flushDataStream(); // so the next stream frames cannot push it out of the queue
+}
+
+void pumpDataStream()
+{
+  PROFILE_BEGIN(pump_start);
+  txQueuePump(&txQueue, us_ticker_read());
+  PROFILE_END(PROFILE_PUMP_STREAM, pump_start);
+}
+
+void serialOutputWritten()
+{
+#if !USE_UART_INTERFACE
+  // The blocking write returned once the host read its packet, so the packets before it were read as well
+  usbWriteOutstanding = false;
+#endif
+}
+
+unsigned int flushDataStream()
+{
+  return txQueueFlush(&txQueue, us_ticker_read, DATA_STREAM_FLUSH_TIMEOUT_US);
+}
@@ -38,6 +38,7 @@
 
 #include "mbed.h"
 #include "gesture_lib.h"
+#include "tx_queue.h"
 
 // Option to implement serial API over UART instead of USB
 #define USE_UART_INTERFACE 0
@@ -46,9 +47,22 @@
 // Bytes prefixed to pixel data to create data frame
 const int NUM_INFO_BYTES = 40;
 
-const unsigned int USB_BLOCK_SIZE = 64;
-
-// Data streaming over USB or UART, depending on which is enabled
+// Data streaming over USB or UART, depending on which is enabled. sendDataStream queues the data and returns
+// right away; pumpDataStream transmits queued data without blocking and must be called from the main loop.
+// flushDataStream blocks until everything queued is sent, but for DATA_STREAM_FLUSH_TIMEOUT_US at most, so a
+// host that stops reading does not stall the main loop. It returns the number of bytes still waiting. Frames
+// queued with TX_BLOCK wait for room for the same time at most
+#define DATA_STREAM_FLUSH_TIMEOUT_US 100000
+extern TxQueue txQueue;
+void initDataStream();
 void sendDataStream(uint8_t *str, const unsigned int num_chars);
+void pumpDataStream();
+unsigned int flushDataStream();
+// Queues a command response in order with the data stream and flushes it. It waits for room instead of being
+// dropped, whatever the policy; only a host that stops reading for the flush timeout can still lose it
+void sendCmdResponse(uint8_t *str, const unsigned int num_chars);
+// Reports output written to the port directly (printf, puts), which blocks until the host has read it. On USB that
+// consumes the completion of the data stream packet before it, which the next non-blocking write waits for
+void serialOutputWritten();
 
 #endif
@@ -38,9 +38,15 @@
 
 #include "config.h"
 #include "gesture_lib.h"
+#include "gesture_config.h"
+#include "gesture_pipeline.h"
 #include "interface.h"
 #include "controller.h"
 #include "cmd.h"
+#include "stream_codec.h"
+#include "profiler.h"
+#include "frame_rate.h"
+#include "capture.h"
 
 #if defined(COMPILE_FOR_MAX32630)
   #include "max32630fthr.h"
@@ -59,6 +65,7 @@ DigitalOut gLED(LED2);
 // Device pins
 DigitalOut csb(P5_5); // sensor 1
 //DigitalOut csb2(P54); // sensor 2
+//static GestureEngine gestEngine2; // sensor 2 runs on its own engine: initGestureEngine(&gestEngine2), runGestureEngine(&gestEngine2, ...)
 DigitalOut sel(P3_2);
 
 InterruptIn intb(P5_3); // sensor 1
@@ -78,17 +85,34 @@ static uint32_t read_sensor_frames_enabled = 0;
 static uint32_t data_stream_enabled = 0;
 
 static uint32_t send_pixel_data_with_stream = 1;
+static uint32_t stream_format = STREAM_FORMAT_V1;
+static StreamEncoder streamEncoder; // State of the version 2 stream format
 
-// Data ready flags
-static uint32_t sensorDataReadyFlag = 0; // Data ready flag, set by the end-of-conversion interrupt
+// Frames are read on the end-of-conversion interrupt into a ring of frame slots, drained by the main loop.
+// The command interface reports its counters (frames command)
+FrameReader frameReader;
+
+// Sensor frame rate, following the activity (rate command)
+FrameRateScheduler frameRate;
+
+// Raw frames around a trigger, for the capture command
+CaptureBuffer frameCapture;
+
+// Result of the last frame processed, read by the capture triggers, the frame rate scheduler and the commands
+GestureResult gesResult;
+// Last swipe, kept until a poll command reads it so a poll slower than the frame rate does not miss it
+GestureEvent latched_gesture = GEST_NONE;
 
 // Declare functions called in main
 static void processFrame(int pixels[]);
+static void scheduleFrameRate(const uint32_t timestamp_us, const uint32_t frame);
 void set_default_register_settings();
 
 int main()
 {
   static int pixels[NUM_SENSOR_PIXELS];
+  initProfiler();
+  initDataStream();
   gLED = LED_OFF;
   rLED = LED_ON;
 
@@ -102,7 +126,8 @@ int main()
     i2c_init();
   #endif
 
-  // Write register settings to device
+  // Write register settings to device, starting at the fast frame rate
+  initFrameRateScheduler(&frameRate, FRAME_RATE_FAST_SDLY, FRAME_RATE_SLOW_SDLY, END_DETECTION_THRESHOLD, FRAME_RATE_IDLE_MS);
   set_default_register_settings();
 
   // Set FTHR board status LEDs
@@ -117,36 +142,65 @@ int main()
   // Then pass this struct to the configGesture function to initialize the gesture library
   configGesture(&gestCfg);
   //configGesture(NULL); // If configGesture is called with NULL, then default parameters will be used.
+  // The firmware pipeline is compiled for one mode and window filter setting, see FirmwarePipeline
+  MBED_ASSERT((gestureStagesMatchConfig<GESTURE_MODE, ENABLE_WINDOW_FILTER>(&gestCfg)));
 
   // Enable reading of sensor frames
+  initCaptureBuffer(&frameCapture, CAPTURE_PRE_FRAMES, CAPTURE_POST_FRAMES, CAPTURE_TRIGGERS, CAPTURE_MAXPIXEL_LIMIT);
+  initFrameReader(&frameReader, startSensorFrameRead, NULL);
   enable_read_sensor_frames();
 
   while (1) {
     // Check if a command was received over the serial interface
     checkUserCmd();
 
-    // If using INTB interrupt, the sensorDataReadyFlag will be set when the end-of-conversion occurs
-    if (sensorDataReadyFlag) {
-        getSensorPixels(pixels, getGestureConfigPtr()->flip_sensor_pixels);
+    // Blocking frame readout requested by the INTB interrupt, unless frames are read asynchronously
+    serviceSensorFrameRead();
+
+    // Process the oldest frame read. Its slot is released as soon as the pixels are converted
+    const FrameSlot *slot = acquireFrameReaderSlot(&frameReader, us_ticker_read());
+    if (slot) {
+        const uint32_t timestamp_us = slot->timestamp_us, frame = slot->frame;
+        captureFrame(&frameCapture, slot->buffer + FRAME_READER_HEADROOM, timestamp_us, frame);
+        frameBytesToPixels(slot->buffer + FRAME_READER_HEADROOM, pixels, getGestureConfigPtr()->flip_sensor_pixels);
+        releaseFrameReaderSlot(&frameReader);
         processFrame(pixels);
-        sensorDataReadyFlag = 0;
+        checkCaptureTriggers(&frameCapture, gesResult.state, gesResult.maxpixel);
+        scheduleFrameRate(timestamp_us, frame);
     }
+
+    // Transmit queued data stream frames, as far as the serial port accepts them without blocking
+    pumpDataStream();
   }
 }
 
+// The gesture algorithm, composed at compile time (gesture_pipeline.h). It runs on the default engine, so the
+// thresholds and filter coefficients of configGesture, and resetGesture, apply to it. The stages are fixed by
+// GESTURE_MODE and ENABLE_WINDOW_FILTER: GestureConfig.gesture_mode and enable_window_filter are ignored here,
+// unlike in runGesture, and the configuration passed to configGesture must match them (checked in main)
+typedef GesturePipeline<GestureStages<GESTURE_MODE, ENABLE_WINDOW_FILTER>::Stages> FirmwarePipeline;
+static FirmwarePipeline gesturePipeline(getDefaultGestureEngine());
+
 /*
 * This function calls the gesture library for a single sensor frame
 * It builds a data stream frame from the gesture results
 * And sends the stream over the serial connection
 */
-GestureResult gesResult;
 void processFrame(int pixels[])
 {
-  runGesture(pixels, &gesResult);
-  // For raw pixels, instead uncomment out the following line
+  gesturePipeline.run(pixels, &gesResult);
+  if (gesResult.gesture != GEST_NONE) {
+    latched_gesture = gesResult.gesture;
+  }
+  // For raw pixels, instead uncomment out the following line. Version 2 frames send pixels beyond 14 bits as 16-bit
   //memset(&gesResult, 0, sizeof(GestureResult));
 
-  if (data_stream_enabled) {
+  if (data_stream_enabled && stream_format != STREAM_FORMAT_V1) {
+    // Compact version 2 frames, see stream_codec.h
+    uint8_t frm_data[STREAM_V2_MAX_FRAME_BYTES];
+    sendDataStream(frm_data, encodeStreamFrame(&streamEncoder, &gesResult, pixels, frm_data));
+  }
+  else if (data_stream_enabled) {
 
     uint8_t frm_data[NUM_SENSOR_PIXELS*2+NUM_INFO_BYTES];
 
@@ -154,6 +208,7 @@ void processFrame(int pixels[])
     // SYNC bits are used by receiver to know the start of frame
     frm_data[0] = 255;  // SYNC
     frm_data[1] = 255;  // SYNC2
+    frm_data[2] = gesResult.gesture;
     frm_data[3] = gesResult.state;
     frm_data[4] = gesResult.n_sample;
     frm_data[6] = (gesResult.maxpixel>>8) & 0xFF;  // maxpixel high byte
@@ -176,6 +231,35 @@ void processFrame(int pixels[])
 }
 
 
+/*
+* This function programs the sample delay (SDLY) of the sensor, which sets its frame rate
+*/
+void set_sample_delay(const int sdly)
+{
+  uint8_t reg;
+  reg_read(FRAME_RATE_REG, 1, &reg);
+  reg_write(FRAME_RATE_REG, (reg & ~FRAME_RATE_SDLY_MASK) | ((sdly << FRAME_RATE_SDLY_SHIFT) & FRAME_RATE_SDLY_MASK));
+}
+
+/*
+* This function runs in the main loop after each processed frame, not in the INTB interrupt. It adapts the frame
+* rate to the result of the frame and keeps the sample period of the gesture library at the measured one
+*/
+void scheduleFrameRate(const uint32_t timestamp_us, const uint32_t frame)
+{
+  #if ENABLE_ADAPTIVE_FRAME_RATE
+  float period_ms;
+  if (measureFramePeriod(&frameRate, timestamp_us, frame, &period_ms)) {
+    setGestureSamplePeriod(period_ms);
+  }
+  const int sdly = updateFrameRate(&frameRate, gesResult.state || gesResult.tracking_state, gesResult.maxpixel, us_ticker_read());
+  if (sdly >= 0) {
+    set_sample_delay(sdly);
+  }
+  #endif
+}
+
+
 void set_default_register_settings()
 {
   uint32_t ledDrvLevel = 0x0F;
@@ -197,6 +281,9 @@ void set_default_register_settings()
   reg_write(0xa8, 0x88);
   reg_write(0xa9, 0x88);
   reg_write(0xc1, 0x0A); // PWM LED driver
+  #if ENABLE_ADAPTIVE_FRAME_RATE
+  set_sample_delay(getFrameRateSdly(&frameRate)); // SDLY of the current frame rate
+  #endif
 }
 
 /*
@@ -204,7 +291,7 @@ void set_default_register_settings()
 */
 void intb_handler()
 {
-  sensorDataReadyFlag = 1;
+  frameReaderDataReady(&frameReader, us_ticker_read());
 }
 
 /*
@@ -242,9 +329,11 @@ void disable_read_sensor_frames()
 /*
 * These functions set the data reporting mode and starts sending of data
 */
-void set_stream_on(uint32_t send_pixel_data)
+void set_stream_on(uint32_t send_pixel_data, uint32_t format)
 {
   send_pixel_data_with_stream = send_pixel_data;
+  stream_format = format;
+  initStreamEncoder(&streamEncoder, send_pixel_data, format == STREAM_FORMAT_V2_DELTA);
   data_stream_enabled = 1;
   if (read_sensor_frames_enabled == 0)
     enable_read_sensor_frames(); // make sure
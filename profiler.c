@@ -0,0 +1,171 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+#if !defined(__ARM_ARCH_7M__) && !defined(__ARM_ARCH_7EM__)
+  #define _POSIX_C_SOURCE 200809L // clock_gettime
+  #include <time.h>
+#endif
+#include <string.h>
+#include "profiler.h"
+
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+  // Cortex-M debug registers
+  #define DEMCR (*(volatile uint32_t *)0xE000EDFC)
+  #define DEMCR_TRCENA (1u << 24)
+  #define DWT_CTRL (*(volatile uint32_t *)0xE0001000)
+  #define DWT_CTRL_CYCCNTENA 1u
+  #define DWT_CYCCNT (*(volatile uint32_t *)0xE0001004)
+#endif
+
+static ProfileHistogram stages[PROFILE_NUM_STAGES];
+
+static const char * const stage_names[PROFILE_NUM_STAGES] = {
+  "frame", "filter", "window_filter", "background", "interp", "clamp_com", "track_bias", "track_low_pass",
+  "track_gain", "track_position", "read_pixels", "send_stream", "pump_stream"
+};
+
+void initProfiler()
+{
+  #if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+    DEMCR |= DEMCR_TRCENA;
+    DWT_CYCCNT = 0;
+    DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+  #endif
+  resetProfiler();
+}
+
+void resetProfiler()
+{
+  memset(stages, 0, sizeof(stages));
+  for (int i = 0; i < PROFILE_NUM_STAGES; i++) {
+    stages[i].min = UINT32_MAX;
+  }
+}
+
+uint32_t profileNow()
+{
+  #if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+    return DWT_CYCCNT;
+  #else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)ts.tv_sec * 1000000000u + (uint32_t)ts.tv_nsec;
+  #endif
+}
+
+const char * getProfileTickUnit()
+{
+  #if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+    return "cycles";
+  #else
+    return "ns";
+  #endif
+}
+
+static int highestBit(uint32_t value)
+{
+  #ifdef __GNUC__
+    return 31 - __builtin_clz(value);
+  #else
+    int bit = 0;
+    while (value >>= 1) {
+      bit++;
+    }
+    return bit;
+  #endif
+}
+
+// Values below 4 have a bucket each, above that 4 buckets per power of two
+static int bucketIndex(const uint32_t ticks)
+{
+  if (ticks < 4) {
+    return ticks;
+  }
+  int bit = highestBit(ticks);
+  return (bit - 1) * 4 + ((ticks >> (bit - 2)) & 3);
+}
+
+static uint32_t bucketUpperBound(const int index)
+{
+  if (index < 4) {
+    return index;
+  }
+  int shift = index / 4 - 1;
+  return (uint32_t)(((uint64_t)(5 + index % 4) << shift) - 1);
+}
+
+void profileRecord(const ProfileStage stage, const uint32_t ticks)
+{
+  ProfileHistogram *h = &stages[stage];
+  h->count++;
+  h->sum += ticks;
+  if (ticks < h->min) {
+    h->min = ticks;
+  }
+  if (ticks > h->max) {
+    h->max = ticks;
+  }
+  h->histogram[bucketIndex(ticks)]++;
+}
+
+void getProfileSummary(const ProfileStage stage, ProfileSummary *summary)
+{
+  const ProfileHistogram *h = &stages[stage];
+  memset(summary, 0, sizeof(ProfileSummary));
+  if (h->count == 0) {
+    return;
+  }
+  summary->count = h->count;
+  summary->min = h->min;
+  summary->max = h->max;
+  summary->mean = (uint32_t)(h->sum / h->count);
+
+  // Smallest bucket with at least 99% of the measurements at or below it
+  const uint64_t rank = ((uint64_t)h->count * 99 + 99) / 100;
+  uint64_t seen = 0;
+  for (int i = 0; i < PROFILE_HISTOGRAM_BUCKETS; i++) {
+    seen += h->histogram[i];
+    if (seen >= rank) {
+      uint32_t bound = bucketUpperBound(i);
+      summary->p99 = bound < h->max ? bound : h->max;
+      break;
+    }
+  }
+}
+
+const char * getProfileStageName(const ProfileStage stage)
+{
+  return stage_names[stage];
+}
@@ -0,0 +1,186 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+#ifndef PROFILER_H_INCLUDED
+#define PROFILER_H_INCLUDED
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+* Per stage timing of the frame pipeline.
+*
+* Built in when GESTURE_PROFILE is set to 1 (mbed compile -DGESTURE_PROFILE=1, or the GESTURE_PROFILE CMake option),
+* otherwise the PROFILE_BEGIN / PROFILE_END markers compile to nothing. Stages are timed in ticks: CPU cycles from
+* the DWT cycle counter on Cortex-M, nanoseconds from the monotonic clock on the host. Each stage keeps its count,
+* min, max and sum, and a histogram with 4 buckets per power of two from which the 99th percentile is estimated
+* to within 25%.
+*/
+#ifndef GESTURE_PROFILE
+#define GESTURE_PROFILE 0
+#endif
+
+typedef enum {
+  PROFILE_FRAME,              // runGesture, all stages of the gesture library
+  PROFILE_FILTER,             // Noise window filter and background subtraction (a single pass)
+  PROFILE_WINDOW_FILTER,      // Noise window filter stage of a gesture_pipeline.h pipeline
+  PROFILE_BACKGROUND,         // Background subtraction stage of a gesture_pipeline.h pipeline
+  PROFILE_INTERP,             // Interpolation, including the region of interest search
+  PROFILE_CLAMP_COM,          // Clamp below threshold and center of mass (a single pass)
+  PROFILE_TRACK_BIAS,         // Tracking bias compensation
+  PROFILE_TRACK_LOW_PASS,     // Tracking low pass filter
+  PROFILE_TRACK_GAIN,         // Tracking software gain
+  PROFILE_TRACK_POSITION,     // Tracking state, interpolation, clamp and center of mass
+  PROFILE_READ_PIXELS,        // Blocking sensor frame readout
+  PROFILE_SEND_STREAM,        // sendDataStream
+  PROFILE_PUMP_STREAM,        // Data stream transmission from the main loop
+  PROFILE_NUM_STAGES
+} ProfileStage;
+
+#define PROFILE_HISTOGRAM_BUCKETS 124
+
+typedef struct {
+  uint32_t count;
+  uint32_t min;
+  uint32_t max;
+  uint64_t sum;
+  uint32_t histogram[PROFILE_HISTOGRAM_BUCKETS];
+} ProfileHistogram;
+
+// Summary of a stage, in ticks
+typedef struct {
+  uint32_t count;
+  uint32_t min;
+  uint32_t mean;
+  uint32_t max;
+  uint32_t p99;               // Upper bound of the histogram bucket holding the 99th percentile, at most max
+} ProfileSummary;
+
+#if GESTURE_PROFILE
+  #define PROFILE_BEGIN(start) const uint32_t start = profileNow()
+  #define PROFILE_END(stage, start) profileRecord(stage, profileNow() - (start))
+#else
+  #define PROFILE_BEGIN(start)
+  #define PROFILE_END(stage, start)
+#endif
+
+/**
+* This function starts the tick counter and clears all stages. On Cortex-M it enables the DWT cycle counter.
+*
+* Parameters
+* None
+*
+* Return Value
+* None
+*/
+void initProfiler();
+
+/**
+* This function clears all stages.
+*
+* Parameters
+* None
+*
+* Return Value
+* None
+*/
+void resetProfiler();
+
+/**
+* This function reads the tick counter. Differences of two readings are valid across a wrap of the counter.
+*
+* Parameters
+* None
+*
+* Return Value
+* Current tick count
+*/
+uint32_t profileNow();
+
+/**
+* This function adds a measurement to a stage.
+*
+* Parameters
+* stage: The stage
+* ticks: Duration in ticks
+*
+* Return Value
+* None
+*/
+void profileRecord(const ProfileStage stage, const uint32_t ticks);
+
+/**
+* This function summarizes the measurements of a stage.
+*
+* Parameters
+* stage:   The stage
+* summary: A pointer to a ProfileSummary structure. All fields are 0 if the stage has no measurements
+*
+* Return Value
+* None
+*/
+void getProfileSummary(const ProfileStage stage, ProfileSummary *summary);
+
+/**
+* This function gets the short name of a stage, for reports.
+*
+* Parameters
+* stage: The stage
+*
+* Return Value
+* The name
+*/
+const char * getProfileStageName(const ProfileStage stage);
+
+/**
+* This function gets the unit of the ticks, for reports.
+*
+* Parameters
+* None
+*
+* Return Value
+* "cycles" or "ns"
+*/
+const char * getProfileTickUnit();
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
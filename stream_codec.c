@@ -0,0 +1,321 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+#include "stream_codec.h"
+
+#define PIXEL_MAX ((1 << (STREAM_V2_PIXEL_BITS-1)) - 1)
+#define PIXEL_MIN (-(1 << (STREAM_V2_PIXEL_BITS-1)))
+#define PIXEL_MASK ((1 << STREAM_V2_PIXEL_BITS) - 1)
+
+#define DELTA_RUN_TOKEN 0x80
+#define DELTA_WIDE_TOKEN 0xC0
+#define DELTA_MAX_RUN 64
+
+static int saturate(const int value, const int min, const int max)
+{
+  return value < min ? min : (value > max ? max : value);
+}
+
+// Sign extends the low STREAM_V2_PIXEL_BITS bits of value
+static int16_t signExtendPixel(const unsigned int value)
+{
+  return (int16_t)((int)((value & PIXEL_MASK) ^ (1 << (STREAM_V2_PIXEL_BITS-1))) - (1 << (STREAM_V2_PIXEL_BITS-1)));
+}
+
+static void putInt16(uint8_t *dst, const int value)
+{
+  dst[0] = (value >> 8) & 0xFF;
+  dst[1] = value & 0xFF;
+}
+
+static int getInt16(const uint8_t *src)
+{
+  return (int16_t)(src[0] << 8 | src[1]);
+}
+
+// Q8.8 with rounding to nearest
+static int floatToQ8(const float value)
+{
+  float scaled = value * 256.0f;
+  return saturate((int)(scaled < 0 ? scaled - 0.5f : scaled + 0.5f), INT16_MIN, INT16_MAX);
+}
+
+static uint8_t checksum(const uint8_t *data, const unsigned int length)
+{
+  uint8_t sum = 0;
+  for (unsigned int i = 0; i < length; i++) {
+    sum += data[i];
+  }
+  return sum;
+}
+
+static unsigned int packPixels(const int16_t pixels[], uint8_t *dst)
+{
+  uint32_t bits = 0;
+  unsigned int num_bits = 0, n = 0;
+  for (unsigned int i = 0; i < NUM_SENSOR_PIXELS; i++) {
+    bits = bits << STREAM_V2_PIXEL_BITS | (pixels[i] & PIXEL_MASK);
+    num_bits += STREAM_V2_PIXEL_BITS;
+    while (num_bits >= 8) {
+      num_bits -= 8;
+      dst[n++] = (bits >> num_bits) & 0xFF;
+    }
+  }
+  if (num_bits > 0) {
+    dst[n++] = (bits << (8 - num_bits)) & 0xFF;
+  }
+  return n;
+}
+
+static void unpackPixels(const uint8_t *src, int16_t pixels[])
+{
+  uint32_t bits = 0;
+  unsigned int num_bits = 0, n = 0;
+  for (unsigned int i = 0; i < NUM_SENSOR_PIXELS; i++) {
+    while (num_bits < STREAM_V2_PIXEL_BITS) {
+      bits = bits << 8 | src[n++];
+      num_bits += 8;
+    }
+    num_bits -= STREAM_V2_PIXEL_BITS;
+    pixels[i] = signExtendPixel(bits >> num_bits);
+  }
+}
+
+// Returns the payload length, or 0 if the delta encoding does not fit in max_length bytes
+static unsigned int deltaEncodePixels(const int16_t prev[], const int16_t pixels[], uint8_t *dst, const unsigned int max_length)
+{
+  unsigned int n = 0, run = 0;
+  for (unsigned int i = 0; i < NUM_SENSOR_PIXELS; i++) {
+    int delta = signExtendPixel(pixels[i] - prev[i]);
+    if (delta == 0) {
+      run++;
+      if (run < DELTA_MAX_RUN && i < NUM_SENSOR_PIXELS-1) {
+        continue;
+      }
+    }
+    if (run > 0) {
+      if (n + 1 > max_length) {
+        return 0;
+      }
+      dst[n++] = DELTA_RUN_TOKEN | (run - 1);
+      run = 0;
+    }
+    if (delta == 0) {
+      continue;
+    }
+    if (delta >= -64 && delta <= 63) {
+      if (n + 1 > max_length) {
+        return 0;
+      }
+      dst[n++] = delta & 0x7F;
+    }
+    else {
+      if (n + 2 > max_length) {
+        return 0;
+      }
+      dst[n++] = DELTA_WIDE_TOKEN | ((delta >> 8) & 0x3F);
+      dst[n++] = delta & 0xFF;
+    }
+  }
+  return n;
+}
+
+// Returns 0 on success, -1 if the payload is malformed
+static int deltaDecodePixels(const uint8_t *src, const unsigned int length, int16_t pixels[])
+{
+  unsigned int n = 0, i = 0;
+  while (n < length) {
+    const uint8_t token = src[n++];
+    if ((token & DELTA_RUN_TOKEN) == 0) {
+      if (i >= NUM_SENSOR_PIXELS) {
+        return -1;
+      }
+      pixels[i] = signExtendPixel(pixels[i] + ((token & 0x40) ? (int)token - 0x80 : token));
+      i++;
+    }
+    else if ((token & DELTA_WIDE_TOKEN) == DELTA_RUN_TOKEN) {
+      i += (token & 0x3F) + 1;
+    }
+    else {
+      if (i >= NUM_SENSOR_PIXELS || n >= length) {
+        return -1;
+      }
+      pixels[i] = signExtendPixel(pixels[i] + ((token & 0x3F) << 8 | src[n++]));
+      i++;
+    }
+  }
+  return i == NUM_SENSOR_PIXELS ? 0 : -1;
+}
+
+void initStreamEncoder(StreamEncoder *enc, const uint32_t pixels, const uint32_t delta)
+{
+  memset(enc, 0, sizeof(StreamEncoder));
+  enc->pixels = pixels != 0;
+  enc->delta = delta != 0;
+  enc->frames_since_key = STREAM_V2_KEYFRAME_INTERVAL; // start with a keyframe
+}
+
+unsigned int encodeStreamFrame(StreamEncoder *enc, const GestureResult *gesResult, const int pixels[], uint8_t frm_data[])
+{
+  uint8_t *payload = frm_data + STREAM_V2_HEADER_BYTES;
+  StreamPixelEncoding encoding = STREAM_PIXELS_NONE;
+  unsigned int length = 0;
+
+  if (enc->pixels) {
+    int16_t saturated[NUM_SENSOR_PIXELS];
+    int fits = TRUE;
+    for (unsigned int i = 0; i < NUM_SENSOR_PIXELS; i++) {
+      saturated[i] = saturate(pixels[i], INT16_MIN, INT16_MAX);
+      if (saturated[i] < PIXEL_MIN || saturated[i] > PIXEL_MAX) {
+        fits = FALSE;
+      }
+    }
+    if (!fits) {
+      // Would clip in 14 bits: 16-bit pixels, and a keyframe next since deltas are taken modulo 2^14
+      for (unsigned int i = 0; i < NUM_SENSOR_PIXELS; i++) {
+        putInt16(payload + 2*i, saturated[i]);
+      }
+      length = STREAM_V2_WIDE_BYTES;
+      encoding = STREAM_PIXELS_WIDE;
+      enc->frames_since_key = STREAM_V2_KEYFRAME_INTERVAL;
+    }
+    else if (enc->delta && enc->frames_since_key < STREAM_V2_KEYFRAME_INTERVAL) {
+      length = deltaEncodePixels(enc->prev, saturated, payload, STREAM_V2_PACKED_BYTES - 1);
+      encoding = STREAM_PIXELS_DELTA;
+      enc->frames_since_key++;
+    }
+    if (length == 0) {
+      length = packPixels(saturated, payload);
+      encoding = STREAM_PIXELS_PACKED;
+      enc->frames_since_key = 1;
+    }
+    memcpy(enc->prev, saturated, sizeof(saturated));
+  }
+
+  frm_data[0] = STREAM_V2_SYNC;
+  frm_data[1] = STREAM_V2_SYNC2;
+  frm_data[2] = enc->seq++;
+  frm_data[3] = encoding;
+  frm_data[4] = gesResult->state;
+  frm_data[5] = gesResult->gesture;
+  frm_data[6] = gesResult->n_sample > 255 ? 255 : gesResult->n_sample;
+  putInt16(frm_data + 7, saturate(gesResult->maxpixel, INT16_MIN, INT16_MAX));
+  putInt16(frm_data + 9, floatToQ8(gesResult->x));
+  putInt16(frm_data + 11, floatToQ8(gesResult->y));
+  frm_data[13] = length;
+  frm_data[STREAM_V2_HEADER_BYTES + length] = checksum(frm_data + 2, STREAM_V2_HEADER_BYTES - 2 + length);
+  return STREAM_V2_HEADER_BYTES + length + 1;
+}
+
+void initStreamDecoder(StreamDecoder *dec)
+{
+  memset(dec, 0, sizeof(StreamDecoder));
+}
+
+int decodeStreamFrame(StreamDecoder *dec, const uint8_t frm_data[], const unsigned int length, StreamFrame *frame)
+{
+  if (length < STREAM_V2_HEADER_BYTES) {
+    return 0;
+  }
+  if (frm_data[0] != STREAM_V2_SYNC || frm_data[1] != STREAM_V2_SYNC2) {
+    return -1;
+  }
+  const unsigned int payload_length = frm_data[13];
+  const unsigned int frame_length = STREAM_V2_HEADER_BYTES + payload_length + 1;
+  if (length < frame_length) {
+    return 0;
+  }
+  if (checksum(frm_data + 2, STREAM_V2_HEADER_BYTES - 2 + payload_length) != frm_data[frame_length - 1]) {
+    return -1;
+  }
+
+  const uint8_t seq = frm_data[2];
+  const uint8_t *payload = frm_data + STREAM_V2_HEADER_BYTES;
+  int16_t pixels[NUM_SENSOR_PIXELS];
+  switch (frm_data[3]) {
+    case STREAM_PIXELS_NONE:
+      if (payload_length != 0) {
+        return -1;
+      }
+      dec->have_prev = 0;
+      break;
+    case STREAM_PIXELS_PACKED:
+      if (payload_length != STREAM_V2_PACKED_BYTES) {
+        return -1;
+      }
+      unpackPixels(payload, pixels);
+      break;
+    case STREAM_PIXELS_WIDE:
+      if (payload_length != STREAM_V2_WIDE_BYTES) {
+        return -1;
+      }
+      for (unsigned int i = 0; i < NUM_SENSOR_PIXELS; i++) {
+        pixels[i] = getInt16(payload + 2*i);
+      }
+      break;
+    case STREAM_PIXELS_DELTA:
+      if (!dec->have_prev || seq != (uint8_t)(dec->seq + 1)) {
+        dec->have_prev = 0;
+        dec->seq = seq;
+        return -2;
+      }
+      memcpy(pixels, dec->prev, sizeof(pixels));
+      if (deltaDecodePixels(payload, payload_length, pixels)) {
+        return -1;
+      }
+      break;
+    default:
+      return -1;
+  }
+
+  memset(frame, 0, sizeof(StreamFrame));
+  frame->seq = seq;
+  frame->encoding = (StreamPixelEncoding)frm_data[3];
+  frame->result.state = frm_data[4];
+  frame->result.gesture = (GestureEvent)frm_data[5];
+  frame->result.n_sample = frm_data[6];
+  frame->result.maxpixel = getInt16(frm_data + 7);
+  frame->result.x = getInt16(frm_data + 9) / 256.0f;
+  frame->result.y = getInt16(frm_data + 11) / 256.0f;
+  if (frame->encoding != STREAM_PIXELS_NONE) {
+    for (unsigned int i = 0; i < NUM_SENSOR_PIXELS; i++) {
+      frame->pixels[i] = pixels[i];
+    }
+    memcpy(dec->prev, pixels, sizeof(pixels));
+    dec->have_prev = frame->encoding != STREAM_PIXELS_WIDE;
+  }
+  dec->seq = seq;
+  return frame_length;
+}
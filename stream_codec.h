@@ -0,0 +1,186 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+#ifndef STREAM_CODEC_H_INCLUDED
+#define STREAM_CODEC_H_INCLUDED
+
+#include "gesture_common.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+* Data stream frame format version 2, selected with "stream on v2" or "stream on v2delta".
+*
+* Version 1 frames (processFrame in main.cpp) are 0xFF 0xFF, 38 info bytes and 60 16-bit pixels: 160 bytes.
+* Version 2 frames are:
+*
+*   0      0xFF          SYNC
+*   1      0x5A          SYNC2, distinguishes version 2 frames from version 1
+*   2      seq           Frame sequence number, incremented for every frame sent
+*   3      encoding      StreamPixelEncoding of the payload
+*   4      state         GestureResult.state
+*   5      gesture       GestureResult.gesture
+*   6      n_sample      GestureResult.n_sample, saturated at 255
+*   7-8    maxpixel      GestureResult.maxpixel, int16 big-endian, saturated
+*   9-10   x             GestureResult.x, Q8.8 int16 big-endian (-1.0 when no object is present)
+*   11-12  y             GestureResult.y, Q8.8 int16 big-endian
+*   13     length        Payload length in bytes
+*   14     payload       Pixel data, see StreamPixelEncoding
+*   14+length checksum   Sum of bytes 2 to 13+length, modulo 256
+*
+* Pixels are sent as 14-bit signed values (-8192..8191), which cover the processed pixels. A frame with a pixel
+* outside that range, e.g. raw ADC values up to ADC_FULL_SCALE, is sent with 16-bit pixels instead, saturated to
+* the int16 range. A frame without pixels is 15 bytes. Packed pixels take 105 bytes, 120 per frame; 16-bit
+* pixels 120 bytes, 135 per frame.
+*/
+#define STREAM_V2_SYNC 0xFF
+#define STREAM_V2_SYNC2 0x5A
+#define STREAM_V2_HEADER_BYTES 14
+#define STREAM_V2_PIXEL_BITS 14
+#define STREAM_V2_PACKED_BYTES ((NUM_SENSOR_PIXELS * STREAM_V2_PIXEL_BITS + 7) / 8)
+#define STREAM_V2_WIDE_BYTES (NUM_SENSOR_PIXELS * 2)
+#define STREAM_V2_MAX_PAYLOAD_BYTES 255
+#define STREAM_V2_MAX_FRAME_BYTES (STREAM_V2_HEADER_BYTES + STREAM_V2_MAX_PAYLOAD_BYTES + 1)
+
+// A packed keyframe is sent at least every STREAM_V2_KEYFRAME_INTERVAL frames, so a receiver that lost
+// frames recovers within that many frames
+#define STREAM_V2_KEYFRAME_INTERVAL 32
+
+/*
+* Pixel payload encodings.
+*
+* STREAM_PIXELS_PACKED: NUM_SENSOR_PIXELS 14-bit two's complement values, packed MSB first.
+* STREAM_PIXELS_DELTA: differences to the pixels of the previous frame, modulo 2^14, one token per run:
+*   0xxxxxxx            7-bit signed difference of one pixel (-64..63)
+*   10nnnnnn            nnnnnn+1 pixels (1..64) are unchanged
+*   11xxxxxx xxxxxxxx   14-bit difference of one pixel
+* Delta frames are only decoded if the previous frame was received, i.e. if seq is one more than its seq.
+* STREAM_PIXELS_WIDE: NUM_SENSOR_PIXELS int16 big-endian values, for frames with pixels outside the 14-bit range.
+* The frame after it is a keyframe, delta frames only follow packed or delta frames.
+*/
+typedef enum {
+  STREAM_PIXELS_NONE,
+  STREAM_PIXELS_PACKED,
+  STREAM_PIXELS_DELTA,
+  STREAM_PIXELS_WIDE
+} StreamPixelEncoding;
+
+// Encoder state, one per stream
+typedef struct {
+  uint8_t seq;
+  uint8_t delta;                        // Use delta encoding. Otherwise every frame is a packed keyframe
+  uint8_t pixels;                       // Send pixel data
+  uint32_t frames_since_key;
+  int16_t prev[NUM_SENSOR_PIXELS];      // Saturated pixels of the last frame sent
+} StreamEncoder;
+
+// Decoder state, one per stream
+typedef struct {
+  uint8_t seq;
+  uint8_t have_prev;                    // prev holds the pixels of frame seq, so the next delta frame can be decoded
+  int16_t prev[NUM_SENSOR_PIXELS];
+} StreamDecoder;
+
+// A decoded frame. The GestureResult fields not carried by the stream are zero
+typedef struct {
+  uint8_t seq;
+  StreamPixelEncoding encoding;
+  GestureResult result;
+  int pixels[NUM_SENSOR_PIXELS];        // Valid if encoding is not STREAM_PIXELS_NONE
+} StreamFrame;
+
+/**
+* This function initializes a stream encoder. The first frame encoded is a keyframe.
+*
+* Parameters
+* enc:    A pointer to a StreamEncoder structure
+* pixels: Nonzero to send pixel data
+* delta:  Nonzero to delta encode the pixel data
+*
+* Return Value
+* None
+*/
+void initStreamEncoder(StreamEncoder *enc, const uint32_t pixels, const uint32_t delta);
+
+/**
+* This function builds a version 2 data stream frame. Delta frames that would be larger than a packed frame
+* are sent packed instead.
+*
+* Parameters
+* enc:       A pointer to the StreamEncoder of the stream
+* gesResult: The gesture results of the frame
+* pixels:    The NUM_SENSOR_PIXELS pixels of the frame
+* frm_data:  Output buffer of at least STREAM_V2_MAX_FRAME_BYTES bytes
+*
+* Return Value
+* Number of bytes in frm_data
+*/
+unsigned int encodeStreamFrame(StreamEncoder *enc, const GestureResult *gesResult, const int pixels[], uint8_t frm_data[]);
+
+/**
+* This function initializes a stream decoder.
+*
+* Parameters
+* dec: A pointer to a StreamDecoder structure
+*
+* Return Value
+* None
+*/
+void initStreamDecoder(StreamDecoder *dec);
+
+/**
+* This function decodes one version 2 data stream frame, starting at the SYNC byte.
+*
+* Parameters
+* dec:      A pointer to the StreamDecoder of the stream
+* frm_data: The frame bytes
+* length:   Number of bytes available in frm_data
+* frame:    A pointer to a StreamFrame; populated with the decoded frame
+*
+* Return Value
+* The size of the frame in bytes on success. 0 if more bytes are needed to decode the frame, -1 if the bytes
+* are not a valid frame (bad sync, length or checksum), -2 if the frame is a delta frame whose previous frame
+* was lost; it is skipped, and decoding resumes with the next keyframe
+*/
+int decodeStreamFrame(StreamDecoder *dec, const uint8_t frm_data[], const unsigned int length, StreamFrame *frame);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
@@ -0,0 +1,151 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+#include "gesture_common.h"
+
+// Smoothing of the per frame velocity, so a single noisy center of mass does not make a peak
+static const float SWIPE_VELOCITY_ALPHA = 0.5f;
+// The net motion along the swipe axis must be this many times the motion along the other axis
+static const float SWIPE_AXIS_RATIO = 2.0f;
+
+void configSwipe(SwipeContext *ctx, const GestureConfig *cfg)
+{
+  ctx->start_detection_threshold = cfg->start_detection_threshold;
+  ctx->end_detection_threshold = cfg->end_detection_threshold;
+  ctx->min_distance = cfg->swipe_min_distance;
+  setSwipeSamplePeriod(ctx, cfg);
+  resetSwipe(ctx);
+}
+
+void setSwipeSamplePeriod(SwipeContext *ctx, const GestureConfig *cfg)
+{
+  ctx->min_speed = cfg->swipe_min_speed * cfg->sample_period_ms / 1000.0f;
+  ctx->exit_frames = (uint32_t)(cfg->swipe_exit_ms / cfg->sample_period_ms);
+}
+
+void resetSwipe(SwipeContext *ctx)
+{
+  ctx->state = STATE_INACTIVE;
+  ctx->n_sample = 0;
+}
+
+// Start a trajectory at the first position of the object
+static void startSwipe(SwipeContext *ctx, const float x, const float y)
+{
+  ctx->state = GESTURE_IN_PROGRESS;
+  ctx->n_sample = 1;
+  ctx->n_exit = 0;
+  ctx->rejected = FALSE;
+  ctx->start_x = ctx->last_x = x;
+  ctx->start_y = ctx->last_y = y;
+  ctx->accum_dx = ctx->accum_dy = 0.0f;
+  ctx->vx = ctx->vy = 0.0f;
+  ctx->peak_vx = ctx->peak_vy = 0.0f;
+}
+
+// Add a position to the trajectory
+static void updateSwipe(SwipeContext *ctx, const float x, const float y)
+{
+  const float dx = x - ctx->last_x;
+  const float dy = y - ctx->last_y;
+  ctx->n_sample++;
+  ctx->n_exit = 0;
+  ctx->last_x = x;
+  ctx->last_y = y;
+
+  ctx->accum_dx += fabsf(dx);
+  ctx->accum_dy += fabsf(dy);
+  if (ctx->accum_dx > MAX_ABS_ACCUM_DX || ctx->accum_dy > MAX_ABS_ACCUM_DY) {
+    ctx->rejected = TRUE; // Hovering or erratic motion, rather than a single pass over the sensor
+  }
+
+  ctx->vx += SWIPE_VELOCITY_ALPHA * (dx - ctx->vx);
+  ctx->vy += SWIPE_VELOCITY_ALPHA * (dy - ctx->vy);
+  if (ctx->peak_vx < fabsf(ctx->vx)) {
+    ctx->peak_vx = fabsf(ctx->vx);
+  }
+  if (ctx->peak_vy < fabsf(ctx->vy)) {
+    ctx->peak_vy = fabsf(ctx->vy);
+  }
+}
+
+// Swipe direction from the net motion, once the object has left
+static GestureEvent classifySwipe(const SwipeContext *ctx)
+{
+  if (ctx->rejected) {
+    return GEST_NONE;
+  }
+  const float dx = ctx->last_x - ctx->start_x;
+  const float dy = ctx->last_y - ctx->start_y;
+  if (fabsf(dx) >= SWIPE_AXIS_RATIO * fabsf(dy)) {
+    if (fabsf(dx) >= ctx->min_distance && ctx->peak_vx >= ctx->min_speed) {
+      return dx < 0 ? GEST_SWIPE_LEFT : GEST_SWIPE_RIGHT;
+    }
+  }
+  else if (fabsf(dy) >= SWIPE_AXIS_RATIO * fabsf(dx)) {
+    if (fabsf(dy) >= ctx->min_distance && ctx->peak_vy >= ctx->min_speed) {
+      return dy < 0 ? GEST_SWIPE_UP : GEST_SWIPE_DOWN;
+    }
+  }
+  return GEST_NONE; // Diagonal, too short or too slow
+}
+
+GestureEvent runSwipe(SwipeContext *ctx, const int maxpixel, const float x, const float y)
+{
+  if (ctx->state == STATE_INACTIVE) {
+    // Start with the start threshold, continue down to the end threshold
+    if (maxpixel >= ctx->start_detection_threshold) {
+      startSwipe(ctx, x, y);
+    }
+    else {
+      ctx->n_sample = 0;
+    }
+    return GEST_NONE;
+  }
+
+  if (maxpixel >= ctx->end_detection_threshold) {
+    updateSwipe(ctx, x, y);
+    return GEST_NONE;
+  }
+
+  // The object left. Short dropouts continue the gesture, so it is only classified once the object stayed
+  // gone for exit_frames frames
+  if (ctx->n_exit < ctx->exit_frames) {
+    ctx->n_exit++;
+    return GEST_NONE;
+  }
+  ctx->state = STATE_INACTIVE;
+  return classifySwipe(ctx);
+}
@@ -35,95 +35,115 @@
 
 #include "gesture_common.h"
 
-static uint32_t reset_flag = TRUE;
-static uint32_t reset_bias_flag = TRUE;
-
-// Calculated from parameters
-static uint32_t sampleT;
-static uint32_t adc_full_scale;
-static uint32_t static_state_bias_n;
+typedef enum { INACTIVE_STATE, TRACKING_STATE } TrackingState;
 
-static uint32_t force_calibration_flag = FALSE;
+void initTrackingContext(TrackingContext *ctx)
+{
+  memset(ctx, 0, sizeof(TrackingContext));
+  ctx->reset_flag = TRUE;
+  ctx->reset_bias_flag = TRUE;
+  ctx->force_calibration_flag = FALSE;
+  ctx->state = INACTIVE_STATE;
+  ctx->calibration_done = FALSE;
+  ctx->reset_filter_flag = TRUE;
+}
 
-typedef enum { INACTIVE_STATE, TRACKING_STATE } TrackingState;
+// Frames of static state before an automatic bias calibration. The sample period is in milliseconds and may be
+// fractional, as measured by the adaptive frame rate
+static uint32_t staticStateBiasFrames(const TrackingConfig *cfg, const float sampleT)
+{
+  return (uint32_t)(cfg->static_state_bias_ms / sampleT);
+}
 
-void configTracking(const uint32_t _sampleT, const uint32_t _adc_full_scale, const TrackingConfig *cfg)
+void configTracking(TrackingContext *ctx, const float _sampleT, const uint32_t _adc_full_scale, const TrackingConfig *cfg)
 {
-  sampleT = _sampleT;
-  adc_full_scale = _adc_full_scale;
-  static_state_bias_n = cfg->static_state_bias_ms/sampleT;
-  resetTracking();
+  ctx->sampleT = _sampleT > 0.0f ? _sampleT : 1.0f;
+  ctx->adc_full_scale = _adc_full_scale;
+  ctx->static_state_bias_n = staticStateBiasFrames(cfg, ctx->sampleT);
+  ctx->low_pass_filter_alpha_q16 = floatToQ16(cfg->low_pass_filter_alpha);
+  ctx->gain_factor_q16[0] = floatToQ16(cfg->gain_factor_0);
+  ctx->gain_factor_q16[1] = floatToQ16(cfg->gain_factor_1);
+  ctx->gain_factor_q16[2] = floatToQ16(cfg->gain_factor_2);
+  resetTracking(ctx);
 
   // Reset calibration only if sample period or full-scale changed, so calibration is not cleared.
-  static uint32_t last_sampleT = 0;
-  static uint32_t last_adc_full_scale = 0;
-  if ((sampleT != last_sampleT) || (adc_full_scale != last_adc_full_scale)) {
-    clearTrackingCalibration();
+  if ((ctx->sampleT != ctx->last_sampleT) || (ctx->adc_full_scale != ctx->last_adc_full_scale)) {
+    clearTrackingCalibration(ctx);
   }
-  last_sampleT = sampleT;
-  last_adc_full_scale = adc_full_scale;
+  ctx->last_sampleT = ctx->sampleT;
+  ctx->last_adc_full_scale = ctx->adc_full_scale;
+}
+
+void setTrackingSamplePeriod(TrackingContext *ctx, const float _sampleT, const TrackingConfig *cfg)
+{
+  const float sampleT = _sampleT > 0.0f ? _sampleT : 1.0f;
+  // Keep the time already spent in static state
+  ctx->static_state_bias_count = (uint32_t)(ctx->static_state_bias_count * ctx->sampleT / sampleT);
+  ctx->sampleT = sampleT;
+  ctx->static_state_bias_n = staticStateBiasFrames(cfg, ctx->sampleT);
+  ctx->last_sampleT = ctx->sampleT;
 }
 
 // Force a single bias configuration
-void forceTrackingCalibration()
+void requestTrackingCalibration(TrackingContext *ctx)
 {
-  force_calibration_flag = TRUE;
+  ctx->force_calibration_flag = TRUE;
 }
 
-void clearTrackingCalibration()
+void clearTrackingCalibration(TrackingContext *ctx)
 {
-  reset_bias_flag = TRUE;
+  ctx->reset_bias_flag = TRUE;
 }
 
 // Reset the state machine and clear the filter
-void resetTracking()
+void resetTracking(TrackingContext *ctx)
 {
-  reset_flag = TRUE;
+  ctx->reset_flag = TRUE;
 }
 
-void runTracking(const TrackingConfig *cfg, int pixels[], TrackingResult *gesResult)
+void runTracking(TrackingContext *ctx, const TrackingConfig *cfg, const InterpTable *interp, int interp_pixels[], int pixels[], const int maxpixel, TrackingResult *gesResult)
 {
-  static TrackingState state = INACTIVE_STATE;
-  static uint32_t calibration_done = FALSE;
-  static uint32_t static_state_bias_count = 0;
-
-  static uint32_t reset_filter_flag = TRUE;
-  static uint32_t reset_linger_flag = TRUE;
-
-  memset(gesResult, 0, sizeof(TrackingResult));
+  trackingBiasCompensation(ctx, cfg, pixels, NUM_SENSOR_PIXELS, maxpixel);
+  trackingLowPassFilter(ctx, cfg, pixels, NUM_SENSOR_PIXELS);
+  trackingGain(ctx, cfg, pixels, SENSOR_XRES, SENSOR_YRES);
+  trackingPosition(ctx, cfg, interp, interp_pixels, pixels, gesResult);
+}
 
+// maxpixel is the max of pixels, already known from the filters
+void trackingBiasCompensation(TrackingContext *ctx, const TrackingConfig *cfg, int pixels[], const unsigned int num_pixels, const int maxpixel)
+{
   // A reset will reset the calibration, so filters and static state counters must also be reset once a calibration is performed
-  if (reset_flag) {
-    state = INACTIVE_STATE;
-    static_state_bias_count = 0; // Reset the bias calibration counter but don't clear the bias cal.
-    reset_filter_flag = TRUE;
-    reset_flag = FALSE;
+  if (ctx->reset_flag) {
+    ctx->state = INACTIVE_STATE;
+    ctx->static_state_bias_count = 0; // Reset the bias calibration counter but don't clear the bias cal.
+    ctx->reset_filter_flag = TRUE;
+    ctx->reset_flag = FALSE;
   }
 
   // -----------------------------------------
   // Bias Compenstation
   // -----------------------------------------
+  PROFILE_BEGIN(bias_start);
   {
-    static int biaspixels[NUM_SENSOR_PIXELS];
-    static float refpixels[NUM_SENSOR_PIXELS];
-
-    int max_raw_pixel=getMaxPixelValue(pixels, NUM_SENSOR_PIXELS);
-    int min_raw_pixel=getMinPixelValue(pixels, NUM_SENSOR_PIXELS);
+    int *biaspixels = ctx->biaspixels;
+    int *refpixels = ctx->refpixels;
 
-    if (reset_bias_flag) {
-      for(uint32_t i=0; i<NUM_SENSOR_PIXELS; i++) {
+    if (ctx->reset_bias_flag) {
+      for(uint32_t i=0; i<num_pixels; i++) {
         biaspixels[i] = 0;         // clear the bias compensation
         refpixels[i] = pixels[i];  // reset reference pixels
       }
-      static_state_bias_count = 0;
-      reset_bias_flag = FALSE;
-      calibration_done = FALSE;
+      ctx->static_state_bias_count = 0;
+      ctx->reset_bias_flag = FALSE;
+      ctx->calibration_done = FALSE;
     }
 
     if (cfg->enable_auto_bias_calibration) {
+      int min_raw_pixel=getMinPixelValue(pixels, num_pixels);
+
       // Compare current pixel to reference
       int maxdelta = -99999;
-      for (uint32_t i = 0; i < NUM_SENSOR_PIXELS; i++) {
+      for (uint32_t i = 0; i < num_pixels; i++) {
         int delta = abs(pixels[i]  - refpixels[i]);
         if (maxdelta < delta) {
           maxdelta = delta;
@@ -131,128 +151,148 @@ void runTracking(const TrackingConfig *cfg, int pixels[], TrackingResult *gesRes
       }
       // Check for static condition
       if (maxdelta < (int)cfg->static_state_bias_delta_max
-        && max_raw_pixel-min_raw_pixel < (int)adc_full_scale/(int)cfg->bias_fullscale_factor_max
-        && state != TRACKING_STATE)
+        && maxpixel-min_raw_pixel < (int)ctx->adc_full_scale/(int)cfg->bias_fullscale_factor_max
+        && ctx->state != TRACKING_STATE)
       {
-        static_state_bias_count++;
+        ctx->static_state_bias_count++;
       }
       else {
         // Sensor not static, reset the counter and set new reference
-        static_state_bias_count = 0;
-        for(uint32_t i=0; i<NUM_SENSOR_PIXELS; i++) {
+        ctx->static_state_bias_count = 0;
+        for(uint32_t i=0; i<num_pixels; i++) {
           refpixels[i] = pixels[i];
         }
       }
       // If static condition, recalculate bias compenstation
-      if (static_state_bias_count > static_state_bias_n) {
-        for (uint32_t i = 0; i < NUM_SENSOR_PIXELS; i++) {
+      if (ctx->static_state_bias_count > ctx->static_state_bias_n) {
+        for (uint32_t i = 0; i < num_pixels; i++) {
           biaspixels[i] = refpixels[i];
         }
-        static_state_bias_count = 0;
-        calibration_done = TRUE;
+        ctx->static_state_bias_count = 0;
+        ctx->calibration_done = TRUE;
       }
     }
     // If force_calibration_flag is set, set bias to current pixel values
-    if (force_calibration_flag) {
-      for (uint32_t i = 0; i < NUM_SENSOR_PIXELS; i++) {
+    if (ctx->force_calibration_flag) {
+      for (uint32_t i = 0; i < num_pixels; i++) {
         biaspixels[i] = pixels[i];
       }
-      calibration_done = TRUE;
-      force_calibration_flag = FALSE;
+      ctx->calibration_done = TRUE;
+      ctx->force_calibration_flag = FALSE;
     }
     // Apply bias compensation
-    for (uint32_t i = 0; i < NUM_SENSOR_PIXELS; i++) {
+    for (uint32_t i = 0; i < num_pixels; i++) {
       pixels[i] -= biaspixels[i];
     }
   }
+  PROFILE_END(PROFILE_TRACK_BIAS, bias_start);
+}
 
+void trackingLowPassFilter(TrackingContext *ctx, const TrackingConfig *cfg, int pixels[], const unsigned int num_pixels)
+{
   // -----------------------------------------
   // Low pass filter
   // -----------------------------------------
-  if (calibration_done) {
-    static float filtpixels[NUM_SENSOR_PIXELS];
-    if (reset_filter_flag) {
-      for(uint32_t i=0; i<NUM_SENSOR_PIXELS; i++)
+  PROFILE_BEGIN(low_pass_start);
+  if (ctx->calibration_done) {
+    filt_t *filtpixels = ctx->filtpixels;
+    if (ctx->reset_filter_flag) {
+      for(uint32_t i=0; i<num_pixels; i++)
       {
-        filtpixels[i] = pixels[i]; // Clear the filter
+        #if GESTURE_FIXED_POINT
+          filtpixels[i] = pixels[i] * Q16_ONE; // Clear the filter
+        #else
+          filtpixels[i] = pixels[i]; // Clear the filter
+        #endif
       }
-      reset_filter_flag = FALSE;
+      ctx->reset_filter_flag = FALSE;
     }
-    filterLowPassPixels(pixels, filtpixels, NUM_SENSOR_PIXELS, cfg->low_pass_filter_alpha);
+    #if GESTURE_FIXED_POINT
+      (void)cfg; // The fixed point coefficient is calculated by configTracking
+      filterLowPassPixelsQ16(pixels, filtpixels, num_pixels, ctx->low_pass_filter_alpha_q16);
+    #else
+      filterLowPassPixels(pixels, filtpixels, num_pixels, cfg->low_pass_filter_alpha);
+    #endif
   }
+  PROFILE_END(PROFILE_TRACK_LOW_PASS, low_pass_start);
+}
 
+void trackingGain(const TrackingContext *ctx, const TrackingConfig *cfg, int pixels[], const unsigned int xres, const unsigned int yres)
+{
   // -----------------------------------------
   // Software gain
   // -----------------------------------------
-  {
-    double gain_factor = 0.0f;
-    for (uint32_t i = 0; i < NUM_SENSOR_PIXELS; i++) {
-      if (i%SENSOR_XRES == 0 || i%SENSOR_XRES == 9 || i%SENSOR_XRES == 1 || i%SENSOR_XRES == 8 || i/SENSOR_XRES == 0 || i/SENSOR_XRES == 5)
-        gain_factor = cfg->gain_factor_2;
-      else if (i%SENSOR_XRES == 2 || i%SENSOR_XRES == 7 || i/SENSOR_XRES == 1 || i/SENSOR_XRES == 4)
-        gain_factor = cfg->gain_factor_1;
-      else if (i%SENSOR_XRES == 3 || i%SENSOR_XRES == 6 || i%SENSOR_XRES == 4 || i%SENSOR_XRES == 5)
-        gain_factor = cfg->gain_factor_0;
+  PROFILE_BEGIN(gain_start);
+  applyTrackingGain(ctx, cfg, pixels, xres, yres);
+  PROFILE_END(PROFILE_TRACK_GAIN, gain_start);
+}
 
-      pixels[i] *= gain_factor;
-    }
-  }
+void trackingPosition(TrackingContext *ctx, const TrackingConfig *cfg, const InterpTable *interp, int interp_buffer[], int pixels[], TrackingResult *gesResult)
+{
+  memset(gesResult, 0, sizeof(TrackingResult));
 
   // -----------------------------------------
   // Determine tracking state
   // -----------------------------------------
 
   // Get max/min pixel after applying bias compensation and filtering
-  int maxpixel=getMaxPixelValue(pixels, NUM_SENSOR_PIXELS);
+  PROFILE_BEGIN(position_start);
+  const int xres = (int)interp->w, yres = (int)interp->h;
+  int maxpixel=getMaxPixelValue(pixels, xres*yres);
 
   // Determine state
-  if (calibration_done
-    && ((state == INACTIVE_STATE
-    && maxpixel > cfg->start_detection_threshold) || (state == TRACKING_STATE
+  if (ctx->calibration_done
+    && ((ctx->state == INACTIVE_STATE
+    && maxpixel > cfg->start_detection_threshold) || (ctx->state == TRACKING_STATE
     && maxpixel > cfg->end_detection_threshold)))
   {
-    state = TRACKING_STATE;
+    ctx->state = TRACKING_STATE;
   }
   else {
-    state = INACTIVE_STATE;
+    ctx->state = INACTIVE_STATE;
   }
 
   // -----------------------------------------
   // Object position
   // -----------------------------------------
   float x_scaled = -1.0, y_scaled = -1.0;
-  if (state == TRACKING_STATE) {
-    #if INTERP_FACTOR == 1
-      int *interp_pixels;
+  if (ctx->state == TRACKING_STATE) {
+    int *interp_pixels;
+    if (interp->factor == 1) {
       interp_pixels = pixels;
-    #else
-      int interp_pixels[NUM_INTERP_PIXELS];
-      interpn(pixels, interp_pixels, SENSOR_XRES, SENSOR_YRES, INTERP_FACTOR);
-    #endif
-
-    // Zero out low pixels to reduce artifacts and noise
-    zeroPixelsBelowThreshold(interp_pixels,NUM_INTERP_PIXELS,(int)(maxpixel/cfg->zero_clamp_threshold_factor)); // zero out pixels below some percent of peak
-    zeroPixelsBelowThreshold(interp_pixels,NUM_INTERP_PIXELS,cfg->zero_clamp_threshold);
+    }
+    else {
+      interp_pixels = interp_buffer;
+      interpnTable(pixels, interp_pixels, interp);
+    }
+    const unsigned int num_interp_pixels = interp->w2 * interp->h2;
+    const int peak_threshold = (int)(maxpixel/cfg->zero_clamp_threshold_factor);
+    const int clamp_threshold = peak_threshold > cfg->zero_clamp_threshold ? peak_threshold : cfg->zero_clamp_threshold;
 
-    // Find center of mass.
+    // Zero out low pixels to reduce artifacts and noise (below some percent of peak and below the fixed threshold),
+    // and find center of mass
     float cmx,cmy;
     if (maxpixel > 0) {
       int totalmass=0;
-      calcCenterOfMass(interp_pixels, INTERP_XRES, INTERP_YRES, &cmx, &cmy, &totalmass); // only calculate COM if there is a pixel above the noise (avoid divide-by-zero)
-      cmx = cmx/(float)INTERP_FACTOR;
-      cmy = cmy/(float)INTERP_FACTOR;
+      clampCenterOfMass(interp_pixels, interp->w2, interp->h2, clamp_threshold, &cmx, &cmy, &totalmass); // only calculate COM if there is a pixel above the noise (avoid divide-by-zero)
+      cmx = cmx/(float)interp->factor;
+      cmy = cmy/(float)interp->factor;
+    }
+    else {
+      zeroPixelsBelowThreshold(interp_pixels,num_interp_pixels,clamp_threshold);
     }
 
-    // Scale position according to tracking width/height parameter. This scales to values (0,9) in x, (0,5) in y
-    x_scaled = (cmx - ((float)SENSOR_XRES - cfg->track_width)/2.0f) * (SENSOR_XRES-1)/(cfg->track_width-1);
-    x_scaled = x_scaled >= (SENSOR_XRES-1) ? SENSOR_XRES - 1.001 : x_scaled < 0.0f ? 0.0f : x_scaled;
-    y_scaled = (cmy - ((float)SENSOR_YRES - cfg->track_height)/2.0f) * (SENSOR_YRES-1)/(cfg->track_height-1);
-    y_scaled = y_scaled >= (SENSOR_YRES-1) ? SENSOR_YRES - 1.001 : y_scaled < 0.0f ? 0.0f : y_scaled;
+    // Scale position according to tracking width/height parameter. This scales to values (0,xres-1) in x, (0,yres-1) in y
+    x_scaled = (cmx - ((float)xres - cfg->track_width)/2.0f) * (xres-1)/(cfg->track_width-1);
+    x_scaled = x_scaled >= (xres-1) ? xres - 1.001 : x_scaled < 0.0f ? 0.0f : x_scaled;
+    y_scaled = (cmy - ((float)yres - cfg->track_height)/2.0f) * (yres-1)/(cfg->track_height-1);
+    y_scaled = y_scaled >= (yres-1) ? yres - 1.001 : y_scaled < 0.0f ? 0.0f : y_scaled;
   }
+  PROFILE_END(PROFILE_TRACK_POSITION, position_start);
 
   // Update gesture result struct
-  gesResult->state = state == TRACKING_STATE ? 1 : 0;
-  gesResult->x = state == TRACKING_STATE ? x_scaled : -1.00f;
-  gesResult->y = state == TRACKING_STATE ? y_scaled : -1.00f;
+  gesResult->state = ctx->state == TRACKING_STATE ? 1 : 0;
+  gesResult->x = ctx->state == TRACKING_STATE ? x_scaled : -1.00f;
+  gesResult->y = ctx->state == TRACKING_STATE ? y_scaled : -1.00f;
   gesResult->maxpixel = maxpixel;
 }
@@ -0,0 +1,246 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+#include <string.h>
+#include "tx_queue.h"
+
+#define RING_MASK (TX_QUEUE_BYTES - 1)
+#define LENGTH_BYTES 2
+
+static unsigned int pump(TxQueue *txq, const int send_short);
+
+static unsigned int ringFree(const TxQueue *txq)
+{
+  return TX_QUEUE_BYTES - (txq->head - txq->tail);
+}
+
+static void ringPut(TxQueue *txq, const uint8_t *data, const unsigned int length)
+{
+  for (unsigned int i = 0; i < length; i++) {
+    txq->ring[(txq->head + i) & RING_MASK] = data[i];
+  }
+  txq->head += length;
+}
+
+static void ringGet(TxQueue *txq, uint8_t *data, const unsigned int length)
+{
+  for (unsigned int i = 0; i < length; i++) {
+    data[i] = txq->ring[(txq->tail + i) & RING_MASK];
+  }
+  txq->tail += length;
+}
+
+// Length of the oldest queued frame
+static unsigned int frontFrameLength(const TxQueue *txq)
+{
+  return txq->ring[txq->tail & RING_MASK] << 8 | txq->ring[(txq->tail + 1) & RING_MASK];
+}
+
+static void dropOldestFrame(TxQueue *txq)
+{
+  txq->tail += LENGTH_BYTES + frontFrameLength(txq);
+  txq->num_frames--;
+  txq->stats.frames_dropped++;
+}
+
+// Bytes waiting in the queue and in the transmit block
+static unsigned int queuedBytes(const TxQueue *txq)
+{
+  return (txq->head - txq->tail) - LENGTH_BYTES * txq->num_frames + (txq->block_length - txq->block_sent);
+}
+
+static void updateHighWater(TxQueue *txq)
+{
+  const uint32_t queued_bytes = queuedBytes(txq);
+  if (queued_bytes > txq->stats.max_queued_bytes) {
+    txq->stats.max_queued_bytes = queued_bytes;
+  }
+  if (txq->num_frames > txq->stats.max_queued_frames) {
+    txq->stats.max_queued_frames = txq->num_frames;
+  }
+}
+
+void initTxQueue(TxQueue *txq, TxQueueWrite write, void *ctx, const TxQueuePolicy policy)
+{
+  memset(txq, 0, sizeof(TxQueue));
+  txq->write = write;
+  txq->ctx = ctx;
+  txq->policy = policy;
+  txq->short_block_hold_us = TX_SHORT_BLOCK_HOLD_US;
+}
+
+void setTxQueueBlockTimeout(TxQueue *txq, TxQueueClock clock, const uint32_t timeout_us)
+{
+  txq->clock = clock;
+  txq->block_timeout_us = timeout_us;
+}
+
+static int pushFrame(TxQueue *txq, const uint8_t *data, const unsigned int length, const TxQueuePolicy policy)
+{
+  const unsigned int needed = LENGTH_BYTES + length;
+  if (ringFree(txq) < needed) {
+    if (policy == TX_DROP_NEWEST) {
+      txq->stats.frames_dropped++;
+      return -1;
+    }
+    if (policy == TX_DROP_OLDEST) {
+      while (ringFree(txq) < needed) {
+        dropOldestFrame(txq);
+      }
+    }
+    else {
+      txq->stats.blocked++;
+      const uint32_t start_us = txq->clock ? txq->clock() : 0;
+      while (ringFree(txq) < needed) {
+        if (txq->clock && txq->clock() - start_us >= txq->block_timeout_us) {
+          txq->stats.block_timeouts++;
+          txq->stats.frames_dropped++;
+          return -1;
+        }
+        pump(txq, 0);
+      }
+    }
+  }
+  const uint8_t length_bytes[LENGTH_BYTES] = {(uint8_t)(length >> 8), (uint8_t)length};
+  ringPut(txq, length_bytes, LENGTH_BYTES);
+  ringPut(txq, data, length);
+  txq->num_frames++;
+  txq->stats.frames_queued++;
+  updateHighWater(txq);
+  return 0;
+}
+
+int txQueuePush(TxQueue *txq, const uint8_t *data, const unsigned int length)
+{
+  return txQueuePushWithPolicy(txq, data, length, txq->policy);
+}
+
+int txQueuePushWithPolicy(TxQueue *txq, const uint8_t *data, const unsigned int length, const TxQueuePolicy policy)
+{
+  int status = 0;
+  for (unsigned int offset = 0; offset < length; offset += TX_MAX_FRAME_BYTES) {
+    const unsigned int chunk = length - offset < TX_MAX_FRAME_BYTES ? length - offset : TX_MAX_FRAME_BYTES;
+    status |= pushFrame(txq, data + offset, chunk, policy);
+  }
+  return status;
+}
+
+// Writes full blocks, and the last partial block if send_short
+static unsigned int pump(TxQueue *txq, const int send_short)
+{
+  while (1) {
+    // Move whole frames behind the unsent part of the transmit block, to fill it to a full block
+    if (txq->block_sent > 0 && txq->block_sent == txq->block_length) {
+      txq->block_sent = txq->block_length = 0;
+    }
+    while (txq->num_frames > 0 && txq->block_length - txq->block_sent < TX_BLOCK_BYTES) {
+      const unsigned int length = frontFrameLength(txq);
+      if (txq->block_length + length > sizeof(txq->block)) {
+        memmove(txq->block, txq->block + txq->block_sent, txq->block_length - txq->block_sent);
+        txq->block_length -= txq->block_sent;
+        txq->block_sent = 0;
+      }
+      txq->tail += LENGTH_BYTES;
+      ringGet(txq, txq->block + txq->block_length, length);
+      txq->block_length += length;
+      txq->num_frames--;
+    }
+
+    const unsigned int pending = txq->block_length - txq->block_sent;
+    if (pending == 0) {
+      return 0;
+    }
+    if (pending < TX_BLOCK_BYTES && !send_short) {
+      return queuedBytes(txq);
+    }
+    const unsigned int length = pending < TX_BLOCK_BYTES ? pending : TX_BLOCK_BYTES;
+    const unsigned int written = txq->write(txq->ctx, txq->block + txq->block_sent, length);
+    if (written == 0) {
+      return queuedBytes(txq);
+    }
+    txq->block_sent += written;
+    txq->stats.bytes_sent += written;
+    if (written == length) {
+      txq->stats.blocks_sent++;
+      if (length < TX_BLOCK_BYTES) {
+        txq->stats.short_blocks_sent++;
+      }
+    }
+  }
+}
+
+unsigned int txQueuePump(TxQueue *txq, const uint32_t now_us)
+{
+  unsigned int pending = pump(txq, 0);
+  if (pending == 0 || pending >= TX_BLOCK_BYTES) {
+    txq->short_held = 0;
+    return pending;
+  }
+  // Only a partial block is left. Give the next frame a chance to fill it, but not for longer than the hold time
+  if (!txq->short_held) {
+    txq->short_held = 1;
+    txq->short_since_us = now_us;
+  }
+  if (now_us - txq->short_since_us >= txq->short_block_hold_us) {
+    pending = pump(txq, 1);
+    txq->short_held = pending > 0; // transmitter busy: retry on the next call
+  }
+  return pending;
+}
+
+unsigned int txQueueFlush(TxQueue *txq, TxQueueClock now_us, const uint32_t timeout_us)
+{
+  const uint32_t start_us = now_us ? now_us() : 0;
+  unsigned int pending;
+  while ((pending = pump(txq, 1)) > 0 && (!now_us || now_us() - start_us < timeout_us)) {}
+  txq->short_held = 0;
+  return pending;
+}
+
+unsigned int txQueueDiscard(TxQueue *txq)
+{
+  const unsigned int num_frames = txq->num_frames;
+  while (txq->num_frames > 0) {
+    dropOldestFrame(txq);
+  }
+  return num_frames;
+}
+
+void getTxQueueStats(const TxQueue *txq, TxQueueStats *stats)
+{
+  *stats = txq->stats;
+  stats->queued_frames = txq->num_frames;
+  stats->queued_bytes = queuedBytes(txq);
+}
@@ -0,0 +1,226 @@
+/*******************************************************************************
+* Copyright (C) Maxim Integrated Products, Inc., All rights Reserved.
+*
+* This software is protected by copyright laws of the United States and
+* of foreign countries. This material may also be protected by patent laws
+* and technology transfer regulations of the United States and of foreign
+* countries. This software is furnished under a license agreement and/or a
+* nondisclosure agreement and may only be used or reproduced in accordance
+* with the terms of those agreements. Dissemination of this information to
+* any party or parties not specified in the license agreement and/or
+* nondisclosure agreement is expressly prohibited.
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+* IN NO EVENT SHALL MAXIM INTEGRATED BE LIABLE FOR ANY CLAIM, DAMAGES
+* OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*
+* Except as contained in this notice, the name of Maxim Integrated
+* Products, Inc. shall not be used except as stated in the Maxim Integrated
+* Products, Inc. Branding Policy.
+*
+* The mere transfer of this software does not imply any licenses
+* of trade secrets, proprietary technology, copyrights, patents,
+* trademarks, maskwork rights, or any other form of intellectual
+* property whatsoever. Maxim Integrated Products, Inc. retains all
+* ownership rights.
+*******************************************************************************
+*/
+
+#ifndef TX_QUEUE_H_INCLUDED
+#define TX_QUEUE_H_INCLUDED
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+* Buffered transmit queue for the serial data stream.
+*
+* sendDataStream queues whole frames and returns right away; the main loop calls txQueuePump, which coalesces
+* the queued frames into full blocks of TX_BLOCK_BYTES (one USB packet) and hands them to a non-blocking write
+* function. The last, partial block of the queue is held back for up to short_block_hold_us, so that the next
+* frame can complete it; a frame is therefore delayed by at most that time.
+*
+* When a frame does not fit, the queue applies its policy: drop the oldest queued frames to make room, drop the
+* new frame, or block, pumping until there is room. A blocked frame waits for block_timeout_us at most (see
+* setTxQueueBlockTimeout) and is dropped when the transmitter does not make room by then. Frames are only ever
+* dropped whole; frames already moved to the transmit block are always sent completely, so the receiver never
+* sees a partial frame.
+*/
+#define TX_QUEUE_BYTES 2048           // Queue capacity, a power of two. Each frame takes 2 extra bytes for its length
+#define TX_BLOCK_BYTES 64             // Transmit block size, the USB bulk packet size
+#define TX_MAX_FRAME_BYTES 512        // Longer messages are queued as several frames
+#define TX_SHORT_BLOCK_HOLD_US 1000   // Default time a partial block waits for more data (one USB frame)
+
+typedef enum {
+  TX_DROP_OLDEST,                     // Drop the oldest queued frames to make room for the new one
+  TX_DROP_NEWEST,                     // Drop the new frame
+  TX_BLOCK                            // Wait for the transmitter to make room, up to block_timeout_us
+} TxQueuePolicy;
+
+// Writes up to length bytes without blocking. Returns the number of bytes written, 0 if the transmitter is busy
+typedef unsigned int (*TxQueueWrite)(void *ctx, const uint8_t *data, const unsigned int length);
+
+// Current time in microseconds, for the timeouts of TX_BLOCK and txQueueFlush
+typedef uint32_t (*TxQueueClock)(void);
+
+// Transmit queue counters, see getTxQueueStats
+typedef struct {
+  uint32_t frames_queued;             // Frames accepted
+  uint32_t frames_dropped;            // Frames dropped by the policy
+  uint32_t blocked;                   // Frames that had to wait for room (TX_BLOCK)
+  uint32_t block_timeouts;            // Blocked frames dropped because no room was made within block_timeout_us
+  uint32_t blocks_sent;               // Transmit blocks written
+  uint32_t short_blocks_sent;         // Transmit blocks shorter than TX_BLOCK_BYTES
+  uint32_t bytes_sent;
+  uint32_t queued_bytes;              // Bytes waiting, queued or in the transmit block
+  uint32_t max_queued_bytes;          // High-water mark of queued_bytes
+  uint32_t queued_frames;             // Frames waiting in the queue
+  uint32_t max_queued_frames;         // High-water mark of queued_frames
+} TxQueueStats;
+
+typedef struct {
+  TxQueueWrite write;
+  void *ctx;
+  TxQueuePolicy policy;
+  uint32_t short_block_hold_us;       // Time a partial block waits for more data before it is sent
+  TxQueueClock clock;                 // Clock for block_timeout_us, NULL to block without a timeout
+  uint32_t block_timeout_us;          // Longest time a TX_BLOCK frame waits for room
+
+  uint8_t ring[TX_QUEUE_BYTES];       // Queued frames, each preceded by its 16-bit length
+  uint32_t head, tail;                // Free running byte positions in ring
+  uint32_t num_frames;
+
+  // Frames taken from the queue, sent TX_BLOCK_BYTES at a time
+  uint8_t block[TX_BLOCK_BYTES + TX_MAX_FRAME_BYTES];
+  unsigned int block_length;
+  unsigned int block_sent;
+  uint32_t short_since_us;            // When the partial block was first held back
+  uint8_t short_held;
+
+  TxQueueStats stats;
+} TxQueue;
+
+/**
+* This function initializes a transmit queue. Partial blocks are held for TX_SHORT_BLOCK_HOLD_US, and TX_BLOCK
+* frames wait for room without a timeout until setTxQueueBlockTimeout is called.
+*
+* Parameters
+* txq:    A pointer to a TxQueue structure
+* write:  The non-blocking write function of the transmitter
+* ctx:    Passed to write
+* policy: What to do with a frame that does not fit
+*
+* Return Value
+* None
+*/
+void initTxQueue(TxQueue *txq, TxQueueWrite write, void *ctx, const TxQueuePolicy policy);
+
+/**
+* This function limits how long a TX_BLOCK frame waits for the transmitter to make room. A frame that still does
+* not fit after the timeout is dropped and counted in frames_dropped and block_timeouts.
+*
+* Parameters
+* txq:        A pointer to the TxQueue
+* clock:      Clock for the timeout. NULL waits until there is room
+* timeout_us: Longest time to wait for room
+*
+* Return Value
+* None
+*/
+void setTxQueueBlockTimeout(TxQueue *txq, TxQueueClock clock, const uint32_t timeout_us);
+
+/**
+* This function queues a frame for transmission.
+*
+* Parameters
+* txq:    A pointer to the TxQueue
+* data:   The frame bytes
+* length: Number of bytes
+*
+* Return Value
+* 0 if the frame was queued, -1 if it was dropped
+*/
+int txQueuePush(TxQueue *txq, const uint8_t *data, const unsigned int length);
+
+/**
+* This function queues a frame for transmission with the given policy instead of the policy of the queue, e.g.
+* TX_BLOCK for data that must not be dropped.
+*
+* Parameters
+* txq:    A pointer to the TxQueue
+* data:   The frame bytes
+* length: Number of bytes
+* policy: What to do if the frame does not fit
+*
+* Return Value
+* 0 if the frame was queued, -1 if it was dropped
+*/
+int txQueuePushWithPolicy(TxQueue *txq, const uint8_t *data, const unsigned int length, const TxQueuePolicy policy);
+
+/**
+* This function writes as much queued data as the transmitter accepts without blocking. Call it from the main loop.
+*
+* Parameters
+* txq:    A pointer to the TxQueue
+* now_us: Current time in microseconds, to release partial blocks held for short_block_hold_us
+*
+* Return Value
+* Number of bytes still waiting
+*/
+unsigned int txQueuePump(TxQueue *txq, const uint32_t now_us);
+
+/**
+* This function pumps until all queued data is written, including a partial block, or until the timeout expires.
+* Data left over stays queued for the next pump.
+*
+* Parameters
+* txq:        A pointer to the TxQueue
+* now_us:     Clock for the timeout. NULL waits until everything is written
+* timeout_us: Longest time to wait for the transmitter
+*
+* Return Value
+* Number of bytes still waiting, 0 if everything was written
+*/
+unsigned int txQueueFlush(TxQueue *txq, TxQueueClock now_us, const uint32_t timeout_us);
+
+/**
+* This function drops all frames still waiting in the queue, e.g. what a flush left over from a message that is
+* useless when incomplete. They are counted in frames_dropped. Frames already moved to the transmit block are
+* still sent.
+*
+* Parameters
+* txq: A pointer to the TxQueue
+*
+* Return Value
+* Number of frames dropped
+*/
+unsigned int txQueueDiscard(TxQueue *txq);
+
+/**
+* This function obtains the transmit queue counters.
+*
+* Parameters
+* txq:   A pointer to the TxQueue
+* stats: A pointer to a TxQueueStats structure
+*
+* Return Value
+* None
+*/
+void getTxQueueStats(const TxQueue *txq, TxQueueStats *stats);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif